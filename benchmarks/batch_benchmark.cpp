@@ -0,0 +1,170 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Round trip of the control frame of the traffic manager over a loopback RPC
+// server, sent as a regular batch, as a packed batch followed by a regular
+// batch with the commands that cannot be packed, and as a single packed
+// batch carrying them, against the number of vehicles.
+//
+// Usage: batch_benchmark [frames] [port] [vehicles...]
+
+#include "carla/MsgPack.h"
+#include "carla/StopWatch.h"
+#include "carla/rpc/Client.h"
+#include "carla/rpc/Command.h"
+#include "carla/rpc/CommandResponse.h"
+#include "carla/rpc/PackedCommandBatch.h"
+#include "carla/rpc/Server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using carla::rpc::Command;
+using carla::rpc::CommandResponse;
+using carla::rpc::PackedCommandBatch;
+
+/// One vehicle out of this many changes its lights in a frame, the traffic
+/// manager sends a SetVehicleLightState command for it.
+static constexpr size_t LIGHT_STATE_PERIOD = 10u;
+
+static constexpr size_t WARM_UP_FRAMES = 10u;
+
+/// Counts the commands received, as the server applies them.
+static std::atomic_size_t received{0u};
+
+static std::vector<Command> MakeControlFrame(const size_t vehicles, const size_t frame) {
+  std::vector<Command> commands;
+  commands.reserve(vehicles + vehicles / LIGHT_STATE_PERIOD + 1u);
+  for (size_t i = 0u; i < vehicles; ++i) {
+    carla::rpc::VehicleControl control;
+    control.throttle = 0.5f;
+    control.steer = static_cast<float>(i % 100u) / 100.0f - 0.5f;
+    commands.emplace_back(Command::ApplyVehicleControl{static_cast<carla::rpc::ActorId>(i + 1u), control});
+  }
+  for (size_t i = frame % LIGHT_STATE_PERIOD; i < vehicles; i += LIGHT_STATE_PERIOD) {
+    commands.emplace_back(Command::SetVehicleLightState{static_cast<carla::rpc::ActorId>(i + 1u), 1u});
+  }
+  return commands;
+}
+
+template <typename T>
+static size_t EncodedSize(const T &value) {
+  clmdep_msgpack::sbuffer buffer;
+  clmdep_msgpack::pack(buffer, value);
+  return buffer.size();
+}
+
+static size_t PackedSize(const std::vector<Command> &control_frame) {
+  PackedCommandBatch batch;
+  for (const auto &command : control_frame) {
+    batch.Append(command);
+  }
+  return EncodedSize(batch);
+}
+
+/// Sends @a frames control frames with @a send, returns the time per frame in
+/// microseconds.
+template <typename SendT>
+static double Run(const size_t vehicles, const size_t frames, SendT &&send) {
+  std::vector<std::vector<Command>> control_frames;
+  for (size_t i = 0u; i < LIGHT_STATE_PERIOD; ++i) {
+    control_frames.emplace_back(MakeControlFrame(vehicles, i));
+  }
+  for (size_t i = 0u; i < WARM_UP_FRAMES; ++i) {
+    send(control_frames[i % control_frames.size()]);
+  }
+
+  received = 0u;
+  size_t expected = 0u;
+  carla::StopWatch stop_watch;
+  for (size_t i = 0u; i < frames; ++i) {
+    const auto &control_frame = control_frames[i % control_frames.size()];
+    send(control_frame);
+    expected += control_frame.size();
+  }
+  stop_watch.Stop();
+  if (received != expected) {
+    std::fprintf(stderr, "unexpected number of commands: %zu of %zu\n", received.load(), expected);
+  }
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) /
+      static_cast<double>(std::max<size_t>(frames, 1u));
+}
+
+int main(int argc, char *argv[]) {
+  const size_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000u;
+  const uint16_t port = argc > 2 ? static_cast<uint16_t>(std::atoi(argv[2])) : 2700u;
+  std::vector<size_t> vehicle_counts;
+  for (int i = 3; i < argc; ++i) {
+    vehicle_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (vehicle_counts.empty()) {
+    vehicle_counts = {10u, 100u, 500u, 2000u};
+  }
+
+  // Same bindings as the simulator, only counting the commands.
+  carla::rpc::Server server(port);
+  server.BindAsync("apply_batch", [](std::vector<Command> commands, bool) {
+    std::vector<CommandResponse> responses;
+    responses.reserve(commands.size());
+    for (size_t i = 0u; i < commands.size(); ++i) {
+      responses.emplace_back(CommandResponse(0u));
+    }
+    received += commands.size();
+    return responses;
+  });
+  server.BindAsync("apply_packed_batch", [](PackedCommandBatch batch, bool) {
+    batch.ForEach([](const auto &) { ++received; });
+  });
+  server.AsyncRun(1u);
+
+  carla::rpc::Client client("127.0.0.1", port);
+
+  const auto batch = [&](const std::vector<Command> &control_frame) {
+    client.call("apply_batch", control_frame, false);
+  };
+  PackedCommandBatch packed;
+  std::vector<Command> unpacked;
+  const auto two_calls = [&](const std::vector<Command> &control_frame) {
+    packed.clear();
+    unpacked.clear();
+    for (const auto &command : control_frame) {
+      if (!packed.TryAdd(command)) {
+        unpacked.emplace_back(command);
+      }
+    }
+    client.call("apply_packed_batch", packed, false);
+    if (!unpacked.empty()) {
+      client.call("apply_batch", unpacked, false);
+    }
+  };
+  const auto one_call = [&](const std::vector<Command> &control_frame) {
+    packed.clear();
+    for (const auto &command : control_frame) {
+      packed.Append(command);
+    }
+    client.call("apply_packed_batch", packed, false);
+  };
+
+  std::printf("%zu frames, a light state change every %zu vehicles\n", frames, LIGHT_STATE_PERIOD);
+  std::printf("%10s %12s %18s %12s %10s %10s\n",
+      "vehicles", "batch us", "packed+batch us", "packed us", "batch B", "packed B");
+  for (const size_t vehicles : vehicle_counts) {
+    const double batch_us = Run(vehicles, frames, batch);
+    const double two_calls_us = Run(vehicles, frames, two_calls);
+    const double one_call_us = Run(vehicles, frames, one_call);
+    const auto control_frame = MakeControlFrame(vehicles, 0u);
+    std::printf("%10zu %12.1f %18.1f %12.1f %10zu %10zu\n",
+        vehicles, batch_us, two_calls_us, one_call_us,
+        EncodedSize(control_frame), PackedSize(control_frame));
+  }
+
+  server.Stop();
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Cost of calling the callbacks of a CallbackList, as done on every tick, and
+// of registering and removing one, against the number of callbacks.
+//
+// Usage: callback_benchmark [calls] [callbacks...]
+
+#include "carla/StopWatch.h"
+#include "carla/client/detail/CallbackList.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/// Stands for the shared pointer to the episode state passed to the tick
+/// callbacks.
+using State = std::shared_ptr<const size_t>;
+
+using List = carla::client::detail::CallbackList<State>;
+
+struct Result {
+  double call_ns = 0.0;
+  double push_remove_ns = 0.0;
+};
+
+static Result Run(const size_t callbacks, const size_t calls) {
+  List list;
+  std::atomic_size_t sum{0u};
+  for (size_t i = 0u; i < callbacks; ++i) {
+    list.Push([&sum](const State &state) {
+      sum.fetch_add(*state, std::memory_order_relaxed);
+    });
+  }
+
+  Result result;
+  const auto state = std::make_shared<const size_t>(1u);
+  {
+    carla::StopWatch stop_watch;
+    for (size_t i = 0u; i < calls; ++i) {
+      list.Call(state);
+    }
+    stop_watch.Stop();
+    result.call_ns = static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>()) /
+        static_cast<double>(std::max<size_t>(calls, 1u));
+  }
+  if (sum != callbacks * calls) {
+    std::fprintf(stderr, "unexpected number of calls: %zu\n", sum.load());
+  }
+  {
+    carla::StopWatch stop_watch;
+    for (size_t i = 0u; i < calls; ++i) {
+      list.Remove(list.Push([](const State &) {}));
+    }
+    stop_watch.Stop();
+    result.push_remove_ns = static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>()) /
+        static_cast<double>(std::max<size_t>(calls, 1u));
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000u;
+  std::vector<size_t> callback_counts;
+  for (int i = 2; i < argc; ++i) {
+    callback_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (callback_counts.empty()) {
+    callback_counts = {1u, 10u, 100u, 1000u};
+  }
+
+  std::printf("%zu calls\n", calls);
+  std::printf("%10s %12s %18s\n", "callbacks", "Call ns", "Push+Remove ns");
+  for (const size_t callbacks : callback_counts) {
+    const auto result = Run(callbacks, calls);
+    std::printf("%10zu %12.1f %18.1f\n", callbacks, result.call_ns, result.push_remove_ns);
+  }
+  return 0;
+}
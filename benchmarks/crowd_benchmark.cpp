@@ -0,0 +1,144 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Step time of the walker crowd against the number of walkers, with a single
+// crowd and with the crowd split into regions.
+//
+// Usage: crowd_benchmark <navmesh.bin> [region_size] [steps] [max_agents_per_region] [agents...]
+//
+// The navigation mesh is the binary the server sends to the client, the ones
+// of the maps are in the Nav folder of the CARLA package.
+
+#include "carla/JobSystem.h"
+#include "carla/StopWatch.h"
+#include "carla/nav/Navigation.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace nav = carla::nav;
+
+static constexpr double DELTA_SECONDS = 0.05;
+
+static constexpr unsigned int SEED = 42u;
+
+static constexpr size_t WARM_UP_STEPS = 10u;
+
+struct Result {
+  size_t crowds = 0u;
+  size_t walkers = 0u;
+  double mean_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+static bool RunCrowd(
+    const std::vector<uint8_t> &navmesh,
+    const nav::CrowdSettings &settings,
+    const size_t agents,
+    const size_t steps,
+    Result &result) {
+  nav::Navigation navigation;
+  navigation.SetSeed(SEED);
+  if (!navigation.SetCrowdSettings(settings) || !navigation.Load(navmesh)) {
+    return false;
+  }
+
+  // same spawn points and targets for every configuration
+  result.walkers = 0u;
+  for (size_t i = 0u; i < agents; ++i) {
+    const auto id = static_cast<carla::ActorId>(i + 1u);
+    carla::geom::Location from;
+    carla::geom::Location to;
+    if (!navigation.GetRandomLocation(from) || !navigation.GetRandomLocation(to)) {
+      continue;
+    }
+    if (navigation.AddWalker(id, from) && navigation.SetWalkerTarget(id, to)) {
+      ++result.walkers;
+    }
+  }
+  result.crowds = navigation.GetCrowdCount();
+
+  for (size_t i = 0u; i < WARM_UP_STEPS; ++i) {
+    navigation.UpdateCrowd(DELTA_SECONDS);
+  }
+
+  double total_ms = 0.0;
+  result.max_ms = 0.0;
+  for (size_t i = 0u; i < steps; ++i) {
+    carla::StopWatch stop_watch;
+    navigation.UpdateCrowd(DELTA_SECONDS);
+    stop_watch.Stop();
+    const double ms = static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+    total_ms += ms;
+    result.max_ms = std::max(result.max_ms, ms);
+  }
+  result.mean_ms = total_ms / static_cast<double>(std::max<size_t>(steps, 1u));
+  return true;
+}
+
+static void PrintResult(const char *name, const size_t agents, const Result &result) {
+  std::printf("%8zu %-8s %6zu %8zu %10.3f %10.3f\n",
+      agents, name, result.crowds, result.walkers, result.mean_ms, result.max_ms);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr,
+        "usage: %s <navmesh.bin> [region_size=100] [steps=200] [max_agents_per_region=500] [agents...]\n",
+        argv[0]);
+    return 1;
+  }
+
+  std::vector<uint8_t> navmesh;
+  {
+    std::ifstream file(argv[1], std::ios::binary);
+    navmesh.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  if (navmesh.empty()) {
+    std::fprintf(stderr, "failed to read navigation mesh %s\n", argv[1]);
+    return 1;
+  }
+
+  const float region_size = argc > 2 ? std::strtof(argv[2], nullptr) : 100.0f;
+  const size_t steps = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200u;
+  const int max_agents_per_region = argc > 4 ? std::atoi(argv[4]) : 500;
+  std::vector<size_t> agent_counts;
+  for (int i = 5; i < argc; ++i) {
+    agent_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (agent_counts.empty()) {
+    agent_counts = {100u, 250u, 500u, 1000u, 2000u};
+  }
+
+  std::printf("job system workers: %zu, region size: %.1f m, %zu steps of %.3f s\n",
+      carla::JobSystem::Get().GetWorkerCount(), region_size, steps, DELTA_SECONDS);
+  std::printf("%8s %-8s %6s %8s %10s %10s\n", "agents", "mode", "crowds", "walkers", "mean ms", "max ms");
+
+  for (const size_t agents : agent_counts) {
+    Result result;
+
+    nav::CrowdSettings single;
+    single.max_agents_per_crowd = static_cast<int>(std::max<size_t>(agents, 1u));
+    single.region_size = 0.0f;
+    if (!RunCrowd(navmesh, single, agents, steps, result)) {
+      std::fprintf(stderr, "failed to load navigation mesh %s\n", argv[1]);
+      return 1;
+    }
+    PrintResult("single", agents, result);
+
+    nav::CrowdSettings regional;
+    regional.max_agents_per_crowd = max_agents_per_region;
+    regional.region_size = region_size;
+    if (RunCrowd(navmesh, regional, agents, steps, result)) {
+      PrintResult("regional", agents, result);
+    }
+  }
+  return 0;
+}
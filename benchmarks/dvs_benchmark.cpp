@@ -0,0 +1,213 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of the DVS event kernels against a serial loop over the events, and
+// number of elements that differ, against the number of events.
+//
+// Usage: dvs_benchmark [runs] [events...]
+
+#include "carla/StopWatch.h"
+#include "carla/sensor/data/DVSEventKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace csd = carla::sensor::data;
+
+using csd::DVSEvent;
+using csd::DVSEventKernels;
+
+static constexpr size_t WIDTH = 1280u;
+
+static constexpr size_t HEIGHT = 720u;
+
+static constexpr size_t BINS = 5u;
+
+static constexpr float DECAY_TIME = 1e5f;
+
+struct Timing {
+  double serial_ms = 1e30;
+  double kernel_ms = 1e30;
+  size_t mismatches = 0u;
+};
+
+/// Events in order of time, a few of them outside the image.
+static std::vector<DVSEvent> MakeEvents(const size_t count) {
+  std::mt19937 rng(42u);
+  std::vector<DVSEvent> events;
+  events.reserve(count);
+  for (size_t i = 0u; i < count; ++i) {
+    events.emplace_back(
+        static_cast<uint16_t>(rng() % (WIDTH + 3u)),
+        static_cast<uint16_t>(rng() % HEIGHT),
+        static_cast<int64_t>(1000u + i * 7u + rng() % 5u),
+        (rng() & 1u) != 0u);
+  }
+  return events;
+}
+
+static bool IsInside(const DVSEvent &event) {
+  return (event.x < WIDTH) && (event.y < HEIGHT);
+}
+
+/// Times @a serial and @a kernel, keeping the best of @a runs, and counts
+/// the elements of their outputs that differ.
+template <typename T, typename SerialT, typename KernelT>
+static Timing Run(const size_t runs, const size_t size, SerialT &&serial, KernelT &&kernel) {
+  std::vector<T> expected(size);
+  std::vector<T> result(size);
+  Timing timing;
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    serial(expected.data());
+    stop_watch.Stop();
+    timing.serial_ms = std::min(timing.serial_ms,
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0);
+  }
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    kernel(result.data());
+    stop_watch.Stop();
+    timing.kernel_ms = std::min(timing.kernel_ms,
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0);
+  }
+  for (size_t i = 0u; i < size; ++i) {
+    if (std::memcmp(&expected[i], &result[i], sizeof(T)) != 0) {
+      ++timing.mismatches;
+    }
+  }
+  return timing;
+}
+
+static void Print(const char *name, const size_t count, const Timing &timing) {
+  std::printf("%-12s %10zu %12.3f %12.3f %8.1fx %10zu\n",
+      name,
+      count,
+      timing.serial_ms,
+      timing.kernel_ms,
+      timing.serial_ms / std::max(timing.kernel_ms, 1e-9),
+      timing.mismatches);
+}
+
+static void Benchmark(const std::vector<DVSEvent> &events, const size_t runs) {
+  const DVSEvent *data = events.data();
+  const size_t count = events.size();
+  const size_t pixels = WIDTH * HEIGHT;
+
+  int64_t min_time = std::numeric_limits<int64_t>::max();
+  int64_t max_time = std::numeric_limits<int64_t>::min();
+  for (const auto &event : events) {
+    if (IsInside(event)) {
+      min_time = std::min(min_time, event.t);
+      max_time = std::max(max_time, event.t);
+    }
+  }
+
+  Print("columns", count, Run<int64_t>(runs, count,
+      [&](int64_t *t) {
+        for (size_t i = 0u; i < count; ++i) {
+          t[i] = data[i].t;
+        }
+      },
+      [&](int64_t *t) {
+        DVSEventKernels::ToColumns(data, count, nullptr, nullptr, t, nullptr);
+      }));
+
+  Print("image", count, Run<csd::Color>(runs, pixels,
+      [&](csd::Color *image) {
+        std::fill(image, image + pixels, csd::Color(0u, 0u, 0u, 0u));
+        for (size_t i = 0u; i < count; ++i) {
+          if (IsInside(data[i])) {
+            auto &pixel = image[WIDTH * data[i].y + data[i].x];
+            (data[i].pol ? pixel.b : pixel.r) = 255u;
+          }
+        }
+      },
+      [&](csd::Color *image) {
+        DVSEventKernels::ToImage(data, count, WIDTH, HEIGHT, image);
+      }));
+
+  Print("event frame", count, Run<int32_t>(runs, pixels,
+      [&](int32_t *frame) {
+        std::fill(frame, frame + pixels, 0);
+        for (size_t i = 0u; i < count; ++i) {
+          if (IsInside(data[i])) {
+            frame[WIDTH * data[i].y + data[i].x] += data[i].pol ? 1 : -1;
+          }
+        }
+      },
+      [&](int32_t *frame) {
+        DVSEventKernels::ToEventFrame(data, count, WIDTH, HEIGHT, frame);
+      }));
+
+  Print("time surface", count, Run<float>(runs, pixels,
+      [&](float *surface) {
+        std::vector<int64_t> latest(pixels, std::numeric_limits<int64_t>::min());
+        for (size_t i = 0u; i < count; ++i) {
+          if (IsInside(data[i])) {
+            latest[WIDTH * data[i].y + data[i].x] = data[i].t;
+          }
+        }
+        for (size_t i = 0u; i < pixels; ++i) {
+          surface[i] = latest[i] == std::numeric_limits<int64_t>::min() ?
+              0.0f :
+              std::exp(static_cast<float>(latest[i] - max_time) / DECAY_TIME);
+        }
+      },
+      [&](float *surface) {
+        DVSEventKernels::ToTimeSurface(data, count, WIDTH, HEIGHT, max_time, DECAY_TIME, surface);
+      }));
+
+  Print("voxel grid", count, Run<float>(runs, BINS * pixels,
+      [&](float *grid) {
+        std::fill(grid, grid + BINS * pixels, 0.0f);
+        const double scale = max_time > min_time ?
+            static_cast<double>(BINS - 1u) / static_cast<double>(max_time - min_time) :
+            0.0;
+        for (size_t i = 0u; i < count; ++i) {
+          if (!IsInside(data[i])) {
+            continue;
+          }
+          const size_t pixel = WIDTH * data[i].y + data[i].x;
+          const double time = scale * static_cast<double>(data[i].t - min_time);
+          const size_t bin = std::min(static_cast<size_t>(time), BINS - 1u);
+          const float weight = static_cast<float>(time - static_cast<double>(bin));
+          const float polarity = data[i].pol ? 1.0f : -1.0f;
+          grid[bin * pixels + pixel] += polarity * (1.0f - weight);
+          if (bin + 1u < BINS) {
+            grid[(bin + 1u) * pixels + pixel] += polarity * weight;
+          }
+        }
+      },
+      [&](float *grid) {
+        DVSEventKernels::ToVoxelGrid(data, count, WIDTH, HEIGHT, BINS, grid);
+      }));
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  std::vector<size_t> event_counts;
+  for (int i = 2; i < argc; ++i) {
+    event_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (event_counts.empty()) {
+    event_counts = {10000u, 300000u, 3000000u};
+  }
+
+  std::printf("best of %zu runs, %zux%zu pixels, %zu bins\n", runs, WIDTH, HEIGHT, BINS);
+  std::printf("%-12s %10s %12s %12s %9s %10s\n",
+      "kernel", "events", "serial ms", "kernel ms", "speedup", "mismatches");
+  for (const size_t count : event_counts) {
+    Benchmark(MakeEvents(count), runs);
+  }
+  return 0;
+}
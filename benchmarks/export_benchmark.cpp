@@ -0,0 +1,229 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of Mesh::WritePLY and Mesh::WriteGLB against a writer that appends
+// the same binary data one byte at a time, and number of bytes that differ,
+// against the number of vertices. Mesh::WriteOBJ is timed for reference.
+//
+// Usage: export_benchmark [runs] [vertices...]
+
+#include "carla/StopWatch.h"
+#include "carla/geom/Mesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cg = carla::geom;
+
+/// Number of triangles per vertex, as in a regular grid.
+static constexpr size_t TRIANGLES_PER_VERTEX = 2u;
+
+struct Timing {
+  double reference_ms = 1e30;
+  double writer_ms = 1e30;
+  size_t bytes = 0u;
+  size_t mismatches = 0u;
+};
+
+static cg::Mesh MakeMesh(const size_t vertices) {
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+  cg::Mesh mesh;
+  for (size_t i = 0u; i < vertices; ++i) {
+    mesh.AddVertex({value(rng), value(rng), value(rng)});
+    mesh.AddNormal({value(rng), value(rng), value(rng)});
+    mesh.AddUV({value(rng), value(rng)});
+  }
+  for (size_t i = 0u; i < TRIANGLES_PER_VERTEX * vertices; ++i) {
+    for (size_t k = 0u; k < 3u; ++k) {
+      mesh.AddIndex(1u + rng() % vertices);
+    }
+  }
+  return mesh;
+}
+
+/// Binary data written one byte at a time into a buffer.
+class ByteWriter {
+public:
+
+  void WriteUInt32(uint32_t value) {
+    for (auto i = 0u; i < 4u; ++i) {
+      _bytes.push_back(static_cast<char>(value >> (8u * i)));
+    }
+  }
+
+  void WriteFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUInt32(bits);
+  }
+
+  void WriteUInt8(uint8_t value) {
+    _bytes.push_back(static_cast<char>(value));
+  }
+
+  const std::string &GetBytes() const {
+    return _bytes;
+  }
+
+private:
+
+  std::string _bytes;
+};
+
+/// Vertices and faces of the PLY file, without the header.
+static std::string ReferencePLY(const cg::Mesh &mesh) {
+  ByteWriter writer;
+  const auto &vertices = mesh.GetVertices();
+  const auto &normals = mesh.GetNormals();
+  const auto &uvs = mesh.GetUVs();
+  const auto &indexes = mesh.GetIndexes();
+  for (size_t i = 0u; i < vertices.size(); ++i) {
+    writer.WriteFloat(vertices[i].x);
+    writer.WriteFloat(vertices[i].y);
+    writer.WriteFloat(vertices[i].z);
+    writer.WriteFloat(normals[i].x);
+    writer.WriteFloat(normals[i].y);
+    writer.WriteFloat(normals[i].z);
+    writer.WriteFloat(uvs[i].x);
+    writer.WriteFloat(uvs[i].y);
+  }
+  for (size_t i = 0u; i < indexes.size(); i += 3u) {
+    writer.WriteUInt8(3u);
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i] - 1u));
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i + 1u] - 1u));
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i + 2u] - 1u));
+  }
+  return writer.GetBytes();
+}
+
+/// Data of the BIN chunk of the GLB file.
+static std::string ReferenceGLB(const cg::Mesh &mesh) {
+  ByteWriter writer;
+  const auto &indexes = mesh.GetIndexes();
+  for (const auto &v : mesh.GetVertices()) {
+    writer.WriteFloat(v.x);
+    writer.WriteFloat(v.z);
+    writer.WriteFloat(v.y);
+  }
+  for (const auto &n : mesh.GetNormals()) {
+    writer.WriteFloat(n.x);
+    writer.WriteFloat(n.z);
+    writer.WriteFloat(n.y);
+  }
+  for (const auto &uv : mesh.GetUVs()) {
+    writer.WriteFloat(uv.x);
+    writer.WriteFloat(uv.y);
+  }
+  for (size_t i = 0u; i < indexes.size(); i += 3u) {
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i] - 1u));
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i + 2u] - 1u));
+    writer.WriteUInt32(static_cast<uint32_t>(indexes[i + 1u] - 1u));
+  }
+  return writer.GetBytes();
+}
+
+static double ElapsedMs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+}
+
+/// Compares @a expected with the end of @a file, after its header.
+static size_t CountMismatches(const std::string &expected, const std::string &file) {
+  if (file.size() < expected.size()) {
+    return expected.size();
+  }
+  const char *data = file.data() + (file.size() - expected.size());
+  size_t mismatches = 0u;
+  for (size_t i = 0u; i < expected.size(); ++i) {
+    mismatches += expected[i] != data[i] ? 1u : 0u;
+  }
+  return mismatches;
+}
+
+template <typename ReferenceT, typename WriterT>
+static Timing Run(const size_t runs, ReferenceT &&reference, WriterT &&writer) {
+  Timing timing;
+  std::string expected;
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    expected = reference();
+    stop_watch.Stop();
+    timing.reference_ms = std::min(timing.reference_ms, ElapsedMs(stop_watch));
+  }
+  std::string file;
+  for (size_t i = 0u; i < runs; ++i) {
+    std::ostringstream out(std::ios::binary);
+    carla::StopWatch stop_watch;
+    writer(out);
+    stop_watch.Stop();
+    timing.writer_ms = std::min(timing.writer_ms, ElapsedMs(stop_watch));
+    file = out.str();
+  }
+  timing.bytes = file.size();
+  timing.mismatches = CountMismatches(expected, file);
+  return timing;
+}
+
+static void Print(const char *name, const size_t vertices, const Timing &timing) {
+  std::printf("%-6s %10zu %10.1f %14.3f %12.3f %8.1fx %10zu\n",
+      name,
+      vertices,
+      static_cast<double>(timing.bytes) / 1e6,
+      timing.reference_ms,
+      timing.writer_ms,
+      timing.reference_ms / std::max(timing.writer_ms, 1e-9),
+      timing.mismatches);
+}
+
+static void Benchmark(const size_t vertices, const size_t runs) {
+  const auto mesh = MakeMesh(vertices);
+
+  Print("PLY", vertices, Run(runs,
+      [&]() { return ReferencePLY(mesh); },
+      [&](std::ostream &out) { mesh.WritePLY(out); }));
+
+  Print("GLB", vertices, Run(runs,
+      [&]() { return ReferenceGLB(mesh); },
+      [&](std::ostream &out) { mesh.WriteGLB(out); }));
+
+  // No binary reference, the text format is only timed.
+  Timing obj;
+  for (size_t i = 0u; i < runs; ++i) {
+    std::ostringstream out;
+    carla::StopWatch stop_watch;
+    mesh.WriteOBJ(out);
+    stop_watch.Stop();
+    obj.writer_ms = std::min(obj.writer_ms, ElapsedMs(stop_watch));
+    obj.bytes = static_cast<size_t>(out.tellp());
+  }
+  std::printf("%-6s %10zu %10.1f %14s %12.3f %9s %10s\n",
+      "OBJ", vertices, static_cast<double>(obj.bytes) / 1e6, "-", obj.writer_ms, "-", "-");
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  std::vector<size_t> vertex_counts;
+  for (int i = 2; i < argc; ++i) {
+    vertex_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (vertex_counts.empty()) {
+    vertex_counts = {10000u, 100000u, 1000000u};
+  }
+
+  std::printf("best of %zu runs, %zu triangles per vertex\n", runs, TRIANGLES_PER_VERTEX);
+  std::printf("%-6s %10s %10s %14s %12s %9s %10s\n",
+      "format", "vertices", "MB", "reference ms", "writer ms", "speedup", "mismatches");
+  for (const size_t vertices : vertex_counts) {
+    Benchmark(vertices, runs);
+  }
+  return 0;
+}
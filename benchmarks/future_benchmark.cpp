@@ -0,0 +1,119 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Cost of RecurrentSharedFuture::SetValue and time until every waiting thread
+// has the value, against the number of waiting threads.
+//
+// Usage: future_benchmark [rounds] [waiters...]
+
+#include "carla/RecurrentSharedFuture.h"
+#include "carla/StopWatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// Stands for an episode state, big enough to make a copy noticeable.
+struct State {
+  size_t round = 0u;
+  std::shared_ptr<const std::vector<double>> data;
+};
+
+/// Time a round waits for every thread before setting the value again, a
+/// thread may not be waiting yet when the value is set.
+static constexpr size_t RETRY_MICROSECONDS = 1000u;
+
+struct Result {
+  double set_value_us = 0.0;
+  double round_us = 0.0;
+  size_t retries = 0u;
+};
+
+static Result Run(const size_t waiters, const size_t rounds) {
+  carla::RecurrentSharedFuture<State> future;
+  std::atomic_size_t received{0u};
+  std::atomic_bool stop{false};
+
+  std::vector<std::thread> threads;
+  threads.reserve(waiters);
+  for (size_t i = 0u; i < waiters; ++i) {
+    threads.emplace_back([&]() {
+      size_t last_round = 0u;
+      while (!stop) {
+        auto state = future.WaitFor(carla::time_duration::milliseconds(10u));
+        if (state.has_value() && (state->round > last_round)) {
+          last_round = state->round;
+          ++received;
+        }
+      }
+    });
+  }
+
+  State state;
+  state.data = std::make_shared<std::vector<double>>(1024u, 1.0);
+
+  Result result;
+  double set_value_us = 0.0;
+  double round_us = 0.0;
+  size_t set_value_count = 0u;
+  for (size_t round = 1u; round <= rounds; ++round) {
+    state.round = round;
+    const size_t expected = round * waiters;
+    carla::StopWatch round_watch;
+    while (true) {
+      carla::StopWatch set_value_watch;
+      future.SetValue(state);
+      set_value_watch.Stop();
+      set_value_us += static_cast<double>(set_value_watch.GetElapsedTime<std::chrono::nanoseconds>()) / 1000.0;
+      ++set_value_count;
+
+      carla::StopWatch retry_watch;
+      while ((received < expected) &&
+             (retry_watch.GetElapsedTime<std::chrono::microseconds>() < RETRY_MICROSECONDS)) {
+        std::this_thread::yield();
+      }
+      if (received >= expected) {
+        break;
+      }
+      ++result.retries;
+    }
+    round_watch.Stop();
+    round_us += static_cast<double>(round_watch.GetElapsedTime<std::chrono::nanoseconds>()) / 1000.0;
+  }
+
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  result.set_value_us = set_value_us / static_cast<double>(std::max<size_t>(set_value_count, 1u));
+  result.round_us = round_us / static_cast<double>(std::max<size_t>(rounds, 1u));
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000u;
+  std::vector<size_t> waiter_counts;
+  for (int i = 2; i < argc; ++i) {
+    waiter_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (waiter_counts.empty()) {
+    waiter_counts = {1u, 2u, 4u, 8u, 16u, 32u, 64u};
+  }
+
+  std::printf("%zu rounds, hardware threads: %u\n", rounds, std::thread::hardware_concurrency());
+  std::printf("%8s %14s %14s %8s\n", "waiters", "SetValue us", "all woken us", "retries");
+  for (const size_t waiters : waiter_counts) {
+    const auto result = Run(waiters, rounds);
+    std::printf("%8zu %14.3f %14.3f %8zu\n",
+        waiters, result.set_value_us, result.round_us, result.retries);
+  }
+  return 0;
+}
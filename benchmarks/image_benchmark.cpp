@@ -0,0 +1,124 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time per megapixel of the bulk color conversions of ImageKernels against
+// ImageConverter::ConvertInPlace, and number of pixels that differ, against
+// the size of the image.
+//
+// Usage: image_benchmark [runs] [megapixels...]
+
+#include "carla/StopWatch.h"
+#include "carla/image/ColorConverter.h"
+#include "carla/image/ImageConverter.h"
+#include "carla/image/ImageKernels.h"
+#include "carla/sensor/data/Color.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace ci = carla::image;
+
+using carla::sensor::data::Color;
+
+/// Width of the images, the height is set by the number of megapixels.
+static constexpr size_t WIDTH = 1000u;
+
+struct Result {
+  double reference_ms = 0.0;
+  double kernel_ms = 0.0;
+  size_t mismatches = 0u;
+};
+
+static std::vector<Color> MakePixels(const size_t count) {
+  std::mt19937 rng(42u);
+  std::uniform_int_distribution<int> value(0, 255);
+  std::vector<Color> pixels(count);
+  for (auto &pixel : pixels) {
+    // Labels of the palette are in red, keep most of them valid.
+    pixel = Color(
+        static_cast<uint8_t>(value(rng) % 32),
+        static_cast<uint8_t>(value(rng)),
+        static_cast<uint8_t>(value(rng)),
+        255u);
+  }
+  return pixels;
+}
+
+/// Best of @a runs, in milliseconds per megapixel.
+template <typename ConverterT>
+static Result Run(const std::vector<Color> &pixels, const size_t runs) {
+  const double megapixels = static_cast<double>(pixels.size()) / 1e6;
+  std::vector<Color> reference;
+  std::vector<Color> converted(pixels.size());
+
+  Result result;
+  result.reference_ms = result.kernel_ms = 1e30;
+  for (size_t i = 0u; i < runs; ++i) {
+    reference = pixels;
+    auto view = boost::gil::interleaved_view(
+        WIDTH,
+        reference.size() / WIDTH,
+        reinterpret_cast<boost::gil::bgra8_pixel_t *>(reference.data()),
+        sizeof(Color) * WIDTH);
+    carla::StopWatch stop_watch;
+    ci::ImageConverter::ConvertInPlace(view, ConverterT());
+    stop_watch.Stop();
+    result.reference_ms = std::min(result.reference_ms,
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0 / megapixels);
+  }
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    ci::ImageKernels::Convert(pixels.data(), converted.data(), pixels.size(), ConverterT());
+    stop_watch.Stop();
+    result.kernel_ms = std::min(result.kernel_ms,
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0 / megapixels);
+  }
+  for (size_t i = 0u; i < pixels.size(); ++i) {
+    if (converted[i] != reference[i]) {
+      ++result.mismatches;
+    }
+  }
+  return result;
+}
+
+template <typename ConverterT>
+static void Print(const char *name, const double megapixels, const std::vector<Color> &pixels, const size_t runs) {
+  const auto result = Run<ConverterT>(pixels, runs);
+  std::printf("%-18s %6.1f %16.3f %14.3f %8.1fx %10zu\n",
+      name,
+      megapixels,
+      result.reference_ms,
+      result.kernel_ms,
+      result.reference_ms / std::max(result.kernel_ms, 1e-9),
+      result.mismatches);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10u;
+  std::vector<double> megapixel_counts;
+  for (int i = 2; i < argc; ++i) {
+    megapixel_counts.emplace_back(std::atof(argv[i]));
+  }
+  if (megapixel_counts.empty()) {
+    megapixel_counts = {0.3, 2.0, 8.0};
+  }
+
+  std::printf("best of %zu runs, instruction set: %s\n", runs, ci::ImageKernels::GetInstructionSet());
+  std::printf("%-18s %6s %16s %14s %9s %10s\n",
+      "converter", "MP", "reference ms/MP", "kernel ms/MP", "speedup", "mismatches");
+  for (const double megapixels : megapixel_counts) {
+    const size_t height = std::max<size_t>(1u, static_cast<size_t>(megapixels * 1e6) / WIDTH);
+    const auto pixels = MakePixels(WIDTH * height);
+    const double actual = static_cast<double>(pixels.size()) / 1e6;
+    Print<ci::ColorConverter::Depth>("Depth", actual, pixels, runs);
+    Print<ci::ColorConverter::LogarithmicDepth>("LogarithmicDepth", actual, pixels, runs);
+    Print<ci::ColorConverter::CityScapesPalette>("CityScapesPalette", actual, pixels, runs);
+  }
+  return 0;
+}
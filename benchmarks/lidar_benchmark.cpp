@@ -0,0 +1,234 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of the lidar kernels against a serial implementation of the voxel
+// downsampling and of the range image projection, and of the ground
+// segmentation, against the number of points of a synthetic sweep.
+//
+// Usage: lidar_benchmark [runs] [channels] [points per channel...]
+
+#include "carla/StopWatch.h"
+#include "carla/geom/Math.h"
+#include "carla/pointcloud/LidarKernels.h"
+#include "carla/sensor/data/LidarData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace cp = carla::pointcloud;
+
+using carla::sensor::data::LidarDetection;
+
+static constexpr float VOXEL_SIZE = 0.2f;
+
+static constexpr size_t COLUMNS = 2048u;
+
+/// Height of the ground below the sensor, in meters.
+static constexpr float GROUND_HEIGHT = 2.0f;
+
+struct Timing {
+  double serial_ms = 1e30;
+  double kernel_ms = 1e30;
+  size_t mismatches = 0u;
+};
+
+/// A sweep from +15 to -25 degrees of elevation over flat ground, with a
+/// close obstacle every few points.
+static std::vector<LidarDetection> MakeSweep(const size_t channels, const size_t points_per_channel) {
+  constexpr float pi = carla::geom::Math::Pi<float>();
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<float> jitter(0.0f, 1.0f);
+  std::vector<LidarDetection> points;
+  points.reserve(channels * points_per_channel);
+  for (size_t channel = 0u; channel < channels; ++channel) {
+    const float elevation = (15.0f - 40.0f * static_cast<float>(channel) / static_cast<float>(std::max<size_t>(channels - 1u, 1u))) * pi / 180.0f;
+    for (size_t k = 0u; k < points_per_channel; ++k) {
+      const float azimuth = (static_cast<float>(k) + jitter(rng)) / static_cast<float>(points_per_channel) * 2.0f * pi - pi;
+      float range = elevation < 0.0f ? std::min(80.0f, GROUND_HEIGHT / -std::sin(elevation)) : 50.0f;
+      if (k % 97u == 0u) {
+        range = 5.0f + jitter(rng);
+      }
+      points.emplace_back(
+          range * std::cos(elevation) * std::cos(azimuth),
+          range * std::cos(elevation) * std::sin(azimuth),
+          range * std::sin(elevation),
+          1.0f);
+    }
+  }
+  return points;
+}
+
+static double ElapsedMs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+}
+
+/// Index of the first point of each voxel, in order of first point.
+static std::vector<uint32_t> SerialVoxelDownsample(const std::vector<LidarDetection> &points) {
+  struct Key {
+    int x, y, z;
+    bool operator==(const Key &rhs) const {
+      return (x == rhs.x) && (y == rhs.y) && (z == rhs.z);
+    }
+  };
+  struct Hash {
+    size_t operator()(const Key &key) const {
+      return (static_cast<size_t>(key.x) * 73856093u) ^
+             (static_cast<size_t>(key.y) * 19349663u) ^
+             (static_cast<size_t>(key.z) * 83492791u);
+    }
+  };
+  struct Voxel {
+    double x = 0.0, y = 0.0, z = 0.0;
+    size_t count = 0u;
+  };
+  std::unordered_map<Key, size_t, Hash> voxel_of;
+  std::vector<Voxel> voxels;
+  std::vector<uint32_t> first_indices;
+  const float scale = 1.0f / VOXEL_SIZE;
+  for (size_t i = 0u; i < points.size(); ++i) {
+    const auto &point = points[i].point;
+    const Key key{
+        static_cast<int>(std::floor(point.x * scale)),
+        static_cast<int>(std::floor(point.y * scale)),
+        static_cast<int>(std::floor(point.z * scale))};
+    auto result = voxel_of.emplace(key, voxels.size());
+    if (result.second) {
+      voxels.emplace_back();
+      first_indices.emplace_back(static_cast<uint32_t>(i));
+    }
+    auto &voxel = voxels[result.first->second];
+    voxel.x += point.x;
+    voxel.y += point.y;
+    voxel.z += point.z;
+    ++voxel.count;
+  }
+  return first_indices;
+}
+
+/// Cell of each point, as in RangeImage::point_cell.
+static std::vector<int32_t> SerialProjectToRangeImage(
+    const std::vector<LidarDetection> &points,
+    const size_t points_per_channel) {
+  constexpr float pi = carla::geom::Math::Pi<float>();
+  const float column_scale = static_cast<float>(COLUMNS) / (2.0f * pi);
+  std::vector<int32_t> point_cell(points.size());
+  for (size_t i = 0u; i < points.size(); ++i) {
+    const auto &point = points[i].point;
+    const float position = (std::atan2(point.y, point.x) + pi) * column_scale;
+    const size_t column = std::min(COLUMNS - 1u, static_cast<size_t>(std::max(position, 0.0f)));
+    point_cell[i] = static_cast<int32_t>((i / points_per_channel) * COLUMNS + column);
+  }
+  return point_cell;
+}
+
+static void Print(const char *name, const size_t count, const Timing &timing) {
+  std::printf("%-14s %10zu %12.3f %12.3f %8.1fx %10zu\n",
+      name,
+      count,
+      timing.serial_ms,
+      timing.kernel_ms,
+      timing.serial_ms / std::max(timing.kernel_ms, 1e-9),
+      timing.mismatches);
+}
+
+static void Benchmark(const size_t channels, const size_t points_per_channel, const size_t runs) {
+  const auto points = MakeSweep(channels, points_per_channel);
+  const cp::LidarPointView view(points.data(), points.size());
+  const std::vector<uint32_t> channel_counts(channels, static_cast<uint32_t>(points_per_channel));
+
+  {
+    Timing timing;
+    std::vector<uint32_t> expected;
+    for (size_t i = 0u; i < runs; ++i) {
+      carla::StopWatch stop_watch;
+      expected = SerialVoxelDownsample(points);
+      stop_watch.Stop();
+      timing.serial_ms = std::min(timing.serial_ms, ElapsedMs(stop_watch));
+    }
+    std::vector<carla::geom::Location> centroids;
+    std::vector<uint32_t> first_indices;
+    for (size_t i = 0u; i < runs; ++i) {
+      carla::StopWatch stop_watch;
+      cp::LidarKernels::VoxelDownsample(view, VOXEL_SIZE, centroids, &first_indices);
+      stop_watch.Stop();
+      timing.kernel_ms = std::min(timing.kernel_ms, ElapsedMs(stop_watch));
+    }
+    timing.mismatches = first_indices.size() > expected.size() ?
+        first_indices.size() - expected.size() :
+        expected.size() - first_indices.size();
+    for (size_t i = 0u; i < std::min(first_indices.size(), expected.size()); ++i) {
+      timing.mismatches += first_indices[i] != expected[i] ? 1u : 0u;
+    }
+    Print("voxel grid", points.size(), timing);
+  }
+
+  cp::RangeImage image;
+  {
+    Timing timing;
+    std::vector<int32_t> expected;
+    for (size_t i = 0u; i < runs; ++i) {
+      carla::StopWatch stop_watch;
+      expected = SerialProjectToRangeImage(points, points_per_channel);
+      stop_watch.Stop();
+      timing.serial_ms = std::min(timing.serial_ms, ElapsedMs(stop_watch));
+    }
+    for (size_t i = 0u; i < runs; ++i) {
+      carla::StopWatch stop_watch;
+      cp::LidarKernels::ProjectToRangeImage(view, channel_counts.data(), channels, COLUMNS, image);
+      stop_watch.Stop();
+      timing.kernel_ms = std::min(timing.kernel_ms, ElapsedMs(stop_watch));
+    }
+    for (size_t i = 0u; i < points.size(); ++i) {
+      timing.mismatches += image.point_cell[i] != expected[i] ? 1u : 0u;
+    }
+    Print("range image", points.size(), timing);
+  }
+
+  {
+    // No serial version, mismatches are the points classified against the
+    // flat ground of the sweep.
+    Timing timing;
+    std::vector<uint8_t> is_ground;
+    for (size_t i = 0u; i < runs; ++i) {
+      carla::StopWatch stop_watch;
+      cp::LidarKernels::SegmentGround(view, image, cp::GroundSegmentationOptions(), is_ground);
+      stop_watch.Stop();
+      timing.kernel_ms = std::min(timing.kernel_ms, ElapsedMs(stop_watch));
+    }
+    for (size_t i = 0u; i < points.size(); ++i) {
+      const bool on_ground = std::abs(points[i].point.z + GROUND_HEIGHT) < 0.05f;
+      timing.mismatches += (is_ground[i] != 0u) != on_ground ? 1u : 0u;
+    }
+    std::printf("%-14s %10zu %12s %12.3f %9s %10zu\n",
+        "ground", points.size(), "-", timing.kernel_ms, "-", timing.mismatches);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  const size_t channels = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 128u;
+  std::vector<size_t> point_counts;
+  for (int i = 3; i < argc; ++i) {
+    point_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (point_counts.empty()) {
+    point_counts = {1000u, 4000u, 16000u};
+  }
+
+  std::printf("best of %zu runs, %zu channels, %zu columns, instruction set: %s\n",
+      runs, channels, COLUMNS, cp::LidarKernels::GetInstructionSet());
+  std::printf("%-14s %10s %12s %12s %9s %10s\n",
+      "kernel", "points", "serial ms", "kernel ms", "speedup", "mismatches");
+  for (const size_t points_per_channel : point_counts) {
+    Benchmark(channels, points_per_channel, runs);
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of Mesh::Append, copying and moving the meshes, against adding each
+// mesh with Mesh::operator+=, and number of vertices and indices that
+// differ, against the number of meshes.
+//
+// Usage: mesh_benchmark [runs] [vertices per mesh] [meshes...]
+
+#include "carla/StopWatch.h"
+#include "carla/geom/Mesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace cg = carla::geom;
+
+using MeshList = std::vector<std::unique_ptr<cg::Mesh>>;
+
+struct Timing {
+  double loop_us = 1e30;
+  double copy_us = 1e30;
+  double move_us = 1e30;
+  size_t mismatches = 0u;
+};
+
+/// Triangle strips with normals and uvs, as the road mesh generation
+/// builds a mesh for each lane.
+static MeshList MakeMeshes(const size_t count, const size_t vertices) {
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+  MeshList meshes;
+  for (size_t i = 0u; i < count; ++i) {
+    std::vector<cg::Mesh::vertex_type> strip;
+    for (size_t k = 0u; k < vertices; ++k) {
+      strip.emplace_back(value(rng), value(rng), value(rng));
+    }
+    auto mesh = std::make_unique<cg::Mesh>();
+    mesh->AddTriangleStrip(strip);
+    for (size_t k = 0u; k < vertices; ++k) {
+      mesh->AddNormal({0.0f, 0.0f, 1.0f});
+      mesh->AddUV({value(rng), value(rng)});
+    }
+    meshes.emplace_back(std::move(mesh));
+  }
+  return meshes;
+}
+
+static MeshList Copy(const MeshList &meshes) {
+  MeshList copy;
+  copy.reserve(meshes.size());
+  for (const auto &mesh : meshes) {
+    copy.emplace_back(std::make_unique<cg::Mesh>(*mesh));
+  }
+  return copy;
+}
+
+static double ElapsedUs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>()) / 1000.0;
+}
+
+static size_t CountMismatches(const cg::Mesh &expected, const cg::Mesh &mesh) {
+  const auto &lhs_vertices = expected.GetVertices();
+  const auto &rhs_vertices = mesh.GetVertices();
+  const auto &lhs_indexes = expected.GetIndexes();
+  const auto &rhs_indexes = mesh.GetIndexes();
+  if ((lhs_vertices.size() != rhs_vertices.size()) || (lhs_indexes.size() != rhs_indexes.size())) {
+    return std::max(lhs_vertices.size(), rhs_vertices.size()) + std::max(lhs_indexes.size(), rhs_indexes.size());
+  }
+  size_t mismatches = 0u;
+  for (size_t i = 0u; i < lhs_vertices.size(); ++i) {
+    mismatches += lhs_vertices[i] != rhs_vertices[i] ? 1u : 0u;
+  }
+  for (size_t i = 0u; i < lhs_indexes.size(); ++i) {
+    mismatches += lhs_indexes[i] != rhs_indexes[i] ? 1u : 0u;
+  }
+  return mismatches;
+}
+
+static Timing Run(const size_t count, const size_t vertices, const size_t runs) {
+  const auto meshes = MakeMeshes(count, vertices);
+  Timing timing;
+  cg::Mesh expected;
+  for (size_t i = 0u; i < runs; ++i) {
+    cg::Mesh mesh;
+    carla::StopWatch stop_watch;
+    for (const auto &item : meshes) {
+      mesh += *item;
+    }
+    stop_watch.Stop();
+    timing.loop_us = std::min(timing.loop_us, ElapsedUs(stop_watch));
+    expected = std::move(mesh);
+  }
+  for (size_t i = 0u; i < runs; ++i) {
+    cg::Mesh mesh;
+    carla::StopWatch stop_watch;
+    mesh.Append(meshes);
+    stop_watch.Stop();
+    timing.copy_us = std::min(timing.copy_us, ElapsedUs(stop_watch));
+    timing.mismatches += CountMismatches(expected, mesh);
+  }
+  for (size_t i = 0u; i < runs; ++i) {
+    auto copy = Copy(meshes);
+    cg::Mesh mesh;
+    carla::StopWatch stop_watch;
+    mesh.Append(std::move(copy));
+    stop_watch.Stop();
+    timing.move_us = std::min(timing.move_us, ElapsedUs(stop_watch));
+    timing.mismatches += CountMismatches(expected, mesh);
+  }
+  return timing;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  const size_t vertices = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200u;
+  std::vector<size_t> mesh_counts;
+  for (int i = 3; i < argc; ++i) {
+    mesh_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (mesh_counts.empty()) {
+    mesh_counts = {1u, 10u, 100u, 1000u};
+  }
+
+  std::printf("best of %zu runs, %zu vertices per mesh\n", runs, vertices);
+  std::printf("%8s %12s %12s %12s %9s %9s %10s\n",
+      "meshes", "+= us", "copy us", "move us", "copy", "move", "mismatches");
+  for (const size_t count : mesh_counts) {
+    const auto timing = Run(count, vertices, runs);
+    std::printf("%8zu %12.3f %12.3f %12.3f %8.1fx %8.1fx %10zu\n",
+        count,
+        timing.loop_us,
+        timing.copy_us,
+        timing.move_us,
+        timing.loop_us / std::max(timing.copy_us, 1e-9),
+        timing.loop_us / std::max(timing.move_us, 1e-9),
+        timing.mismatches);
+  }
+  return 0;
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of PiecewiseCubicPolynomial::Evaluate and EvaluateWithTangent against
+// looking up the record of each sample and calling CubicPolynomial, and
+// number of values that are not bit-identical, against the number of
+// samples along a road profile.
+//
+// Usage: polynomial_benchmark [runs] [records] [samples...]
+
+#include "carla/StopWatch.h"
+#include "carla/geom/CubicPolynomial.h"
+#include "carla/geom/PiecewiseCubicPolynomial.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace cg = carla::geom;
+
+using value_type = cg::CubicPolynomial::value_type;
+
+/// Length of each record of the profile, in meters.
+static constexpr value_type RECORD_LENGTH = 25.0;
+
+struct Timing {
+  double serial_us = 1e30;
+  double batch_us = 1e30;
+  size_t mismatches = 0u;
+};
+
+struct Profile {
+  std::vector<value_type> starts;
+  std::vector<cg::CubicPolynomial> polynomials;
+  cg::PiecewiseCubicPolynomial piecewise;
+};
+
+static Profile MakeProfile(const size_t records) {
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<value_type> coefficient(-0.01, 0.01);
+  Profile profile;
+  profile.piecewise.Reserve(records);
+  for (size_t i = 0u; i < records; ++i) {
+    const value_type start = static_cast<value_type>(i) * RECORD_LENGTH;
+    const cg::CubicPolynomial polynomial(
+        3.5 + coefficient(rng), coefficient(rng), coefficient(rng), coefficient(rng) * 0.01, start);
+    profile.starts.emplace_back(start);
+    profile.polynomials.emplace_back(polynomial);
+    profile.piecewise.Append(start, polynomial);
+  }
+  return profile;
+}
+
+/// Record valid at @a s, as InformationSet::GetInfo finds it.
+static const cg::CubicPolynomial *FindPolynomial(const Profile &profile, const value_type s) {
+  const auto it = std::upper_bound(profile.starts.begin(), profile.starts.end(), s);
+  if (it == profile.starts.begin()) {
+    return nullptr;
+  }
+  return &profile.polynomials[static_cast<size_t>(std::distance(profile.starts.begin(), it)) - 1u];
+}
+
+static double ElapsedUs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>()) / 1000.0;
+}
+
+static size_t CountMismatches(const std::vector<value_type> &lhs, const std::vector<value_type> &rhs) {
+  size_t mismatches = 0u;
+  for (size_t i = 0u; i < lhs.size(); ++i) {
+    mismatches += std::memcmp(&lhs[i], &rhs[i], sizeof(value_type)) != 0 ? 1u : 0u;
+  }
+  return mismatches;
+}
+
+static void Print(const char *name, const size_t samples, const Timing &timing) {
+  std::printf("%-20s %10zu %12.3f %12.3f %8.1fx %10zu\n",
+      name,
+      samples,
+      timing.serial_us,
+      timing.batch_us,
+      timing.serial_us / std::max(timing.batch_us, 1e-9),
+      timing.mismatches);
+}
+
+static void Benchmark(const Profile &profile, const size_t samples, const size_t runs) {
+  // Samples at a fixed step along the whole profile, as the mesh generation
+  // samples a lane.
+  const value_type length = static_cast<value_type>(profile.starts.size()) * RECORD_LENGTH;
+  std::vector<value_type> s(samples);
+  for (size_t i = 0u; i < samples; ++i) {
+    s[i] = length * static_cast<value_type>(i) / static_cast<value_type>(std::max<size_t>(samples, 1u));
+  }
+
+  std::vector<value_type> expected(samples);
+  std::vector<value_type> expected_tangent(samples);
+  std::vector<value_type> values(samples);
+  std::vector<value_type> tangents(samples);
+
+  Timing evaluate;
+  Timing with_tangent;
+  for (size_t run = 0u; run < runs; ++run) {
+    carla::StopWatch stop_watch;
+    for (size_t i = 0u; i < samples; ++i) {
+      const auto *polynomial = FindPolynomial(profile, s[i]);
+      expected[i] = polynomial != nullptr ? polynomial->Evaluate(s[i]) : 0.0;
+    }
+    stop_watch.Stop();
+    evaluate.serial_us = std::min(evaluate.serial_us, ElapsedUs(stop_watch));
+  }
+  for (size_t run = 0u; run < runs; ++run) {
+    carla::StopWatch stop_watch;
+    for (size_t i = 0u; i < samples; ++i) {
+      const auto *polynomial = FindPolynomial(profile, s[i]);
+      expected[i] = polynomial != nullptr ? polynomial->Evaluate(s[i]) : 0.0;
+      expected_tangent[i] = polynomial != nullptr ? polynomial->Tangent(s[i]) : 0.0;
+    }
+    stop_watch.Stop();
+    with_tangent.serial_us = std::min(with_tangent.serial_us, ElapsedUs(stop_watch));
+  }
+  for (size_t run = 0u; run < runs; ++run) {
+    carla::StopWatch stop_watch;
+    profile.piecewise.Evaluate(s.data(), samples, values.data());
+    stop_watch.Stop();
+    evaluate.batch_us = std::min(evaluate.batch_us, ElapsedUs(stop_watch));
+  }
+  evaluate.mismatches = CountMismatches(expected, values);
+  for (size_t run = 0u; run < runs; ++run) {
+    carla::StopWatch stop_watch;
+    profile.piecewise.EvaluateWithTangent(s.data(), samples, values.data(), tangents.data());
+    stop_watch.Stop();
+    with_tangent.batch_us = std::min(with_tangent.batch_us, ElapsedUs(stop_watch));
+  }
+  with_tangent.mismatches =
+      CountMismatches(expected, values) + CountMismatches(expected_tangent, tangents);
+
+  Print("Evaluate", samples, evaluate);
+  Print("EvaluateWithTangent", samples, with_tangent);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10u;
+  const size_t records = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 40u;
+  std::vector<size_t> sample_counts;
+  for (int i = 3; i < argc; ++i) {
+    sample_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (sample_counts.empty()) {
+    sample_counts = {100u, 2000u, 100000u};
+  }
+
+  const auto profile = MakeProfile(records);
+  std::printf("best of %zu runs, %zu records of %.0f m\n", runs, records, RECORD_LENGTH);
+  std::printf("%-20s %10s %12s %12s %9s %10s\n",
+      "function", "samples", "serial us", "batch us", "speedup", "mismatches");
+  for (const size_t samples : sample_counts) {
+    Benchmark(profile, samples, runs);
+  }
+  return 0;
+}
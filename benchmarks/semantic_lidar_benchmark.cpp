@@ -0,0 +1,201 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of SemanticLidarKernels::AggregateObjects, with and without oriented
+// boxes, against a serial aggregation with std::map, and number of objects
+// that differ, against the number of points.
+//
+// Usage: semantic_lidar_benchmark [runs] [objects] [points...]
+
+#include "carla/StopWatch.h"
+#include "carla/pointcloud/SemanticLidarKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace cp = carla::pointcloud;
+
+using carla::sensor::data::SemanticLidarDetection;
+
+/// Number of semantic tags of the points.
+static constexpr uint32_t TAGS = 29u;
+
+/// Tolerance of the centroids and boxes, in meters.
+static constexpr float TOLERANCE = 1e-3f;
+
+struct Timing {
+  double serial_ms = 1e30;
+  double kernel_ms = 1e30;
+  double oriented_ms = 1e30;
+  size_t mismatches = 0u;
+};
+
+/// Points scattered around @a objects centers, in random order.
+static std::vector<SemanticLidarDetection> MakeSweep(const size_t objects, const size_t count) {
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+  std::normal_distribution<float> offset(0.0f, 1.0f);
+  std::vector<carla::geom::Location> centers;
+  for (size_t i = 0u; i < objects; ++i) {
+    centers.emplace_back(position(rng), position(rng), 0.0f);
+  }
+  std::vector<SemanticLidarDetection> points;
+  points.reserve(count);
+  for (size_t i = 0u; i < count; ++i) {
+    const uint32_t object = static_cast<uint32_t>(rng() % std::max<size_t>(objects, 1u));
+    const auto &center = centers[object];
+    points.emplace_back(
+        center.x + 2.0f * offset(rng),
+        center.y + 0.5f * offset(rng),
+        center.z + offset(rng),
+        1.0f,
+        object,
+        object % TAGS);
+  }
+  return points;
+}
+
+static double ElapsedMs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+}
+
+/// Count, first tag, centroid and axis-aligned box of each object.
+static std::vector<cp::SemanticLidarObject> SerialAggregateObjects(
+    const std::vector<SemanticLidarDetection> &points) {
+  struct Accumulator {
+    uint32_t tag = 0u;
+    uint32_t count = 0u;
+    double x = 0.0, y = 0.0, z = 0.0;
+    carla::geom::Location min, max;
+  };
+  std::map<uint32_t, Accumulator> accumulators;
+  for (const auto &point : points) {
+    auto result = accumulators.emplace(point.object_idx, Accumulator());
+    auto &accumulator = result.first->second;
+    if (result.second) {
+      accumulator.tag = point.object_tag;
+      accumulator.min = accumulator.max = point.point;
+    }
+    ++accumulator.count;
+    accumulator.x += point.point.x;
+    accumulator.y += point.point.y;
+    accumulator.z += point.point.z;
+    accumulator.min.x = std::min(accumulator.min.x, point.point.x);
+    accumulator.min.y = std::min(accumulator.min.y, point.point.y);
+    accumulator.min.z = std::min(accumulator.min.z, point.point.z);
+    accumulator.max.x = std::max(accumulator.max.x, point.point.x);
+    accumulator.max.y = std::max(accumulator.max.y, point.point.y);
+    accumulator.max.z = std::max(accumulator.max.z, point.point.z);
+  }
+  std::vector<cp::SemanticLidarObject> objects;
+  objects.reserve(accumulators.size());
+  for (const auto &item : accumulators) {
+    const auto &accumulator = item.second;
+    cp::SemanticLidarObject object;
+    object.object_idx = item.first;
+    object.object_tag = accumulator.tag;
+    object.point_count = accumulator.count;
+    object.centroid = carla::geom::Location(
+        static_cast<float>(accumulator.x / accumulator.count),
+        static_cast<float>(accumulator.y / accumulator.count),
+        static_cast<float>(accumulator.z / accumulator.count));
+    object.bounding_box.location = (accumulator.min + accumulator.max) * 0.5f;
+    object.bounding_box.extent = carla::geom::Vector3D(accumulator.max - accumulator.min) * 0.5f;
+    objects.emplace_back(object);
+  }
+  return objects;
+}
+
+static bool IsClose(const carla::geom::Vector3D &lhs, const carla::geom::Vector3D &rhs) {
+  return
+      (std::abs(lhs.x - rhs.x) <= TOLERANCE) &&
+      (std::abs(lhs.y - rhs.y) <= TOLERANCE) &&
+      (std::abs(lhs.z - rhs.z) <= TOLERANCE);
+}
+
+static size_t CountMismatches(
+    const std::vector<cp::SemanticLidarObject> &expected,
+    const std::vector<cp::SemanticLidarObject> &objects) {
+  size_t mismatches = objects.size() > expected.size() ?
+      objects.size() - expected.size() :
+      expected.size() - objects.size();
+  for (size_t i = 0u; i < std::min(objects.size(), expected.size()); ++i) {
+    const auto &lhs = expected[i];
+    const auto &rhs = objects[i];
+    if ((lhs.object_idx != rhs.object_idx) ||
+        (lhs.object_tag != rhs.object_tag) ||
+        (lhs.point_count != rhs.point_count) ||
+        !IsClose(lhs.centroid, rhs.centroid) ||
+        !IsClose(lhs.bounding_box.location, rhs.bounding_box.location) ||
+        !IsClose(lhs.bounding_box.extent, rhs.bounding_box.extent)) {
+      ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
+static Timing Run(const size_t objects, const size_t count, const size_t runs) {
+  const auto points = MakeSweep(objects, count);
+  Timing timing;
+  std::vector<cp::SemanticLidarObject> expected;
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    expected = SerialAggregateObjects(points);
+    stop_watch.Stop();
+    timing.serial_ms = std::min(timing.serial_ms, ElapsedMs(stop_watch));
+  }
+  std::vector<cp::SemanticLidarObject> result;
+  std::vector<uint32_t> tag_histogram;
+  cp::ObjectAggregationOptions options;
+  options.oriented_boxes = false;
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    cp::SemanticLidarKernels::AggregateObjects(points.data(), points.size(), result, &tag_histogram, options);
+    stop_watch.Stop();
+    timing.kernel_ms = std::min(timing.kernel_ms, ElapsedMs(stop_watch));
+  }
+  timing.mismatches = CountMismatches(expected, result);
+  options.oriented_boxes = true;
+  for (size_t i = 0u; i < runs; ++i) {
+    carla::StopWatch stop_watch;
+    cp::SemanticLidarKernels::AggregateObjects(points.data(), points.size(), result, &tag_histogram, options);
+    stop_watch.Stop();
+    timing.oriented_ms = std::min(timing.oriented_ms, ElapsedMs(stop_watch));
+  }
+  return timing;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  const size_t objects = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500u;
+  std::vector<size_t> point_counts;
+  for (int i = 3; i < argc; ++i) {
+    point_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (point_counts.empty()) {
+    point_counts = {10000u, 100000u, 1000000u};
+  }
+
+  std::printf("best of %zu runs, %zu objects\n", runs, objects);
+  std::printf("%10s %12s %12s %9s %14s %10s\n",
+      "points", "serial ms", "kernel ms", "speedup", "oriented ms", "mismatches");
+  for (const size_t count : point_counts) {
+    const auto timing = Run(objects, count, runs);
+    std::printf("%10zu %12.3f %12.3f %8.1fx %14.3f %10zu\n",
+        count,
+        timing.serial_ms,
+        timing.kernel_ms,
+        timing.serial_ms / std::max(timing.kernel_ms, 1e-9),
+        timing.oriented_ms,
+        timing.mismatches);
+  }
+  return 0;
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Time of MeshFactory::MergeAndSmooth against serial Gauss-Seidel sweeps of
+// the same Laplacian smoothing, and number of vertices whose height differs,
+// against the number of lanes of a junction.
+//
+// Usage: smoothing_benchmark [runs] [samples per lane] [lanes...]
+
+#include "carla/StopWatch.h"
+#include "carla/geom/Math.h"
+#include "carla/geom/Mesh.h"
+#include "carla/geom/Rtree.h"
+#include "carla/road/MeshFactory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace cg = carla::geom;
+
+using MeshList = std::vector<std::unique_ptr<cg::Mesh>>;
+
+/// Distance between the samples of a lane, in meters.
+static constexpr float RESOLUTION = 2.0f;
+
+static constexpr float LANE_WIDTH = 3.5f;
+
+/// Number of sweeps of the serial smoothing.
+static constexpr int SERIAL_ITERATIONS = 100;
+
+/// Height difference above which a vertex counts as a mismatch, in meters.
+static constexpr float TOLERANCE = 0.01f;
+
+struct Timing {
+  double serial_ms = 1e30;
+  double smooth_ms = 1e30;
+  size_t mismatches = 0u;
+  float max_difference = 0.0f;
+};
+
+/// Lanes crossing the center of the junction at different angles, each one
+/// a strip of a right and a left vertex per sample, with bumpy heights.
+static MeshList MakeJunction(const size_t lanes, const size_t samples) {
+  constexpr float pi = cg::Math::Pi<float>();
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+  const float length = RESOLUTION * static_cast<float>(samples - 1u);
+  MeshList meshes;
+  for (size_t lane = 0u; lane < lanes; ++lane) {
+    const float angle = pi * static_cast<float>(lane) / static_cast<float>(lanes);
+    const cg::Vector3D direction(std::cos(angle), std::sin(angle), 0.0f);
+    const cg::Vector3D side(-direction.y, direction.x, 0.0f);
+    const float offset = LANE_WIDTH * (static_cast<float>(lane % 2u) - 0.5f);
+    const float slope = 0.02f * static_cast<float>(lane % 3u);
+    auto mesh = std::make_unique<cg::Mesh>();
+    for (size_t i = 0u; i < samples; ++i) {
+      const float s = RESOLUTION * static_cast<float>(i) - 0.5f * length;
+      const cg::Vector3D center = direction * s + side * offset;
+      const float height = slope * s + 0.2f * std::sin(0.3f * s);
+      auto right = center - side * (0.5f * LANE_WIDTH);
+      auto left = center + side * (0.5f * LANE_WIDTH);
+      right.z = height + noise(rng);
+      left.z = height + noise(rng);
+      mesh->AddVertex(right);
+      mesh->AddVertex(left);
+    }
+    meshes.emplace_back(std::move(mesh));
+  }
+  return meshes;
+}
+
+static MeshList Copy(const MeshList &meshes) {
+  MeshList copy;
+  copy.reserve(meshes.size());
+  for (const auto &mesh : meshes) {
+    copy.emplace_back(std::make_unique<cg::Mesh>(*mesh));
+  }
+  return copy;
+}
+
+/// Smoothing as done before the Jacobi sweeps: the heights are updated in
+/// place, in the order of the lanes, for a fixed number of sweeps.
+static std::unique_ptr<cg::Mesh> SerialMergeAndSmooth(
+    const cg::MeshFactory::RoadParameters &road_param,
+    MeshList &lane_meshes) {
+  struct VertexInfo {
+    cg::Mesh::vertex_type *vertex;
+    size_t lane_mesh_idx;
+    bool is_static;
+  };
+  struct Neighbor {
+    const cg::Mesh::vertex_type *vertex;
+    double weight;
+  };
+  struct Neighborhood {
+    cg::Mesh::vertex_type *vertex;
+    std::vector<Neighbor> neighbors;
+  };
+  using Rtree = cg::PointCloudRtree<VertexInfo>;
+  using Point = Rtree::BPoint;
+  Rtree rtree;
+  for (size_t lane_mesh_idx = 0u; lane_mesh_idx < lane_meshes.size(); ++lane_mesh_idx) {
+    auto &vertices = lane_meshes[lane_mesh_idx]->GetVertices();
+    for (size_t i = 0u; i < vertices.size(); ++i) {
+      auto &vertex = vertices[i];
+      const bool is_static = i < 2u || i >= vertices.size() - 2u;
+      rtree.InsertElement({Point(vertex.x, vertex.y, vertex.z), {&vertex, lane_mesh_idx, is_static}});
+    }
+  }
+  std::vector<Neighborhood> neighborhoods;
+  for (size_t lane_mesh_idx = 0u; lane_mesh_idx < lane_meshes.size(); ++lane_mesh_idx) {
+    auto &vertices = lane_meshes[lane_mesh_idx]->GetVertices();
+    for (size_t i = 3u; i + 2u < vertices.size(); ++i) {
+      auto &vertex = vertices[i];
+      Neighborhood neighborhood{&vertex, {}};
+      for (const auto &close_vertex : rtree.GetNearestNeighbours(Point(vertex.x, vertex.y, vertex.z), 20u)) {
+        const auto &info = close_vertex.second;
+        if (info.vertex == &vertex) {
+          continue;
+        }
+        const float distance = cg::Math::Distance(vertex, *info.vertex);
+        if ((distance > road_param.max_weight_distance) ||
+            (distance < 10.0 * std::numeric_limits<double>::epsilon())) {
+          continue;
+        }
+        float weight = cg::Math::Clamp<float>(1.0f / distance, 0.0f, 100000.0f);
+        if (info.lane_mesh_idx == lane_mesh_idx) {
+          weight *= road_param.same_lane_weight_multiplier;
+          if (info.is_static) {
+            weight *= road_param.lane_ends_multiplier;
+          }
+        }
+        neighborhood.neighbors.push_back({info.vertex, weight});
+      }
+      neighborhoods.emplace_back(std::move(neighborhood));
+    }
+  }
+  for (int iter = 0; iter < SERIAL_ITERATIONS; ++iter) {
+    for (auto &neighborhood : neighborhoods) {
+      double sum = 0.0;
+      double sum_weight = 0.0;
+      for (const auto &neighbor : neighborhood.neighbors) {
+        sum += (neighbor.vertex->z - neighborhood.vertex->z) * neighbor.weight;
+        sum_weight += neighbor.weight;
+      }
+      if (sum_weight > 0.0) {
+        neighborhood.vertex->z += static_cast<float>(0.5 * sum / sum_weight);
+      }
+    }
+  }
+  auto out_mesh = std::make_unique<cg::Mesh>();
+  out_mesh->Append(lane_meshes);
+  return out_mesh;
+}
+
+static double ElapsedMs(const carla::StopWatch &stop_watch) {
+  return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+}
+
+static Timing Run(const size_t lanes, const size_t samples, const size_t runs) {
+  const auto meshes = MakeJunction(lanes, samples);
+  const cg::MeshFactory factory;
+  Timing timing;
+  std::unique_ptr<cg::Mesh> expected;
+  for (size_t i = 0u; i < runs; ++i) {
+    auto copy = Copy(meshes);
+    carla::StopWatch stop_watch;
+    expected = SerialMergeAndSmooth(factory.road_param, copy);
+    stop_watch.Stop();
+    timing.serial_ms = std::min(timing.serial_ms, ElapsedMs(stop_watch));
+  }
+  std::unique_ptr<cg::Mesh> result;
+  for (size_t i = 0u; i < runs; ++i) {
+    auto copy = Copy(meshes);
+    carla::StopWatch stop_watch;
+    result = factory.MergeAndSmooth(copy);
+    stop_watch.Stop();
+    timing.smooth_ms = std::min(timing.smooth_ms, ElapsedMs(stop_watch));
+  }
+  const auto &lhs = expected->GetVertices();
+  const auto &rhs = result->GetVertices();
+  for (size_t i = 0u; i < lhs.size(); ++i) {
+    const float difference = std::abs(lhs[i].z - rhs[i].z);
+    timing.max_difference = std::max(timing.max_difference, difference);
+    timing.mismatches += difference > TOLERANCE ? 1u : 0u;
+  }
+  return timing;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5u;
+  const size_t samples = std::max<size_t>(8u, argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 30u);
+  std::vector<size_t> lane_counts;
+  for (int i = 3; i < argc; ++i) {
+    lane_counts.emplace_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (lane_counts.empty()) {
+    lane_counts = {4u, 16u, 64u};
+  }
+
+  std::printf("best of %zu runs, %zu samples per lane, %d serial sweeps\n", runs, samples, SERIAL_ITERATIONS);
+  std::printf("%8s %10s %12s %12s %9s %10s %14s\n",
+      "lanes", "vertices", "serial ms", "smooth ms", "speedup", "mismatches", "max diff mm");
+  for (const size_t lanes : lane_counts) {
+    const auto timing = Run(lanes, samples, runs);
+    std::printf("%8zu %10zu %12.3f %12.3f %8.1fx %10zu %14.3f\n",
+        lanes,
+        2u * lanes * samples,
+        timing.serial_ms,
+        timing.smooth_ms,
+        timing.serial_ms / std::max(timing.smooth_ms, 1e-9),
+        timing.mismatches,
+        1000.0f * timing.max_difference);
+  }
+  return 0;
+}
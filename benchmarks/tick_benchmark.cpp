@@ -0,0 +1,174 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Synchronous mode throughput with the default and the pipelined tick, with
+// vehicles driven by the traffic manager and walkers driven by the crowd.
+//
+// Usage: tick_benchmark [host] [port] [vehicles] [walkers] [ticks]
+//
+// Needs a running simulator; the actors spawned are destroyed and the
+// settings restored at the end.
+
+#include "carla/StopWatch.h"
+#include "carla/client/ActorBlueprint.h"
+#include "carla/client/BlueprintLibrary.h"
+#include "carla/client/Client.h"
+#include "carla/client/Map.h"
+#include "carla/client/Vehicle.h"
+#include "carla/client/WalkerAIController.h"
+#include "carla/client/World.h"
+
+#include <boost/pointer_cast.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace cc = carla::client;
+
+static constexpr double DELTA_SECONDS = 0.05;
+
+static constexpr size_t WARM_UP_TICKS = 20u;
+
+static constexpr uint16_t TM_PORT = 8000u;
+
+struct Result {
+  double mean_ms = 0.0;
+  double p95_ms = 0.0;
+  double ticks_per_second = 0.0;
+};
+
+static Result RunTicks(cc::World &world, const bool pipelined, const size_t ticks) {
+  const auto timeout = carla::time_duration::seconds(10u);
+  world.SetPipelinedTick(pipelined);
+  for (size_t i = 0u; i < WARM_UP_TICKS; ++i) {
+    world.Tick(timeout);
+  }
+
+  std::vector<double> times;
+  times.reserve(ticks);
+  carla::StopWatch total;
+  for (size_t i = 0u; i < ticks; ++i) {
+    carla::StopWatch stop_watch;
+    world.Tick(timeout);
+    stop_watch.Stop();
+    times.emplace_back(static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) / 1000.0);
+  }
+  total.Stop();
+  world.SetPipelinedTick(false);
+
+  Result result;
+  if (times.empty()) {
+    return result;
+  }
+  const double total_ms = static_cast<double>(total.GetElapsedTime<std::chrono::microseconds>()) / 1000.0;
+  result.mean_ms = total_ms / static_cast<double>(times.size());
+  result.ticks_per_second = 1000.0 / std::max(result.mean_ms, 1e-6);
+  std::sort(times.begin(), times.end());
+  result.p95_ms = times[std::min(times.size() - 1u, (times.size() * 95u) / 100u)];
+  return result;
+}
+
+static void SpawnActors(
+    cc::World &world,
+    const size_t vehicles,
+    const size_t walkers,
+    std::vector<carla::SharedPtr<cc::Actor>> &actors) {
+  auto blueprints = world.GetBlueprintLibrary();
+
+  // vehicles on the traffic manager
+  auto vehicle_blueprints = blueprints->Filter("vehicle.*");
+  const auto &spawn_points = world.GetMap()->GetRecommendedSpawnPoints();
+  for (size_t i = 0u; (i < spawn_points.size()) && (i < vehicles) && !vehicle_blueprints->empty(); ++i) {
+    const auto &blueprint = (*vehicle_blueprints)[i % vehicle_blueprints->size()];
+    auto actor = world.TrySpawnActor(blueprint, spawn_points[i]);
+    if (actor != nullptr) {
+      boost::static_pointer_cast<cc::Vehicle>(actor)->SetAutopilot(true, TM_PORT);
+      actors.emplace_back(actor);
+    }
+  }
+
+  // walkers on the crowd, started once the server has spawned them
+  auto walker_blueprints = blueprints->Filter("walker.pedestrian.*");
+  auto controller_blueprint = blueprints->Find("controller.ai.walker");
+  std::vector<carla::SharedPtr<cc::Actor>> controllers;
+  for (size_t i = 0u; (i < walkers) && !walker_blueprints->empty() && (controller_blueprint != nullptr); ++i) {
+    auto location = world.GetRandomLocationFromNavigation();
+    if (!location.has_value()) {
+      continue;
+    }
+    carla::geom::Transform transform;
+    transform.location = *location;
+    transform.location.z += 1.0f;
+    const auto &blueprint = (*walker_blueprints)[i % walker_blueprints->size()];
+    auto walker = world.TrySpawnActor(blueprint, transform);
+    if (walker == nullptr) {
+      continue;
+    }
+    auto controller = world.TrySpawnActor(*controller_blueprint, carla::geom::Transform(), walker.get());
+    actors.emplace_back(walker);
+    if (controller != nullptr) {
+      controllers.emplace_back(controller);
+      actors.emplace_back(controller);
+    }
+  }
+  world.Tick(carla::time_duration::seconds(10u));
+  for (auto &actor : controllers) {
+    auto controller = boost::static_pointer_cast<cc::WalkerAIController>(actor);
+    controller->Start();
+    auto target = world.GetRandomLocationFromNavigation();
+    if (target.has_value()) {
+      controller->GoToLocation(*target);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const std::string host = argc > 1 ? argv[1] : "localhost";
+  const uint16_t port = argc > 2 ? static_cast<uint16_t>(std::atoi(argv[2])) : 2000u;
+  const size_t vehicles = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100u;
+  const size_t walkers = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 200u;
+  const size_t ticks = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 500u;
+
+  try {
+    cc::Client client(host, port);
+    client.SetTimeout(carla::time_duration::seconds(20u));
+    auto world = client.GetWorld();
+
+    const auto original_settings = world.GetSettings();
+    auto settings = original_settings;
+    settings.synchronous_mode = true;
+    settings.fixed_delta_seconds = DELTA_SECONDS;
+    world.ApplySettings(settings, carla::time_duration::seconds(10u));
+    auto traffic_manager = client.GetInstanceTM(TM_PORT);
+    traffic_manager.SetSynchronousMode(true);
+
+    std::vector<carla::SharedPtr<cc::Actor>> actors;
+    SpawnActors(world, vehicles, walkers, actors);
+
+    std::printf("map %s, %zu actors spawned, %zu ticks of %.3f s\n",
+        world.GetMap()->GetName().c_str(), actors.size(), ticks, DELTA_SECONDS);
+    std::printf("%-10s %10s %10s %10s\n", "tick", "mean ms", "p95 ms", "ticks/s");
+    for (const bool pipelined : {false, true}) {
+      const auto result = RunTicks(world, pipelined, ticks);
+      std::printf("%-10s %10.3f %10.3f %10.1f\n",
+          pipelined ? "pipelined" : "default", result.mean_ms, result.p95_ms, result.ticks_per_second);
+    }
+
+    for (auto it = actors.rbegin(); it != actors.rend(); ++it) {
+      (*it)->Destroy();
+    }
+    traffic_manager.SetSynchronousMode(false);
+    world.ApplySettings(original_settings, carla::time_duration::seconds(10u));
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
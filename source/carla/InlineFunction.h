@@ -0,0 +1,144 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Debug.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace carla {
+
+  template <typename SignatureT, size_t Capacity = 64u>
+  class InlineFunction;
+
+  /// Move-only replacement of std::function that keeps callables of up to
+  /// @a Capacity bytes in place, without allocating. Bigger callables, or
+  /// callables that may throw on move, are allocated on the heap.
+  ///
+  /// As with std::function, calling it through a const reference calls the
+  /// callable as non-const.
+  template <typename R, typename... Args, size_t Capacity>
+  class InlineFunction<R(Args...), Capacity> {
+  public:
+
+    InlineFunction() = default;
+
+    InlineFunction(std::nullptr_t) {}
+
+    template <
+        typename FunctorT,
+        typename F = typename std::decay<FunctorT>::type,
+        typename = typename std::enable_if<!std::is_same<F, InlineFunction>::value>::type>
+    InlineFunction(FunctorT &&functor) {
+      Emplace<F>(std::forward<FunctorT>(functor), std::integral_constant<bool, IsInline<F>()>());
+    }
+
+    InlineFunction(InlineFunction &&rhs) noexcept {
+      MoveFrom(rhs);
+    }
+
+    InlineFunction &operator=(InlineFunction &&rhs) noexcept {
+      if (this != &rhs) {
+        reset();
+        MoveFrom(rhs);
+      }
+      return *this;
+    }
+
+    InlineFunction(const InlineFunction &) = delete;
+    InlineFunction &operator=(const InlineFunction &) = delete;
+
+    ~InlineFunction() {
+      reset();
+    }
+
+    R operator()(Args... args) const {
+      DEBUG_ASSERT(_operations != nullptr);
+      return _operations->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+      return _operations != nullptr;
+    }
+
+    void reset() {
+      if (_operations != nullptr) {
+        _operations->destroy(_storage);
+        _operations = nullptr;
+      }
+    }
+
+  private:
+
+    struct Operations {
+      R (*invoke)(void *storage, Args &&... args);
+      void (*move)(void *from, void *to);
+      void (*destroy)(void *storage);
+    };
+
+    template <typename F>
+    static constexpr bool IsInline() {
+      return
+          (sizeof(F) <= Capacity) &&
+          (alignof(std::max_align_t) % alignof(F) == 0u) &&
+          std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template <typename F, typename FunctorT>
+    void Emplace(FunctorT &&functor, std::true_type) {
+      static const Operations operations = {
+        [](void *storage, Args &&... args) -> R {
+          return (*static_cast<F *>(storage))(std::forward<Args>(args)...);
+        },
+        [](void *from, void *to) {
+          new (to) F(std::move(*static_cast<F *>(from)));
+          static_cast<F *>(from)->~F();
+        },
+        [](void *storage) {
+          static_cast<F *>(storage)->~F();
+        }
+      };
+      new (_storage) F(std::forward<FunctorT>(functor));
+      _operations = &operations;
+    }
+
+    template <typename F, typename FunctorT>
+    void Emplace(FunctorT &&functor, std::false_type) {
+      static const Operations operations = {
+        [](void *storage, Args &&... args) -> R {
+          return (**static_cast<F **>(storage))(std::forward<Args>(args)...);
+        },
+        [](void *from, void *to) {
+          new (to) F *(*static_cast<F **>(from));
+        },
+        [](void *storage) {
+          delete *static_cast<F **>(storage);
+        }
+      };
+      new (_storage) F *(new F(std::forward<FunctorT>(functor)));
+      _operations = &operations;
+    }
+
+    void MoveFrom(InlineFunction &rhs) {
+      if (rhs._operations != nullptr) {
+        rhs._operations->move(rhs._storage, _storage);
+        _operations = rhs._operations;
+        rhs._operations = nullptr;
+      }
+    }
+
+    static_assert(Capacity >= sizeof(void *), "InlineFunction too small to hold a pointer");
+
+    const Operations *_operations = nullptr;
+
+    alignas(std::max_align_t) mutable unsigned char _storage[Capacity];
+  };
+
+} // namespace carla
@@ -0,0 +1,57 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/JobSystem.h"
+
+#include <thread>
+
+namespace carla {
+
+  JobSystem::JobSystem(const size_t worker_threads)
+    : _worker_count(worker_threads) {
+    _workers.CreateThreads(_worker_count, [this]() { WorkerLoop(); });
+  }
+
+  JobSystem::~JobSystem() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _condition.notify_all();
+    _workers.JoinAll();
+  }
+
+  JobSystem &JobSystem::Get() {
+    static JobSystem instance(
+        std::max<size_t>(1u, std::thread::hardware_concurrency()) - 1u);
+    return instance;
+  }
+
+  void JobSystem::Post(std::function<void()> job) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _jobs.emplace_back(std::move(job));
+    }
+    _condition.notify_one();
+  }
+
+  void JobSystem::WorkerLoop() {
+    for (;;) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+        if (_jobs.empty()) {
+          return;
+        }
+        job = std::move(_jobs.front());
+        _jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+} // namespace carla
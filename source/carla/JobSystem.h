@@ -0,0 +1,181 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/NonCopyable.h"
+#include "carla/ThreadGroup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace carla {
+
+  /// A fixed set of worker threads shared by the CPU-bound parallel loops of
+  /// the library (waypoint, topology and mesh generation, walker crowds and
+  /// path queries), so nested or concurrent loops never create more threads
+  /// than there are cores.
+  class JobSystem : private NonCopyable {
+  public:
+
+    /// Creates a job system with @a worker_threads workers. The thread that
+    /// calls ParallelFor works too, so the default uses one worker less than
+    /// the hardware concurrency.
+    explicit JobSystem(size_t worker_threads);
+
+    /// Stops the workers once the queued jobs are done.
+    ~JobSystem();
+
+    /// The job system shared by the whole process, created on first use.
+    static JobSystem &Get();
+
+    size_t GetWorkerCount() const {
+      return _worker_count;
+    }
+
+    /// Calls @a functor(i) for every i in [0, count) and returns once every
+    /// call has finished. Indices are handed out one at a time to the calling
+    /// thread and to at most @a max_threads - 1 workers (all if 0).
+    ///
+    /// The calling thread never waits for a job that has not started, so
+    /// ParallelFor can be called from inside another ParallelFor without
+    /// deadlocking. The order in which indices run is unspecified; write the
+    /// result of each index to its own slot to get a deterministic output.
+    ///
+    /// If any call throws, the remaining indices are skipped and the first
+    /// exception is rethrown in the calling thread.
+    template <typename FunctorT>
+    void ParallelFor(size_t count, FunctorT &&functor, size_t max_threads = 0u);
+
+    /// Runs @a functor on a worker and returns a future with its result (or
+    /// exception). If there are no workers it runs right away in the calling
+    /// thread.
+    ///
+    /// The functor should not wait for other jobs of this system, since they
+    /// may be queued behind it.
+    template <typename FunctorT>
+    auto Async(FunctorT &&functor) -> std::future<decltype(functor())>;
+
+  private:
+
+    struct LoopState {
+      explicit LoopState(size_t c) : count(c) {}
+
+      const size_t count;
+
+      std::atomic_size_t next{0u};
+
+      std::atomic_size_t finished{0u};
+
+      std::atomic_bool failed{false};
+
+      std::mutex mutex;
+
+      std::condition_variable done;
+
+      std::exception_ptr exception;
+    };
+
+    template <typename FunctorT>
+    static void RunLoop(LoopState &state, FunctorT &functor);
+
+    void Post(std::function<void()> job);
+
+    void WorkerLoop();
+
+    const size_t _worker_count;
+
+    std::mutex _mutex;
+
+    std::condition_variable _condition;
+
+    std::deque<std::function<void()>> _jobs;
+
+    bool _stop = false;
+
+    ThreadGroup _workers;
+  };
+
+  template <typename FunctorT>
+  void JobSystem::RunLoop(LoopState &state, FunctorT &functor) {
+    for (size_t i = state.next++; i < state.count; i = state.next++) {
+      if (!state.failed) {
+        try {
+          functor(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(state.mutex);
+          if (state.exception == nullptr) {
+            state.exception = std::current_exception();
+          }
+          state.failed = true;
+        }
+      }
+      if (++state.finished == state.count) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done.notify_all();
+      }
+    }
+  }
+
+  template <typename FunctorT>
+  void JobSystem::ParallelFor(const size_t count, FunctorT &&functor, size_t max_threads) {
+    if (count == 0u) {
+      return;
+    }
+    if (max_threads == 0u) {
+      max_threads = _worker_count + 1u;
+    }
+    const size_t helpers = std::min({count, max_threads, _worker_count + 1u}) - 1u;
+    if (helpers == 0u) {
+      for (size_t i = 0u; i < count; ++i) {
+        functor(i);
+      }
+      return;
+    }
+
+    // The state outlives this call, since helpers may be dequeued after the
+    // loop is done; by then they find no index left and never touch the
+    // functor, which lives on this stack.
+    auto state = std::make_shared<LoopState>(count);
+    auto *functor_ptr = &functor;
+    for (size_t i = 0u; i < helpers; ++i) {
+      Post([state, functor_ptr]() { RunLoop(*state, *functor_ptr); });
+    }
+    RunLoop(*state, functor);
+
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->done.wait(lock, [&]() { return state->finished == count; });
+    }
+    if (state->exception != nullptr) {
+      std::rethrow_exception(state->exception);
+    }
+  }
+
+  template <typename FunctorT>
+  auto JobSystem::Async(FunctorT &&functor) -> std::future<decltype(functor())> {
+    using ResultT = decltype(functor());
+    // std::function needs a copyable callable, so the task is shared.
+    auto task = std::make_shared<std::packaged_task<ResultT()>>(
+        std::forward<FunctorT>(functor));
+    auto future = task->get_future();
+    if (_worker_count == 0u) {
+      (*task)();
+    } else {
+      Post([task]() { (*task)(); });
+    }
+    return future;
+  }
+
+} // namespace carla
@@ -0,0 +1,52 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Debug.h"
+#include "carla/JobSystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace carla {
+
+  /// Calls @a functor(i) for every i in [0, count) on the shared JobSystem,
+  /// using at most @a max_threads threads (all the workers if 0). The calling
+  /// thread takes part in the work, and the function returns once every index
+  /// has been processed.
+  ///
+  /// The order in which indices are processed is unspecified; the functor
+  /// should write its result to a slot owned by that index to get a
+  /// deterministic output.
+  ///
+  /// If any call throws, the remaining indices are skipped and the first
+  /// exception is rethrown in the calling thread.
+  template <typename FunctorT>
+  void ParallelFor(const size_t count, FunctorT &&functor, size_t max_threads = 0u) {
+    JobSystem::Get().ParallelFor(count, std::forward<FunctorT>(functor), max_threads);
+  }
+
+  /// Same as above splitting [0, count) in chunks of @a chunk_size indices,
+  /// calls @a functor(chunk, begin, end) once per chunk, the last one may be
+  /// shorter. Chunks spread the cost of scheduling over many indices, and
+  /// let the functor keep per chunk state indexed by @a chunk.
+  template <typename FunctorT>
+  void ParallelFor(
+      const size_t count,
+      const size_t chunk_size,
+      FunctorT &&functor,
+      size_t max_threads = 0u) {
+    DEBUG_ASSERT(chunk_size > 0u);
+    const size_t chunks = (count + chunk_size - 1u) / chunk_size;
+    JobSystem::Get().ParallelFor(chunks, [&](const size_t chunk) {
+      const size_t begin = chunk * chunk_size;
+      functor(chunk, begin, std::min(count, begin + chunk_size));
+    }, max_threads);
+  }
+
+} // namespace carla
@@ -22,7 +22,7 @@
 
 #include <condition_variable>
 #include <exception>
-#include <map>
+#include <memory>
 #include <mutex>
 
 namespace carla {
@@ -39,6 +39,11 @@ namespace detail {
 
   /// This class is meant to be used similar to a shared future, but the value
   /// can be set any number of times.
+  ///
+  /// The latest value is kept in a single shared slot. Setting a value swaps
+  /// the slot and wakes only the first waiting thread, each woken thread
+  /// wakes the next one after taking the value, so setting a value costs the
+  /// same no matter how many threads are waiting.
   template <typename T>
   class RecurrentSharedFuture {
   public:
@@ -65,16 +70,32 @@ namespace detail {
 
   private:
 
-    std::mutex _mutex;
-
-    std::condition_variable _cv;
+    using value_type = boost::variant2::variant<SharedException, T>;
 
-    struct mapped_type {
-      bool should_wait;
-      boost::variant2::variant<SharedException, T> value;
+    /// A thread in WaitFor, linked from the stack of the thread.
+    struct Waiter {
+      std::condition_variable cv;
+      Waiter *previous = nullptr;
+      Waiter *next = nullptr;
+      bool is_woken = false;
     };
 
-    std::map<const char *, mapped_type> _map;
+    void Publish(std::shared_ptr<const value_type> value);
+
+    /// Wakes @a waiter, which takes the value and wakes the waiters after it.
+    /// Must be called with the mutex locked.
+    static void Wake(Waiter &waiter) {
+      waiter.is_woken = true;
+      waiter.previous = nullptr;
+      waiter.cv.notify_one();
+    }
+
+    std::mutex _mutex;
+
+    /// Threads waiting for the next value, the most recent first.
+    Waiter *_waiters = nullptr;
+
+    std::shared_ptr<const value_type> _value;
   };
 
   // ===========================================================================
@@ -83,8 +104,6 @@ namespace detail {
 
 namespace detail {
 
-  static thread_local const char thread_tag{};
-
   class SharedException : public std::exception {
   public:
 
@@ -111,33 +130,62 @@ namespace detail {
 
   template <typename T>
   boost::optional<T> RecurrentSharedFuture<T>::WaitFor(time_duration timeout) {
-    std::unique_lock<std::mutex> lock(_mutex);
-    auto &r = _map[&detail::thread_tag];
-    r.should_wait = true;
-    if (!_cv.wait_for(lock, timeout.to_chrono(), [&]() { return !r.should_wait; })) {
-      return {};
+    std::shared_ptr<const value_type> value;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      Waiter self;
+      self.next = _waiters;
+      if (_waiters != nullptr) {
+        _waiters->previous = &self;
+      }
+      _waiters = &self;
+      if (!self.cv.wait_for(lock, timeout.to_chrono(), [&]() { return self.is_woken; })) {
+        // Unlink from the waiting list, or from the list being woken. Only
+        // the first waiter of the latter has no previous and it is woken.
+        if (self.previous != nullptr) {
+          self.previous->next = self.next;
+        } else {
+          _waiters = self.next;
+        }
+        if (self.next != nullptr) {
+          self.next->previous = self.previous;
+        }
+        return {};
+      }
+      value = _value;
+      if (self.next != nullptr) {
+        Wake(*self.next);
+      }
     }
-    if (r.value.index() == 0) {
-      throw_exception(boost::variant2::get<SharedException>(r.value));
+    if (value->index() == 0) {
+      throw_exception(boost::variant2::get<SharedException>(*value));
     }
-    return boost::variant2::get<T>(std::move(r.value));
+    return boost::variant2::get<T>(*value);
   }
 
   template <typename T>
   template <typename T2>
   void RecurrentSharedFuture<T>::SetValue(const T2 &value) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    for (auto &pair : _map) {
-      pair.second.should_wait = false;
-      pair.second.value = value;
-    }
-    _cv.notify_all();
+    Publish(std::make_shared<const value_type>(boost::variant2::in_place_type_t<T>(), value));
   }
 
   template <typename T>
   template <typename ExceptionT>
   void RecurrentSharedFuture<T>::SetException(ExceptionT &&e) {
-    SetValue(SharedException(std::make_shared<ExceptionT>(std::forward<ExceptionT>(e))));
+    Publish(std::make_shared<const value_type>(
+        boost::variant2::in_place_type_t<SharedException>(),
+        std::make_shared<ExceptionT>(std::forward<ExceptionT>(e))));
+  }
+
+  template <typename T>
+  void RecurrentSharedFuture<T>::Publish(std::shared_ptr<const value_type> value) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // The previous value is released after unlocking.
+    _value.swap(value);
+    if (_waiters != nullptr) {
+      Wake(*_waiters);
+      _waiters = nullptr;
+    }
   }
 
 } // namespace carla
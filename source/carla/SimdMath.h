@@ -0,0 +1,397 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__)
+#  include <immintrin.h>
+#  define LIBCARLA_SIMD_SSE2
+#  if defined(__GNUC__) || defined(__clang__)
+#    define LIBCARLA_SIMD_AVX2
+#    define LIBCARLA_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#  include <arm_neon.h>
+#  define LIBCARLA_SIMD_NEON
+#endif
+
+/// Single precision approximations of the Cephes math library, shared by the
+/// SIMD kernels, for SSE2 (LIBCARLA_SIMD_SSE2), AVX2 (LIBCARLA_SIMD_AVX2,
+/// compiled for AVX2 regardless of the compiler flags, the caller checks that
+/// the CPU supports it) and NEON (LIBCARLA_SIMD_NEON).
+///
+/// The vector versions perform the same operations in the same order as the
+/// scalar ones, so every path gives the same results.
+namespace carla {
+namespace simd {
+
+  static constexpr float PI = 3.14159265358979f;
+
+  // ===========================================================================
+  // -- Coefficients -----------------------------------------------------------
+  // ===========================================================================
+
+  namespace cephes {
+
+    static constexpr float TAN_PI_8 = 0.414213562373095f;
+
+    // Arctangent, for arguments up to tan(pi/8).
+    static constexpr float ATAN_P0 = 8.05374449538e-2f;
+    static constexpr float ATAN_P1 = -1.38776856032e-1f;
+    static constexpr float ATAN_P2 = 1.99777106478e-1f;
+    static constexpr float ATAN_P3 = -3.33329491539e-1f;
+
+    static constexpr float FOUR_OVER_PI = 1.27323954473516f;
+
+    // Sine and cosine: extended precision reduction of the argument by pi/4,
+    // then polynomials over [-pi/4, pi/4].
+    static constexpr float SINCOS_DP1 = 0.78515625f;
+    static constexpr float SINCOS_DP2 = 2.4187564849853515625e-4f;
+    static constexpr float SINCOS_DP3 = 3.77489497744594108e-8f;
+    static constexpr float SIN_P0 = -1.9515295891e-4f;
+    static constexpr float SIN_P1 = 8.3321608736e-3f;
+    static constexpr float SIN_P2 = -1.6666654611e-1f;
+    static constexpr float COS_P0 = 2.443315711809948e-5f;
+    static constexpr float COS_P1 = -1.388731625493765e-3f;
+    static constexpr float COS_P2 = 4.166664568298827e-2f;
+
+    // Natural logarithm.
+    static constexpr float LOG_SQRTHF = 0.707106781186547524f;
+    static constexpr float LOG_Q1 = -2.12194440e-4f;
+    static constexpr float LOG_Q2 = 0.693359375f;
+    static constexpr float LOG_P[] = {
+         7.0376836292e-2f,
+        -1.1514610310e-1f,
+         1.1676998740e-1f,
+        -1.2420140846e-1f,
+         1.4249322787e-1f,
+        -1.6668057665e-1f,
+         2.0000714765e-1f,
+        -2.4999993993e-1f,
+         3.3333331174e-1f};
+
+  } // namespace cephes
+
+  // ===========================================================================
+  // -- Scalar -----------------------------------------------------------------
+  // ===========================================================================
+
+  /// Same as std::atan2(y, x).
+  static inline float Atan2(const float y, const float x) {
+    using namespace cephes;
+    const float ax = std::abs(x);
+    const float ay = std::abs(y);
+    const float t = std::min(ax, ay) / std::max(std::max(ax, ay), std::numeric_limits<float>::min());
+    // atan(t) = pi/4 + atan((t - 1) / (t + 1)).
+    const bool reduce = t > TAN_PI_8;
+    const float u = reduce ? (t - 1.0f) / (t + 1.0f) : t;
+    const float s = u * u;
+    float r = ATAN_P0 * s;
+    r = r + ATAN_P1;
+    r = r * s;
+    r = r + ATAN_P2;
+    r = r * s;
+    r = r + ATAN_P3;
+    r = r * s;
+    r = r * u;
+    r = r + u;
+    r = r + (reduce ? PI / 4.0f : 0.0f);
+    r = (ay > ax) ? (PI / 2.0f) - r : r;
+    r = (x < 0.0f) ? PI - r : r;
+    return (y < 0.0f) ? 0.0f - r : r;
+  }
+
+  static inline void SinCos(const float value, float &sine, float &cosine) {
+    using namespace cephes;
+    const float x = std::abs(value);
+    int32_t j = static_cast<int32_t>(x * FOUR_OVER_PI);
+    j = (j + 1) & ~1;
+    const float y = static_cast<float>(j);
+    const float z = ((x - y * SINCOS_DP1) - y * SINCOS_DP2) - y * SINCOS_DP3;
+    const float zz = z * z;
+    float c = COS_P0 * zz;
+    c = c + COS_P1;
+    c = c * zz;
+    c = c + COS_P2;
+    c = c * zz;
+    c = c * zz;
+    c = c - 0.5f * zz;
+    c = c + 1.0f;
+    float s = SIN_P0 * zz;
+    s = s + SIN_P1;
+    s = s * zz;
+    s = s + SIN_P2;
+    s = s * zz;
+    s = s * z;
+    s = s + z;
+    const bool swap = (j & 2) != 0;
+    sine = swap ? c : s;
+    cosine = swap ? s : c;
+    sine = (std::signbit(value) != ((j & 4) != 0)) ? -sine : sine;
+    cosine = (((j - 2) & 4) == 0) ? -cosine : cosine;
+  }
+
+  // ===========================================================================
+  // -- SSE2 -------------------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_SSE2)
+
+  /// @a a where @a mask is set, @a b elsewhere.
+  static inline __m128 SelectSSE2(const __m128 mask, const __m128 a, const __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  static inline __m128 Atan2SSE2(const __m128 y, const __m128 x) {
+    using namespace cephes;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 ax = _mm_and_ps(x, abs_mask);
+    const __m128 ay = _mm_and_ps(y, abs_mask);
+    const __m128 denominator = _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(std::numeric_limits<float>::min()));
+    const __m128 t = _mm_div_ps(_mm_min_ps(ax, ay), denominator);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 reduce = _mm_cmpgt_ps(t, _mm_set1_ps(TAN_PI_8));
+    const __m128 u = SelectSSE2(reduce, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one)), t);
+    const __m128 s = _mm_mul_ps(u, u);
+    __m128 r = _mm_mul_ps(_mm_set1_ps(ATAN_P0), s);
+    r = _mm_add_ps(r, _mm_set1_ps(ATAN_P1));
+    r = _mm_mul_ps(r, s);
+    r = _mm_add_ps(r, _mm_set1_ps(ATAN_P2));
+    r = _mm_mul_ps(r, s);
+    r = _mm_add_ps(r, _mm_set1_ps(ATAN_P3));
+    r = _mm_mul_ps(r, s);
+    r = _mm_mul_ps(r, u);
+    r = _mm_add_ps(r, u);
+    r = _mm_add_ps(r, _mm_and_ps(reduce, _mm_set1_ps(PI / 4.0f)));
+    r = SelectSSE2(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(PI / 2.0f), r), r);
+    r = SelectSSE2(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(PI), r), r);
+    return SelectSSE2(_mm_cmplt_ps(y, zero), _mm_sub_ps(zero, r), r);
+  }
+
+  static inline void SinCosSSE2(const __m128 value, __m128 &sine, __m128 &cosine) {
+    using namespace cephes;
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(int32_t(0x80000000u)));
+    const __m128 x = _mm_andnot_ps(sign_mask, value);
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    const __m128 y = _mm_cvtepi32_ps(j);
+    __m128 z = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP1)));
+    z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP2)));
+    z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP3)));
+    const __m128 zz = _mm_mul_ps(z, z);
+    __m128 c = _mm_mul_ps(_mm_set1_ps(COS_P0), zz);
+    c = _mm_add_ps(c, _mm_set1_ps(COS_P1));
+    c = _mm_mul_ps(c, zz);
+    c = _mm_add_ps(c, _mm_set1_ps(COS_P2));
+    c = _mm_mul_ps(c, zz);
+    c = _mm_mul_ps(c, zz);
+    c = _mm_sub_ps(c, _mm_mul_ps(_mm_set1_ps(0.5f), zz));
+    c = _mm_add_ps(c, _mm_set1_ps(1.0f));
+    __m128 s = _mm_mul_ps(_mm_set1_ps(SIN_P0), zz);
+    s = _mm_add_ps(s, _mm_set1_ps(SIN_P1));
+    s = _mm_mul_ps(s, zz);
+    s = _mm_add_ps(s, _mm_set1_ps(SIN_P2));
+    s = _mm_mul_ps(s, zz);
+    s = _mm_mul_ps(s, z);
+    s = _mm_add_ps(s, z);
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+    sine = SelectSSE2(swap, c, s);
+    cosine = SelectSSE2(swap, s, c);
+    const __m128 sine_sign = _mm_xor_ps(
+        _mm_and_ps(sign_mask, value),
+        _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+    const __m128 cosine_sign = _mm_andnot_ps(
+        _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29)),
+        sign_mask);
+    sine = _mm_xor_ps(sine, sine_sign);
+    cosine = _mm_xor_ps(cosine, cosine_sign);
+  }
+
+  /// Natural logarithm, values below the smallest normal are clamped to it.
+  static inline __m128 LogSSE2(__m128 x) {
+    using namespace cephes;
+    const __m128 one = _mm_set1_ps(1.0f);
+    x = _mm_max_ps(x, _mm_set1_ps(std::numeric_limits<float>::min()));
+    // Split in exponent and mantissa in [0.5, 1).
+    __m128i exponent = _mm_srli_epi32(_mm_castps_si128(x), 23);
+    x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+    x = _mm_or_ps(x, _mm_set1_ps(0.5f));
+    exponent = _mm_sub_epi32(exponent, _mm_set1_epi32(0x7f));
+    __m128 e = _mm_add_ps(_mm_cvtepi32_ps(exponent), one);
+    // Move the mantissa to [sqrt(1/2), sqrt(2)) - 1.
+    const __m128 mask = _mm_cmplt_ps(x, _mm_set1_ps(LOG_SQRTHF));
+    const __m128 tmp = _mm_and_ps(x, mask);
+    x = _mm_sub_ps(x, one);
+    e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+    x = _mm_add_ps(x, tmp);
+    const __m128 z = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(LOG_P[0u]);
+    for (size_t k = 1u; k < 9u; ++k) {
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P[k]));
+    }
+    y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(LOG_Q1)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    x = _mm_add_ps(x, y);
+    return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(LOG_Q2)));
+  }
+
+#endif // LIBCARLA_SIMD_SSE2
+
+  // ===========================================================================
+  // -- AVX2 -------------------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_AVX2)
+
+  /// @copydoc LogSSE2
+  LIBCARLA_TARGET_AVX2
+  static inline __m256 LogAVX2(__m256 x) {
+    using namespace cephes;
+    const __m256 one = _mm256_set1_ps(1.0f);
+    x = _mm256_max_ps(x, _mm256_set1_ps(std::numeric_limits<float>::min()));
+    // Split in exponent and mantissa in [0.5, 1).
+    __m256i exponent = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+    x = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(~0x7f800000)));
+    x = _mm256_or_ps(x, _mm256_set1_ps(0.5f));
+    exponent = _mm256_sub_epi32(exponent, _mm256_set1_epi32(0x7f));
+    __m256 e = _mm256_add_ps(_mm256_cvtepi32_ps(exponent), one);
+    // Move the mantissa to [sqrt(1/2), sqrt(2)) - 1.
+    const __m256 mask = _mm256_cmp_ps(x, _mm256_set1_ps(LOG_SQRTHF), _CMP_LT_OQ);
+    const __m256 tmp = _mm256_and_ps(x, mask);
+    x = _mm256_sub_ps(x, one);
+    e = _mm256_sub_ps(e, _mm256_and_ps(one, mask));
+    x = _mm256_add_ps(x, tmp);
+    const __m256 z = _mm256_mul_ps(x, x);
+    __m256 y = _mm256_set1_ps(LOG_P[0u]);
+    for (size_t k = 1u; k < 9u; ++k) {
+      y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(LOG_P[k]));
+    }
+    y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+    y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(LOG_Q1)));
+    y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    x = _mm256_add_ps(x, y);
+    return _mm256_add_ps(x, _mm256_mul_ps(e, _mm256_set1_ps(LOG_Q2)));
+  }
+
+#endif // LIBCARLA_SIMD_AVX2
+
+  // ===========================================================================
+  // -- NEON -------------------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_NEON)
+
+  // Plain mul + add instead of vfmaq, as in the x86 versions.
+
+  static inline float32x4_t Atan2NEON(const float32x4_t y, const float32x4_t x) {
+    using namespace cephes;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t ax = vabsq_f32(x);
+    const float32x4_t ay = vabsq_f32(y);
+    const float32x4_t denominator = vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(std::numeric_limits<float>::min()));
+    const float32x4_t t = vdivq_f32(vminq_f32(ax, ay), denominator);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const uint32x4_t reduce = vcgtq_f32(t, vdupq_n_f32(TAN_PI_8));
+    const float32x4_t u = vbslq_f32(reduce, vdivq_f32(vsubq_f32(t, one), vaddq_f32(t, one)), t);
+    const float32x4_t s = vmulq_f32(u, u);
+    float32x4_t r = vmulq_f32(vdupq_n_f32(ATAN_P0), s);
+    r = vaddq_f32(r, vdupq_n_f32(ATAN_P1));
+    r = vmulq_f32(r, s);
+    r = vaddq_f32(r, vdupq_n_f32(ATAN_P2));
+    r = vmulq_f32(r, s);
+    r = vaddq_f32(r, vdupq_n_f32(ATAN_P3));
+    r = vmulq_f32(r, s);
+    r = vmulq_f32(r, u);
+    r = vaddq_f32(r, u);
+    r = vaddq_f32(r, vbslq_f32(reduce, vdupq_n_f32(PI / 4.0f), zero));
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(PI / 2.0f), r), r);
+    r = vbslq_f32(vcltq_f32(x, zero), vsubq_f32(vdupq_n_f32(PI), r), r);
+    return vbslq_f32(vcltq_f32(y, zero), vsubq_f32(zero, r), r);
+  }
+
+  static inline void SinCosNEON(const float32x4_t value, float32x4_t &sine, float32x4_t &cosine) {
+    using namespace cephes;
+    const float32x4_t x = vabsq_f32(value);
+    int32x4_t j = vcvtq_s32_f32(vmulq_f32(x, vdupq_n_f32(FOUR_OVER_PI)));
+    j = vandq_s32(vaddq_s32(j, vdupq_n_s32(1)), vdupq_n_s32(~1));
+    const float32x4_t y = vcvtq_f32_s32(j);
+    float32x4_t z = vsubq_f32(x, vmulq_f32(y, vdupq_n_f32(SINCOS_DP1)));
+    z = vsubq_f32(z, vmulq_f32(y, vdupq_n_f32(SINCOS_DP2)));
+    z = vsubq_f32(z, vmulq_f32(y, vdupq_n_f32(SINCOS_DP3)));
+    const float32x4_t zz = vmulq_f32(z, z);
+    float32x4_t c = vmulq_f32(vdupq_n_f32(COS_P0), zz);
+    c = vaddq_f32(c, vdupq_n_f32(COS_P1));
+    c = vmulq_f32(c, zz);
+    c = vaddq_f32(c, vdupq_n_f32(COS_P2));
+    c = vmulq_f32(c, zz);
+    c = vmulq_f32(c, zz);
+    c = vsubq_f32(c, vmulq_f32(vdupq_n_f32(0.5f), zz));
+    c = vaddq_f32(c, vdupq_n_f32(1.0f));
+    float32x4_t s = vmulq_f32(vdupq_n_f32(SIN_P0), zz);
+    s = vaddq_f32(s, vdupq_n_f32(SIN_P1));
+    s = vmulq_f32(s, zz);
+    s = vaddq_f32(s, vdupq_n_f32(SIN_P2));
+    s = vmulq_f32(s, zz);
+    s = vmulq_f32(s, z);
+    s = vaddq_f32(s, z);
+    const uint32x4_t swap = vtstq_s32(j, vdupq_n_s32(2));
+    sine = vbslq_f32(swap, c, s);
+    cosine = vbslq_f32(swap, s, c);
+    const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+    const uint32x4_t sine_sign = veorq_u32(
+        vandq_u32(vreinterpretq_u32_f32(value), sign_mask),
+        vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(j, vdupq_n_s32(4))), 29));
+    const uint32x4_t cosine_sign = vbicq_u32(
+        sign_mask,
+        vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(vsubq_s32(j, vdupq_n_s32(2)), vdupq_n_s32(4))), 29));
+    sine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sine), sine_sign));
+    cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cosine), cosine_sign));
+  }
+
+  /// @copydoc LogSSE2
+  static inline float32x4_t LogNEON(float32x4_t x) {
+    using namespace cephes;
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    x = vmaxq_f32(x, vdupq_n_f32(std::numeric_limits<float>::min()));
+    // Split in exponent and mantissa in [0.5, 1).
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+    const int32x4_t exponent = vsubq_s32(
+        vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)),
+        vdupq_n_s32(0x7f));
+    x = vreinterpretq_f32_u32(vorrq_u32(
+        vandq_u32(bits, vdupq_n_u32(~0x7f800000u)),
+        vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+    float32x4_t e = vaddq_f32(vcvtq_f32_s32(exponent), one);
+    // Move the mantissa to [sqrt(1/2), sqrt(2)) - 1.
+    const uint32x4_t mask = vcltq_f32(x, vdupq_n_f32(LOG_SQRTHF));
+    const float32x4_t tmp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x), mask));
+    x = vsubq_f32(x, one);
+    e = vsubq_f32(e, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(one), mask)));
+    x = vaddq_f32(x, tmp);
+    const float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y = vdupq_n_f32(LOG_P[0u]);
+    for (size_t k = 1u; k < 9u; ++k) {
+      y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(LOG_P[k]));
+    }
+    y = vmulq_f32(vmulq_f32(y, x), z);
+    y = vaddq_f32(y, vmulq_f32(e, vdupq_n_f32(LOG_Q1)));
+    y = vsubq_f32(y, vmulq_f32(z, vdupq_n_f32(0.5f)));
+    x = vaddq_f32(x, y);
+    return vaddq_f32(x, vmulq_f32(e, vdupq_n_f32(LOG_Q2)));
+  }
+
+#endif // LIBCARLA_SIMD_NEON
+
+} // namespace simd
+} // namespace carla
@@ -27,6 +27,9 @@ namespace client {
 
     static bool FileExists(std::string file);
 
+    /// Path of @a file in the cache folder of this version.
+    static std::string GetFullPath(const std::string &file);
+
     static bool WriteFile(std::string path, std::vector<uint8_t> content);
 
     static std::vector<uint8_t> ReadFile(std::string path);
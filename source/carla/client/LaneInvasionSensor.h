@@ -26,6 +26,10 @@ namespace client {
     /// Register a @a callback to be executed each time a new measurement is
     /// received.
     ///
+    /// The callback is called from a thread of the client dedicated to lane
+    /// invasions, shared by every LaneInvasionSensor of the episode, once per
+    /// frame with a lane invasion and in order of frame.
+    ///
     /// @warning Calling this function on a sensor that is already listening
     /// steals the data stream from the previously set callback. Note that
     /// several instances of Sensor (even in different processes) may point to
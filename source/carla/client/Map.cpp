@@ -95,9 +95,11 @@ namespace client {
   std::vector<SharedPtr<Waypoint>> Map::GenerateWaypoints(double distance) const {
     std::vector<SharedPtr<Waypoint>> result;
     const auto waypoints = _map.GenerateWaypoints(distance);
+    const auto transforms = _map.ComputeTransforms(waypoints);
     result.reserve(waypoints.size());
-    for (const auto &waypoint : waypoints) {
-      result.emplace_back(SharedPtr<Waypoint>(new Waypoint{shared_from_this(), waypoint}));
+    for (size_t i = 0u; i < waypoints.size(); ++i) {
+      result.emplace_back(SharedPtr<Waypoint>(
+          new Waypoint{shared_from_this(), waypoints[i], transforms[i]}));
     }
     return result;
   }
@@ -21,6 +21,15 @@ namespace client {
       _transform(_parent->GetMap().ComputeTransform(_waypoint)),
       _mark_record(_parent->GetMap().GetMarkRecord(_waypoint)) {}
 
+  Waypoint::Waypoint(
+      SharedPtr<const Map> parent,
+      road::element::Waypoint waypoint,
+      geom::Transform transform)
+    : _parent(std::move(parent)),
+      _waypoint(std::move(waypoint)),
+      _transform(std::move(transform)),
+      _mark_record(_parent->GetMap().GetMarkRecord(_waypoint)) {}
+
   Waypoint::~Waypoint() = default;
 
   road::JuncId Waypoint::GetJunctionId() const {
@@ -110,6 +110,12 @@ namespace client {
 
     Waypoint(SharedPtr<const Map> parent, road::element::Waypoint waypoint);
 
+    /// Constructs the waypoint with an already computed @a transform.
+    Waypoint(
+        SharedPtr<const Map> parent,
+        road::element::Waypoint waypoint,
+        geom::Transform transform);
+
     SharedPtr<const Map> _parent;
 
     road::element::Waypoint _waypoint;
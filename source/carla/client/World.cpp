@@ -167,6 +167,10 @@ namespace client {
     return _episode.Lock()->Tick(local_timeout);
   }
 
+  void World::SetPipelinedTick(bool enabled) {
+    _episode.Lock()->SetPipelinedTick(enabled);
+  }
+
   void World::SetPedestriansCrossFactor(float percentage) {
     _episode.Lock()->SetPedestriansCrossFactor(percentage);
   }
@@ -175,6 +179,14 @@ namespace client {
     _episode.Lock()->SetPedestriansSeed(seed);
   }
 
+  bool World::SetPedestriansCrowdSettings(const nav::CrowdSettings &settings) {
+    return _episode.Lock()->SetPedestriansCrowdSettings(settings);
+  }
+
+  void World::SetPedestriansTileStreaming(const nav::TileStreamingSettings &settings) {
+    _episode.Lock()->SetPedestriansTileStreaming(settings);
+  }
+
   SharedPtr<Actor> World::GetTrafficSign(const Landmark& landmark) const {
     SharedPtr<ActorList> actors = GetActors();
     SharedPtr<TrafficSign> result;
@@ -17,6 +17,8 @@
 #include "carla/client/WorldSnapshot.h"
 #include "carla/client/detail/EpisodeProxy.h"
 #include "carla/geom/Transform.h"
+#include "carla/nav/CrowdSettings.h"
+#include "carla/nav/TileStreamingSettings.h"
 #include "carla/rpc/Actor.h"
 #include "carla/rpc/AttachmentType.h"
 #include "carla/rpc/EpisodeSettings.h"
@@ -148,6 +150,13 @@ namespace client {
     /// @return The id of the frame that this call started.
     uint64_t Tick(time_duration timeout);
 
+    /// Enable or disable the pipelined tick (only has effect on synchronous
+    /// mode). Each Tick then sends the tick cue right after the controls of
+    /// the previous frame are committed, and the traffic manager and the
+    /// pedestrians compute the next controls while the simulator runs the
+    /// frame, at the cost of one frame of latency in the controls.
+    void SetPipelinedTick(bool enabled);
+
     /// set the probability that an agent could cross the roads in its path following
     /// percentage of 0.0f means no pedestrian can cross roads
     /// percentage of 0.5f means 50% of all pedestrians can cross roads
@@ -157,6 +166,17 @@ namespace client {
     /// set the seed to use with random numbers in the pedestrians module
     void SetPedestriansSeed(unsigned int seed);
 
+    /// set the size of the crowds that move the pedestrians and how the map
+    /// is split between them, see nav::CrowdSettings. It has to be called
+    /// before spawning any pedestrian, otherwise it returns false and the
+    /// settings are not changed
+    bool SetPedestriansCrowdSettings(const nav::CrowdSettings &settings);
+
+    /// Keep in memory only the tiles of the pedestrians navigation mesh
+    /// around the hero vehicles and the interest points of @a settings,
+    /// instead of the whole map, see nav::TileStreamingSettings.
+    void SetPedestriansTileStreaming(const nav::TileStreamingSettings &settings);
+
     SharedPtr<Actor> GetTrafficSign(const Landmark& landmark) const;
 
     SharedPtr<Actor> GetTrafficLight(const Landmark& landmark) const;
@@ -6,66 +6,199 @@
 
 #pragma once
 
-#include "carla/AtomicList.h"
+#include "carla/AtomicSharedPtr.h"
+#include "carla/Debug.h"
+#include "carla/InlineFunction.h"
+#include "carla/JobSystem.h"
 #include "carla/NonCopyable.h"
 
+#include <algorithm>
 #include <atomic>
-#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace carla {
 namespace client {
 namespace detail {
 
+  /// List of callbacks called with the same arguments, passed by const
+  /// reference.
+  ///
+  /// Each callback is allocated once, with small callables stored in place,
+  /// and shared between the versions of the list; registering a callback
+  /// copies only pointers, and removing one flags it and compacts the list
+  /// once half of it is removed. Call only loads the current version.
+  ///
+  /// Callbacks registered as thread-safe may be called concurrently with each
+  /// other on the shared JobSystem, before the rest, which are called in
+  /// order of registration on the calling thread.
+  ///
+  /// A removed callback is not called by the calls that start after Remove
+  /// returns, but may still be running from a previous call.
   template <typename... InputsT>
   class CallbackList : private NonCopyable {
   public:
 
-    using CallbackType = std::function<void(InputsT...)>;
+    using CallbackType = InlineFunction<void(const InputsT &...)>;
 
-    void Call(InputsT... args) const {
-      auto list = _list.Load();
-      for (auto &item : *list) {
-        item.callback(args...);
+    CallbackList() : _list(std::make_shared<List>()) {}
+
+    void Call(const InputsT &... args) const {
+      auto list = _list.load();
+      if (!list->thread_safe_items.empty()) {
+        JobSystem::Get().ParallelFor(list->thread_safe_items.size(), [&](size_t i) {
+          list->thread_safe_items[i]->Call(args...);
+        });
+      }
+      for (auto &item : list->items) {
+        item->Call(args...);
       }
     }
 
-    size_t Push(CallbackType &&callback) {
-      auto id = ++_counter;
-      DEBUG_ASSERT(id != 0u);
-      _list.Push(Item{id, std::move(callback)});
+    size_t Push(CallbackType &&callback, bool is_thread_safe = false) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto new_list = MakeCompactList(1u);
+      const size_t id = PushItem(*new_list, std::move(callback), is_thread_safe);
+      _list = new_list;
       return id;
     }
 
+    /// Registers all the @a callbacks at once, returns their ids in the same
+    /// order.
+    std::vector<size_t> Push(std::vector<CallbackType> &&callbacks, bool is_thread_safe = false) {
+      std::vector<size_t> ids;
+      ids.reserve(callbacks.size());
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto new_list = MakeCompactList(callbacks.size());
+      for (auto &callback : callbacks) {
+        ids.emplace_back(PushItem(*new_list, std::move(callback), is_thread_safe));
+      }
+      _list = new_list;
+      return ids;
+    }
+
     void Remove(size_t id) {
-      _list.DeleteByValue(id);
+      std::lock_guard<std::mutex> lock(_mutex);
+      RemoveItem(id);
+      CompactIfNeeded();
+    }
+
+    void Remove(const std::vector<size_t> &ids) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto id : ids) {
+        RemoveItem(id);
+      }
+      CompactIfNeeded();
     }
 
     void Clear() {
-      _list.Clear();
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto list = _list.load();
+      for (auto *items : {&list->thread_safe_items, &list->items}) {
+        for (auto &item : *items) {
+          item->is_removed = true;
+        }
+      }
+      _removed_count = 0u;
+      _list = std::make_shared<List>();
     }
 
   private:
 
     struct Item {
-      size_t id;
-      CallbackType callback;
+      Item(size_t id, CallbackType &&callback)
+        : id(id),
+          callback(std::move(callback)) {}
+
+      void Call(const InputsT &... args) const {
+        if (!is_removed) {
+          callback(args...);
+        }
+      }
+
+      const size_t id;
+
+      const CallbackType callback;
+
+      std::atomic_bool is_removed{false};
+    };
 
-      friend bool operator==(const Item &lhs, const Item &rhs) {
-        return lhs.id == rhs.id;
+    struct List {
+      std::vector<std::shared_ptr<Item>> thread_safe_items;
+
+      std::vector<std::shared_ptr<Item>> items;
+
+      size_t size() const {
+        return thread_safe_items.size() + items.size();
       }
+    };
+
+    /// Copy of the current list without the removed items, with room for
+    /// @a extra more. Must be called with the mutex locked.
+    std::shared_ptr<List> MakeCompactList(size_t extra) {
+      auto list = _list.load();
+      auto new_list = std::make_shared<List>();
+      const bool has_removed = (_removed_count > 0u);
+      auto copy = [extra, has_removed](const auto &from, auto &to) {
+        to.reserve(from.size() + extra);
+        if (!has_removed) {
+          to.insert(to.end(), from.begin(), from.end());
+          return;
+        }
+        for (auto &item : from) {
+          if (!item->is_removed) {
+            to.emplace_back(item);
+          }
+        }
+      };
+      copy(list->thread_safe_items, new_list->thread_safe_items);
+      copy(list->items, new_list->items);
+      _removed_count = 0u;
+      return new_list;
+    }
+
+    /// Must be called with the mutex locked.
+    size_t PushItem(List &list, CallbackType &&callback, bool is_thread_safe) {
+      const size_t id = ++_counter;
+      DEBUG_ASSERT(id != 0u);
+      auto item = std::make_shared<Item>(id, std::move(callback));
+      (is_thread_safe ? list.thread_safe_items : list.items).emplace_back(std::move(item));
+      return id;
+    }
 
-      friend bool operator==(const Item &lhs, size_t rhs) {
-        return lhs.id == rhs;
+    /// Items are kept sorted by id. Must be called with the mutex locked.
+    void RemoveItem(size_t id) {
+      auto list = _list.load();
+      for (auto *items : {&list->thread_safe_items, &list->items}) {
+        auto it = std::lower_bound(items->begin(), items->end(), id, [](const auto &item, size_t value) {
+          return item->id < value;
+        });
+        if ((it != items->end()) && ((*it)->id == id)) {
+          if (!(*it)->is_removed) {
+            (*it)->is_removed = true;
+            ++_removed_count;
+          }
+          return;
+        }
       }
+    }
 
-      friend bool operator==(size_t lhs, const Item &rhs) {
-        return lhs == rhs.id;
+    /// Must be called with the mutex locked.
+    void CompactIfNeeded() {
+      if (2u * _removed_count > _list.load()->size()) {
+        _list = MakeCompactList(0u);
       }
-    };
+    }
+
+    std::mutex _mutex;
+
+    size_t _counter = 0u;
 
-    std::atomic_size_t _counter{0u};
+    /// Items of the current list that are flagged as removed.
+    size_t _removed_count = 0u;
 
-    AtomicList<Item> _list;
+    AtomicSharedPtr<const List> _list;
   };
 
 } // namespace detail
@@ -7,6 +7,7 @@
 #include "carla/client/detail/Client.h"
 
 #include "carla/Exception.h"
+#include "carla/Logging.h"
 #include "carla/Version.h"
 #include "carla/client/FileTransfer.h"
 #include "carla/client/TimeoutException.h"
@@ -26,6 +27,8 @@
 
 #include <rpc/rpc_error.h>
 
+#include <atomic>
+#include <string>
 #include <thread>
 
 namespace carla {
@@ -41,6 +44,18 @@ namespace detail {
     return true;
   }
 
+  /// Whether @a e is the error rpclib sends back when the server does not
+  /// have the function called.
+  static bool IsUnknownFunctionError(::rpc::rpc_error &e) {
+    try {
+      const auto &error = e.get_error().get();
+      return (error.type == clmdep_msgpack::type::STR) &&
+          (error.as<std::string>().find("could not find function") != std::string::npos);
+    } catch (const std::exception &) {
+      return false;
+    }
+  }
+
   // ===========================================================================
   // -- Client::Pimpl ----------------------------------------------------------
   // ===========================================================================
@@ -93,6 +108,10 @@ namespace detail {
 
     rpc::Client rpc_client;
 
+    /// Cleared the first time the server reports it does not have
+    /// "apply_packed_batch".
+    std::atomic_bool packed_batch_supported{true};
+
     streaming::Client streaming_client;
   };
 
@@ -757,6 +776,35 @@ namespace detail {
     return result.as<std::vector<rpc::CommandResponse>>();
   }
 
+  bool Client::TryApplyPackedBatchSync(
+      const rpc::PackedCommandBatch &batch,
+      bool do_tick_cue) {
+    if (!_pimpl->packed_batch_supported) {
+      return false;
+    }
+    try {
+      _pimpl->RawCall("apply_packed_batch", batch, do_tick_cue);
+      return true;
+    } catch (::rpc::rpc_error &e) {
+      // Any other error, e.g. a command the server failed to apply, is
+      // reported as usual.
+      if (!IsUnknownFunctionError(e)) {
+        throw;
+      }
+      log_warning("the server does not handle packed command batches, using apply_batch");
+      _pimpl->packed_batch_supported = false;
+      return false;
+    }
+  }
+
+  void Client::ApplyPackedBatchSync(
+      const rpc::PackedCommandBatch &batch,
+      bool do_tick_cue) {
+    if (!TryApplyPackedBatchSync(batch, do_tick_cue)) {
+      ApplyBatchSync(batch.ToCommands(), do_tick_cue);
+    }
+  }
+
   uint64_t Client::SendTickCue() {
     return _pimpl->CallAndWait<uint64_t>("tick_cue");
   }
@@ -24,6 +24,7 @@
 #include "carla/rpc/MapInfo.h"
 #include "carla/rpc/MapLayer.h"
 #include "carla/rpc/OpendriveGenerationParameters.h"
+#include "carla/rpc/PackedCommandBatch.h"
 #include "carla/rpc/TrafficLightState.h"
 #include "carla/rpc/VehicleDoor.h"
 #include "carla/rpc/VehicleLightStateList.h"
@@ -472,6 +473,18 @@ namespace detail {
         std::vector<rpc::Command> commands,
         bool do_tick_cue);
 
+    /// Applies @a batch and waits for it. Returns false, without applying
+    /// it, if the server does not handle packed batches.
+    bool TryApplyPackedBatchSync(
+        const rpc::PackedCommandBatch &batch,
+        bool do_tick_cue);
+
+    /// Applies @a batch and waits for it. Falls back to "apply_batch" if the
+    /// server does not handle packed batches.
+    void ApplyPackedBatchSync(
+        const rpc::PackedCommandBatch &batch,
+        bool do_tick_cue);
+
     uint64_t SendTickCue();
 
     std::vector<rpc::LightState> QueryLightsStateToServer() const;
@@ -8,8 +8,10 @@
 
 #include "carla/Logging.h"
 #include "carla/client/detail/Client.h"
+#include "carla/client/detail/LaneInvasionDetector.h"
 #include "carla/client/detail/WalkerNavigation.h"
 #include "carla/sensor/Deserializer.h"
+#include "carla/sensor/StreamRecorder.h"
 #include "carla/trafficmanager/TrafficManager.h"
 
 #include <exception>
@@ -57,6 +59,8 @@ using namespace std::chrono_literals;
       auto self = weak.lock();
       if (self != nullptr) {
 
+        self->RecordStreamBuffer(sensor::StreamRecorder::EPISODE_STREAM_ID, buffer);
+
         auto data = sensor::Deserializer::Deserialize(std::move(buffer));
         auto next = std::make_shared<const EpisodeState>(CastData(*data));
         auto prev = self->GetState();
@@ -134,6 +138,7 @@ using namespace std::chrono_literals;
     _actors.Clear();
     _on_tick_callbacks.Clear();
     _walker_navigation.reset();
+    _lane_invasion_detector.reset();
     traffic_manager::TrafficManager::Release();
   }
 
@@ -161,6 +166,40 @@ using namespace std::chrono_literals;
     return nav;
   }
 
+  std::shared_ptr<LaneInvasionDetector> Episode::CreateLaneInvasionDetectorIfMissing() {
+    std::shared_ptr<LaneInvasionDetector> detector;
+    do {
+      detector = _lane_invasion_detector.load();
+      if (detector == nullptr) {
+        auto new_detector = std::make_shared<LaneInvasionDetector>();
+        if (_lane_invasion_detector.compare_exchange(&detector, new_detector)) {
+          std::weak_ptr<LaneInvasionDetector> weak = new_detector;
+          // Tick only stores the snapshot under the lock of the detector.
+          constexpr bool is_thread_safe = true;
+          RegisterOnTickEvent([weak](const WorldSnapshot &snapshot) {
+            auto self = weak.lock();
+            if (self != nullptr) {
+              self->Tick(snapshot);
+            }
+          }, is_thread_safe);
+          detector = std::move(new_detector);
+        }
+      }
+    } while (detector == nullptr);
+    return detector;
+  }
+
+  void Episode::RecordStreamBuffer(const uint64_t stream_id, const Buffer &buffer) {
+    auto recorder = _stream_recorder.load();
+    if (recorder != nullptr) {
+      try {
+        recorder->Append(stream_id, buffer);
+      } catch (const std::exception &e) {
+        log_error("failed to record stream", stream_id, ':', e.what());
+      }
+    }
+  }
+
 } // namespace detail
 } // namespace client
 } // namespace carla
@@ -22,10 +22,17 @@
 class FPoseSnapshot;
 
 namespace carla {
+namespace sensor {
+
+  class StreamRecorder;
+
+} // namespace sensor
+
 namespace client {
 namespace detail {
 
   class Client;
+  class LaneInvasionDetector;
   class WalkerNavigation;
 
   /// Holds the current episode, and the current episode state.
@@ -66,15 +73,30 @@ namespace detail {
       return _snapshot.WaitFor(timeout);
     }
 
-    size_t RegisterOnTickEvent(std::function<void(WorldSnapshot)> callback) {
-      return _on_tick_callbacks.Push(std::move(callback));
+    using EventCallback = CallbackList<WorldSnapshot>::CallbackType;
+
+    /// Registers @a callback to be called on every world tick. If
+    /// @a is_thread_safe, it may be called on the JobSystem concurrently with
+    /// other thread-safe callbacks.
+    size_t RegisterOnTickEvent(EventCallback callback, bool is_thread_safe = false) {
+      return _on_tick_callbacks.Push(std::move(callback), is_thread_safe);
+    }
+
+    /// Registers all the @a callbacks at once, returns their ids in the same
+    /// order.
+    std::vector<size_t> RegisterOnTickEvents(std::vector<EventCallback> callbacks, bool is_thread_safe = false) {
+      return _on_tick_callbacks.Push(std::move(callbacks), is_thread_safe);
     }
 
     void RemoveOnTickEvent(size_t id) {
       _on_tick_callbacks.Remove(id);
     }
 
-    size_t RegisterOnMapChangeEvent(std::function<void(WorldSnapshot)> callback) {
+    void RemoveOnTickEvents(const std::vector<size_t> &ids) {
+      _on_tick_callbacks.Remove(ids);
+    }
+
+    size_t RegisterOnMapChangeEvent(EventCallback callback) {
       return _on_map_change_callbacks.Push(std::move(callback));
     }
 
@@ -82,7 +104,7 @@ namespace detail {
       _on_map_change_callbacks.Remove(id);
     }
 
-    size_t RegisterLightUpdateChangeEvent(std::function<void(WorldSnapshot)> callback) {
+    size_t RegisterLightUpdateChangeEvent(EventCallback callback) {
       return _on_light_update_callbacks.Push(std::move(callback));
     }
 
@@ -103,6 +125,24 @@ namespace detail {
 
     std::shared_ptr<WalkerNavigation> CreateNavigationIfMissing();
 
+    /// Detector shared by all the lane invasion sensors of the episode,
+    /// subscribed to the tick event when created.
+    std::shared_ptr<LaneInvasionDetector> CreateLaneInvasionDetectorIfMissing();
+
+    /// Records the raw buffers of the episode state stream and of the
+    /// subscribed sensors into @a recorder, null stops recording.
+    void SetStreamRecorder(std::shared_ptr<sensor::StreamRecorder> recorder) {
+      _stream_recorder = std::move(recorder);
+    }
+
+    std::shared_ptr<sensor::StreamRecorder> GetStreamRecorder() const {
+      return _stream_recorder.load();
+    }
+
+    /// Appends @a buffer of stream @a stream_id to the stream recorder, if
+    /// any.
+    void RecordStreamBuffer(uint64_t stream_id, const Buffer &buffer);
+
   private:
 
     Episode(Client &client, const rpc::EpisodeInfo &info, std::weak_ptr<Simulator> simulator);
@@ -129,6 +169,10 @@ namespace detail {
 
     AtomicSharedPtr<WalkerNavigation> _walker_navigation;
 
+    AtomicSharedPtr<LaneInvasionDetector> _lane_invasion_detector;
+
+    AtomicSharedPtr<sensor::StreamRecorder> _stream_recorder;
+
     const streaming::Token _token;
 
     bool _pending_exceptions = false;
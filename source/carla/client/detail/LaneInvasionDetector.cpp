@@ -0,0 +1,307 @@
+// Copyright (c) 2019 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/client/detail/LaneInvasionDetector.h"
+
+#include "carla/Logging.h"
+#include "carla/ParallelFor.h"
+#include "carla/client/Map.h"
+#include "carla/geom/Location.h"
+#include "carla/geom/Math.h"
+#include "carla/road/element/LaneCrossingCalculator.h"
+#include "carla/sensor/data/LaneInvasionEvent.h"
+
+#include <boost/optional.hpp>
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace carla {
+namespace client {
+namespace detail {
+
+  using road::element::LaneCrossingCalculator;
+  using road::element::LaneProjection;
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  static geom::Location Rotate(float yaw, const geom::Location &location) {
+    yaw *= geom::Math::Pi<float>() / 180.0f;
+    const float c = std::cos(yaw);
+    const float s = std::sin(yaw);
+    return {
+        c * location.x - s * location.y,
+        s * location.x + c * location.y,
+        location.z};
+  }
+
+  static std::array<geom::Location, 4u> MakeCorners(
+      const geom::BoundingBox &box,
+      const geom::Transform &transform) {
+    const auto location = transform.location + box.location;
+    const auto yaw = transform.rotation.yaw;
+    return {{
+        location + Rotate(yaw, geom::Location( box.extent.x,  box.extent.y, 0.0f)),
+        location + Rotate(yaw, geom::Location(-box.extent.x,  box.extent.y, 0.0f)),
+        location + Rotate(yaw, geom::Location( box.extent.x, -box.extent.y, 0.0f)),
+        location + Rotate(yaw, geom::Location(-box.extent.x, -box.extent.y, 0.0f))}};
+  }
+
+  // ===========================================================================
+  // -- LaneInvasionDetector::Vehicle ------------------------------------------
+  // ===========================================================================
+
+  struct LaneInvasionDetector::Vehicle {
+    Vehicle(
+        size_t in_id,
+        ActorId in_actor,
+        const geom::BoundingBox &in_bounding_box,
+        SharedPtr<const Map> in_map,
+        Sensor::CallbackFunctionType in_callback)
+      : id(in_id),
+        actor(in_actor),
+        bounding_box(in_bounding_box),
+        map(std::move(in_map)),
+        callback(std::move(in_callback)) {}
+
+    const size_t id;
+
+    const ActorId actor;
+
+    const geom::BoundingBox bounding_box;
+
+    const SharedPtr<const Map> map;
+
+    const Sensor::CallbackFunctionType callback;
+
+    /// Cleared on unregister, a pass already running may still process the
+    /// vehicle but does not call the callback.
+    std::atomic_bool active{true};
+
+    // Only accessed by the processing job.
+
+    bool has_corners = false;
+
+    size_t frame = 0u;
+
+    std::array<geom::Location, 4u> corners;
+
+    /// Lane of each corner the last time it was projected. The corner is at
+    /// the projected location or well inside that lane.
+    std::array<LaneProjection, 4u> lanes;
+
+    std::array<bool, 4u> has_lane{{false, false, false, false}};
+
+    /// Updates the vehicle with @a snapshot, returns the event to report, if
+    /// any.
+    SharedPtr<sensor::SensorData> Detect(const WorldSnapshot &snapshot);
+  };
+
+  SharedPtr<sensor::SensorData> LaneInvasionDetector::Vehicle::Detect(
+      const WorldSnapshot &snapshot) {
+    // Make sure the parent is alive.
+    auto parent = snapshot.Find(actor);
+    if (!parent) {
+      return nullptr;
+    }
+
+    const auto next = MakeCorners(bounding_box, parent->transform);
+
+    // First frame there is nothing to compare with.
+    if (!has_corners) {
+      has_corners = true;
+      frame = snapshot.GetFrame();
+      corners = next;
+      return nullptr;
+    }
+
+    // Make sure the current frame is up-to-date.
+    if (frame >= snapshot.GetFrame()) {
+      return nullptr;
+    }
+
+    // Make sure the distance is long enough.
+    constexpr float distance_threshold = 10.0f * std::numeric_limits<float>::epsilon();
+    for (auto i = 0u; i < 4u; ++i) {
+      if ((next[i] - corners[i]).Length() < distance_threshold) {
+        return nullptr;
+      }
+    }
+
+    const road::Map &road_map = map->GetMap();
+    std::vector<road::element::LaneMarking> crossed_lanes;
+    for (auto i = 0u; i < 4u; ++i) {
+      // A corner that stays well inside its lane cannot cross any marking.
+      if (has_lane[i] && LaneCrossingCalculator::IsWellInsideLane(lanes[i], next[i])) {
+        continue;
+      }
+      if (!has_lane[i]) {
+        lanes[i] = LaneCrossingCalculator::Project(road_map, corners[i]);
+      }
+      auto next_lane = LaneCrossingCalculator::Project(road_map, next[i]);
+      const auto crossed = LaneCrossingCalculator::Calculate(
+          road_map,
+          corners[i],
+          lanes[i],
+          next[i],
+          next_lane);
+      crossed_lanes.insert(crossed_lanes.end(), crossed.begin(), crossed.end());
+      lanes[i] = std::move(next_lane);
+      has_lane[i] = true;
+    }
+    frame = snapshot.GetFrame();
+    corners = next;
+
+    if (crossed_lanes.empty()) {
+      return nullptr;
+    }
+    return MakeShared<sensor::data::LaneInvasionEvent>(
+        snapshot.GetTimestamp().frame,
+        snapshot.GetTimestamp().elapsed_seconds,
+        parent->transform,
+        actor,
+        std::move(crossed_lanes));
+  }
+
+  // ===========================================================================
+  // -- LaneInvasionDetector::State --------------------------------------------
+  // ===========================================================================
+
+  struct LaneInvasionDetector::State {
+    std::mutex mutex;
+
+    std::condition_variable condition;
+
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+
+    std::deque<WorldSnapshot> pending;
+
+    size_t dropped = 0u;
+
+    bool stop = false;
+  };
+
+  // ===========================================================================
+  // -- LaneInvasionDetector ---------------------------------------------------
+  // ===========================================================================
+
+  LaneInvasionDetector::LaneInvasionDetector()
+    : _state(std::make_shared<State>()),
+      _thread(&LaneInvasionDetector::ProcessSnapshots, _state) {}
+
+  LaneInvasionDetector::~LaneInvasionDetector() {
+    {
+      std::lock_guard<std::mutex> lock(_state->mutex);
+      _state->stop = true;
+      _state->vehicles.clear();
+    }
+    _state->condition.notify_one();
+    // A callback may release the last reference to the detector, its own
+    // thread cannot join itself.
+    if (_thread.get_id() == std::this_thread::get_id()) {
+      _thread.detach();
+    } else {
+      _thread.join();
+    }
+  }
+
+  size_t LaneInvasionDetector::Register(
+      const ActorId vehicle,
+      const geom::BoundingBox &bounding_box,
+      SharedPtr<const Map> map,
+      Sensor::CallbackFunctionType callback) {
+    DEBUG_ASSERT(map != nullptr);
+    // Unique between detectors, so an id is never reused by a new episode.
+    static std::atomic_size_t next_id{1u};
+    const size_t id = next_id++;
+    auto entry = std::make_shared<Vehicle>(id, vehicle, bounding_box, std::move(map), std::move(callback));
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    _state->vehicles.emplace_back(std::move(entry));
+    return id;
+  }
+
+  void LaneInvasionDetector::Unregister(const size_t id) {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    auto &vehicles = _state->vehicles;
+    for (auto it = vehicles.begin(); it != vehicles.end(); ++it) {
+      if ((*it)->id == id) {
+        (*it)->active = false;
+        vehicles.erase(it);
+        return;
+      }
+    }
+  }
+
+  void LaneInvasionDetector::Tick(const WorldSnapshot &snapshot) {
+    {
+      std::lock_guard<std::mutex> lock(_state->mutex);
+      if (_state->vehicles.empty()) {
+        return;
+      }
+      if (_state->pending.size() >= MAX_PENDING_SNAPSHOTS) {
+        _state->pending.pop_front();
+        if (_state->dropped++ == 0u) {
+          log_warning("LaneInvasionSensor: callbacks too slow, dropping world snapshots");
+        }
+      }
+      _state->pending.emplace_back(snapshot);
+    }
+    _state->condition.notify_one();
+  }
+
+  size_t LaneInvasionDetector::GetDroppedSnapshotCount() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->dropped;
+  }
+
+  void LaneInvasionDetector::ProcessSnapshots(std::shared_ptr<State> state) {
+    for (;;) {
+      boost::optional<WorldSnapshot> snapshot;
+      std::vector<std::shared_ptr<Vehicle>> vehicles;
+      {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->condition.wait(lock, [&]() { return state->stop || !state->pending.empty(); });
+        if (state->stop) {
+          return;
+        }
+        snapshot = std::move(state->pending.front());
+        state->pending.pop_front();
+        vehicles = state->vehicles;
+      }
+
+      std::vector<SharedPtr<sensor::SensorData>> events(vehicles.size());
+      ParallelFor(vehicles.size(), [&](const size_t i) {
+        try {
+          events[i] = vehicles[i]->Detect(*snapshot);
+        } catch (const std::exception &e) {
+          log_error("LaneInvasionSensor:", e.what());
+        }
+      });
+
+      for (size_t i = 0u; i < vehicles.size(); ++i) {
+        if ((events[i] != nullptr) && vehicles[i]->active) {
+          try {
+            vehicles[i]->callback(std::move(events[i]));
+          } catch (const std::exception &e) {
+            log_error("LaneInvasionSensor:", e.what());
+          }
+        }
+      }
+    }
+  }
+
+} // namespace detail
+} // namespace client
+} // namespace carla
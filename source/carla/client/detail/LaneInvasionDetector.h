@@ -0,0 +1,88 @@
+// Copyright (c) 2019 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Memory.h"
+#include "carla/NonCopyable.h"
+#include "carla/client/Sensor.h"
+#include "carla/client/WorldSnapshot.h"
+#include "carla/geom/BoundingBox.h"
+#include "carla/rpc/ActorId.h"
+
+#include <memory>
+#include <thread>
+
+namespace carla {
+namespace client {
+
+  class Map;
+
+namespace detail {
+
+  /// Detects the lane invasions of every vehicle with a LaneInvasionSensor of
+  /// the episode in a single pass per world tick.
+  ///
+  /// The tick callback only queues the snapshot. A dedicated thread of the
+  /// detector processes the snapshots one by one in order of arrival,
+  /// splitting the vehicles of each one between the threads of the shared
+  /// JobSystem. The lane of each corner of each vehicle is cached, so corners
+  /// that stay well inside the same lane skip the map queries; any other
+  /// corner is projected on the map on its own, one query per corner.
+  ///
+  /// At most MAX_PENDING_SNAPSHOTS snapshots are queued, when full the oldest
+  /// one is dropped and counted. Each vehicle is compared with its last
+  /// processed position, so the crossings of a dropped frame are reported
+  /// with the next processed one.
+  ///
+  /// Sensor callbacks are called one after another from the thread of the
+  /// detector, never from the JobSystem, in order of frame.
+  class LaneInvasionDetector : private NonCopyable {
+  public:
+
+    LaneInvasionDetector();
+
+    /// Stops the thread of the detector, the snapshots still queued are not
+    /// processed.
+    ~LaneInvasionDetector();
+
+    /// Starts detecting the lane invasions of @a vehicle, calling @a callback
+    /// with a LaneInvasionEvent for each one. Returns an id to unregister it.
+    size_t Register(
+        ActorId vehicle,
+        const geom::BoundingBox &bounding_box,
+        SharedPtr<const Map> map,
+        Sensor::CallbackFunctionType callback);
+
+    /// Stops calling the callback registered with @a id, if any.
+    void Unregister(size_t id);
+
+    /// Queues @a snapshot to be processed by the thread of the detector.
+    void Tick(const WorldSnapshot &snapshot);
+
+    /// Snapshots dropped because the queue was full.
+    size_t GetDroppedSnapshotCount() const;
+
+    static constexpr size_t MAX_PENDING_SNAPSHOTS = 16u;
+
+  private:
+
+    struct Vehicle;
+
+    /// Shared with the thread, so it outlives the detector if a callback
+    /// releases the last reference to it.
+    struct State;
+
+    static void ProcessSnapshots(std::shared_ptr<State> state);
+
+    std::shared_ptr<State> _state;
+
+    std::thread _thread;
+  };
+
+} // namespace detail
+} // namespace client
+} // namespace carla
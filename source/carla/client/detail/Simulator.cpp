@@ -18,6 +18,7 @@
 #include "carla/client/WalkerAIController.h"
 #include "carla/client/detail/ActorFactory.h"
 #include "carla/client/detail/WalkerNavigation.h"
+#include "carla/profiler/Profiler.h"
 #include "carla/trafficmanager/TrafficManager.h"
 #include "carla/sensor/Deserializer.h"
 
@@ -46,7 +47,7 @@ namespace detail {
     }
   }
 
-  static bool SynchronizeFrame(uint64_t frame, const Episode &episode, time_duration timeout) {
+  static bool WaitForFrame(uint64_t frame, const Episode &episode, time_duration timeout) {
     bool result = true;
     auto start = std::chrono::system_clock::now();
     while (frame > episode.GetState()->GetTimestamp().frame) {
@@ -58,6 +59,11 @@ namespace detail {
         break;
       }
     }
+    return result;
+  }
+
+  static bool SynchronizeFrame(uint64_t frame, const Episode &episode, time_duration timeout) {
+    bool result = WaitForFrame(frame, episode, timeout);
     if(result) {
       carla::traffic_manager::TrafficManager::Tick();
     }
@@ -80,11 +86,38 @@ namespace detail {
       _gc_policy(enable_garbage_collection ?
         GarbageCollectionPolicy::Enabled : GarbageCollectionPolicy::Disabled) {}
 
+  Simulator::~Simulator() {
+    if (!_client_work_thread.joinable()) {
+      return;
+    }
+    // The client work may release the last reference to the simulator, then
+    // its thread finishes on its own.
+    const bool is_client_work_thread = (_client_work_thread.get_id() == std::this_thread::get_id());
+    if (!is_client_work_thread) {
+      try {
+        WaitForPendingClientWork();
+      } catch (const std::exception &) {
+        // Already logged.
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(_client_work->mutex);
+      _client_work->stop = true;
+    }
+    _client_work->condition.notify_all();
+    if (is_client_work_thread) {
+      _client_work_thread.detach();
+    } else {
+      _client_work_thread.join();
+    }
+  }
+
   // ===========================================================================
   // -- Load a new episode -----------------------------------------------------
   // ===========================================================================
 
   EpisodeProxy Simulator::LoadEpisode(std::string map_name, bool reset_settings, rpc::MapLayer map_layers) {
+    WaitForPendingClientWork();
     const auto id = GetCurrentEpisode().GetId();
     _client.LoadEpisode(std::move(map_name), reset_settings, map_layers);
 
@@ -213,6 +246,7 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
 
   WorldSnapshot Simulator::WaitForTick(time_duration timeout) {
     DEBUG_ASSERT(_episode != nullptr);
+    WaitForPendingClientWork();
 
     // tick pedestrian navigation
     NavigationTick();
@@ -227,6 +261,11 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
   uint64_t Simulator::Tick(time_duration timeout) {
     DEBUG_ASSERT(_episode != nullptr);
 
+    if (_pipelined_tick) {
+      return PipelinedTick(timeout);
+    }
+    WaitForPendingClientWork();
+
     // tick pedestrian navigation
     NavigationTick();
 
@@ -241,6 +280,96 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
     return frame;
   }
 
+  uint64_t Simulator::PipelinedTick(time_duration timeout) {
+    // The controls computed on the frames up to the current one go with this
+    // tick cue.
+    const auto current_frame = _episode->GetState()->GetTimestamp().frame;
+    WaitForPendingClientWork(current_frame);
+
+    const auto frame = [this]() {
+      CARLA_PROFILE_SCOPE(Simulator, TickCue);
+      return _client.SendTickCue();
+    }();
+
+    // Compute the controls of the next tick on the current frame while the
+    // server simulates this one.
+    StartClientWork(current_frame, [self = shared_from_this()]() {
+      CARLA_PROFILE_SCOPE(Simulator, PipelinedClientWork);
+      carla::traffic_manager::TrafficManager::Tick();
+      self->NavigationTick();
+    });
+
+    CARLA_PROFILE_SCOPE(Simulator, WaitForFrame);
+    if (!WaitForFrame(frame, *_episode, timeout)) {
+      throw_exception(TimeoutException(_client.GetEndpoint(), timeout));
+    }
+    return frame;
+  }
+
+  void Simulator::StartClientWork(uint64_t frame, std::function<void()> work) {
+    if (!_client_work_thread.joinable()) {
+      _client_work_thread = std::thread(&Simulator::RunClientWork, _client_work);
+    }
+    {
+      std::lock_guard<std::mutex> lock(_client_work->mutex);
+      _client_work->pending.emplace_back(frame, std::move(work));
+    }
+    _client_work->condition.notify_all();
+  }
+
+  void Simulator::WaitForPendingClientWork(const uint64_t frame) {
+    std::unique_lock<std::mutex> lock(_client_work->mutex);
+    {
+      CARLA_PROFILE_SCOPE(Simulator, WaitForClientWork);
+      _client_work->condition.wait(lock, [&]() {
+        return _client_work->pending.empty() || (_client_work->pending.front().first > frame);
+      });
+    }
+    if (_client_work->error == nullptr || _client_work->error_frame > frame) {
+      return;
+    }
+    auto error = std::move(_client_work->error);
+    _client_work->error = nullptr;
+    const auto error_frame = _client_work->error_frame;
+    lock.unlock();
+    try {
+      std::rethrow_exception(error);
+    } catch (const std::exception &e) {
+      log_error("pipelined tick: client work on frame", error_frame, "failed:", e.what());
+      throw;
+    }
+  }
+
+  void Simulator::RunClientWork(std::shared_ptr<ClientWorkState> state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true) {
+      state->condition.wait(lock, [&]() {
+        return state->stop || !state->pending.empty();
+      });
+      if (state->pending.empty()) {
+        return;
+      }
+      const uint64_t frame = state->pending.front().first;
+      auto work = std::move(state->pending.front().second);
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        work();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      // May release the last reference to the simulator.
+      work = nullptr;
+      lock.lock();
+      state->pending.pop_front();
+      if ((error != nullptr) && (state->error == nullptr)) {
+        state->error = error;
+        state->error_frame = frame;
+      }
+      state->condition.notify_all();
+    }
+  }
+
   // ===========================================================================
   // -- Access to global objects in the episode --------------------------------
   // ===========================================================================
@@ -259,6 +388,8 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
   }
 
   uint64_t Simulator::SetEpisodeSettings(const rpc::EpisodeSettings &settings) {
+    // The pipelined client work must not run across a change of settings.
+    WaitForPendingClientWork();
     if (settings.synchronous_mode && !settings.fixed_delta_seconds) {
       log_warning(
           "synchronous mode enabled with variable delta seconds. It is highly "
@@ -297,6 +428,11 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
     return nav;
   }
 
+  std::shared_ptr<LaneInvasionDetector> Simulator::GetLaneInvasionDetector() {
+    DEBUG_ASSERT(_episode != nullptr);
+    return _episode->CreateLaneInvasionDetectorIfMissing();
+  }
+
   // tick pedestrian navigation
   void Simulator::NavigationTick() {
     DEBUG_ASSERT(_episode != nullptr);
@@ -344,6 +480,18 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
     nav->SetPedestriansSeed(seed);
   }
 
+  bool Simulator::SetPedestriansCrowdSettings(const nav::CrowdSettings &settings) {
+    DEBUG_ASSERT(_episode != nullptr);
+    auto nav = _episode->CreateNavigationIfMissing();
+    return nav->SetPedestriansCrowdSettings(settings);
+  }
+
+  void Simulator::SetPedestriansTileStreaming(const nav::TileStreamingSettings &settings) {
+    DEBUG_ASSERT(_episode != nullptr);
+    auto nav = _episode->CreateNavigationIfMissing();
+    nav->SetPedestriansTileStreaming(settings);
+  }
+
   // ===========================================================================
   // -- General operations with actors -----------------------------------------
   // ===========================================================================
@@ -407,9 +555,13 @@ EpisodeProxy Simulator::GetCurrentEpisode() {
     DEBUG_ASSERT(_episode != nullptr);
     _client.SubscribeToStream(
         sensor.GetActorDescription().GetStreamToken(),
-        [cb=std::move(callback), ep=WeakEpisodeProxy{shared_from_this()}](auto buffer) {
+        [cb=std::move(callback), ep=WeakEpisodeProxy{shared_from_this()}, id=sensor.GetId()](auto buffer) {
+          auto simulator = ep.TryLock();
+          if (simulator != nullptr) {
+            simulator->_episode->RecordStreamBuffer(id, buffer);
+          }
           auto data = sensor::Deserializer::Deserialize(std::move(buffer));
-          data->_episode = ep.TryLock();
+          data->_episode = simulator;
           cb(std::move(data));
         });
   }
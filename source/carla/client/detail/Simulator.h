@@ -31,7 +31,16 @@
 
 #include <boost/optional.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 namespace carla {
 namespace client {
@@ -63,6 +72,8 @@ namespace detail {
         size_t worker_threads = 0u,
         bool enable_garbage_collection = false);
 
+    ~Simulator();
+
     /// @}
     // =========================================================================
     /// @name Load a new episode
@@ -191,9 +202,16 @@ namespace detail {
 
     WorldSnapshot WaitForTick(time_duration timeout);
 
-    size_t RegisterOnTickEvent(std::function<void(WorldSnapshot)> callback) {
+    /// @copydoc Episode::RegisterOnTickEvent
+    size_t RegisterOnTickEvent(Episode::EventCallback callback, bool is_thread_safe = false) {
       DEBUG_ASSERT(_episode != nullptr);
-      return _episode->RegisterOnTickEvent(std::move(callback));
+      return _episode->RegisterOnTickEvent(std::move(callback), is_thread_safe);
+    }
+
+    /// @copydoc Episode::RegisterOnTickEvents
+    std::vector<size_t> RegisterOnTickEvents(std::vector<Episode::EventCallback> callbacks, bool is_thread_safe = false) {
+      DEBUG_ASSERT(_episode != nullptr);
+      return _episode->RegisterOnTickEvents(std::move(callbacks), is_thread_safe);
     }
 
     void RemoveOnTickEvent(size_t id) {
@@ -201,8 +219,30 @@ namespace detail {
       _episode->RemoveOnTickEvent(id);
     }
 
+    void RemoveOnTickEvents(const std::vector<size_t> &ids) {
+      DEBUG_ASSERT(_episode != nullptr);
+      _episode->RemoveOnTickEvents(ids);
+    }
+
     uint64_t Tick(time_duration timeout);
 
+    /// Enables the pipelined synchronous tick. Tick then sends the tick cue as
+    /// soon as the controls computed on the previous frame are committed, and
+    /// runs the traffic manager and the walker crowd on the current frame in
+    /// a thread of its own while the server simulates the next one. The controls
+    /// reach the server one frame later than with the default tick.
+    /// Disabling it waits for the client work still running.
+    void SetPipelinedTick(bool enabled) {
+      _pipelined_tick = enabled;
+      if (!enabled) {
+        WaitForPendingClientWork();
+      }
+    }
+
+    bool IsPipelinedTick() const {
+      return _pipelined_tick;
+    }
+
     /// @}
     // =========================================================================
     /// @name Access to global objects in the episode
@@ -313,6 +353,8 @@ namespace detail {
 
     std::shared_ptr<WalkerNavigation> GetNavigation();
 
+    std::shared_ptr<LaneInvasionDetector> GetLaneInvasionDetector();
+
     void NavigationTick();
 
     void RegisterAIController(const WalkerAIController &controller);
@@ -325,6 +367,10 @@ namespace detail {
 
     void SetPedestriansSeed(unsigned int seed);
 
+    bool SetPedestriansCrowdSettings(const nav::CrowdSettings &settings);
+
+    void SetPedestriansTileStreaming(const nav::TileStreamingSettings &settings);
+
     /// @}
     // =========================================================================
     /// @name General operations with actors
@@ -726,6 +772,19 @@ namespace detail {
 
     void SetIgnoredVehicles(const Sensor &sensor, const std::vector<ActorId>& vehicle_ids);
 
+    /// Records the raw buffers of the episode state and of the sensors
+    /// subscribed from this client into @a recorder, null stops recording.
+    /// Sensor streams are recorded with the actor id of the sensor.
+    void SetStreamRecorder(std::shared_ptr<sensor::StreamRecorder> recorder) {
+      DEBUG_ASSERT(_episode != nullptr);
+      _episode->SetStreamRecorder(std::move(recorder));
+    }
+
+    std::shared_ptr<sensor::StreamRecorder> GetStreamRecorder() const {
+      DEBUG_ASSERT(_episode != nullptr);
+      return _episode->GetStreamRecorder();
+    }
+
     /// @}
     // =========================================================================
     /// @name Operations with traffic lights
@@ -801,6 +860,14 @@ namespace detail {
       return _client.ApplyBatchSync(std::move(commands), do_tick_cue);
     }
 
+    bool TryApplyPackedBatchSync(const rpc::PackedCommandBatch &batch, bool do_tick_cue) {
+      return _client.TryApplyPackedBatchSync(batch, do_tick_cue);
+    }
+
+    void ApplyPackedBatchSync(const rpc::PackedCommandBatch &batch, bool do_tick_cue) {
+      _client.ApplyPackedBatchSync(batch, do_tick_cue);
+    }
+
     /// @}
     // =========================================================================
     /// @name Operations lights
@@ -825,7 +892,7 @@ namespace detail {
       _client.UpdateDayNightCycle(active);
     }
 
-    size_t RegisterLightUpdateChangeEvent(std::function<void(WorldSnapshot)> callback) {
+    size_t RegisterLightUpdateChangeEvent(Episode::EventCallback callback) {
       DEBUG_ASSERT(_episode != nullptr);
       return _episode->RegisterLightUpdateChangeEvent(std::move(callback));
     }
@@ -859,8 +926,36 @@ namespace detail {
 
   private:
 
+    /// Client work of the pipelined tick, run in order on a thread of its own
+    /// as it blocks on the traffic manager and on RPCs. Shared with the
+    /// thread, which outlives the simulator if it releases the last
+    /// reference to it.
+    struct ClientWorkState {
+      std::mutex mutex;
+      std::condition_variable condition;
+      /// Work started and not finished yet, tagged with the frame it computes
+      /// on, in order. The front one is running.
+      std::deque<std::pair<uint64_t, std::function<void()>>> pending;
+      /// First failure not rethrown yet, and the frame it computed on.
+      std::exception_ptr error;
+      uint64_t error_frame = 0u;
+      bool stop = false;
+    };
+
     bool ShouldUpdateMap(rpc::MapInfo& map_info);
 
+    uint64_t PipelinedTick(time_duration timeout);
+
+    /// Starts @a work on the client work thread, after the work started
+    /// before, tagged with the @a frame it computes on.
+    void StartClientWork(uint64_t frame, std::function<void()> work);
+
+    /// Waits for the client work computing on @a frame or before, rethrowing
+    /// its exception if any.
+    void WaitForPendingClientWork(uint64_t frame = std::numeric_limits<uint64_t>::max());
+
+    static void RunClientWork(std::shared_ptr<ClientWorkState> state);
+
     Client _client;
 
     SharedPtr<LightManager> _light_manager;
@@ -869,6 +964,13 @@ namespace detail {
 
     const GarbageCollectionPolicy _gc_policy;
 
+    std::atomic_bool _pipelined_tick{false};
+
+    const std::shared_ptr<ClientWorkState> _client_work = std::make_shared<ClientWorkState>();
+
+    /// Started on the first pipelined tick.
+    std::thread _client_work_thread;
+
     SharedPtr<Map> _cached_map;
 
     std::string _open_drive_file;
@@ -6,12 +6,14 @@
 
 #include "carla/client/detail/WalkerNavigation.h"
 
+#include "carla/client/FileTransfer.h"
 #include "carla/client/detail/Client.h"
 #include "carla/client/detail/Episode.h"
 #include "carla/client/detail/EpisodeState.h"
 #include "carla/client/detail/Simulator.h"
 #include "carla/nav/Navigation.h"
 #include "carla/rpc/Command.h"
+#include "carla/rpc/PackedCommandBatch.h"
 #include "carla/rpc/DebugShape.h"
 #include "carla/rpc/WalkerControl.h"
 
@@ -26,11 +28,23 @@ namespace detail {
     // Here call the server to retrieve the navmesh data.
     auto files = _simulator.lock()->GetRequiredFiles("Nav");
     if (!files.empty()) {
-      _nav.Load(_simulator.lock()->GetCacheFile(files[0], true));
+      // load from the cache file, so the tiles are read only when needed
+      if (!FileTransfer::FileExists(files[0]) ||
+          !_nav.Load(FileTransfer::GetFullPath(files[0]))) {
+        _nav.Load(_simulator.lock()->GetCacheFile(files[0], true));
+      }
     }
   }
 
   void WalkerNavigation::Tick(std::shared_ptr<Episode> episode) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // load the tiles around the hero vehicles, also before any walker exists
+    // so they can be spawned there
+    if (_nav.IsStreamingTiles()) {
+      UpdateInterestPoints(episode);
+    }
+
     auto walkers = _walkers.Load();
     if (walkers->empty()) {
       return;
@@ -48,25 +62,26 @@ namespace detail {
     // update crowd in navigation module
     _nav.UpdateCrowd(*state);
 
-    carla::geom::Transform trans;
+    // get the state of all walkers after the update, no need to lock
+    auto walker_states = _nav.GetWalkerStates();
+    if (walker_states == nullptr) {
+      return;
+    }
+
     using Cmd = rpc::Command;
-    std::vector<Cmd> commands;
-    commands.reserve(walkers->size());
-    for (auto handle : *walkers) {
-      // get the transform of the walker
-      if (_nav.GetWalkerTransform(handle.walker, trans)) {
-        float speed = _nav.GetWalkerSpeed(handle.walker);
-        commands.emplace_back(Cmd::ApplyWalkerState{ handle.walker, trans, speed });
-      }
+    rpc::PackedCommandBatch commands;
+    for (const auto &walker : *walker_states) {
+      commands.Add(Cmd::ApplyWalkerState{ walker.id, walker.transform, walker.speed });
     }
-    _simulator.lock()->ApplyBatchSync(std::move(commands), false);
+    _simulator.lock()->ApplyPackedBatchSync(commands, false);
 
     // check if any agent has been killed
-    bool alive;
-    for (auto handle : *walkers) {
-      // get the agent state
-      if (_nav.IsWalkerAlive(handle.walker, alive)) {
-        if (!alive) {
+    for (const auto &walker : *walker_states) {
+      if (walker.alive) {
+        continue;
+      }
+      for (auto handle : *walkers) {
+        if (handle.walker == walker.id) {
           _simulator.lock()->SetActorCollisions(handle.walker, true);
           _simulator.lock()->SetActorDead(handle.walker);
           // remove from the crowd
@@ -75,6 +90,7 @@ namespace detail {
           _simulator.lock()->DestroyActor(handle.controller);
           // unregister from list
           UnregisterWalker(handle.walker, handle.controller);
+          break;
         }
       }
     }
@@ -100,6 +116,28 @@ namespace detail {
 
   }
 
+  // set the hero vehicles as the interest points of the navigation tiles
+  void WalkerNavigation::UpdateInterestPoints(std::shared_ptr<Episode> episode) {
+    std::vector<geom::Location> points;
+
+    // get current state
+    std::shared_ptr<const EpisodeState> state = episode->GetState();
+
+    for (auto &&actor : episode->GetActors()) {
+      if (actor.description.id.rfind("vehicle.", 0) != 0) {
+        continue;
+      }
+      for (auto &&attribute : actor.description.attributes) {
+        if (attribute.id == "role_name" && attribute.value == "hero") {
+          points.emplace_back(state->GetActorSnapshot(actor.id).transform.location);
+          break;
+        }
+      }
+    }
+
+    _nav.SetInterestPoints(std::move(points));
+  }
+
   // add/update/delete all vehicles in crowd
   void WalkerNavigation::UpdateVehiclesInCrowd(std::shared_ptr<Episode> episode, bool show_debug) {
     std::vector<carla::nav::VehicleCollisionInfo> vehicles;
@@ -126,62 +164,68 @@ namespace detail {
       if (_nav.GetCrowd() == nullptr) return;
 
       // draw bounding boxes for debug
-      for (int i = 0; i < _nav.GetCrowd()->getAgentCount(); ++i) {
-        // get the agent
-        const dtCrowdAgent *agent = _nav.GetCrowd()->getAgent(i);
-        if (agent && agent->params.useObb) {
-          // draw for debug
-          carla::geom::Location p1, p2, p3, p4;
-          p1.x = agent->params.obb[0];
-          p1.z = agent->params.obb[1];
-          p1.y = agent->params.obb[2];
-          p2.x = agent->params.obb[3];
-          p2.z = agent->params.obb[4];
-          p2.y = agent->params.obb[5];
-          p3.x = agent->params.obb[6];
-          p3.z = agent->params.obb[7];
-          p3.y = agent->params.obb[8];
-          p4.x = agent->params.obb[9];
-          p4.z = agent->params.obb[10];
-          p4.y = agent->params.obb[11];
-          carla::rpc::DebugShape line1;
-          line1.life_time = 0.01f;
-          line1.persistent_lines = false;
-          // line 1
-          line1.primitive = carla::rpc::DebugShape::Line {p1, p2, 0.2f};
-          line1.color = { 0, 255, 0 };
-          _simulator.lock()->DrawDebugShape(line1);
-          // line 2
-          line1.primitive = carla::rpc::DebugShape::Line {p2, p3, 0.2f};
-          line1.color = { 255, 0, 0 };
-          _simulator.lock()->DrawDebugShape(line1);
-          // line 3
-          line1.primitive = carla::rpc::DebugShape::Line {p3, p4, 0.2f};
-          line1.color = { 0, 0, 255 };
-          _simulator.lock()->DrawDebugShape(line1);
-          // line 4
-          line1.primitive = carla::rpc::DebugShape::Line {p4, p1, 0.2f};
-          line1.color = { 255, 255, 0 };
-          _simulator.lock()->DrawDebugShape(line1);
+      for (size_t c = 0; c < _nav.GetCrowdCount(); ++c) {
+        dtCrowd *crowd = _nav.GetCrowd(c);
+        for (int i = 0; i < crowd->getAgentCount(); ++i) {
+          // get the agent
+          const dtCrowdAgent *agent = crowd->getAgent(i);
+          if (agent && agent->params.useObb) {
+            // draw for debug
+            carla::geom::Location p1, p2, p3, p4;
+            p1.x = agent->params.obb[0];
+            p1.z = agent->params.obb[1];
+            p1.y = agent->params.obb[2];
+            p2.x = agent->params.obb[3];
+            p2.z = agent->params.obb[4];
+            p2.y = agent->params.obb[5];
+            p3.x = agent->params.obb[6];
+            p3.z = agent->params.obb[7];
+            p3.y = agent->params.obb[8];
+            p4.x = agent->params.obb[9];
+            p4.z = agent->params.obb[10];
+            p4.y = agent->params.obb[11];
+            carla::rpc::DebugShape line1;
+            line1.life_time = 0.01f;
+            line1.persistent_lines = false;
+            // line 1
+            line1.primitive = carla::rpc::DebugShape::Line {p1, p2, 0.2f};
+            line1.color = { 0, 255, 0 };
+            _simulator.lock()->DrawDebugShape(line1);
+            // line 2
+            line1.primitive = carla::rpc::DebugShape::Line {p2, p3, 0.2f};
+            line1.color = { 255, 0, 0 };
+            _simulator.lock()->DrawDebugShape(line1);
+            // line 3
+            line1.primitive = carla::rpc::DebugShape::Line {p3, p4, 0.2f};
+            line1.color = { 0, 0, 255 };
+            _simulator.lock()->DrawDebugShape(line1);
+            // line 4
+            line1.primitive = carla::rpc::DebugShape::Line {p4, p1, 0.2f};
+            line1.color = { 255, 255, 0 };
+            _simulator.lock()->DrawDebugShape(line1);
+          }
         }
       }
 
       // draw some text for debug
-      for (int i = 0; i < _nav.GetCrowd()->getAgentCount(); ++i) {
-        // get the agent
-        const dtCrowdAgent *agent = _nav.GetCrowd()->getAgent(i);
-        if (agent) {
-          // draw for debug
-          carla::geom::Location p1(agent->npos[0], agent->npos[2], agent->npos[1] + 1);
-          if (agent->params.userData) {
-            std::ostringstream out;
-            out << *(reinterpret_cast<const float *>(agent->params.userData));
-            carla::rpc::DebugShape text;
-            text.life_time = 0.01f;
-            text.persistent_lines = false;
-            text.primitive = carla::rpc::DebugShape::String {p1, out.str(), false};
-            text.color = { 0, 255, 0 };
-            _simulator.lock()->DrawDebugShape(text);
+      for (size_t c = 0; c < _nav.GetCrowdCount(); ++c) {
+        dtCrowd *crowd = _nav.GetCrowd(c);
+        for (int i = 0; i < crowd->getAgentCount(); ++i) {
+          // get the agent
+          const dtCrowdAgent *agent = crowd->getAgent(i);
+          if (agent) {
+            // draw for debug
+            carla::geom::Location p1(agent->npos[0], agent->npos[2], agent->npos[1] + 1);
+            if (agent->params.userData) {
+              std::ostringstream out;
+              out << *(reinterpret_cast<const float *>(agent->params.userData));
+              carla::rpc::DebugShape text;
+              text.life_time = 0.01f;
+              text.persistent_lines = false;
+              text.primitive = carla::rpc::DebugShape::String {p1, out.str(), false};
+              text.color = { 0, 255, 0 };
+              _simulator.lock()->DrawDebugShape(text);
+            }
           }
         }
       }
@@ -13,6 +13,7 @@
 #include "carla/rpc/ActorId.h"
 
 #include <memory>
+#include <mutex>
 
 namespace carla {
 namespace client {
@@ -50,11 +51,13 @@ namespace detail {
 
     void RemoveWalker(ActorId walker_id) {
       // remove the walker in the crowd
+      std::lock_guard<std::mutex> lock(_mutex);
       _nav.RemoveAgent(walker_id);
     }
 
     void AddWalker(ActorId walker_id, carla::geom::Location location) {
       // create the walker in the crowd (to manage its movement in Detour)
+      std::lock_guard<std::mutex> lock(_mutex);
       _nav.AddWalker(walker_id, location);
     }
 
@@ -63,6 +66,7 @@ namespace detail {
     // Get Random location in nav mesh
     boost::optional<geom::Location> GetRandomLocation() {
       geom::Location random_location(0, 0, 0);
+      std::lock_guard<std::mutex> lock(_mutex);
       if (_nav.GetRandomLocation(random_location))
         return boost::optional<geom::Location>(random_location);
       else
@@ -71,29 +75,49 @@ namespace detail {
 
     // set a new target point to go
     bool SetWalkerTarget(ActorId id, const carla::geom::Location to) {
+      std::lock_guard<std::mutex> lock(_mutex);
       return _nav.SetWalkerTarget(id, to);
     }
 
     // set new max speed
     bool SetWalkerMaxSpeed(ActorId id, float max_speed) {
+      std::lock_guard<std::mutex> lock(_mutex);
       return _nav.SetWalkerMaxSpeed(id, max_speed);
     }
 
     // set percentage of pedestrians that can cross the road
     void SetPedestriansCrossFactor(float percentage) {
+      std::lock_guard<std::mutex> lock(_mutex);
       _nav.SetPedestriansCrossFactor(percentage);
     }
 
     void SetPedestriansSeed(unsigned int seed) {
+      std::lock_guard<std::mutex> lock(_mutex);
       _nav.SetSeed(seed);
     }
 
+    // set the size of the crowds and how the map is split between them
+    bool SetPedestriansCrowdSettings(const carla::nav::CrowdSettings &settings) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _nav.SetCrowdSettings(settings);
+    }
+
+    // set which tiles of the navigation mesh are kept in memory
+    void SetPedestriansTileStreaming(const carla::nav::TileStreamingSettings &settings) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _nav.SetTileStreaming(settings);
+    }
+
   private:
 
     std::weak_ptr<Simulator> _simulator;
 
     unsigned long _next_check_index;
 
+    /// the pipelined tick updates the crowd in a thread of its own, while
+    /// the walkers are added, removed and driven from the user thread
+    std::mutex _mutex;
+
     carla::nav::Navigation _nav;
 
     struct WalkerHandle {
@@ -107,6 +131,9 @@ namespace detail {
     void CheckIfWalkerExist(std::vector<WalkerHandle> walkers, const EpisodeState &state);
     /// add/update/delete all vehicles in crowd
     void UpdateVehiclesInCrowd(std::shared_ptr<Episode> episode, bool show_debug = false);
+
+    /// load the navigation tiles around the hero vehicles
+    void UpdateInterestPoints(std::shared_ptr<Episode> episode);
   };
 
 } // namespace detail
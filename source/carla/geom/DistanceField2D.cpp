@@ -0,0 +1,257 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/geom/DistanceField2D.h"
+
+#include "carla/Debug.h"
+#include "carla/ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace carla {
+namespace geom {
+
+  /// Squared distance used for the cells with no occupied cell in reach.
+  static constexpr double INFINITE_DISTANCE = 1e20;
+
+  static constexpr uint32_t NO_CELL = std::numeric_limits<uint32_t>::max();
+
+  /// Number of rows or columns handed to each job of the distance transform.
+  static constexpr size_t LINES_PER_JOB = 32u;
+
+  // ===========================================================================
+  // -- Distance transform -----------------------------------------------------
+  // ===========================================================================
+
+  /// Scratch buffers of the 1D distance transform, reused for every line.
+  struct DistanceTransformBuffers {
+    explicit DistanceTransformBuffers(size_t size)
+      : f(size),
+        d(size),
+        arg(size),
+        v(size),
+        z(size + 1u) {}
+
+    std::vector<double> f;
+
+    std::vector<double> d;
+
+    std::vector<uint32_t> arg;
+
+    std::vector<uint32_t> v;
+
+    std::vector<double> z;
+  };
+
+  /// 1D squared Euclidean distance transform of the first @a n values of
+  /// buffers.f: d[q] = min_p (q - p)^2 + f[p] and arg[q] the p reaching it.
+  /// See "Distance Transforms of Sampled Functions", Felzenszwalb and
+  /// Huttenlocher, 2012.
+  static void DistanceTransform1D(DistanceTransformBuffers &buffers, const size_t n) {
+    const auto &f = buffers.f;
+    auto &v = buffers.v;
+    auto &z = buffers.z;
+    auto intersection = [&](const uint32_t q, const uint32_t p) {
+      const double dq = static_cast<double>(q);
+      const double dp = static_cast<double>(p);
+      return ((f[q] + dq * dq) - (f[p] + dp * dp)) / (2.0 * dq - 2.0 * dp);
+    };
+    size_t k = 0u;
+    v[0u] = 0u;
+    z[0u] = -std::numeric_limits<double>::infinity();
+    z[1u] = std::numeric_limits<double>::infinity();
+    for (uint32_t q = 1u; q < n; ++q) {
+      double s = intersection(q, v[k]);
+      while (s <= z[k]) {
+        --k;
+        s = intersection(q, v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1u] = std::numeric_limits<double>::infinity();
+    }
+    k = 0u;
+    for (uint32_t q = 0u; q < n; ++q) {
+      while (z[k + 1u] < static_cast<double>(q)) {
+        ++k;
+      }
+      const double delta = static_cast<double>(q) - static_cast<double>(v[k]);
+      buffers.d[q] = delta * delta + f[v[k]];
+      buffers.arg[q] = v[k];
+    }
+  }
+
+  // ===========================================================================
+  // -- DistanceField2D --------------------------------------------------------
+  // ===========================================================================
+
+  DistanceField2D::DistanceField2D(
+      const Vector2D &min,
+      const Vector2D &size,
+      const float cell_size)
+    : _min(min),
+      _cell_size(cell_size),
+      _width(std::max<size_t>(1u, static_cast<size_t>(std::ceil(size.x / cell_size)))),
+      _height(std::max<size_t>(1u, static_cast<size_t>(std::ceil(size.y / cell_size)))),
+      _height_map(_width * _height, 0.0f),
+      _distance(_width * _height, 0.0f),
+      _nearest(_width * _height, NO_CELL) {
+    DEBUG_ASSERT(cell_size > 0.0f);
+    RELEASE_ASSERT(_width * _height < NO_CELL);
+  }
+
+  void DistanceField2D::FillQuad(
+      const Vector3D &a,
+      const Vector3D &b,
+      const Vector3D &c,
+      const Vector3D &d) {
+    const Vector3D corners[4u] = {a, b, c, d};
+    float min_x = a.x, max_x = a.x, min_y = a.y, max_y = a.y;
+    for (const auto &corner : corners) {
+      min_x = std::min(min_x, corner.x);
+      max_x = std::max(max_x, corner.x);
+      min_y = std::min(min_y, corner.y);
+      max_y = std::max(max_y, corner.y);
+    }
+    // Range of cells whose center may lie inside the quad, clipped to the
+    // field.
+    auto to_cell = [this](float value, float origin, size_t size) {
+      const float cell = std::floor((value - origin) / _cell_size - 0.5f);
+      return static_cast<long>(std::min(std::max(cell, -1.0f), static_cast<float>(size)));
+    };
+    const long x0 = std::max(0l, to_cell(min_x, _min.x, _width) + 1l);
+    const long x1 = std::min(static_cast<long>(_width) - 1l, to_cell(max_x, _min.x, _width));
+    const long y0 = std::max(0l, to_cell(min_y, _min.y, _height) + 1l);
+    const long y1 = std::min(static_cast<long>(_height) - 1l, to_cell(max_y, _min.y, _height));
+    if (x0 > x1 || y0 > y1) {
+      return;
+    }
+    const float height = 0.25f * (a.z + b.z + c.z + d.z);
+    for (long y = y0; y <= y1; ++y) {
+      const float py = _min.y + (static_cast<float>(y) + 0.5f) * _cell_size;
+      for (long x = x0; x <= x1; ++x) {
+        const float px = _min.x + (static_cast<float>(x) + 0.5f) * _cell_size;
+        // Inside a convex polygon all the edge cross products share sign.
+        bool has_positive = false;
+        bool has_negative = false;
+        for (size_t i = 0u; i < 4u; ++i) {
+          const auto &p0 = corners[i];
+          const auto &p1 = corners[(i + 1u) % 4u];
+          const float cross = (p1.x - p0.x) * (py - p0.y) - (p1.y - p0.y) * (px - p0.x);
+          has_positive |= cross > 0.0f;
+          has_negative |= cross < 0.0f;
+        }
+        if (has_positive && has_negative) {
+          continue;
+        }
+        const size_t index = static_cast<size_t>(y) * _width + static_cast<size_t>(x);
+        _nearest[index] = static_cast<uint32_t>(index);
+        _height_map[index] = height;
+        _has_occupied_cells = true;
+      }
+    }
+  }
+
+  void DistanceField2D::ComputeDistances() {
+    if (!_has_occupied_cells) {
+      std::fill(_distance.begin(), _distance.end(), std::numeric_limits<float>::max());
+      return;
+    }
+    // Squared distance in cells along the columns, and the row of the
+    // nearest occupied cell in each column.
+    std::vector<double> column_distance(_width * _height);
+    std::vector<uint32_t> column_nearest(_width * _height);
+    const size_t column_jobs = (_width + LINES_PER_JOB - 1u) / LINES_PER_JOB;
+    ParallelFor(column_jobs, [&](const size_t job) {
+      DistanceTransformBuffers buffers(_height);
+      const size_t end = std::min(_width, (job + 1u) * LINES_PER_JOB);
+      for (size_t x = job * LINES_PER_JOB; x < end; ++x) {
+        for (size_t y = 0u; y < _height; ++y) {
+          const bool occupied = _nearest[y * _width + x] != NO_CELL;
+          buffers.f[y] = occupied ? 0.0 : INFINITE_DISTANCE;
+        }
+        DistanceTransform1D(buffers, _height);
+        for (size_t y = 0u; y < _height; ++y) {
+          column_distance[y * _width + x] = buffers.d[y];
+          column_nearest[y * _width + x] = buffers.arg[y];
+        }
+      }
+    });
+
+    // Then along the rows, combining both.
+    const size_t row_jobs = (_height + LINES_PER_JOB - 1u) / LINES_PER_JOB;
+    ParallelFor(row_jobs, [&](const size_t job) {
+      DistanceTransformBuffers buffers(_width);
+      const size_t end = std::min(_height, (job + 1u) * LINES_PER_JOB);
+      for (size_t y = job * LINES_PER_JOB; y < end; ++y) {
+        const size_t row = y * _width;
+        std::copy_n(column_distance.begin() + row, _width, buffers.f.begin());
+        DistanceTransform1D(buffers, _width);
+        for (size_t x = 0u; x < _width; ++x) {
+          const uint32_t nearest_x = buffers.arg[x];
+          const uint32_t nearest_y = column_nearest[row + nearest_x];
+          _nearest[row + x] = nearest_y * static_cast<uint32_t>(_width) + nearest_x;
+          // Distances are measured between cell centers, the border of the
+          // occupied region lies half a cell before.
+          const double distance = std::sqrt(buffers.d[x]);
+          _distance[row + x] = distance == 0.0 ?
+              0.0f :
+              static_cast<float>((distance - 0.5) * _cell_size);
+        }
+      }
+    });
+  }
+
+  size_t DistanceField2D::CellIndex(const double x, const double y) const {
+    const double u = std::floor((x - _min.x) / _cell_size);
+    const double v = std::floor((y - _min.y) / _cell_size);
+    const size_t cx = static_cast<size_t>(
+        std::min(std::max(u, 0.0), static_cast<double>(_width - 1u)));
+    const size_t cy = static_cast<size_t>(
+        std::min(std::max(v, 0.0), static_cast<double>(_height - 1u)));
+    return cy * _width + cx;
+  }
+
+  Vector3D DistanceField2D::CellCenter(const size_t index) const {
+    const size_t x = index % _width;
+    const size_t y = index / _width;
+    return {
+        _min.x + (static_cast<float>(x) + 0.5f) * _cell_size,
+        _min.y + (static_cast<float>(y) + 0.5f) * _cell_size,
+        _height_map[index]};
+  }
+
+  float DistanceField2D::GetDistance(const double x, const double y) const {
+    // Continuous coordinates with cell centers at integer positions.
+    const double u = std::min(std::max((x - _min.x) / _cell_size - 0.5, 0.0),
+                              static_cast<double>(_width - 1u));
+    const double v = std::min(std::max((y - _min.y) / _cell_size - 0.5, 0.0),
+                              static_cast<double>(_height - 1u));
+    const size_t x0 = static_cast<size_t>(u);
+    const size_t y0 = static_cast<size_t>(v);
+    const size_t x1 = std::min(x0 + 1u, _width - 1u);
+    const size_t y1 = std::min(y0 + 1u, _height - 1u);
+    const float tx = static_cast<float>(u - static_cast<double>(x0));
+    const float ty = static_cast<float>(v - static_cast<double>(y0));
+    const float d00 = _distance[y0 * _width + x0];
+    const float d10 = _distance[y0 * _width + x1];
+    const float d01 = _distance[y1 * _width + x0];
+    const float d11 = _distance[y1 * _width + x1];
+    const float bottom = d00 + tx * (d10 - d00);
+    const float top = d01 + tx * (d11 - d01);
+    return bottom + ty * (top - bottom);
+  }
+
+  Vector3D DistanceField2D::GetNearestOccupied(const double x, const double y) const {
+    DEBUG_ASSERT(_has_occupied_cells);
+    return CellCenter(_nearest[CellIndex(x, y)]);
+  }
+
+} // namespace geom
+} // namespace carla
@@ -0,0 +1,105 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/Vector2D.h"
+#include "carla/geom/Vector3D.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace carla {
+namespace geom {
+
+  /// Regular 2D grid of occupied cells, each one with a height, plus the
+  /// Euclidean distance from every cell to the nearest occupied cell.
+  ///
+  /// Shapes are rasterized with FillQuad, then ComputeDistances runs an exact
+  /// distance transform (Felzenszwalb & Huttenlocher) over the whole grid.
+  /// After that, distance and nearest occupied point queries are constant
+  /// time, which makes the grid suitable as a signed distance function for
+  /// meshing.
+  class DistanceField2D {
+  public:
+
+    /// Creates an empty field covering [min, min + size] with square cells
+    /// of @a cell_size.
+    DistanceField2D(const Vector2D &min, const Vector2D &size, float cell_size);
+
+    size_t GetWidth() const {
+      return _width;
+    }
+
+    size_t GetHeight() const {
+      return _height;
+    }
+
+    float GetCellSize() const {
+      return _cell_size;
+    }
+
+    /// Marks as occupied the cells whose center lies inside the convex quad
+    /// @a a, @a b, @a c, @a d (either winding), with the mean height of the
+    /// four corners.
+    void FillQuad(
+        const Vector3D &a,
+        const Vector3D &b,
+        const Vector3D &c,
+        const Vector3D &d);
+
+    /// Computes the distance from each cell to the nearest occupied cell.
+    /// Must be called after filling and before any of the queries below.
+    void ComputeDistances();
+
+    /// Whether any cell has been filled.
+    bool HasOccupiedCells() const {
+      return _has_occupied_cells;
+    }
+
+    /// Whether the cell containing (@a x, @a y) is occupied. Points outside
+    /// the field are clamped to its border.
+    bool IsOccupied(double x, double y) const {
+      return _nearest[CellIndex(x, y)] == CellIndex(x, y);
+    }
+
+    /// Distance in meters from (@a x, @a y) to the nearest occupied cell,
+    /// bilinearly interpolated between cell centers.
+    float GetDistance(double x, double y) const;
+
+    /// Center of the occupied cell nearest to (@a x, @a y), at the height of
+    /// that cell.
+    Vector3D GetNearestOccupied(double x, double y) const;
+
+  private:
+
+    size_t CellIndex(double x, double y) const;
+
+    Vector3D CellCenter(size_t index) const;
+
+    Vector2D _min;
+
+    float _cell_size;
+
+    size_t _width;
+
+    size_t _height;
+
+    bool _has_occupied_cells = false;
+
+    /// Height of each occupied cell.
+    std::vector<float> _height_map;
+
+    /// Distance in meters to the nearest occupied cell.
+    std::vector<float> _distance;
+
+    /// Index of the nearest occupied cell, or of the cell itself if occupied.
+    std::vector<uint32_t> _nearest;
+  };
+
+} // namespace geom
+} // namespace carla
@@ -6,12 +6,17 @@
 
 #include <carla/geom/Mesh.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <ios>
 #include <iostream>
 #include <fstream>
 
+#include <carla/Debug.h>
 #include <carla/geom/Math.h>
 
 namespace carla {
@@ -45,14 +50,27 @@ namespace geom {
   // #---#---#---#
   // 2   4   6   8
   void Mesh::AddTriangleStrip(const std::vector<Mesh::vertex_type> &vertices) {
-    if (vertices.size() == 0) {
+    AddTriangleStrip(vertices.data(), vertices.size());
+  }
+
+  void Mesh::AddTriangleStrip(const vertex_type *vertices, const size_t count) {
+    if (count == 0) {
       return;
     }
-    DEBUG_ASSERT(vertices.size() >= 3);
-    size_t i = GetVerticesNum() + 2;
-    AddVertices(vertices);
+    DEBUG_ASSERT(count >= 3);
+    const index_type first_index = GetVerticesNum() + 1;
+    AddVertices(vertices, count);
+    AddTriangleStripIndexes(first_index, count);
+  }
+
+  void Mesh::AddTriangleStripIndexes(const index_type first_index, const size_t count) {
+    if (count < 3) {
+      return;
+    }
+    DEBUG_ASSERT(first_index + count - 1 <= GetVerticesNum());
+    const index_type end = first_index + count - 1;
     bool index_clockwise = true;
-    while (i < GetVerticesNum()) {
+    for (index_type i = first_index + 1; i < end; ++i) {
       index_clockwise = !index_clockwise;
       if (index_clockwise) {
         AddIndex(i + 1);
@@ -63,7 +81,6 @@ namespace geom {
         AddIndex(i);
         AddIndex(i + 1);
       }
-      ++i;
     }
   }
 
@@ -74,10 +91,14 @@ namespace geom {
   // #---#---#
   // 3   4   5
   void Mesh::AddTriangleFan(const std::vector<Mesh::vertex_type> &vertices) {
-    DEBUG_ASSERT(vertices.size() >= 3);
+    AddTriangleFan(vertices.data(), vertices.size());
+  }
+
+  void Mesh::AddTriangleFan(const vertex_type *vertices, const size_t count) {
+    DEBUG_ASSERT(count >= 3);
     const size_t initial_index = GetVerticesNum() + 1;
     size_t i = GetVerticesNum() + 2;
-    AddVertices(vertices);
+    AddVertices(vertices, count);
     while (i < GetVerticesNum()) {
       AddIndex(initial_index);
       AddIndex(i);
@@ -86,12 +107,22 @@ namespace geom {
     }
   }
 
+  void Mesh::Reserve(size_t num_vertices, size_t num_indexes, size_t num_uvs) {
+    _vertices.reserve(num_vertices);
+    _indexes.reserve(num_indexes);
+    _uvs.reserve(num_uvs);
+  }
+
   void Mesh::AddVertex(vertex_type vertex) {
     _vertices.push_back(vertex);
   }
 
   void Mesh::AddVertices(const std::vector<Mesh::vertex_type> &vertices) {
-    std::copy(vertices.begin(), vertices.end(), std::back_inserter(_vertices));
+    AddVertices(vertices.data(), vertices.size());
+  }
+
+  void Mesh::AddVertices(const vertex_type *vertices, const size_t count) {
+    _vertices.insert(_vertices.end(), vertices, vertices + count);
   }
 
   void Mesh::AddNormal(normal_type normal) {
@@ -107,7 +138,7 @@ namespace geom {
   }
 
   void Mesh::AddUVs(const std::vector<uv_type> & uv) {
-    std::copy(uv.begin(), uv.end(), std::back_inserter(_uvs));
+    _uvs.insert(_uvs.end(), uv.begin(), uv.end());
   }
 
   void Mesh::AddMaterial(const std::string &material_name) {
@@ -143,115 +174,406 @@ namespace geom {
     _materials.back().index_end = close_index;
   }
 
+  // ===========================================================================
+  // -- Export helpers ---------------------------------------------------------
+  // ===========================================================================
+
+  /// Writes the faces of @a mesh in OBJ, switching to the corresponding
+  /// material when needed. If @a clockwise the last two indices of every face
+  /// are swapped.
+  static void WriteOBJFaces(
+      std::ostream &out,
+      const std::vector<Mesh::index_type> &indexes,
+      const std::vector<Mesh::material_type> &materials,
+      const bool clockwise) {
+    out << "\n# Polygonal face element.\n";
+    auto it_m = materials.begin();
+    auto it = indexes.begin();
+    size_t index_counter = 0u;
+    while (it != indexes.end()) {
+      // While exist materials
+      if (it_m != materials.end()) {
+        // If the current material ends at this index
+        if (it_m->index_end == index_counter) {
+          ++it_m;
+        }
+        // If the current material start at this index
+        if (it_m != materials.end() && it_m->index_start == index_counter) {
+          out << "\nusemtl " << it_m->name << '\n';
+        }
+      }
+      // Add the actual face using the 3 consecutive indices
+      const auto i_1 = *it; ++it;
+      const auto i_2 = *it; ++it;
+      const auto i_3 = *it; ++it;
+      if (clockwise) {
+        out << "f " << i_1 << ' ' << i_3 << ' ' << i_2 << '\n';
+      } else {
+        out << "f " << i_1 << ' ' << i_2 << ' ' << i_3 << '\n';
+      }
+      index_counter += 3;
+    }
+  }
+
+  /// Stores @a value in @a bytes in little-endian order.
+  static void EncodeUInt32(const uint32_t value, unsigned char *bytes) {
+    for (auto i = 0u; i < 4u; ++i) {
+      bytes[i] = static_cast<unsigned char>(value >> (8u * i));
+    }
+  }
+
+  static bool IsLittleEndian() {
+    const uint32_t value = 1u;
+    unsigned char first;
+    std::memcpy(&first, &value, 1u);
+    return first == 1u;
+  }
+
+  /// Buffers little-endian binary data and writes it to a stream in blocks of
+  /// fixed size, so exporting never holds more than one block in memory. Each
+  /// call copies its values into the block at once, on little-endian hosts
+  /// arrays are copied as they are in memory.
+  class BinaryWriter {
+  public:
+
+    explicit BinaryWriter(std::ostream &out) : _out(out) {
+      _buffer.reserve(BlockSize);
+    }
+
+    ~BinaryWriter() {
+      Flush();
+    }
+
+    void WriteUInt32s(const uint32_t *values, size_t count) {
+      if (IsLittleEndian()) {
+        WriteBytes(values, count * sizeof(uint32_t));
+        return;
+      }
+      for (size_t i = 0u; i < count; ++i) {
+        unsigned char bytes[sizeof(uint32_t)];
+        EncodeUInt32(values[i], bytes);
+        WriteBytes(bytes, sizeof(bytes));
+      }
+    }
+
+    void WriteFloats(const float *values, size_t count) {
+      static_assert(sizeof(float) == sizeof(uint32_t), "Unexpected float size.");
+      if (IsLittleEndian()) {
+        WriteBytes(values, count * sizeof(float));
+        return;
+      }
+      for (size_t i = 0u; i < count; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        WriteUInt32s(&bits, 1u);
+      }
+    }
+
+    /// Appends @a size bytes to the block, data that does not fit in an empty
+    /// block is written straight to the stream.
+    void WriteBytes(const void *data, size_t size) {
+      const char *bytes = static_cast<const char *>(data);
+      if (_buffer.size() + size > BlockSize) {
+        Flush();
+        if (size >= BlockSize) {
+          _out.write(bytes, static_cast<std::streamsize>(size));
+          return;
+        }
+      }
+      _buffer.insert(_buffer.end(), bytes, bytes + size);
+    }
+
+    void WriteBytes(const std::string &bytes) {
+      WriteBytes(bytes.data(), bytes.size());
+    }
+
+    void Flush() {
+      _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+      _buffer.clear();
+    }
+
+  private:
+
+    static constexpr size_t BlockSize = 1u << 16u;
+
+    std::ostream &_out;
+
+    std::vector<char> _buffer;
+  };
+
+  /// Converts a 1-based mesh index to the 0-based index of binary formats.
+  static uint32_t ToZeroBasedIndex(const Mesh::index_type index) {
+    DEBUG_ASSERT(index > 0u);
+    DEBUG_ASSERT(index - 1u <= std::numeric_limits<uint32_t>::max());
+    return static_cast<uint32_t>(index - 1u);
+  }
+
+  // ===========================================================================
+  // -- Export methods ---------------------------------------------------------
+  // ===========================================================================
+
   std::string Mesh::GenerateOBJ() const {
     if (!IsValid()) {
       return "";
     }
-    std::stringstream out;
+    std::ostringstream out;
+    WriteOBJ(out);
+    return out.str();
+  }
+
+  void Mesh::WriteOBJ(std::ostream &out) const {
+    if (!IsValid()) {
+      return;
+    }
+    const auto flags = out.flags();
     out << std::fixed; // Avoid using scientific notation
 
-    out << "# List of geometric vertices, with (x, y, z) coordinates." << std::endl;
+    out << "# List of geometric vertices, with (x, y, z) coordinates.\n";
     for (auto &v : _vertices) {
-      out << "v " << v.x << " " << v.y << " " << v.z << std::endl;
+      out << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
     }
 
     if (!_uvs.empty()) {
-      out << std::endl << "# List of texture coordinates, in (u, v) coordinates, these will vary between 0 and 1." << std::endl;
+      out << "\n# List of texture coordinates, in (u, v) coordinates, these will vary between 0 and 1.\n";
       for (auto &vt : _uvs) {
-        out << "vt " << vt.x << " " << vt.y << std::endl;
+        out << "vt " << vt.x << ' ' << vt.y << '\n';
       }
     }
 
     if (!_normals.empty()) {
-      out << std::endl << "# List of vertex normals in (x, y, z) form; normals might not be unit vectors." << std::endl;
+      out << "\n# List of vertex normals in (x, y, z) form; normals might not be unit vectors.\n";
       for (auto &vn : _normals) {
-        out << "vn " << vn.x << " " << vn.y << " " << vn.z << std::endl;
+        out << "vn " << vn.x << ' ' << vn.y << ' ' << vn.z << '\n';
       }
     }
 
     if (!_indexes.empty()) {
-      out << std::endl << "# Polygonal face element." << std::endl;
-      auto it_m = _materials.begin();
-      auto it = _indexes.begin();
-      size_t index_counter = 0u;
-      while (it != _indexes.end()) {
-        // While exist materials
-        if (it_m != _materials.end()) {
-          // If the current material ends at this index
-          if (it_m->index_end == index_counter) {
-            ++it_m;
-          }
-          // If the current material start at this index
-          if (it_m->index_start == index_counter) {
-            out << "\nusemtl " << it_m->name << std::endl;
-          }
-        }
-
-        // Add the actual face using the 3 consecutive indices
-        out << "f " << *it; ++it;
-        out << " " << *it; ++it;
-        out << " " << *it << std::endl; ++it;
-
-        index_counter += 3;
-      }
+      WriteOBJFaces(out, _indexes, _materials, false);
     }
-
-    return out.str();
+    out.flags(flags);
   }
 
   std::string Mesh::GenerateOBJForRecast() const {
     if (!IsValid()) {
       return "";
     }
-    std::stringstream out;
+    std::ostringstream out;
+    WriteOBJForRecast(out);
+    return out.str();
+  }
+
+  void Mesh::WriteOBJForRecast(std::ostream &out) const {
+    if (!IsValid()) {
+      return;
+    }
+    const auto flags = out.flags();
     out << std::fixed; // Avoid using scientific notation
 
-    out << "# List of geometric vertices, with (x, y, z) coordinates." << std::endl;
+    out << "# List of geometric vertices, with (x, y, z) coordinates.\n";
     for (auto &v : _vertices) {
       // Switched "y" and "z" for Recast library
-      out << "v " << v.x << " " << v.z << " " << v.y << std::endl;
+      out << "v " << v.x << ' ' << v.z << ' ' << v.y << '\n';
     }
 
     if (!_indexes.empty()) {
-      out << std::endl << "# Polygonal face element." << std::endl;
-      auto it_m = _materials.begin();
-      auto it = _indexes.begin();
-      size_t index_counter = 0u;
-      while (it != _indexes.end()) {
-        // While exist materials
-        if (it_m != _materials.end()) {
-          // If the current material ends at this index
-          if (it_m->index_end == index_counter) {
-            ++it_m;
-          }
-          // If the current material start at this index
-          if (it_m->index_start == index_counter) {
-            out << "\nusemtl " << it_m->name << std::endl;
-          }
-        }
-        // Add the actual face using the 3 consecutive indices
-        // Changes the face build direction to clockwise since
-        // the space has changed.
-        out << "f " << *it; ++it;
-        const auto i_2 = *it; ++it;
-        const auto i_3 = *it; ++it;
-        out << " " << i_3 << " " << i_2 << std::endl;
-        index_counter += 3;
-      }
+      // Changes the face build direction to clockwise since the space has
+      // changed.
+      WriteOBJFaces(out, _indexes, _materials, true);
     }
-
-    return out.str();
+    out.flags(flags);
   }
 
   std::string Mesh::GeneratePLY() const {
     if (!IsValid()) {
       return "Invalid Mesh";
     }
-    // Generate header
-    std::stringstream out;
+    std::ostringstream out(std::ios::binary);
+    WritePLY(out);
     return out.str();
   }
 
+  void Mesh::WritePLY(std::ostream &out) const {
+    if (!IsValid()) {
+      return;
+    }
+    const bool has_normals = _normals.size() == _vertices.size();
+    const bool has_uvs = _uvs.size() == _vertices.size();
+
+    // Generate header
+    std::ostringstream header;
+    header << "ply\n"
+           << "format binary_little_endian 1.0\n"
+           << "element vertex " << _vertices.size() << '\n'
+           << "property float x\n"
+           << "property float y\n"
+           << "property float z\n";
+    if (has_normals) {
+      header << "property float nx\n"
+             << "property float ny\n"
+             << "property float nz\n";
+    }
+    if (has_uvs) {
+      header << "property float s\n"
+             << "property float t\n";
+    }
+    header << "element face " << _indexes.size() / 3u << '\n'
+           << "property list uchar uint vertex_indices\n"
+           << "end_header\n";
+
+    BinaryWriter writer(out);
+    writer.WriteBytes(header.str());
+    // Each vertex is a record of up to 8 floats, position, normal and uv.
+    float vertex[8u];
+    for (size_t i = 0u; i < _vertices.size(); ++i) {
+      size_t size = 0u;
+      vertex[size++] = _vertices[i].x;
+      vertex[size++] = _vertices[i].y;
+      vertex[size++] = _vertices[i].z;
+      if (has_normals) {
+        vertex[size++] = _normals[i].x;
+        vertex[size++] = _normals[i].y;
+        vertex[size++] = _normals[i].z;
+      }
+      if (has_uvs) {
+        vertex[size++] = _uvs[i].x;
+        vertex[size++] = _uvs[i].y;
+      }
+      writer.WriteFloats(vertex, size);
+    }
+    // Each face is a record of 13 bytes, the count and the 3 indices.
+    unsigned char face[1u + 3u * sizeof(uint32_t)];
+    face[0u] = 3u;
+    for (size_t i = 0u; i < _indexes.size(); i += 3u) {
+      EncodeUInt32(ToZeroBasedIndex(_indexes[i]), face + 1u);
+      EncodeUInt32(ToZeroBasedIndex(_indexes[i + 1u]), face + 5u);
+      EncodeUInt32(ToZeroBasedIndex(_indexes[i + 2u]), face + 9u);
+      writer.WriteBytes(face, sizeof(face));
+    }
+  }
+
+  void Mesh::WriteGLB(std::ostream &out) const {
+    if (!IsValid()) {
+      return;
+    }
+    const bool has_normals = _normals.size() == _vertices.size();
+    const bool has_uvs = _uvs.size() == _vertices.size();
+    const size_t num_vertices = _vertices.size();
+    const size_t num_indexes = _indexes.size();
+
+    // Binary buffer layout: positions, normals, uvs and indices, each one
+    // already a multiple of 4 bytes.
+    const size_t positions_size = num_vertices * 3u * sizeof(float);
+    const size_t normals_size = has_normals ? num_vertices * 3u * sizeof(float) : 0u;
+    const size_t uvs_size = has_uvs ? num_vertices * 2u * sizeof(float) : 0u;
+    const size_t indexes_size = num_indexes * sizeof(uint32_t);
+    const size_t buffer_size = positions_size + normals_size + uvs_size + indexes_size;
+
+    // The POSITION accessor requires the bounds of the positions.
+    vertex_type min = {_vertices.front().x, _vertices.front().z, _vertices.front().y};
+    vertex_type max = min;
+    for (const auto &v : _vertices) {
+      min.x = std::min(min.x, v.x);
+      min.y = std::min(min.y, v.z);
+      min.z = std::min(min.z, v.y);
+      max.x = std::max(max.x, v.x);
+      max.y = std::max(max.y, v.z);
+      max.z = std::max(max.z, v.y);
+    }
+
+    std::ostringstream json;
+    json.precision(9);
+    size_t accessor = 0u;
+    size_t offset = 0u;
+    std::ostringstream buffer_views;
+    std::ostringstream accessors;
+    std::ostringstream attributes;
+    auto add_view = [&](size_t size, const char *target) {
+      buffer_views << (accessor == 0u ? "" : ",")
+                   << "{\"buffer\":0,\"byteOffset\":" << offset
+                   << ",\"byteLength\":" << size
+                   << ",\"target\":" << target << '}';
+      offset += size;
+    };
+    auto add_accessor = [&](size_t count, const char *component_type, const char *type) {
+      accessors << (accessor == 0u ? "" : ",")
+                << "{\"bufferView\":" << accessor
+                << ",\"componentType\":" << component_type
+                << ",\"count\":" << count
+                << ",\"type\":\"" << type << '"';
+    };
+    add_view(positions_size, "34962");
+    add_accessor(num_vertices, "5126", "VEC3");
+    accessors.precision(9);
+    accessors << ",\"min\":[" << min.x << ',' << min.y << ',' << min.z << ']'
+              << ",\"max\":[" << max.x << ',' << max.y << ',' << max.z << "]}";
+    attributes << "\"POSITION\":" << accessor++;
+    if (has_normals) {
+      add_view(normals_size, "34962");
+      add_accessor(num_vertices, "5126", "VEC3");
+      accessors << '}';
+      attributes << ",\"NORMAL\":" << accessor++;
+    }
+    if (has_uvs) {
+      add_view(uvs_size, "34962");
+      add_accessor(num_vertices, "5126", "VEC2");
+      accessors << '}';
+      attributes << ",\"TEXCOORD_0\":" << accessor++;
+    }
+    add_view(indexes_size, "34963");
+    add_accessor(num_indexes, "5125", "SCALAR");
+    accessors << '}';
+    const size_t indices_accessor = accessor++;
+
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"CARLA\"}"
+         << ",\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}]"
+         << ",\"meshes\":[{\"primitives\":[{\"attributes\":{" << attributes.str()
+         << "},\"indices\":" << indices_accessor << ",\"mode\":4}]}]"
+         << ",\"buffers\":[{\"byteLength\":" << buffer_size << "}]"
+         << ",\"bufferViews\":[" << buffer_views.str() << ']'
+         << ",\"accessors\":[" << accessors.str() << "]}";
+    std::string json_chunk = json.str();
+    json_chunk.resize((json_chunk.size() + 3u) & ~size_t(3u), ' ');
+
+    const size_t total_size = 12u + 8u + json_chunk.size() + 8u + buffer_size;
+    DEBUG_ASSERT(total_size <= std::numeric_limits<uint32_t>::max());
+
+    BinaryWriter writer(out);
+    // Header: magic "glTF", version and total length, then the header of the
+    // JSON chunk.
+    const uint32_t header[] = {
+        0x46546C67u,
+        2u,
+        static_cast<uint32_t>(total_size),
+        static_cast<uint32_t>(json_chunk.size()),
+        0x4E4F534Au};
+    writer.WriteUInt32s(header, 5u);
+    writer.WriteBytes(json_chunk);
+    // BIN chunk.
+    const uint32_t bin_header[] = {static_cast<uint32_t>(buffer_size), 0x004E4942u};
+    writer.WriteUInt32s(bin_header, 2u);
+    for (const auto &v : _vertices) {
+      const float position[] = {v.x, v.z, v.y};
+      writer.WriteFloats(position, 3u);
+    }
+    if (has_normals) {
+      for (const auto &n : _normals) {
+        const float normal[] = {n.x, n.z, n.y};
+        writer.WriteFloats(normal, 3u);
+      }
+    }
+    if (has_uvs) {
+      static_assert(sizeof(uv_type) == 2u * sizeof(float), "Unexpected uv size.");
+      writer.WriteFloats(&_uvs.front().x, 2u * num_vertices);
+    }
+    for (size_t i = 0u; i < num_indexes; i += 3u) {
+      const uint32_t triangle[] = {
+          ToZeroBasedIndex(_indexes[i]),
+          ToZeroBasedIndex(_indexes[i + 2u]),
+          ToZeroBasedIndex(_indexes[i + 1u])};
+      writer.WriteUInt32s(triangle, 3u);
+    }
+  }
+
   const std::vector<Mesh::vertex_type> &Mesh::GetVertices() const {
     return _vertices;
   }
@@ -382,6 +704,78 @@ namespace geom {
     return *this;
   }
 
+  Mesh &Mesh::operator+=(Mesh &&rhs) {
+    if (!IsEmpty()) {
+      return *this += static_cast<const Mesh &>(rhs);
+    }
+    _vertices = std::move(rhs._vertices);
+    _normals = std::move(rhs._normals);
+    _indexes = std::move(rhs._indexes);
+    _uvs = std::move(rhs._uvs);
+    _materials = std::move(rhs._materials);
+    rhs._vertices.clear();
+    rhs._normals.clear();
+    rhs._indexes.clear();
+    rhs._uvs.clear();
+    rhs._materials.clear();
+    return *this;
+  }
+
+  Mesh &Mesh::Append(const std::vector<std::unique_ptr<Mesh>> &meshes) {
+    AppendMeshes(meshes.begin(), meshes.end());
+    return *this;
+  }
+
+  Mesh &Mesh::Append(std::vector<std::unique_ptr<Mesh>> &&meshes) {
+    auto it = meshes.cbegin();
+    if (IsEmpty()) {
+      // Take the buffers of the first mesh as they are, only the rest are
+      // copied after them.
+      it = std::find_if(meshes.cbegin(), meshes.cend(),
+          [](const std::unique_ptr<Mesh> &mesh) { return mesh != nullptr; });
+      if (it != meshes.cend()) {
+        *this += std::move(**it);
+        ++it;
+      }
+    }
+    AppendMeshes(it, meshes.cend());
+    return *this;
+  }
+
+  void Mesh::AppendMeshes(const MeshIterator begin, const MeshIterator end) {
+    size_t num_vertices = 0u;
+    size_t num_normals = 0u;
+    size_t num_indexes = 0u;
+    size_t num_uvs = 0u;
+    size_t num_materials = 0u;
+    for (auto it = begin; it != end; ++it) {
+      if (*it != nullptr) {
+        num_vertices += (*it)->_vertices.size();
+        num_normals += (*it)->_normals.size();
+        num_indexes += (*it)->_indexes.size();
+        num_uvs += (*it)->_uvs.size();
+        num_materials += (*it)->_materials.size();
+      }
+    }
+    // Reserving only what is added keeps the buffers as they are when the
+    // rest of the meshes are empty.
+    _vertices.reserve(_vertices.size() + num_vertices);
+    _normals.reserve(_normals.size() + num_normals);
+    _indexes.reserve(_indexes.size() + num_indexes);
+    _uvs.reserve(_uvs.size() + num_uvs);
+    _materials.reserve(_materials.size() + num_materials);
+    for (auto it = begin; it != end; ++it) {
+      if (*it != nullptr) {
+        *this += **it;
+      }
+    }
+  }
+
+  bool Mesh::IsEmpty() const {
+    return _vertices.empty() && _normals.empty() && _indexes.empty() &&
+        _uvs.empty() && _materials.empty();
+  }
+
   Mesh operator+(const Mesh &lhs, const Mesh &rhs) {
     Mesh m = lhs;
     return m += rhs;
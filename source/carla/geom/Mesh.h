@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <iosfwd>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <carla/geom/Vector3D.h>
@@ -74,18 +77,44 @@ namespace geom {
     // -- Mesh build methods ---------------------------------------------------
     // =========================================================================
 
+    /// Reserves memory for at least the given amount of vertices, indexes
+    /// and uvs, so building a mesh of a known size does not reallocate.
+    void Reserve(size_t num_vertices, size_t num_indexes, size_t num_uvs = 0u);
+
+    /// Number of indexes added by a triangle strip or fan of
+    /// @a num_vertices vertices, useful to compute the size to Reserve.
+    static constexpr size_t GetTriangleStripIndexesNum(size_t num_vertices) {
+      return num_vertices < 3u ? 0u : 3u * (num_vertices - 2u);
+    }
+
     /// Adds a triangle strip to the mesh, vertex order is counterclockwise.
     void AddTriangleStrip(const std::vector<vertex_type> &vertices);
 
+    /// Adds a triangle strip of the @a count vertices starting at
+    /// @a vertices, vertex order is counterclockwise.
+    void AddTriangleStrip(const vertex_type *vertices, size_t count);
+
+    /// Adds the indexes of a triangle strip over @a count vertices already
+    /// in the mesh, starting at the (1-based) index @a first_index. Lets the
+    /// vertices be written directly with AddVertex, with no temporary list.
+    void AddTriangleStripIndexes(index_type first_index, size_t count);
+
     /// Adds a triangle fan to the mesh, vertex order is counterclockwise.
     void AddTriangleFan(const std::vector<vertex_type> &vertices);
 
+    /// Adds a triangle fan of the @a count vertices starting at
+    /// @a vertices, vertex order is counterclockwise.
+    void AddTriangleFan(const vertex_type *vertices, size_t count);
+
     /// Appends a vertex to the vertices list.
     void AddVertex(vertex_type vertex);
 
     /// Appends a vertex to the vertices list.
     void AddVertices(const std::vector<vertex_type> &vertices);
 
+    /// Appends the @a count vertices starting at @a vertices.
+    void AddVertices(const vertex_type *vertices, size_t count);
+
     /// Appends a normal to the normal list.
     void AddNormal(normal_type normal);
 
@@ -118,10 +147,29 @@ namespace geom {
     /// Changes the build face direction and the coordinate space.
     std::string GenerateOBJForRecast() const;
 
-    /// Returns a string containing the mesh encoded in PLY.
+    /// Returns a string containing the mesh encoded in binary PLY.
     /// Units are in meters.
     std::string GeneratePLY() const;
 
+    /// Writes the mesh encoded in OBJ to @a out, see GenerateOBJ.
+    void WriteOBJ(std::ostream &out) const;
+
+    /// Writes the mesh encoded in OBJ for Recast to @a out, see
+    /// GenerateOBJForRecast.
+    void WriteOBJForRecast(std::ostream &out) const;
+
+    /// Writes the mesh encoded in little-endian binary PLY to @a out.
+    /// Normals and uvs are included when there is one per vertex. Units are
+    /// in meters. It is in Unreal space.
+    void WritePLY(std::ostream &out) const;
+
+    /// Writes the mesh encoded in binary glTF 2.0 (.glb) to @a out, with all
+    /// the triangles in a single primitive. Normals and uvs are included when
+    /// there is one per vertex. Units are in meters. Y and Z are swapped to
+    /// match the Y-up glTF space, which also changes the build face
+    /// direction.
+    void WriteGLB(std::ostream &out) const;
+
     // =========================================================================
     // -- Other methods --------------------------------------------------------
     // =========================================================================
@@ -153,6 +201,19 @@ namespace geom {
     /// Merges two meshes into a single mesh
     Mesh &operator+=(const Mesh &rhs);
 
+    /// Merges two meshes into a single mesh. If this mesh is empty it takes
+    /// the buffers of @a rhs instead of copying them.
+    Mesh &operator+=(Mesh &&rhs);
+
+    /// Merges all the @a meshes (null ones are skipped) into this mesh,
+    /// reserving the memory for all of them at once.
+    Mesh &Append(const std::vector<std::unique_ptr<Mesh>> &meshes);
+
+    /// Merges all the @a meshes (null ones are skipped) into this mesh,
+    /// reserving the memory for all of them at once. If this mesh is empty,
+    /// the buffers of the first mesh are taken instead of copied.
+    Mesh &Append(std::vector<std::unique_ptr<Mesh>> &&meshes);
+
     friend Mesh operator+(const Mesh &lhs, const Mesh &rhs);
 
     // =========================================================================
@@ -228,6 +289,15 @@ namespace geom {
 
   private:
 
+    /// Whether the mesh has no data at all.
+    bool IsEmpty() const;
+
+    using MeshIterator = std::vector<std::unique_ptr<Mesh>>::const_iterator;
+
+    /// Merges the meshes in [@a begin, @a end) into this mesh, reserving the
+    /// memory they add at once.
+    void AppendMeshes(MeshIterator begin, MeshIterator end);
+
     // =========================================================================
     // -- Private data members -------------------------------------------------
     // =========================================================================
@@ -0,0 +1,255 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/geom/PiecewiseCubicPolynomial.h"
+
+#include "carla/Debug.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#  include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+namespace carla {
+namespace geom {
+
+  using value_type = PiecewiseCubicPolynomial::value_type;
+
+  // ===========================================================================
+  // -- Kernels ----------------------------------------------------------------
+  // ===========================================================================
+
+  // The kernels below keep the exact operation order of
+  // CubicPolynomial::Evaluate and CubicPolynomial::Tangent so the batched
+  // results are bit-identical to the scalar ones.
+
+  /// out[i] = a + s[i] * (b + s[i] * (c + s[i] * d))
+  static void EvaluateRun(
+      const value_type a,
+      const value_type b,
+      const value_type c,
+      const value_type d,
+      const value_type *s,
+      const size_t count,
+      value_type *out) {
+    size_t i = 0u;
+#if defined(__AVX__)
+    const __m256d va = _mm256_set1_pd(a);
+    const __m256d vb = _mm256_set1_pd(b);
+    const __m256d vc = _mm256_set1_pd(c);
+    const __m256d vd = _mm256_set1_pd(d);
+    for (; i + 4u <= count; i += 4u) {
+      const __m256d x = _mm256_loadu_pd(s + i);
+      __m256d r = _mm256_add_pd(vc, _mm256_mul_pd(x, vd));
+      r = _mm256_add_pd(vb, _mm256_mul_pd(x, r));
+      r = _mm256_add_pd(va, _mm256_mul_pd(x, r));
+      _mm256_storeu_pd(out + i, r);
+    }
+#elif defined(__SSE2__)
+    const __m128d va = _mm_set1_pd(a);
+    const __m128d vb = _mm_set1_pd(b);
+    const __m128d vc = _mm_set1_pd(c);
+    const __m128d vd = _mm_set1_pd(d);
+    for (; i + 2u <= count; i += 2u) {
+      const __m128d x = _mm_loadu_pd(s + i);
+      __m128d r = _mm_add_pd(vc, _mm_mul_pd(x, vd));
+      r = _mm_add_pd(vb, _mm_mul_pd(x, r));
+      r = _mm_add_pd(va, _mm_mul_pd(x, r));
+      _mm_storeu_pd(out + i, r);
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    const float64x2_t va = vdupq_n_f64(a);
+    const float64x2_t vb = vdupq_n_f64(b);
+    const float64x2_t vc = vdupq_n_f64(c);
+    const float64x2_t vd = vdupq_n_f64(d);
+    for (; i + 2u <= count; i += 2u) {
+      const float64x2_t x = vld1q_f64(s + i);
+      // Plain mul + add instead of vfmaq to match the scalar rounding.
+      float64x2_t r = vaddq_f64(vc, vmulq_f64(x, vd));
+      r = vaddq_f64(vb, vmulq_f64(x, r));
+      r = vaddq_f64(va, vmulq_f64(x, r));
+      vst1q_f64(out + i, r);
+    }
+#endif
+    for (; i < count; ++i) {
+      const value_type x = s[i];
+      out[i] = a + x * (b + x * (c + x * d));
+    }
+  }
+
+  /// out[i] = b + s[i] * (2c + s[i] * 3 * d)
+  static void TangentRun(
+      const value_type b,
+      const value_type c,
+      const value_type d,
+      const value_type *s,
+      const size_t count,
+      value_type *out) {
+    const value_type c2 = 2 * c;
+    size_t i = 0u;
+#if defined(__AVX__)
+    const __m256d vb = _mm256_set1_pd(b);
+    const __m256d vc2 = _mm256_set1_pd(c2);
+    const __m256d vd = _mm256_set1_pd(d);
+    const __m256d v3 = _mm256_set1_pd(3.0);
+    for (; i + 4u <= count; i += 4u) {
+      const __m256d x = _mm256_loadu_pd(s + i);
+      __m256d r = _mm256_mul_pd(_mm256_mul_pd(x, v3), vd);
+      r = _mm256_add_pd(vc2, r);
+      r = _mm256_add_pd(vb, _mm256_mul_pd(x, r));
+      _mm256_storeu_pd(out + i, r);
+    }
+#elif defined(__SSE2__)
+    const __m128d vb = _mm_set1_pd(b);
+    const __m128d vc2 = _mm_set1_pd(c2);
+    const __m128d vd = _mm_set1_pd(d);
+    const __m128d v3 = _mm_set1_pd(3.0);
+    for (; i + 2u <= count; i += 2u) {
+      const __m128d x = _mm_loadu_pd(s + i);
+      __m128d r = _mm_mul_pd(_mm_mul_pd(x, v3), vd);
+      r = _mm_add_pd(vc2, r);
+      r = _mm_add_pd(vb, _mm_mul_pd(x, r));
+      _mm_storeu_pd(out + i, r);
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    const float64x2_t vb = vdupq_n_f64(b);
+    const float64x2_t vc2 = vdupq_n_f64(c2);
+    const float64x2_t vd = vdupq_n_f64(d);
+    const float64x2_t v3 = vdupq_n_f64(3.0);
+    for (; i + 2u <= count; i += 2u) {
+      const float64x2_t x = vld1q_f64(s + i);
+      float64x2_t r = vmulq_f64(vmulq_f64(x, v3), vd);
+      r = vaddq_f64(vc2, r);
+      r = vaddq_f64(vb, vmulq_f64(x, r));
+      vst1q_f64(out + i, r);
+    }
+#endif
+    for (; i < count; ++i) {
+      const value_type x = s[i];
+      out[i] = b + x * (c2 + x * 3 * d);
+    }
+  }
+
+  // ===========================================================================
+  // -- PiecewiseCubicPolynomial -----------------------------------------------
+  // ===========================================================================
+
+  void PiecewiseCubicPolynomial::Reserve(const size_t size) {
+    _start.reserve(size);
+    _a.reserve(size);
+    _b.reserve(size);
+    _c.reserve(size);
+    _d.reserve(size);
+  }
+
+  void PiecewiseCubicPolynomial::Append(
+      const value_type start,
+      const CubicPolynomial &polynomial) {
+    DEBUG_ASSERT(_start.empty() || _start.back() <= start);
+    _start.push_back(start);
+    _a.push_back(polynomial.GetA());
+    _b.push_back(polynomial.GetB());
+    _c.push_back(polynomial.GetC());
+    _d.push_back(polynomial.GetD());
+  }
+
+  size_t PiecewiseCubicPolynomial::FindRecord(const value_type s) const {
+    // Same lookup as RoadElementSet::GetReverseSubset: the last record whose
+    // start is less or equal than s.
+    const auto it = std::upper_bound(_start.begin(), _start.end(), s);
+    if (it == _start.begin()) {
+      return _start.size();
+    }
+    return static_cast<size_t>(std::distance(_start.begin(), it)) - 1u;
+  }
+
+  /// Splits [0, count) into runs of consecutive values that fall in the same
+  /// record and calls @a callback(record, begin, end) for each one.
+  template <typename FuncT>
+  static void ForEachRun(
+      const std::vector<value_type> &starts,
+      const PiecewiseCubicPolynomial &polynomial,
+      const value_type *s,
+      const size_t count,
+      FuncT &&callback) {
+    constexpr value_type lowest = std::numeric_limits<value_type>::lowest();
+    constexpr value_type highest = std::numeric_limits<value_type>::max();
+    size_t begin = 0u;
+    while (begin < count) {
+      const size_t record = polynomial.FindRecord(s[begin]);
+      value_type low, high;
+      if (record == starts.size()) {
+        low = lowest;
+        high = starts.empty() ? highest : starts.front();
+      } else {
+        low = starts[record];
+        high = record + 1u < starts.size() ? starts[record + 1u] : highest;
+      }
+      size_t end = begin + 1u;
+      while (end < count && s[end] >= low && s[end] < high) {
+        ++end;
+      }
+      callback(record, begin, end);
+      begin = end;
+    }
+  }
+
+  void PiecewiseCubicPolynomial::Evaluate(
+      const value_type *s,
+      const size_t count,
+      value_type *out) const {
+    ForEachRun(_start, *this, s, count, [&](size_t record, size_t begin, size_t end) {
+      if (record == _start.size()) {
+        std::fill(out + begin, out + end, 0.0);
+      } else {
+        EvaluateRun(
+            _a[record], _b[record], _c[record], _d[record],
+            s + begin, end - begin, out + begin);
+      }
+    });
+  }
+
+  void PiecewiseCubicPolynomial::Tangent(
+      const value_type *s,
+      const size_t count,
+      value_type *out) const {
+    ForEachRun(_start, *this, s, count, [&](size_t record, size_t begin, size_t end) {
+      if (record == _start.size()) {
+        std::fill(out + begin, out + end, 0.0);
+      } else {
+        TangentRun(
+            _b[record], _c[record], _d[record],
+            s + begin, end - begin, out + begin);
+      }
+    });
+  }
+
+  void PiecewiseCubicPolynomial::EvaluateWithTangent(
+      const value_type *s,
+      const size_t count,
+      value_type *out_value,
+      value_type *out_tangent) const {
+    ForEachRun(_start, *this, s, count, [&](size_t record, size_t begin, size_t end) {
+      if (record == _start.size()) {
+        std::fill(out_value + begin, out_value + end, 0.0);
+        std::fill(out_tangent + begin, out_tangent + end, 0.0);
+      } else {
+        EvaluateRun(
+            _a[record], _b[record], _c[record], _d[record],
+            s + begin, end - begin, out_value + begin);
+        TangentRun(
+            _b[record], _c[record], _d[record],
+            s + begin, end - begin, out_tangent + begin);
+      }
+    });
+  }
+
+} // namespace geom
+} // namespace carla
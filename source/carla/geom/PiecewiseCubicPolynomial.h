@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/CubicPolynomial.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace carla {
+namespace geom {
+
+  /// Structure-of-arrays copy of a list of consecutive CubicPolynomial
+  /// records (lane widths, lane offsets, elevations, ...), each valid from its
+  /// start distance until the start of the next one.
+  ///
+  /// Evaluates a whole range of "s" values at once, splitting the range by
+  /// record boundaries and evaluating each run with SIMD when available.
+  class PiecewiseCubicPolynomial {
+  public:
+
+    using value_type = CubicPolynomial::value_type;
+
+    PiecewiseCubicPolynomial() = default;
+
+    /// Builds the piecewise polynomial from a list of road infos ordered by
+    /// distance, as returned by InformationSet::GetInfos<T>(). @a T must
+    /// provide GetDistance() and GetPolynomial().
+    template <typename T>
+    static PiecewiseCubicPolynomial FromInfos(const std::vector<const T *> &infos) {
+      PiecewiseCubicPolynomial result;
+      result.Reserve(infos.size());
+      for (const auto *info : infos) {
+        result.Append(info->GetDistance(), info->GetPolynomial());
+      }
+      return result;
+    }
+
+    void Reserve(size_t size);
+
+    /// Appends a record valid from @a start. Records must be appended in
+    /// ascending order of @a start.
+    void Append(value_type start, const CubicPolynomial &polynomial);
+
+    bool empty() const {
+      return _start.empty();
+    }
+
+    size_t size() const {
+      return _start.size();
+    }
+
+    /// Evaluates f(s) for each of the @a count values in @a s and writes the
+    /// results in @a out. Values before the first record evaluate to 0, as
+    /// when InformationSet::GetInfo returns no record. Ascending @a s gives
+    /// the longest runs, but any order is valid.
+    void Evaluate(const value_type *s, size_t count, value_type *out) const;
+
+    /// Same as Evaluate but computes df/ds.
+    void Tangent(const value_type *s, size_t count, value_type *out) const;
+
+    /// Computes both f(s) and df/ds in a single pass.
+    void EvaluateWithTangent(
+        const value_type *s,
+        size_t count,
+        value_type *out_value,
+        value_type *out_tangent) const;
+
+    /// Returns the index of the record valid at @a s, or size() if @a s lies
+    /// before the first record.
+    size_t FindRecord(value_type s) const;
+
+  private:
+
+    std::vector<value_type> _start;
+
+    std::vector<value_type> _a;
+
+    std::vector<value_type> _b;
+
+    std::vector<value_type> _c;
+
+    std::vector<value_type> _d;
+  };
+
+} // namespace geom
+} // namespace carla
@@ -0,0 +1,379 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/image/DepthUnprojector.h"
+
+#include "carla/Debug.h"
+#include "carla/ParallelFor.h"
+#include "carla/geom/Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#if defined(__SSE2__)
+#  include <immintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+#    define LIBCARLA_DEPTH_UNPROJECTOR_AVX2
+#    define LIBCARLA_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#  include <arm_neon.h>
+#  define LIBCARLA_DEPTH_UNPROJECTOR_NEON
+#endif
+
+namespace carla {
+namespace image {
+
+  using Color = sensor::data::Color;
+
+  /// Pixels handed to each job, rounded to whole rows.
+  static constexpr size_t PIXELS_PER_JOB = 1u << 16u;
+
+  static constexpr float MAX_DEPTH = static_cast<float>(256 * 256 * 256 - 1);
+
+  /// Depth in meters of the farthest encoded value.
+  static constexpr float FAR_PLANE = 1000.0f;
+
+  /// Origin and directions of the rays of one row: the ray of column u goes
+  /// from origin along base + ray_y[u] * right.
+  struct RowFrame {
+    float origin[3];
+
+    float base[3];
+
+    float right[3];
+  };
+
+  using RowKernelFn = void (*)(
+      const Color *, const float *, size_t, const RowFrame &, float *, float *, float *);
+
+  // ===========================================================================
+  // -- Row kernels ------------------------------------------------------------
+  // ===========================================================================
+
+  /// Same decoding as ColorConverter::Depth, scaled to meters.
+  static inline float DecodeDepth(const Color &color) {
+    const float depth = color.r + (color.g * 256) + (color.b * 256 * 256);
+    return (depth / MAX_DEPTH) * FAR_PLANE;
+  }
+
+  static void UnprojectRowScalar(
+      const Color *pixels,
+      const float *ray_y,
+      const size_t count,
+      const RowFrame &frame,
+      float *x,
+      float *y,
+      float *z) {
+    for (size_t i = 0u; i < count; ++i) {
+      const float depth = DecodeDepth(pixels[i]);
+      x[i] = frame.origin[0u] + depth * (frame.base[0u] + ray_y[i] * frame.right[0u]);
+      y[i] = frame.origin[1u] + depth * (frame.base[1u] + ray_y[i] * frame.right[1u]);
+      z[i] = frame.origin[2u] + depth * (frame.base[2u] + ray_y[i] * frame.right[2u]);
+    }
+  }
+
+#if defined(__SSE2__)
+
+  static void UnprojectRowSSE2(
+      const Color *pixels,
+      const float *ray_y,
+      const size_t count,
+      const RowFrame &frame,
+      float *x,
+      float *y,
+      float *z) {
+    float *out[3u] = {x, y, z};
+    const __m128i byte = _mm_set1_epi32(0xff);
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+      const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), byte);
+      const __m128i g = _mm_and_si128(p, _mm_set1_epi32(0xff00));
+      const __m128i b = _mm_slli_epi32(_mm_and_si128(p, byte), 16);
+      const __m128 encoded = _mm_cvtepi32_ps(_mm_or_si128(_mm_or_si128(r, g), b));
+      const __m128 depth = _mm_mul_ps(_mm_div_ps(encoded, _mm_set1_ps(MAX_DEPTH)), _mm_set1_ps(FAR_PLANE));
+      const __m128 ray = _mm_loadu_ps(ray_y + i);
+      for (size_t c = 0u; c < 3u; ++c) {
+        const __m128 direction = _mm_add_ps(
+            _mm_set1_ps(frame.base[c]),
+            _mm_mul_ps(ray, _mm_set1_ps(frame.right[c])));
+        _mm_storeu_ps(out[c] + i, _mm_add_ps(_mm_set1_ps(frame.origin[c]), _mm_mul_ps(depth, direction)));
+      }
+    }
+    UnprojectRowScalar(pixels + i, ray_y + i, count - i, frame, x + i, y + i, z + i);
+  }
+
+#endif // __SSE2__
+
+#if defined(LIBCARLA_DEPTH_UNPROJECTOR_AVX2)
+
+  // Compiled for AVX2 regardless of the compiler flags, and only called if
+  // the CPU supports it.
+  LIBCARLA_TARGET_AVX2
+  static void UnprojectRowAVX2(
+      const Color *pixels,
+      const float *ray_y,
+      const size_t count,
+      const RowFrame &frame,
+      float *x,
+      float *y,
+      float *z) {
+    float *out[3u] = {x, y, z};
+    const __m256i byte = _mm256_set1_epi32(0xff);
+    size_t i = 0u;
+    for (; i + 8u <= count; i += 8u) {
+      const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+      const __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), byte);
+      const __m256i g = _mm256_and_si256(p, _mm256_set1_epi32(0xff00));
+      const __m256i b = _mm256_slli_epi32(_mm256_and_si256(p, byte), 16);
+      const __m256 encoded = _mm256_cvtepi32_ps(_mm256_or_si256(_mm256_or_si256(r, g), b));
+      const __m256 depth = _mm256_mul_ps(
+          _mm256_div_ps(encoded, _mm256_set1_ps(MAX_DEPTH)),
+          _mm256_set1_ps(FAR_PLANE));
+      const __m256 ray = _mm256_loadu_ps(ray_y + i);
+      for (size_t c = 0u; c < 3u; ++c) {
+        const __m256 direction = _mm256_add_ps(
+            _mm256_set1_ps(frame.base[c]),
+            _mm256_mul_ps(ray, _mm256_set1_ps(frame.right[c])));
+        _mm256_storeu_ps(out[c] + i, _mm256_add_ps(_mm256_set1_ps(frame.origin[c]), _mm256_mul_ps(depth, direction)));
+      }
+    }
+    UnprojectRowScalar(pixels + i, ray_y + i, count - i, frame, x + i, y + i, z + i);
+  }
+
+#endif // LIBCARLA_DEPTH_UNPROJECTOR_AVX2
+
+#if defined(LIBCARLA_DEPTH_UNPROJECTOR_NEON)
+
+  static void UnprojectRowNEON(
+      const Color *pixels,
+      const float *ray_y,
+      const size_t count,
+      const RowFrame &frame,
+      float *x,
+      float *y,
+      float *z) {
+    float *out[3u] = {x, y, z};
+    const uint32x4_t byte = vdupq_n_u32(0xffu);
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      // Colors are packed, so pixels are loaded as bytes.
+      const uint32x4_t p = vreinterpretq_u32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(pixels + i)));
+      const uint32x4_t r = vandq_u32(vshrq_n_u32(p, 16), byte);
+      const uint32x4_t g = vandq_u32(p, vdupq_n_u32(0xff00u));
+      const uint32x4_t b = vshlq_n_u32(vandq_u32(p, byte), 16);
+      const float32x4_t encoded = vcvtq_f32_u32(vorrq_u32(vorrq_u32(r, g), b));
+      const float32x4_t depth = vmulq_f32(
+          vdivq_f32(encoded, vdupq_n_f32(MAX_DEPTH)),
+          vdupq_n_f32(FAR_PLANE));
+      const float32x4_t ray = vld1q_f32(ray_y + i);
+      for (size_t c = 0u; c < 3u; ++c) {
+        // Plain mul + add instead of vfmaq to match the scalar rounding.
+        const float32x4_t direction = vaddq_f32(
+            vdupq_n_f32(frame.base[c]),
+            vmulq_f32(ray, vdupq_n_f32(frame.right[c])));
+        vst1q_f32(out[c] + i, vaddq_f32(vdupq_n_f32(frame.origin[c]), vmulq_f32(depth, direction)));
+      }
+    }
+    UnprojectRowScalar(pixels + i, ray_y + i, count - i, frame, x + i, y + i, z + i);
+  }
+
+#endif // LIBCARLA_DEPTH_UNPROJECTOR_NEON
+
+  static RowKernelFn SelectRowKernel() {
+#if defined(LIBCARLA_DEPTH_UNPROJECTOR_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return UnprojectRowAVX2;
+    }
+#endif
+#if defined(__SSE2__)
+    return UnprojectRowSSE2;
+#elif defined(LIBCARLA_DEPTH_UNPROJECTOR_NEON)
+    return UnprojectRowNEON;
+#else
+    return UnprojectRowScalar;
+#endif
+  }
+
+  static RowKernelFn GetRowKernel() {
+    static const RowKernelFn kernel = SelectRowKernel();
+    return kernel;
+  }
+
+  // ===========================================================================
+  // -- DepthUnprojector -------------------------------------------------------
+  // ===========================================================================
+
+  DepthUnprojector::DepthUnprojector(
+      const uint32_t width,
+      const uint32_t height,
+      const float fov_angle)
+    : _width(width),
+      _height(height),
+      _fov_angle(fov_angle),
+      _ray_y(width),
+      _ray_z(height) {
+    DEBUG_ASSERT(fov_angle > 0.0f && fov_angle < 180.0f);
+    // Pinhole camera with the principal point at the center of the image.
+    const float focal = static_cast<float>(width) /
+        (2.0f * std::tan(geom::Math::ToRadians(fov_angle) / 2.0f));
+    const float cx = static_cast<float>(width) / 2.0f;
+    const float cy = static_cast<float>(height) / 2.0f;
+    for (uint32_t u = 0u; u < width; ++u) {
+      _ray_y[u] = (static_cast<float>(u) - cx) / focal;
+    }
+    // Rows go down the image, z goes up.
+    for (uint32_t v = 0u; v < height; ++v) {
+      _ray_z[v] = (cy - static_cast<float>(v)) / focal;
+    }
+  }
+
+  SharedPtr<const DepthUnprojector> DepthUnprojector::Get(
+      const uint32_t width,
+      const uint32_t height,
+      const float fov_angle) {
+    static std::mutex mutex;
+    static std::map<std::tuple<uint32_t, uint32_t, float>, SharedPtr<const DepthUnprojector>> unprojectors;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &unprojector = unprojectors[std::make_tuple(width, height, fov_angle)];
+    if (unprojector == nullptr) {
+      unprojector = MakeShared<const DepthUnprojector>(width, height, fov_angle);
+    }
+    return unprojector;
+  }
+
+  void DepthUnprojector::Unproject(
+      const Image &depth,
+      DepthPointCloud &out,
+      const DepthUnprojectionOptions &options) const {
+    Unproject(depth, nullptr, false, out, options);
+  }
+
+  void DepthUnprojector::Unproject(
+      const Image &depth,
+      const Image &segmentation,
+      const bool instance,
+      DepthPointCloud &out,
+      const DepthUnprojectionOptions &options) const {
+    Unproject(depth, &segmentation, instance, out, options);
+  }
+
+  void DepthUnprojector::Unproject(
+      const Image &depth,
+      const Image *segmentation,
+      const bool instance,
+      DepthPointCloud &out,
+      const DepthUnprojectionOptions &options) const {
+    DEBUG_ASSERT(depth.GetWidth() == _width);
+    DEBUG_ASSERT(depth.GetHeight() == _height);
+    DEBUG_ASSERT(segmentation == nullptr || segmentation->size() == depth.size());
+
+    const size_t width = _width;
+    const size_t pixels = depth.size();
+    if (out.x.size() < pixels) {
+      out.x.resize(pixels);
+      out.y.resize(pixels);
+      out.z.resize(pixels);
+    }
+    if (segmentation != nullptr && out.tag.size() < pixels) {
+      out.tag.resize(pixels);
+    }
+    if (segmentation != nullptr && instance && out.instance.size() < pixels) {
+      out.instance.resize(pixels);
+    }
+
+    // Rotation columns and origin of the output frame.
+    RowFrame frame = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+    float up[3u] = {0.0f, 0.0f, 1.0f};
+    if (options.world_coordinates) {
+      const auto matrix = depth.GetSensorTransform().GetMatrix();
+      for (size_t c = 0u; c < 3u; ++c) {
+        frame.origin[c] = matrix[4u * c + 3u];
+        frame.base[c] = matrix[4u * c + 0u];
+        frame.right[c] = matrix[4u * c + 1u];
+        up[c] = matrix[4u * c + 2u];
+      }
+    }
+    const bool filter = std::isfinite(options.max_depth);
+
+    // Each job writes its points at the start of its own rows, then the
+    // chunks are moved together in order.
+    const size_t rows_per_job = std::max<size_t>(1u, PIXELS_PER_JOB / std::max<size_t>(1u, width));
+    const size_t jobs = (_height + rows_per_job - 1u) / rows_per_job;
+    std::vector<size_t> counts(jobs, 0u);
+    const RowKernelFn kernel = GetRowKernel();
+    const Color *depth_pixels = depth.data();
+    const Color *segmentation_pixels = segmentation != nullptr ? segmentation->data() : nullptr;
+    ParallelFor(jobs, [&](const size_t job) {
+      const size_t row_begin = job * rows_per_job;
+      const size_t row_end = std::min<size_t>(_height, row_begin + rows_per_job);
+      RowFrame row_frame = frame;
+      for (size_t v = row_begin; v < row_end; ++v) {
+        for (size_t c = 0u; c < 3u; ++c) {
+          row_frame.base[c] = frame.base[c] + _ray_z[v] * up[c];
+        }
+        const size_t offset = v * width;
+        kernel(depth_pixels + offset, _ray_y.data(), width, row_frame,
+            out.x.data() + offset, out.y.data() + offset, out.z.data() + offset);
+      }
+
+      const size_t begin = row_begin * width;
+      const size_t end = row_end * width;
+      if (!filter && segmentation_pixels == nullptr) {
+        counts[job] = end - begin;
+        return;
+      }
+      size_t written = begin;
+      for (size_t i = begin; i < end; ++i) {
+        if (filter && !(DecodeDepth(depth_pixels[i]) < options.max_depth)) {
+          continue;
+        }
+        out.x[written] = out.x[i];
+        out.y[written] = out.y[i];
+        out.z[written] = out.z[i];
+        if (segmentation_pixels != nullptr) {
+          const Color &color = segmentation_pixels[i];
+          out.tag[written] = color.r;
+          if (instance) {
+            out.instance[written] = static_cast<uint16_t>(color.g | (color.b << 8));
+          }
+        }
+        ++written;
+      }
+      counts[job] = written - begin;
+    });
+
+    // Chunks only move towards the start, so each one is copied before any
+    // later chunk is overwritten.
+    size_t total = 0u;
+    for (size_t job = 0u; job < jobs; ++job) {
+      const size_t begin = job * rows_per_job * width;
+      if (total != begin) {
+        auto move = [&](auto &buffer) {
+          std::copy(buffer.begin() + begin, buffer.begin() + begin + counts[job], buffer.begin() + total);
+        };
+        move(out.x);
+        move(out.y);
+        move(out.z);
+        if (segmentation_pixels != nullptr) {
+          move(out.tag);
+          if (instance) {
+            move(out.instance);
+          }
+        }
+      }
+      total += counts[job];
+    }
+    out.count = total;
+  }
+
+} // namespace image
+} // namespace carla
@@ -0,0 +1,125 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Memory.h"
+#include "carla/geom/Transform.h"
+#include "carla/sensor/data/Color.h"
+#include "carla/sensor/data/ImageTmpl.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace carla {
+namespace image {
+
+  /// Points unprojected from a depth image, as a structure of arrays. The
+  /// buffers keep their size between calls, only the first @a count elements
+  /// are valid.
+  struct DepthPointCloud {
+    std::vector<float> x;
+
+    std::vector<float> y;
+
+    std::vector<float> z;
+
+    /// Semantic tag of each point, only filled if a segmentation image is
+    /// given.
+    std::vector<uint8_t> tag;
+
+    /// Instance id of each point (green and blue channels), only filled if
+    /// an instance segmentation image is given.
+    std::vector<uint16_t> instance;
+
+    /// Number of points written.
+    size_t count = 0u;
+  };
+
+  struct DepthUnprojectionOptions {
+    /// Pixels at this depth in meters or farther (e.g. the sky) produce no
+    /// point.
+    float max_depth = std::numeric_limits<float>::infinity();
+
+    /// Output in world coordinates using the sensor transform of the image,
+    /// otherwise in the sensor frame (x forward, y right, z up).
+    bool world_coordinates = true;
+  };
+
+  /// Turns depth camera images into point clouds.
+  ///
+  /// The ray of each column and row is computed once per image size and field
+  /// of view. Each image is then decoded with SIMD and split in chunks of
+  /// rows between the threads of the shared JobSystem. Unproject is const and
+  /// can be called for several cameras at once, also from inside a
+  /// ParallelFor over the cameras of a rig.
+  class DepthUnprojector {
+  public:
+
+    using Image = sensor::data::ImageTmpl<sensor::data::Color>;
+
+    DepthUnprojector(uint32_t width, uint32_t height, float fov_angle);
+
+    /// Unprojector shared by all the cameras with this image size and field
+    /// of view, created on first use.
+    static SharedPtr<const DepthUnprojector> Get(uint32_t width, uint32_t height, float fov_angle);
+
+    uint32_t GetWidth() const {
+      return _width;
+    }
+
+    uint32_t GetHeight() const {
+      return _height;
+    }
+
+    float GetFOVAngle() const {
+      return _fov_angle;
+    }
+
+    /// Writes one point for each pixel of @a depth closer than the maximum
+    /// depth into @a out, growing its buffers if needed.
+    void Unproject(
+        const Image &depth,
+        DepthPointCloud &out,
+        const DepthUnprojectionOptions &options = DepthUnprojectionOptions()) const;
+
+    /// Same as above, also taking the tag of each point from the red channel
+    /// of @a segmentation and, if @a instance is true, the instance id from
+    /// its green and blue channels. @a segmentation must have the size of
+    /// @a depth.
+    void Unproject(
+        const Image &depth,
+        const Image &segmentation,
+        bool instance,
+        DepthPointCloud &out,
+        const DepthUnprojectionOptions &options = DepthUnprojectionOptions()) const;
+
+  private:
+
+    void Unproject(
+        const Image &depth,
+        const Image *segmentation,
+        bool instance,
+        DepthPointCloud &out,
+        const DepthUnprojectionOptions &options) const;
+
+    const uint32_t _width;
+
+    const uint32_t _height;
+
+    const float _fov_angle;
+
+    /// Horizontal offset of the ray of each column, per meter forward.
+    std::vector<float> _ray_y;
+
+    /// Vertical offset of the ray of each row, per meter forward.
+    std::vector<float> _ray_z;
+  };
+
+} // namespace image
+} // namespace carla
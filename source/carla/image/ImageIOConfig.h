@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "carla/Debug.h"
 #include "carla/FileSystem.h"
 #include "carla/Logging.h"
 #include "carla/StringUtil.h"
@@ -72,6 +73,17 @@
 
 namespace carla {
 namespace image {
+
+  /// Encoder settings of the formats that have them, formats without
+  /// settings ignore them. Defaults are the ones of Boost.GIL.
+  struct ImageWriteOptions {
+    /// zlib compression level of PNG files, from 0 (none, fastest) to 9.
+    int png_compression_level = 3;
+
+    /// Quality of JPEG files, from 1 to 100.
+    int jpeg_quality = 100;
+  };
+
 namespace io {
 
   constexpr bool has_png_support() {
@@ -123,6 +135,13 @@ namespace detail {
       boost::gil::write_view(std::forward<Str>(out_filename), view, boost::gil::png_tag());
     }
 
+    template <typename Str, typename ViewT>
+    static void write_view(Str &&out_filename, const ViewT &view, const ImageWriteOptions &options) {
+      boost::gil::image_write_info<boost::gil::png_tag> info;
+      info._compression_level = options.png_compression_level;
+      boost::gil::write_view(std::forward<Str>(out_filename), view, info);
+    }
+
 #endif // LIBCARLA_IMAGE_WITH_PNG_SUPPORT
   };
 
@@ -162,6 +181,24 @@ namespace detail {
           boost::gil::jpeg_tag());
     }
 
+    template <typename Str, typename ViewT>
+    static typename std::enable_if<is_write_supported<ViewT, boost::gil::jpeg_tag>::value>::type
+    write_view(Str &&out_filename, const ViewT &view, const ImageWriteOptions &options) {
+      boost::gil::write_view(
+          std::forward<Str>(out_filename),
+          view,
+          boost::gil::image_write_info<boost::gil::jpeg_tag>(options.jpeg_quality));
+    }
+
+    template <typename Str, typename ViewT>
+    static typename std::enable_if<!is_write_supported<ViewT, boost::gil::jpeg_tag>::value>::type
+    write_view(Str &&out_filename, const ViewT &view, const ImageWriteOptions &options) {
+      boost::gil::write_view(
+          std::forward<Str>(out_filename),
+          boost::gil::color_converted_view<boost::gil::rgb8_pixel_t>(view),
+          boost::gil::image_write_info<boost::gil::jpeg_tag>(options.jpeg_quality));
+    }
+
 #endif // LIBCARLA_IMAGE_WITH_JPEG_SUPPORT
   };
 
@@ -200,6 +237,11 @@ namespace detail {
           boost::gil::tiff_tag());
     }
 
+    template <typename Str, typename ViewT>
+    static void write_view(Str &&out_filename, const ViewT &view, const ImageWriteOptions &) {
+      write_view(std::forward<Str>(out_filename), view);
+    }
+
 #endif // LIBCARLA_IMAGE_WITH_TIFF_SUPPORT
   };
 
@@ -0,0 +1,334 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/image/ImageKernels.h"
+
+#include "carla/ParallelFor.h"
+#include "carla/SimdMath.h"
+#include "carla/image/CityScapesPalette.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace carla {
+namespace image {
+
+  using Color = sensor::data::Color;
+
+  /// Pixels handed to each job.
+  static constexpr size_t PIXELS_PER_JOB = 1u << 16u;
+
+  static constexpr float MAX_DEPTH = static_cast<float>(256 * 256 * 256 - 1);
+
+  static constexpr float LOG_DEPTH_SCALE = 5.70378f;
+
+  static constexpr float LOG_DEPTH_MIN = 0.005f;
+
+  static constexpr uint32_t ALPHA_MASK = 0xff000000u;
+
+  using KernelFn = void (*)(const Color *, Color *, size_t);
+
+  // ===========================================================================
+  // -- Scalar kernels ---------------------------------------------------------
+  // ===========================================================================
+
+  // Same operations as ColorConverter and boost::gil's float to 8-bit channel
+  // conversion.
+
+  static inline float DecodeDepth(const Color &color) {
+    const float depth = color.r + (color.g * 256) + (color.b * 256 * 256);
+    return depth / MAX_DEPTH;
+  }
+
+  static inline float LogarithmicLinear(const float value) {
+    const float log_value = 1.0f + std::log(value) / LOG_DEPTH_SCALE;
+    return std::max(std::min(log_value, 1.0f), LOG_DEPTH_MIN);
+  }
+
+  static inline Color Gray(const float value) {
+    const auto level = static_cast<uint8_t>(value * 255.0f + 0.5f);
+    return {level, level, level, 255u};
+  }
+
+  static void DepthScalar(const Color *src, Color *dst, const size_t count) {
+    for (size_t i = 0u; i < count; ++i) {
+      dst[i] = Gray(DecodeDepth(src[i]));
+    }
+  }
+
+  static void LogarithmicDepthScalar(const Color *src, Color *dst, const size_t count) {
+    for (size_t i = 0u; i < count; ++i) {
+      dst[i] = Gray(LogarithmicLinear(DecodeDepth(src[i])));
+    }
+  }
+
+  // ===========================================================================
+  // -- SSE2 kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_SSE2)
+
+  static inline __m128 DecodeDepthSSE2(const __m128i pixels) {
+    const __m128i byte = _mm_set1_epi32(0xff);
+    const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), byte);
+    const __m128i g = _mm_and_si128(pixels, _mm_set1_epi32(0xff00));
+    const __m128i b = _mm_slli_epi32(_mm_and_si128(pixels, byte), 16);
+    const __m128i depth = _mm_or_si128(_mm_or_si128(r, g), b);
+    return _mm_div_ps(_mm_cvtepi32_ps(depth), _mm_set1_ps(MAX_DEPTH));
+  }
+
+  static inline __m128 LogarithmicLinearSSE2(const __m128 value) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 log_value = _mm_add_ps(one, _mm_div_ps(simd::LogSSE2(value), _mm_set1_ps(LOG_DEPTH_SCALE)));
+    return _mm_max_ps(_mm_min_ps(log_value, one), _mm_set1_ps(LOG_DEPTH_MIN));
+  }
+
+  static inline __m128i GraySSE2(const __m128 value) {
+    const __m128 scaled = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    const __m128i level = _mm_cvttps_epi32(scaled);
+    const __m128i rgb = _mm_or_si128(
+        _mm_or_si128(level, _mm_slli_epi32(level, 8)),
+        _mm_slli_epi32(level, 16));
+    return _mm_or_si128(rgb, _mm_set1_epi32(static_cast<int>(ALPHA_MASK)));
+  }
+
+  static void DepthSSE2(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), GraySSE2(DecodeDepthSSE2(pixels)));
+    }
+    DepthScalar(src + i, dst + i, count - i);
+  }
+
+  static void LogarithmicDepthSSE2(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      const __m128 value = LogarithmicLinearSSE2(DecodeDepthSSE2(pixels));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), GraySSE2(value));
+    }
+    LogarithmicDepthScalar(src + i, dst + i, count - i);
+  }
+
+#endif // LIBCARLA_SIMD_SSE2
+
+  // ===========================================================================
+  // -- AVX2 kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_AVX2)
+
+  // Compiled for AVX2 regardless of the compiler flags, and only called if
+  // the CPU supports it.
+
+  LIBCARLA_TARGET_AVX2
+  static inline __m256 DecodeDepthAVX2(const __m256i pixels) {
+    const __m256i byte = _mm256_set1_epi32(0xff);
+    const __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), byte);
+    const __m256i g = _mm256_and_si256(pixels, _mm256_set1_epi32(0xff00));
+    const __m256i b = _mm256_slli_epi32(_mm256_and_si256(pixels, byte), 16);
+    const __m256i depth = _mm256_or_si256(_mm256_or_si256(r, g), b);
+    return _mm256_div_ps(_mm256_cvtepi32_ps(depth), _mm256_set1_ps(MAX_DEPTH));
+  }
+
+  LIBCARLA_TARGET_AVX2
+  static inline __m256 LogarithmicLinearAVX2(const __m256 value) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 log_value = _mm256_add_ps(one, _mm256_div_ps(simd::LogAVX2(value), _mm256_set1_ps(LOG_DEPTH_SCALE)));
+    return _mm256_max_ps(_mm256_min_ps(log_value, one), _mm256_set1_ps(LOG_DEPTH_MIN));
+  }
+
+  LIBCARLA_TARGET_AVX2
+  static inline __m256i GrayAVX2(const __m256 value) {
+    const __m256 scaled = _mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f));
+    const __m256i level = _mm256_cvttps_epi32(scaled);
+    const __m256i rgb = _mm256_or_si256(
+        _mm256_or_si256(level, _mm256_slli_epi32(level, 8)),
+        _mm256_slli_epi32(level, 16));
+    return _mm256_or_si256(rgb, _mm256_set1_epi32(static_cast<int>(ALPHA_MASK)));
+  }
+
+  LIBCARLA_TARGET_AVX2
+  static void DepthAVX2(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 8u <= count; i += 8u) {
+      const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), GrayAVX2(DecodeDepthAVX2(pixels)));
+    }
+    DepthScalar(src + i, dst + i, count - i);
+  }
+
+  LIBCARLA_TARGET_AVX2
+  static void LogarithmicDepthAVX2(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 8u <= count; i += 8u) {
+      const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+      const __m256 value = LogarithmicLinearAVX2(DecodeDepthAVX2(pixels));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), GrayAVX2(value));
+    }
+    LogarithmicDepthScalar(src + i, dst + i, count - i);
+  }
+
+#endif // LIBCARLA_SIMD_AVX2
+
+  // ===========================================================================
+  // -- NEON kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_NEON)
+
+  // Colors are packed, so pixels are loaded and stored as bytes.
+
+  static inline uint32x4_t LoadNEON(const Color *src) {
+    return vreinterpretq_u32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(src)));
+  }
+
+  static inline void StoreNEON(Color *dst, const uint32x4_t pixels) {
+    vst1q_u8(reinterpret_cast<uint8_t *>(dst), vreinterpretq_u8_u32(pixels));
+  }
+
+  static inline float32x4_t DecodeDepthNEON(const uint32x4_t pixels) {
+    const uint32x4_t byte = vdupq_n_u32(0xffu);
+    const uint32x4_t r = vandq_u32(vshrq_n_u32(pixels, 16), byte);
+    const uint32x4_t g = vandq_u32(pixels, vdupq_n_u32(0xff00u));
+    const uint32x4_t b = vshlq_n_u32(vandq_u32(pixels, byte), 16);
+    const uint32x4_t depth = vorrq_u32(vorrq_u32(r, g), b);
+    return vdivq_f32(vcvtq_f32_u32(depth), vdupq_n_f32(MAX_DEPTH));
+  }
+
+  static inline float32x4_t LogarithmicLinearNEON(const float32x4_t value) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t log_value = vaddq_f32(one, vdivq_f32(simd::LogNEON(value), vdupq_n_f32(LOG_DEPTH_SCALE)));
+    return vmaxq_f32(vminq_f32(log_value, one), vdupq_n_f32(LOG_DEPTH_MIN));
+  }
+
+  static inline uint32x4_t GrayNEON(const float32x4_t value) {
+    const float32x4_t scaled = vaddq_f32(vmulq_f32(value, vdupq_n_f32(255.0f)), vdupq_n_f32(0.5f));
+    const uint32x4_t level = vcvtq_u32_f32(scaled);
+    const uint32x4_t rgb = vorrq_u32(
+        vorrq_u32(level, vshlq_n_u32(level, 8)),
+        vshlq_n_u32(level, 16));
+    return vorrq_u32(rgb, vdupq_n_u32(ALPHA_MASK));
+  }
+
+  static void DepthNEON(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      StoreNEON(dst + i, GrayNEON(DecodeDepthNEON(LoadNEON(src + i))));
+    }
+    DepthScalar(src + i, dst + i, count - i);
+  }
+
+  static void LogarithmicDepthNEON(const Color *src, Color *dst, const size_t count) {
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+      const float32x4_t value = LogarithmicLinearNEON(DecodeDepthNEON(LoadNEON(src + i)));
+      StoreNEON(dst + i, GrayNEON(value));
+    }
+    LogarithmicDepthScalar(src + i, dst + i, count - i);
+  }
+
+#endif // LIBCARLA_SIMD_NEON
+
+  // ===========================================================================
+  // -- Dispatch ---------------------------------------------------------------
+  // ===========================================================================
+
+  struct Kernels {
+    const char *name;
+
+    KernelFn depth;
+
+    KernelFn logarithmic_depth;
+  };
+
+  static Kernels SelectKernels() {
+#if defined(LIBCARLA_SIMD_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return {"avx2", DepthAVX2, LogarithmicDepthAVX2};
+    }
+#endif
+#if defined(LIBCARLA_SIMD_SSE2)
+    return {"sse2", DepthSSE2, LogarithmicDepthSSE2};
+#elif defined(LIBCARLA_SIMD_NEON)
+    return {"neon", DepthNEON, LogarithmicDepthNEON};
+#else
+    return {"scalar", DepthScalar, LogarithmicDepthScalar};
+#endif
+  }
+
+  static const Kernels &GetKernels() {
+    static const Kernels kernels = SelectKernels();
+    return kernels;
+  }
+
+  /// Color of each possible tag.
+  static const std::array<Color, 256u> &GetPaletteTable() {
+    static const auto table = []() {
+      std::array<Color, 256u> result;
+      for (size_t tag = 0u; tag < result.size(); ++tag) {
+        const auto color = CityScapesPalette::GetColor(static_cast<uint8_t>(tag));
+        result[tag] = Color{color[0u], color[1u], color[2u], 255u};
+      }
+      return result;
+    }();
+    return table;
+  }
+
+  /// Runs @a kernel over the pixels, in chunks shared between the threads of
+  /// the JobSystem.
+  template <typename KernelT>
+  static void RunKernel(const Color *src, Color *dst, const size_t count, KernelT &&kernel) {
+    ParallelFor(count, PIXELS_PER_JOB, [&](size_t, const size_t begin, const size_t end) {
+      kernel(src + begin, dst + begin, end - begin);
+    });
+  }
+
+  // ===========================================================================
+  // -- ImageKernels -----------------------------------------------------------
+  // ===========================================================================
+
+  void ImageKernels::Convert(
+      const Color *src,
+      Color *dst,
+      const size_t count,
+      ColorConverter::Depth) {
+    RunKernel(src, dst, count, GetKernels().depth);
+  }
+
+  void ImageKernels::Convert(
+      const Color *src,
+      Color *dst,
+      const size_t count,
+      ColorConverter::LogarithmicDepth) {
+    RunKernel(src, dst, count, GetKernels().logarithmic_depth);
+  }
+
+  void ImageKernels::Convert(
+      const Color *src,
+      Color *dst,
+      const size_t count,
+      ColorConverter::CityScapesPalette) {
+    const auto &table = GetPaletteTable();
+    RunKernel(src, dst, count, [&table](const Color *in, Color *out, const size_t n) {
+      // The tag is in the red channel.
+      for (size_t i = 0u; i < n; ++i) {
+        out[i] = table[in[i].r];
+      }
+    });
+  }
+
+  const char *ImageKernels::GetInstructionSet() {
+    return GetKernels().name;
+  }
+
+} // namespace image
+} // namespace carla
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/image/ColorConverter.h"
+#include "carla/sensor/data/Color.h"
+#include "carla/sensor/data/ImageTmpl.h"
+
+#include <cstddef>
+
+namespace carla {
+namespace image {
+
+  /// Bulk color conversions working directly on the memory of BGRA images.
+  ///
+  /// They produce the same pixels as ImageConverter::ConvertInPlace with the
+  /// matching ColorConverter, which stays as the reference implementation,
+  /// but process several pixels per instruction (AVX2 or SSE2 on x86,
+  /// selected at run time, NEON on AArch64) and split the image between the
+  /// threads of the shared JobSystem. The logarithm of LogarithmicDepth uses
+  /// a polynomial approximation accurate to a couple of float ulps, so a
+  /// pixel may very rarely round to the next 8-bit level.
+  class ImageKernels {
+  public:
+
+    using Image = sensor::data::ImageTmpl<sensor::data::Color>;
+
+    static void ConvertInPlace(Image &image, ColorConverter::Depth converter) {
+      Convert(image.data(), image.data(), image.size(), converter);
+    }
+
+    static void ConvertInPlace(Image &image, ColorConverter::LogarithmicDepth converter) {
+      Convert(image.data(), image.data(), image.size(), converter);
+    }
+
+    static void ConvertInPlace(Image &image, ColorConverter::CityScapesPalette converter) {
+      Convert(image.data(), image.data(), image.size(), converter);
+    }
+
+    /// Converts @a count pixels of @a src into @a dst, which may be the same
+    /// buffer.
+    static void Convert(
+        const sensor::data::Color *src,
+        sensor::data::Color *dst,
+        size_t count,
+        ColorConverter::Depth);
+
+    static void Convert(
+        const sensor::data::Color *src,
+        sensor::data::Color *dst,
+        size_t count,
+        ColorConverter::LogarithmicDepth);
+
+    static void Convert(
+        const sensor::data::Color *src,
+        sensor::data::Color *dst,
+        size_t count,
+        ColorConverter::CityScapesPalette);
+
+    /// Name of the instruction set the kernels run with: "avx2", "sse2",
+    /// "neon" or "scalar".
+    static const char *GetInstructionSet();
+  };
+
+} // namespace image
+} // namespace carla
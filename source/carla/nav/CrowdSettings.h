@@ -0,0 +1,26 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+namespace carla {
+namespace nav {
+
+  /// Settings of the crowds that move the walkers.
+  struct CrowdSettings {
+    /// Maximum number of agents (walkers and the vehicles they avoid) of
+    /// each crowd.
+    int max_agents_per_crowd = 500;
+
+    /// Side in meters of the square regions the navigation mesh is split
+    /// into. Each region has its own crowd, all of them updated in parallel,
+    /// and walkers move from one crowd to another when they cross a border.
+    /// Zero uses a single crowd for the whole map.
+    float region_size = 0.0f;
+  };
+
+} // namespace nav
+} // namespace carla
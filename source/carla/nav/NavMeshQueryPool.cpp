@@ -0,0 +1,67 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/nav/NavMeshQueryPool.h"
+
+#include "carla/Debug.h"
+#include "carla/Logging.h"
+
+namespace carla {
+namespace nav {
+
+  NavMeshQueryPool::~NavMeshQueryPool() {
+    Reset(nullptr, 0);
+  }
+
+  void NavMeshQueryPool::Reset(const dtNavMesh *nav_mesh, const int max_nodes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    DEBUG_ASSERT(_leased == 0u);
+    for (auto query : _free) {
+      dtFreeNavMeshQuery(query);
+    }
+    _free.clear();
+    _nav_mesh = nav_mesh;
+    _max_nodes = max_nodes;
+  }
+
+  NavMeshQueryPool::Lease NavMeshQueryPool::Acquire() {
+    dtNavMeshQuery *query = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_nav_mesh == nullptr) {
+        return Lease(*this, nullptr);
+      }
+      if (!_free.empty()) {
+        query = _free.back();
+        _free.pop_back();
+        ++_leased;
+        return Lease(*this, query);
+      }
+      ++_leased;
+    }
+
+    // create a new one out of the lock, the mesh does not change while any
+    // query is leased
+    query = dtAllocNavMeshQuery();
+    if (query == nullptr || dtStatusFailed(query->init(_nav_mesh, _max_nodes))) {
+      logging::log("Nav: failed to create a navigation mesh query");
+      dtFreeNavMeshQuery(query);
+      std::lock_guard<std::mutex> lock(_mutex);
+      --_leased;
+      return Lease(*this, nullptr);
+    }
+    return Lease(*this, query);
+  }
+
+  void NavMeshQueryPool::Release(dtNavMeshQuery *query) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    DEBUG_ASSERT(_leased > 0u);
+    --_leased;
+    _free.push_back(query);
+  }
+
+} // namespace nav
+} // namespace carla
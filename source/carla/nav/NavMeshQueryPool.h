@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/NonCopyable.h"
+
+#include <recast/DetourNavMesh.h>
+#include <recast/DetourNavMeshQuery.h>
+
+#include <mutex>
+#include <vector>
+
+namespace carla {
+namespace nav {
+
+  /// Pool of navigation mesh queries, so threads can search paths at the
+  /// same time without sharing a query (Detour queries keep their search
+  /// state inside). A new query is created whenever all of them are taken,
+  /// so there are as many as threads searching at once.
+  class NavMeshQueryPool : private NonCopyable {
+  public:
+
+    /// A query taken from the pool, given back to it on destruction.
+    class Lease {
+    public:
+
+      Lease(NavMeshQueryPool &pool, dtNavMeshQuery *query)
+        : _pool(&pool),
+          _query(query) {}
+
+      Lease(const Lease &) = delete;
+      Lease &operator=(const Lease &) = delete;
+
+      Lease(Lease &&rhs)
+        : _pool(rhs._pool),
+          _query(rhs._query) {
+        rhs._query = nullptr;
+      }
+
+      Lease &operator=(Lease &&) = delete;
+
+      ~Lease() {
+        if (_query != nullptr) {
+          _pool->Release(_query);
+        }
+      }
+
+      explicit operator bool() const {
+        return _query != nullptr;
+      }
+
+      dtNavMeshQuery *operator->() const {
+        return _query;
+      }
+
+      dtNavMeshQuery *get() const {
+        return _query;
+      }
+
+    private:
+
+      NavMeshQueryPool *_pool;
+
+      dtNavMeshQuery *_query;
+    };
+
+    NavMeshQueryPool() = default;
+
+    ~NavMeshQueryPool();
+
+    /// Frees all the queries, the next ones will search in @a nav_mesh with
+    /// up to @a max_nodes nodes. No query can be in use.
+    void Reset(const dtNavMesh *nav_mesh, int max_nodes);
+
+    /// Takes a query from the pool, the lease evaluates to false if there is
+    /// no navigation mesh or the query could not be created.
+    Lease Acquire();
+
+  private:
+
+    void Release(dtNavMeshQuery *query);
+
+    std::mutex _mutex;
+
+    const dtNavMesh *_nav_mesh = nullptr;
+
+    int _max_nodes = 0;
+
+    size_t _leased = 0u;
+
+    std::vector<dtNavMeshQuery *> _free;
+  };
+
+} // namespace nav
+} // namespace carla
@@ -9,13 +9,16 @@
 #include <cmath>
 
 #include "carla/Logging.h"
+#include "carla/ParallelFor.h"
 #include "carla/nav/Navigation.h"
 #include "carla/nav/WalkerManager.h"
 #include "carla/geom/Math.h"
 
-#include <iterator>
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <mutex>
+#include <shared_mutex>
 
 namespace carla {
 namespace nav {
@@ -31,7 +34,6 @@ namespace nav {
   // these settings are the same than in RecastBuilder, so if you change the height of the agent, 
   // you should do the same in RecastBuilder
   static const int   MAX_POLYS = 256;
-  static const int   MAX_AGENTS = 500;
   static const int   MAX_QUERY_SEARCH_NODES = 2048;
   static const float AGENT_HEIGHT = 1.8f;
   static const float AGENT_RADIUS = 0.3f;
@@ -40,6 +42,24 @@ namespace nav {
   static const float AGENT_UNBLOCK_DISTANCE_SQUARED = AGENT_UNBLOCK_DISTANCE * AGENT_UNBLOCK_DISTANCE;
   static const float AGENT_UNBLOCK_TIME = 4.0f;
 
+  // distance a walker can go past the border of its region before moving to
+  // the crowd of the next one, so walkers on a border do not jump back and
+  // forth
+  static const float REGION_MIGRATION_MARGIN = 1.0f;
+  // vehicles are added to the crowds of all the regions closer than this
+  // (plus the vehicle size), so walkers see them before entering a region
+  static const float REGION_VEHICLE_MARGIN = 15.0f;
+
+  // tiles closer than this to a walker are always loaded when streaming
+  static const float TILE_WALKER_RADIUS = 10.0f;
+
+  // what to do with each tile when streaming
+  enum TileWanted : unsigned char {
+    TILE_UNWANTED = 0,
+    TILE_KEEP,
+    TILE_LOAD
+  };
+
   static const float AREA_GRASS_COST =  1.0f;
   static const float AREA_ROAD_COST  = 10.0f;
 
@@ -61,9 +81,16 @@ namespace nav {
     _mapped_by_index.clear();
     _walkers_blocked_position.clear();
     _yaw_walkers.clear();
+    _walker_states.store(nullptr);
+    _walker_states_back.reset();
     _binary_mesh.clear();
-    dtFreeCrowd(_crowd);
-    dtFreeNavMeshQuery(_nav_query);
+    _tiles.clear();
+    _tiles_by_cell.clear();
+    for (auto crowd : _crowds) {
+      dtFreeCrowd(crowd);
+    }
+    _crowds.clear();
+    _query_pool.Reset(nullptr, 0);
     dtFreeNavMesh(_nav_mesh);
   }
 
@@ -79,25 +106,59 @@ namespace nav {
     srand(seed);
   }
 
-  // load navigation data
+  // load navigation data from a file, the tiles are read from it when they
+  // are added to the mesh
   bool Navigation::Load(const std::string &filename) {
-    std::ifstream f;
-    std::istream_iterator<uint8_t> start(f), end;
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      return false;
+    }
+    const size_t size = static_cast<size_t>(file.tellg());
 
-    // read the whole file
-    f.open(filename, std::ios::binary);
-    if (!f.is_open()) {
+    // read the index of the tiles
+    auto read = [&file](size_t offset, void *data, size_t count) {
+      file.seekg(static_cast<std::streamoff>(offset));
+      file.read(static_cast<char *>(data), static_cast<std::streamsize>(count));
+      return file.good();
+    };
+    if (!ReadMeshIndex(size, read)) {
       return false;
     }
-    std::vector<uint8_t> content(start, end);
-    f.close();
 
-    // parse the content
-    return Load(std::move(content));
+    // keep the file open as the source of the tiles
+    _binary_mesh.clear();
+    _binary_mesh.shrink_to_fit();
+    _mesh_file = std::move(file);
+
+    InitLoadedMesh();
+    return true;
   }
 
-  // load navigation data from memory
+  // load navigation data from memory, the content is kept as the source of
+  // the tiles
   bool Navigation::Load(std::vector<uint8_t> content) {
+    auto read = [&content](size_t offset, void *data, size_t count) {
+      if (offset > content.size() || count > content.size() - offset) {
+        return false;
+      }
+      memcpy(data, &content[offset], count);
+      return true;
+    };
+    if (!ReadMeshIndex(content.size(), read)) {
+      return false;
+    }
+
+    // copy
+    _mesh_file.close();
+    _binary_mesh = std::move(content);
+
+    InitLoadedMesh();
+    return true;
+  }
+
+  // read the header and the index of the tiles of a navigation binary, and
+  // create the empty mesh
+  bool Navigation::ReadMeshIndex(size_t size, const MeshReader &read) {
     const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T'; // 'MSET';
     const int NAVMESHSET_VERSION = 1;
 #pragma pack(push, 1)
@@ -114,15 +175,12 @@ namespace nav {
     };
 #pragma pack(pop)
 
-    // check size for header
-    if (content.size() < sizeof(header)) {
+    // read the file header
+    size_t pos = 0;
+    if (size < sizeof(header) || !read(pos, &header, sizeof(header))) {
       logging::log("Nav: failed loading binary");
       return false;
     }
-
-    // read the file header
-    unsigned long pos = 0;
-    memcpy(&header, &content[pos], sizeof(header));
     pos += sizeof(header);
 
     // check file magic and version
@@ -139,238 +197,435 @@ namespace nav {
     // set number of tiles and origin
     dtStatus status = mesh->init(&header.params);
     if (dtStatusFailed(status)) {
+      dtFreeNavMesh(mesh);
       return false;
     }
 
-    // read the tiles data
+    // read the index of the tiles, their data is added to the mesh when
+    // needed
+    std::vector<NavTile> tiles;
+    tiles.reserve(static_cast<size_t>(std::max(header.num_tiles, 0)));
     for (int i = 0; i < header.num_tiles; ++i) {
       NavMeshTileHeader tile_header;
 
       // read the tile header
-      memcpy(&tile_header, &content[pos], sizeof(tile_header));
-      pos += sizeof(tile_header);
-      if (pos >= content.size()) {
+      if (pos + sizeof(tile_header) >= size || !read(pos, &tile_header, sizeof(tile_header))) {
         dtFreeNavMesh(mesh);
         return false;
       }
+      pos += sizeof(tile_header);
 
       // check for valid tile
       if (!tile_header.tile_ref || !tile_header.data_size) {
         break;
       }
-
-      // allocate the buffer
-      char *data = static_cast<char *>(dtAlloc(static_cast<size_t>(tile_header.data_size), DT_ALLOC_PERM));
-      if (!data) {
-        break;
-      }
-
-      // read the tile
-      memcpy(data, &content[pos], static_cast<size_t>(tile_header.data_size));
-      pos += static_cast<unsigned long>(tile_header.data_size);
-      if (pos > content.size()) {
-        dtFree(data);
+      dtMeshHeader mesh_header;
+      if (static_cast<size_t>(tile_header.data_size) < sizeof(dtMeshHeader) ||
+          pos + static_cast<size_t>(tile_header.data_size) > size ||
+          !read(pos, &mesh_header, sizeof(mesh_header))) {
         dtFreeNavMesh(mesh);
         return false;
       }
 
-      // add the tile data
-      mesh->addTile(reinterpret_cast<unsigned char *>(data), tile_header.data_size, DT_TILE_FREE_DATA,
-      tile_header.tile_ref, 0);
+      // keep the position and bounds of the tile
+      NavTile tile;
+      tile.ref = tile_header.tile_ref;
+      tile.offset = pos;
+      tile.size = tile_header.data_size;
+      tile.x = mesh_header.x;
+      tile.y = mesh_header.y;
+      tile.bmin[0] = mesh_header.bmin[0];
+      tile.bmin[1] = mesh_header.bmin[2];
+      tile.bmax[0] = mesh_header.bmax[0];
+      tile.bmax[1] = mesh_header.bmax[2];
+      tiles.emplace_back(tile);
+      pos += static_cast<size_t>(tile_header.data_size);
     }
 
     // exchange
     dtFreeNavMesh(_nav_mesh);
     _nav_mesh = mesh;
+    _nav_params = header.params;
+    _tiles = std::move(tiles);
+    _tiles_by_cell.clear();
+    for (size_t i = 0; i < _tiles.size(); ++i) {
+      _tiles_by_cell[GetTileCellKey(_tiles[i].x, _tiles[i].y)].emplace_back(i);
+    }
+    _loaded_tiles = 0u;
 
-    // prepare the query object
-    dtFreeNavMeshQuery(_nav_query);
-    _nav_query = dtAllocNavMeshQuery();
-    _nav_query->init(_nav_mesh, MAX_QUERY_SEARCH_NODES);
+    // prepare the query objects
+    _query_pool.Reset(_nav_mesh, MAX_QUERY_SEARCH_NODES);
+    _path_cache.Clear();
 
-    // copy
-    _binary_mesh = std::move(content);
+    return true;
+  }
+
+  // add the tiles and create the crowds once the mesh index is read
+  void Navigation::InitLoadedMesh(void) {
+    // add the whole map, or only the tiles around the interest points when
+    // streaming
+    {
+      // critical section, force single thread running this
+      std::lock_guard<std::mutex> lock(_mutex);
+      UpdateTiles();
+    }
     _ready = true;
 
     // create and init the crowd manager
     CreateCrowd();
+  }
 
-    return true;
+  // copy the data of a tile from the source of the mesh
+  bool Navigation::ReadTileData(const NavTile &tile, unsigned char *data) {
+    const size_t size = static_cast<size_t>(tile.size);
+    if (!_binary_mesh.empty()) {
+      memcpy(data, &_binary_mesh[tile.offset], size);
+      return true;
+    }
+    _mesh_file.clear();
+    _mesh_file.seekg(static_cast<std::streamoff>(tile.offset));
+    _mesh_file.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(size));
+    return _mesh_file.good();
   }
 
-  void Navigation::CreateCrowd(void) {
+  void Navigation::SetTileStreaming(const TileStreamingSettings &settings) {
+    DEBUG_ASSERT(settings.radius >= 0.0f);
+    DEBUG_ASSERT(settings.unload_margin >= 0.0f);
 
-    // check if all is ready
-    if (!_ready) {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tile_streaming = settings;
+    UpdateTiles();
+  }
+
+  void Navigation::SetInterestPoints(std::vector<carla::geom::Location> points) {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+    _interest_points = std::move(points);
+    UpdateTiles();
+  }
+
+  bool Navigation::IsStreamingTiles() const {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _tile_streaming.radius > 0.0f;
+  }
+
+  size_t Navigation::GetLoadedTileCount() const {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _loaded_tiles;
+  }
+
+  uint64_t Navigation::GetTileCellKey(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32u) | static_cast<uint32_t>(y);
+  }
+
+  // add and remove tiles of the mesh, so only the ones around the interest
+  // points and the walkers are loaded (all of them if not streaming)
+  void Navigation::UpdateTiles(void) {
+    if (_nav_mesh == nullptr || _tiles.empty()) {
       return;
     }
 
-    DEBUG_ASSERT(_crowd == nullptr);
+    const bool streaming = _tile_streaming.radius > 0.0f;
+    std::vector<unsigned char> wanted(_tiles.size(), streaming ? TILE_UNWANTED : TILE_LOAD);
+
+    if (streaming) {
+      // mark the tiles closer than radius to load, and the ones closer than
+      // radius + margin to keep if already loaded (Recast coords)
+      const float margin = _tile_streaming.unload_margin;
+      auto mark = [&](const float x, const float z, const float radius) {
+        const float reach = radius + margin;
+        const int x0 = static_cast<int>(std::floor((x - reach - _nav_params.orig[0]) / _nav_params.tileWidth));
+        const int x1 = static_cast<int>(std::floor((x + reach - _nav_params.orig[0]) / _nav_params.tileWidth));
+        const int y0 = static_cast<int>(std::floor((z - reach - _nav_params.orig[2]) / _nav_params.tileHeight));
+        const int y1 = static_cast<int>(std::floor((z + reach - _nav_params.orig[2]) / _nav_params.tileHeight));
+        for (int ty = y0; ty <= y1; ++ty) {
+          for (int tx = x0; tx <= x1; ++tx) {
+            auto it = _tiles_by_cell.find(GetTileCellKey(tx, ty));
+            if (it == _tiles_by_cell.end()) {
+              continue;
+            }
+            for (auto index : it->second) {
+              const NavTile &tile = _tiles[index];
+              const float dx = std::max({tile.bmin[0] - x, 0.0f, x - tile.bmax[0]});
+              const float dz = std::max({tile.bmin[1] - z, 0.0f, z - tile.bmax[1]});
+              const float distance = std::sqrt(dx * dx + dz * dz);
+              if (distance <= radius) {
+                wanted[index] = TILE_LOAD;
+              } else if (distance <= reach && wanted[index] == TILE_UNWANTED) {
+                wanted[index] = TILE_KEEP;
+              }
+            }
+          }
+        }
+      };
+      for (const auto &point : _tile_streaming.interest_points) {
+        mark(point.x, point.y, _tile_streaming.radius);
+      }
+      for (const auto &point : _interest_points) {
+        mark(point.x, point.y, _tile_streaming.radius);
+      }
+      // the walkers need the mesh under and around them
+      for (const auto &it : _mapped_walkers_id) {
+        const dtCrowdAgent *agent = GetEditableAgent(it.second);
+        if (agent != nullptr && agent->active) {
+          mark(agent->npos[0], agent->npos[2], TILE_WALKER_RADIUS);
+        }
+      }
+    }
 
-    // create and init
-    _crowd = dtAllocCrowd();
-    // these radius should be the maximum size of the vehicles (CarlaCola for Carla)
-    const float max_agent_radius = AGENT_RADIUS * 20;
-    if (!_crowd->init(MAX_AGENTS, max_agent_radius, _nav_mesh)) {
-      logging::log("Nav: failed to create crowd");
+    // find the changes
+    std::vector<size_t> to_unload;
+    std::vector<size_t> to_load;
+    for (size_t i = 0; i < _tiles.size(); ++i) {
+      if (_tiles[i].loaded && wanted[i] == TILE_UNWANTED) {
+        to_unload.emplace_back(i);
+      } else if (!_tiles[i].loaded && wanted[i] == TILE_LOAD) {
+        to_load.emplace_back(i);
+      }
+    }
+    if (to_unload.empty() && to_load.empty()) {
       return;
     }
 
-    // set different filters
-    // filter 0 can not walk on roads
-    _crowd->getEditableFilter(0)->setIncludeFlags(CARLA_TYPE_WALKABLE);
-    _crowd->getEditableFilter(0)->setExcludeFlags(CARLA_TYPE_ROAD);
-    _crowd->getEditableFilter(0)->setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
-    _crowd->getEditableFilter(0)->setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
-    // filter 1 can walk on roads
-    _crowd->getEditableFilter(1)->setIncludeFlags(CARLA_TYPE_WALKABLE);
-    _crowd->getEditableFilter(1)->setExcludeFlags(CARLA_TYPE_NONE);
-    _crowd->getEditableFilter(1)->setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
-    _crowd->getEditableFilter(1)->setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
-
-    // Setup local avoidance params to different qualities.
-    dtObstacleAvoidanceParams params;
-    // Use mostly default settings, copy from dtCrowd.
-    memcpy(&params, _crowd->getObstacleAvoidanceParams(0), sizeof(dtObstacleAvoidanceParams));
-
-    // Low (11)
-    params.velBias = 0.5f;
-    params.adaptiveDivs = 5;
-    params.adaptiveRings = 2;
-    params.adaptiveDepth = 1;
-    _crowd->setObstacleAvoidanceParams(0, &params);
-
-    // Medium (22)
-    params.velBias = 0.5f;
-    params.adaptiveDivs = 5;
-    params.adaptiveRings = 2;
-    params.adaptiveDepth = 2;
-    _crowd->setObstacleAvoidanceParams(1, &params);
-
-    // Good (45)
-    params.velBias = 0.5f;
-    params.adaptiveDivs = 7;
-    params.adaptiveRings = 2;
-    params.adaptiveDepth = 3;
-    _crowd->setObstacleAvoidanceParams(2, &params);
-
-    // High (66)
-    params.velBias = 0.5f;
-    params.adaptiveDivs = 7;
-    params.adaptiveRings = 3;
-    params.adaptiveDepth = 3;
-
-    _crowd->setObstacleAvoidanceParams(3, &params);
-  }
+    // no path query can run while the mesh changes
+    std::unique_lock<std::shared_timed_mutex> lock(_tiles_mutex);
+    for (auto index : to_unload) {
+      NavTile &tile = _tiles[index];
+      // the mesh frees the data of the tile (DT_TILE_FREE_DATA)
+      if (dtStatusFailed(_nav_mesh->removeTile(tile.ref, nullptr, nullptr))) {
+        continue;
+      }
+      tile.loaded = false;
+      --_loaded_tiles;
+    }
+    for (auto index : to_load) {
+      NavTile &tile = _tiles[index];
+      // allocate the buffer
+      unsigned char *data = static_cast<unsigned char *>(dtAlloc(static_cast<size_t>(tile.size), DT_ALLOC_PERM));
+      if (!data) {
+        break;
+      }
+      if (!ReadTileData(tile, data)) {
+        logging::log("Nav: failed reading tile data");
+        dtFree(data);
+        continue;
+      }
+      // add the tile data with its original reference, so the polygons keep
+      // their ids
+      if (dtStatusFailed(_nav_mesh->addTile(data, tile.size, DT_TILE_FREE_DATA, tile.ref, 0))) {
+        dtFree(data);
+        continue;
+      }
+      tile.loaded = true;
+      ++_loaded_tiles;
+    }
 
-  // return the path points to go from one position to another
-  bool Navigation::GetPath(carla::geom::Location from,
-                           carla::geom::Location to,
-                           dtQueryFilter * filter,
-                           std::vector<carla::geom::Location> &path,
-                           std::vector<unsigned char> &area) {
-    // path found
-    float straight_path[MAX_POLYS * 3];
-    unsigned char straight_path_flags[MAX_POLYS];
-    dtPolyRef straight_path_polys[MAX_POLYS];
-    int num_straight_path;
-    int straight_path_options = DT_STRAIGHTPATH_AREA_CROSSINGS;
+    // the cached paths may cross removed tiles
+    _path_cache.Clear();
+  }
 
-    // polys in path
-    dtPolyRef polys[MAX_POLYS];
-    int num_polys;
+  bool Navigation::SetCrowdSettings(const CrowdSettings &settings) {
+    DEBUG_ASSERT(settings.max_agents_per_crowd > 0);
+    DEBUG_ASSERT(settings.region_size >= 0.0f);
 
-    // check if all is ready
-    if (!_ready) {
+    // the agents would be lost
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_mapped_walkers_id.empty() || !_mapped_vehicles_id.empty()) {
       return false;
     }
 
-    DEBUG_ASSERT(_nav_query != nullptr);
+    _crowd_settings = settings;
 
-    // point extension
-    float poly_pick_ext[3];
-    poly_pick_ext[0] = 2;
-    poly_pick_ext[1] = 4;
-    poly_pick_ext[2] = 2;
+    // create the crowds again with the new settings
+    for (auto crowd : _crowds) {
+      dtFreeCrowd(crowd);
+    }
+    _crowds.clear();
+    _walkers_blocked_position.clear();
+    CreateCrowd();
 
-    // filter
-    dtQueryFilter filter2;
-    if (filter == nullptr) {
-      filter2.setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
-      filter2.setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
-      filter2.setIncludeFlags(CARLA_TYPE_WALKABLE);
-      filter2.setExcludeFlags(CARLA_TYPE_NONE);
-      filter = &filter2;
+    return true;
+  }
+
+  void Navigation::CreateCrowd(void) {
+
+    // check if all is ready
+    if (!_ready) {
+      return;
     }
 
-    // set the points
-    dtPolyRef start_ref = 0;
-    dtPolyRef end_ref = 0;
-    float start_pos[3] = { from.x, from.z, from.y };
-    float end_pos[3] = { to.x, to.z, to.y };
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->findNearestPoly(start_pos, poly_pick_ext, filter, &start_ref, 0);
-      _nav_query->findNearestPoly(end_pos, poly_pick_ext, filter, &end_ref, 0);
+    DEBUG_ASSERT(_crowds.empty());
+
+    // split the bounds of the navigation mesh in regions
+    _regions_x = 1;
+    _regions_z = 1;
+    if (_crowd_settings.region_size > 0.0f) {
+      float bmin[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+      float bmax[2] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+      // use all the tiles, also the ones not loaded
+      for (const auto &tile : _tiles) {
+        bmin[0] = std::min(bmin[0], tile.bmin[0]);
+        bmin[1] = std::min(bmin[1], tile.bmin[1]);
+        bmax[0] = std::max(bmax[0], tile.bmax[0]);
+        bmax[1] = std::max(bmax[1], tile.bmax[1]);
+      }
+      if (bmin[0] <= bmax[0] && bmin[1] <= bmax[1]) {
+        _regions_origin[0] = bmin[0];
+        _regions_origin[1] = bmin[1];
+        _regions_x = std::max(1, static_cast<int>(std::ceil((bmax[0] - bmin[0]) / _crowd_settings.region_size)));
+        _regions_z = std::max(1, static_cast<int>(std::ceil((bmax[1] - bmin[1]) / _crowd_settings.region_size)));
+      }
     }
-    if (!start_ref || !end_ref) {
-      return false;
+    const size_t total_regions = static_cast<size_t>(_regions_x * _regions_z);
+    RELEASE_ASSERT(total_regions * static_cast<size_t>(_crowd_settings.max_agents_per_crowd) <=
+        static_cast<size_t>(std::numeric_limits<int>::max()));
+
+    // create and init
+    for (size_t i = 0; i < total_regions; ++i) {
+      dtCrowd *crowd = dtAllocCrowd();
+      // these radius should be the maximum size of the vehicles (CarlaCola for Carla)
+      const float max_agent_radius = AGENT_RADIUS * 20;
+      if (!crowd || !crowd->init(_crowd_settings.max_agents_per_crowd, max_agent_radius, _nav_mesh)) {
+        logging::log("Nav: failed to create crowd");
+        dtFreeCrowd(crowd);
+        for (auto created : _crowds) {
+          dtFreeCrowd(created);
+        }
+        _crowds.clear();
+        return;
+      }
+
+      // set different filters
+      // filter 0 can not walk on roads
+      crowd->getEditableFilter(0)->setIncludeFlags(CARLA_TYPE_WALKABLE);
+      crowd->getEditableFilter(0)->setExcludeFlags(CARLA_TYPE_ROAD);
+      crowd->getEditableFilter(0)->setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
+      crowd->getEditableFilter(0)->setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
+      // filter 1 can walk on roads
+      crowd->getEditableFilter(1)->setIncludeFlags(CARLA_TYPE_WALKABLE);
+      crowd->getEditableFilter(1)->setExcludeFlags(CARLA_TYPE_NONE);
+      crowd->getEditableFilter(1)->setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
+      crowd->getEditableFilter(1)->setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
+
+      // Setup local avoidance params to different qualities.
+      dtObstacleAvoidanceParams params;
+      // Use mostly default settings, copy from dtCrowd.
+      memcpy(&params, crowd->getObstacleAvoidanceParams(0), sizeof(dtObstacleAvoidanceParams));
+
+      // Low (11)
+      params.velBias = 0.5f;
+      params.adaptiveDivs = 5;
+      params.adaptiveRings = 2;
+      params.adaptiveDepth = 1;
+      crowd->setObstacleAvoidanceParams(0, &params);
+
+      // Medium (22)
+      params.velBias = 0.5f;
+      params.adaptiveDivs = 5;
+      params.adaptiveRings = 2;
+      params.adaptiveDepth = 2;
+      crowd->setObstacleAvoidanceParams(1, &params);
+
+      // Good (45)
+      params.velBias = 0.5f;
+      params.adaptiveDivs = 7;
+      params.adaptiveRings = 2;
+      params.adaptiveDepth = 3;
+      crowd->setObstacleAvoidanceParams(2, &params);
+
+      // High (66)
+      params.velBias = 0.5f;
+      params.adaptiveDivs = 7;
+      params.adaptiveRings = 3;
+      params.adaptiveDepth = 3;
+      crowd->setObstacleAvoidanceParams(3, &params);
+
+      _crowds.push_back(crowd);
     }
+  }
 
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      // get the path of nodes
-      _nav_query->findPath(start_ref, end_ref, start_pos, end_pos, filter, polys, &num_polys, MAX_POLYS);
+  size_t Navigation::GetRegion(const float *position) const {
+    if (_crowds.size() <= 1u) {
+      return 0u;
     }
+    const float size = _crowd_settings.region_size;
+    const int x = static_cast<int>(std::floor((position[0] - _regions_origin[0]) / size));
+    const int z = static_cast<int>(std::floor((position[2] - _regions_origin[1]) / size));
+    return static_cast<size_t>(
+        std::min(std::max(z, 0), _regions_z - 1) * _regions_x +
+        std::min(std::max(x, 0), _regions_x - 1));
+  }
 
-    // get the path of points
-    num_straight_path = 0;
-    if (num_polys == 0) {
-      return false;
+  bool Navigation::IsInRegion(size_t region, const float *position, float margin) const {
+    if (_crowds.size() <= 1u) {
+      return true;
     }
+    // regions on the border of the grid extend to infinity
+    const float size = _crowd_settings.region_size;
+    const int x = static_cast<int>(region) % _regions_x;
+    const int z = static_cast<int>(region) / _regions_x;
+    const float min_x = _regions_origin[0] + static_cast<float>(x) * size - margin;
+    const float min_z = _regions_origin[1] + static_cast<float>(z) * size - margin;
+    return (x == 0 || position[0] >= min_x) &&
+           (x == _regions_x - 1 || position[0] < min_x + size + 2.0f * margin) &&
+           (z == 0 || position[2] >= min_z) &&
+           (z == _regions_z - 1 || position[2] < min_z + size + 2.0f * margin);
+  }
 
-    // in case of partial path, make sure the end point is clamped to the last
-    // polygon
-    float end_pos2[3];
-    dtVcopy(end_pos2, end_pos);
-    if (polys[num_polys - 1] != end_ref) {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->closestPointOnPoly(polys[num_polys - 1], end_pos, end_pos2, 0);
+  // set the flags and costs of one of the walker filters
+  static void InitQueryFilter(dtQueryFilter &filter, const unsigned char filter_type) {
+    filter.setIncludeFlags(CARLA_TYPE_WALKABLE);
+    // filter 0 can not walk on roads, filter 1 can
+    filter.setExcludeFlags(filter_type == 0 ? CARLA_TYPE_ROAD : CARLA_TYPE_NONE);
+    filter.setAreaCost(CARLA_AREA_ROAD, AREA_ROAD_COST);
+    filter.setAreaCost(CARLA_AREA_GRASS, AREA_GRASS_COST);
+  }
+
+  // return the path points to go from one position to another
+  bool Navigation::GetPath(carla::geom::Location from,
+                           carla::geom::Location to,
+                           dtQueryFilter * filter,
+                           std::vector<carla::geom::Location> &path,
+                           std::vector<unsigned char> &area) {
+    // the default filter can cross roads, and its paths can be cached
+    if (filter == nullptr) {
+      dtQueryFilter filter2;
+      InitQueryFilter(filter2, 1);
+      return FindPath(from, to, &filter2, 1, path, area);
     }
+    return FindPath(from, to, filter, -1, path, area);
+  }
 
-    // get the points
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->findStraightPath(start_pos, end_pos2, polys, num_polys,
-      straight_path, straight_path_flags,
-      straight_path_polys, &num_straight_path, MAX_POLYS, straight_path_options);
+  bool Navigation::GetAgentRoute(ActorId id, carla::geom::Location from, carla::geom::Location to,
+  std::vector<carla::geom::Location> &path, std::vector<unsigned char> &area) {
+
+    // check if all is ready
+    if (!_ready) {
+      return false;
     }
 
-    // copy the path to the output buffer
-    path.clear();
-    path.reserve(static_cast<unsigned long>(num_straight_path));
-    unsigned char area_type;
-    for (int i = 0, j = 0; j < num_straight_path; i += 3, ++j) {
-      // save coordinate for Unreal axis (x, z, y)
-      path.emplace_back(straight_path[i], straight_path[i + 2], straight_path[i + 1]);
-      // save area type
-      {
-        // critical section, force single thread running this
-        std::lock_guard<std::mutex> lock(_mutex);
-        _nav_mesh->getPolyArea(straight_path_polys[j], &area_type);
-      }
-      area.emplace_back(area_type);
+    // get current filter from agent
+    unsigned char filter_type;
+    if (!GetWalkerFilterType(id, filter_type)) {
+      return false;
     }
 
-    return true;
+    dtQueryFilter filter;
+    InitQueryFilter(filter, filter_type);
+    return FindPath(from, to, &filter, filter_type, path, area);
   }
 
-  bool Navigation::GetAgentRoute(ActorId id, carla::geom::Location from, carla::geom::Location to,
-  std::vector<carla::geom::Location> &path, std::vector<unsigned char> &area) {
+  // find a path with a query from the pool, so several threads can search
+  // at the same time
+  bool Navigation::FindPath(carla::geom::Location from,
+                            carla::geom::Location to,
+                            const dtQueryFilter *filter,
+                            int cache_filter_type,
+                            std::vector<carla::geom::Location> &path,
+                            std::vector<unsigned char> &area) {
     // path found
     float straight_path[MAX_POLYS * 3];
     unsigned char straight_path_flags[MAX_POLYS];
@@ -380,50 +635,43 @@ namespace nav {
 
     // polys in path
     dtPolyRef polys[MAX_POLYS];
-    int num_polys;
+    int num_polys = 0;
 
     // check if all is ready
     if (!_ready) {
       return false;
     }
 
-    DEBUG_ASSERT(_nav_query != nullptr);
+    auto query = _query_pool.Acquire();
+    if (!query) {
+      return false;
+    }
+
+    // the tiles can not change while searching
+    std::shared_lock<std::shared_timed_mutex> tiles_lock(_tiles_mutex);
 
     // point extension
     float poly_pick_ext[3] = {2,4,2};
 
-    // get current filter from agent
-    auto it = _mapped_walkers_id.find(id);
-    if (it == _mapped_walkers_id.end())
-      return false;
-
-    const dtQueryFilter *filter;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      filter = _crowd->getFilter(_crowd->getAgent(it->second)->params.queryFilterType);
-    }
-
     // set the points
     dtPolyRef start_ref = 0;
     dtPolyRef end_ref = 0;
     float start_pos[3] = { from.x, from.z, from.y };
     float end_pos[3] = { to.x, to.z, to.y };
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->findNearestPoly(start_pos, poly_pick_ext, filter, &start_ref, 0);
-      _nav_query->findNearestPoly(end_pos, poly_pick_ext, filter, &end_ref, 0);
-    }
+    query->findNearestPoly(start_pos, poly_pick_ext, filter, &start_ref, 0);
+    query->findNearestPoly(end_pos, poly_pick_ext, filter, &end_ref, 0);
     if (!start_ref || !end_ref) {
       return false;
     }
 
-    // get the path of nodes
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->findPath(start_ref, end_ref, start_pos, end_pos, filter, polys, &num_polys, MAX_POLYS);
+    // get the path of nodes, reusing a recent one between the same polygons
+    const bool cacheable = cache_filter_type >= 0;
+    const unsigned char cache_filter = static_cast<unsigned char>(cache_filter_type);
+    if (!cacheable || !_path_cache.Get(start_ref, end_ref, cache_filter, polys, &num_polys, MAX_POLYS)) {
+      query->findPath(start_ref, end_ref, start_pos, end_pos, filter, polys, &num_polys, MAX_POLYS);
+      if (cacheable && num_polys > 0) {
+        _path_cache.Put(start_ref, end_ref, cache_filter, polys, num_polys);
+      }
     }
 
     // get the path of points
@@ -436,19 +684,13 @@ namespace nav {
     float end_pos2[3];
     dtVcopy(end_pos2, end_pos);
     if (polys[num_polys - 1] != end_ref) {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->closestPointOnPoly(polys[num_polys - 1], end_pos, end_pos2, 0);
+      query->closestPointOnPoly(polys[num_polys - 1], end_pos, end_pos2, 0);
     }
 
     // get the points
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      _nav_query->findStraightPath(start_pos, end_pos2, polys, num_polys,
-      straight_path, straight_path_flags,
-      straight_path_polys, &num_straight_path, MAX_POLYS, straight_path_options);
-    }
+    query->findStraightPath(start_pos, end_pos2, polys, num_polys,
+    straight_path, straight_path_flags,
+    straight_path_polys, &num_straight_path, MAX_POLYS, straight_path_options);
 
     // copy the path to the output buffer
     path.clear();
@@ -458,17 +700,42 @@ namespace nav {
       // save coordinate for Unreal axis (x, z, y)
       path.emplace_back(straight_path[i], straight_path[i + 2], straight_path[i + 1]);
       // save area type
-      {
-        // critical section, force single thread running this
-        std::lock_guard<std::mutex> lock(_mutex);
-        _nav_mesh->getPolyArea(straight_path_polys[j], &area_type);
-      }
+      _nav_mesh->getPolyArea(straight_path_polys[j], &area_type);
       area.emplace_back(area_type);
     }
 
     return true;
   }
 
+  // find several paths at once, split between the threads of the job
+  // system; the calling thread takes part, so it can run inside a job
+  std::vector<PathResult> Navigation::GetPaths(const std::vector<PathRequest> &requests) {
+    std::vector<PathResult> results(requests.size());
+    ParallelFor(requests.size(), [&](size_t i) {
+      const PathRequest &request = requests[i];
+      PathResult &result = results[i];
+      dtQueryFilter filter;
+      InitQueryFilter(filter, request.filter_type);
+      result.found = FindPath(request.from, request.to, &filter,
+          request.filter_type, result.path, result.area);
+    });
+    return results;
+  }
+
+  bool Navigation::GetWalkerFilterType(ActorId id, unsigned char &filter_type) {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // get the internal index
+    auto it = _mapped_walkers_id.find(id);
+    if (it == _mapped_walkers_id.end()) {
+      return false;
+    }
+
+    filter_type = GetEditableAgent(it->second)->params.queryFilterType;
+    return true;
+  }
+
   // create a new walker in crowd
   bool Navigation::AddWalker(ActorId id, carla::geom::Location from) {
     dtCrowdAgentParams params;
@@ -478,7 +745,7 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
 
     // set parameters
     memset(&params, 0, sizeof(params));
@@ -506,23 +773,25 @@ namespace nav {
     // from Unreal coordinates (subtract half height to move pivot from center
     // (unreal) to bottom (recast))
     float point_from[3] = { from.x, from.z - (AGENT_HEIGHT / 2.0f), from.y };
-    // add walker
-    int index;
+    // add walker to the crowd of its region, and map it before the crowd
+    // update can migrate it
     {
       // critical section, force single thread running this
       std::lock_guard<std::mutex> lock(_mutex);
-      index = _crowd->addAgent(point_from, &params);
+      const size_t region = GetRegion(point_from);
+      int index = _crowds[region]->addAgent(point_from, &params);
       if (index == -1) {
         return false;
       }
-    }
+      index = MakeHandle(region, index);
 
-    // save the id
-    _mapped_walkers_id[id] = index;
-    _mapped_by_index[index] = id;
+      // save the id
+      _mapped_walkers_id[id] = index;
+      _mapped_by_index[index] = id;
 
-    // init yaw
-    _yaw_walkers[id] = 0.0f;
+      // init yaw
+      _yaw_walkers[id] = 0.0f;
+    }
 
     // add walker for the route planning
     _walker_manager.AddWalker(id);
@@ -540,7 +809,7 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
 
     // get the bounding box extension plus some space around
     float marge = 0.8f;
@@ -563,40 +832,51 @@ namespace nav {
     box_corner3 += vehicle.transform.location;
     box_corner4 += vehicle.transform.location;
 
-    // check if this actor exists
-    auto it = _mapped_vehicles_id.find(vehicle.id);
-    if (it != _mapped_vehicles_id.end()) {
-      // get the index found
-      int index = it->second;
-      if (index != -1) {
-        // get the agent
-        dtCrowdAgent *agent;
-        {
-          // critical section, force single thread running this
-          std::lock_guard<std::mutex> lock(_mutex);
-          agent = _crowd->getEditableAgent(index);
-        }
-        if (agent) {
-          // update its position
-          agent->npos[0] = vehicle.transform.location.x;
-          agent->npos[1] = vehicle.transform.location.z;
-          agent->npos[2] = vehicle.transform.location.y;
-          // update its oriented bounding box
-          agent->params.obb[0]  = box_corner1.x;
-          agent->params.obb[1]  = box_corner1.z;
-          agent->params.obb[2]  = box_corner1.y;
-          agent->params.obb[3]  = box_corner2.x;
-          agent->params.obb[4]  = box_corner2.z;
-          agent->params.obb[5]  = box_corner2.y;
-          agent->params.obb[6]  = box_corner3.x;
-          agent->params.obb[7]  = box_corner3.z;
-          agent->params.obb[8]  = box_corner3.y;
-          agent->params.obb[9]  = box_corner4.x;
-          agent->params.obb[10] = box_corner4.z;
-          agent->params.obb[11] = box_corner4.y;
-        }
-        return true;
+    // from Unreal coordinates (vertical is Z) to Recast coordinates (vertical is Y)
+    float point_from[3] = { vehicle.transform.location.x,
+                            vehicle.transform.location.z,
+                            vehicle.transform.location.y };
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the vehicle is needed in the crowds of all the regions around it
+    const float range = REGION_VEHICLE_MARGIN + std::max(hx, hy);
+    auto &handles = _mapped_vehicles_id[vehicle.id];
+
+    // update the agents already added, and remove the ones too far away
+    std::vector<bool> in_crowd(_crowds.size(), false);
+    for (auto handle = handles.begin(); handle != handles.end(); ) {
+      const size_t region = static_cast<size_t>(*handle / _crowd_settings.max_agents_per_crowd);
+      if (!IsInRegion(region, point_from, range)) {
+        GetCrowdOfHandle(*handle)->removeAgent(GetIndexOfHandle(*handle));
+        _mapped_by_index.erase(*handle);
+        handle = handles.erase(handle);
+        continue;
+      }
+      in_crowd[region] = true;
+      // get the agent
+      dtCrowdAgent *agent = GetEditableAgent(*handle);
+      if (agent) {
+        // update its position
+        agent->npos[0] = vehicle.transform.location.x;
+        agent->npos[1] = vehicle.transform.location.z;
+        agent->npos[2] = vehicle.transform.location.y;
+        // update its oriented bounding box
+        agent->params.obb[0]  = box_corner1.x;
+        agent->params.obb[1]  = box_corner1.z;
+        agent->params.obb[2]  = box_corner1.y;
+        agent->params.obb[3]  = box_corner2.x;
+        agent->params.obb[4]  = box_corner2.z;
+        agent->params.obb[5]  = box_corner2.y;
+        agent->params.obb[6]  = box_corner3.x;
+        agent->params.obb[7]  = box_corner3.z;
+        agent->params.obb[8]  = box_corner3.y;
+        agent->params.obb[9]  = box_corner4.x;
+        agent->params.obb[10] = box_corner4.z;
+        agent->params.obb[11] = box_corner4.y;
       }
+      ++handle;
     }
 
     // set parameters
@@ -629,34 +909,36 @@ namespace nav {
     params.obb[10] = box_corner4.z;
     params.obb[11] = box_corner4.y;
 
-    // from Unreal coordinates (vertical is Z) to Recast coordinates (vertical is Y)
-    float point_from[3] = { vehicle.transform.location.x,
-                            vehicle.transform.location.z,
-                            vehicle.transform.location.y };
-
-    // add walker
-    int index;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      index = _crowd->addAgent(point_from, &params);
+    // add the vehicle to the crowds it just got close to
+    bool added = true;
+    for (size_t region = 0; region < _crowds.size(); ++region) {
+      if (in_crowd[region] || !IsInRegion(region, point_from, range)) {
+        continue;
+      }
+      int index = _crowds[region]->addAgent(point_from, &params);
       if (index == -1) {
         logging::log("Vehicle agent not added to the crowd by some problem!");
-        return false;
+        added = false;
+        continue;
       }
 
       // mark as valid
-      dtCrowdAgent *agent = _crowd->getEditableAgent(index);
+      dtCrowdAgent *agent = _crowds[region]->getEditableAgent(index);
       if (agent) {
         agent->state = DT_CROWDAGENT_STATE_WALKING;
       }
+
+      // save the id
+      index = MakeHandle(region, index);
+      handles.push_back(index);
+      _mapped_by_index[index] = vehicle.id;
     }
 
-    // save the id
-    _mapped_vehicles_id[vehicle.id] = index;
-    _mapped_by_index[index] = vehicle.id;
+    if (handles.empty()) {
+      _mapped_vehicles_id.erase(vehicle.id);
+    }
 
-    return true;
+    return added;
   }
 
   // remove an agent
@@ -667,42 +949,43 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
 
-    // get the internal walker index
-    auto it = _mapped_walkers_id.find(id);
-    if (it != _mapped_walkers_id.end()) {
-      // remove from crowd
-      {
-        // critical section, force single thread running this
-        std::lock_guard<std::mutex> lock(_mutex);
-        _crowd->removeAgent(it->second);
-      }
-      _walker_manager.RemoveWalker(id);
-      // remove from mapping
-      _mapped_walkers_id.erase(it);
-      _mapped_by_index.erase(it->second);
+    {
+      // critical section, force single thread running this
+      std::lock_guard<std::mutex> lock(_mutex);
 
-      return true;
-    }
+      // get the internal walker index
+      auto it = _mapped_walkers_id.find(id);
+      if (it == _mapped_walkers_id.end()) {
+        // get the internal vehicle handles
+        auto vehicle = _mapped_vehicles_id.find(id);
+        if (vehicle == _mapped_vehicles_id.end()) {
+          return false;
+        }
+        // remove from all its crowds
+        for (int handle : vehicle->second) {
+          GetCrowdOfHandle(handle)->removeAgent(GetIndexOfHandle(handle));
+          _mapped_by_index.erase(handle);
+        }
+        // remove from mapping
+        _mapped_vehicles_id.erase(vehicle);
 
-    // get the internal vehicle index
-    it = _mapped_vehicles_id.find(id);
-    if (it != _mapped_vehicles_id.end()) {
-      // remove from crowd
-      {
-        // critical section, force single thread running this
-        std::lock_guard<std::mutex> lock(_mutex);
-        _crowd->removeAgent(it->second);
+        return true;
       }
+
+      // remove from crowd
+      GetCrowdOfHandle(it->second)->removeAgent(GetIndexOfHandle(it->second));
       // remove from mapping
-      _mapped_vehicles_id.erase(it);
       _mapped_by_index.erase(it->second);
-
-      return true;
+      _walkers_blocked_position.erase(it->second);
+      _yaw_walkers.erase(id);
+      _mapped_walkers_id.erase(it);
     }
 
-    return false;
+    _walker_manager.RemoveWalker(id);
+
+    return true;
   }
 
   // add/update/delete vehicles in crowd
@@ -710,8 +993,12 @@ namespace nav {
     std::unordered_set<carla::rpc::ActorId> updated;
 
     // add all current mapped vehicles in the set
-    for (auto &&entry : _mapped_vehicles_id) {
-      updated.insert(entry.first);
+    {
+      // critical section, force single thread running this
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto &&entry : _mapped_vehicles_id) {
+        updated.insert(entry.first);
+      }
     }
 
     // add all vehicles (if already exists, it gets updated only)
@@ -739,7 +1026,10 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -748,14 +1038,10 @@ namespace nav {
     }
 
     // get the agent
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      dtCrowdAgent *agent = _crowd->getEditableAgent(it->second);
-      if (agent) {
-        agent->params.maxSpeed = max_speed;
-        return true;
-      }
+    dtCrowdAgent *agent = GetEditableAgent(it->second);
+    if (agent) {
+      agent->params.maxSpeed = max_speed;
+      return true;
     }
 
     return false;
@@ -769,10 +1055,12 @@ namespace nav {
       return false;
     }
 
-    // get the internal index
-    auto it = _mapped_walkers_id.find(id);
-    if (it == _mapped_walkers_id.end()) {
-      return false;
+    {
+      // critical section, force single thread running this
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_mapped_walkers_id.find(id) == _mapped_walkers_id.end()) {
+        return false;
+      }
     }
 
     return _walker_manager.SetWalkerRoute(id, to);
@@ -786,13 +1074,23 @@ namespace nav {
       return false;
     }
 
+    DEBUG_ASSERT(!_crowds.empty());
+
+    auto query = _query_pool.Acquire();
+    if (!query) {
+      return false;
+    }
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
     if (it == _mapped_walkers_id.end()) {
       return false;
     }
 
-    return SetWalkerDirectTargetIndex(it->second, to);
+    return RequestMoveTarget(query.get(), it->second, to);
   }
 
   // set a new target point to go directly without events
@@ -803,49 +1101,67 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
-    DEBUG_ASSERT(_nav_query != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
 
     if (index == -1) {
       return false;
     }
 
+    auto query = _query_pool.Acquire();
+    if (!query) {
+      return false;
+    }
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+    return RequestMoveTarget(query.get(), index, to);
+  }
+
+  // set the target of an agent, with the mutex locked
+  bool Navigation::RequestMoveTarget(dtNavMeshQuery *query, int index, carla::geom::Location to) {
     // set target position
     float point_to[3] = { to.x, to.z, to.y };
     float nearest[3];
-    bool res;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      const dtQueryFilter *filter = _crowd->getFilter(0);
-      dtPolyRef target_ref;
-      _nav_query->findNearestPoly(point_to, _crowd->getQueryHalfExtents(), filter, &target_ref, nearest);
-      if (!target_ref) {
-        return false;
-      }
-
-      res = _crowd->requestMoveTarget(index, target_ref, point_to);
+    dtCrowd *crowd = GetCrowdOfHandle(index);
+    const dtQueryFilter *filter = crowd->getFilter(0);
+    dtPolyRef target_ref;
+    query->findNearestPoly(point_to, crowd->getQueryHalfExtents(), filter, &target_ref, nearest);
+    if (!target_ref) {
+      return false;
     }
 
-    return res;
+    return crowd->requestMoveTarget(GetIndexOfHandle(index), target_ref, point_to);
   }
 
   // update all walkers in crowd
   void Navigation::UpdateCrowd(const client::detail::EpisodeState &state) {
+    UpdateCrowd(state.GetTimestamp().delta_seconds);
+  }
+
+  void Navigation::UpdateCrowd(const double delta_seconds) {
 
     // check if all is ready
     if (!_ready) {
       return;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
 
-    // update crowd agents
-    _delta_seconds = state.GetTimestamp().delta_seconds;
+    // update crowd agents, each crowd in its own thread
+    _delta_seconds = delta_seconds;
     {
       // critical section, force single thread running this
       std::lock_guard<std::mutex> lock(_mutex);
-      _crowd->update(static_cast<float>(_delta_seconds), nullptr);
+      const float delta = static_cast<float>(_delta_seconds);
+      ParallelFor(_crowds.size(), [this, delta](size_t i) {
+        _crowds[i]->update(delta, nullptr);
+      });
+      // move the walkers that crossed to another region
+      MigrateAgents();
+      // turn them towards where they go
+      UpdateWalkerYaws();
+      // and publish their new state
+      ExportWalkerStates();
     }
 
     // update the walkers route
@@ -853,69 +1169,114 @@ namespace nav {
 
     // update the time to check for blocked agents
     _time_to_unblock += _delta_seconds;
+    if (_time_to_unblock < AGENT_UNBLOCK_TIME) {
+      return;
+    }
+    _time_to_unblock = 0.0f;
 
-    // check all active agents
-    int total_unblocked = 0;
-    int total_agents;
+    // check all active agents, in crowd and index order to keep the random
+    // sequence deterministic
+    std::vector<ActorId> blocked;
     {
       // critical section, force single thread running this
       std::lock_guard<std::mutex> lock(_mutex);
-      total_agents = _crowd->getAgentCount();
-    }
-    const dtCrowdAgent *ag;
-    for (int i = 0; i < total_agents; ++i) {
-      {
-        // critical section, force single thread running this
-        std::lock_guard<std::mutex> lock(_mutex);
-        ag = _crowd->getAgent(i);
-      }
-
-      if (!ag->active || ag->paused || ag->dead) {
-        continue;
-      }
-
-      // check only pedestrians not paused, and no vehicles
-      if (!ag->params.useObb && !ag->paused) {
-        bool reset_target_pos = false;
-        bool use_same_filter = false;
+      for (size_t crowd = 0; crowd < _crowds.size(); ++crowd) {
+        const int total_agents = _crowds[crowd]->getAgentCount();
+        for (int i = 0; i < total_agents; ++i) {
+          const dtCrowdAgent *ag = _crowds[crowd]->getAgent(i);
+
+          // check only pedestrians not paused, and no vehicles
+          if (!ag->active || ag->paused || ag->dead || ag->params.useObb) {
+            continue;
+          }
 
-        // check for unblocking actors
-        if (_time_to_unblock >= AGENT_UNBLOCK_TIME) {
           // get the distance moved by each actor
-          carla::geom::Vector3D previous = _walkers_blocked_position[i];
+          const int handle = MakeHandle(crowd, i);
+          carla::geom::Vector3D previous = _walkers_blocked_position[handle];
           carla::geom::Vector3D current = carla::geom::Vector3D(ag->npos[0], ag->npos[1], ag->npos[2]);
           carla::geom::Vector3D distance = current - previous;
           float d = distance.SquaredLength();
           if (d < AGENT_UNBLOCK_DISTANCE_SQUARED) {
-            ++total_unblocked;
-            reset_target_pos = true;
-            use_same_filter = true;
-          }
-          // update with current position
-          _walkers_blocked_position[i] = current;
-
-          // check to assign a new target position
-          if (reset_target_pos) {
-            // set if the agent can cross roads or not
-            if (!use_same_filter) {
-              if (frand() <= _probability_crossing) {
-                SetAgentFilter(i, 1);
-              } else {
-                SetAgentFilter(i, 0);
-              }
+            auto it = _mapped_by_index.find(handle);
+            if (it != _mapped_by_index.end()) {
+              blocked.push_back(it->second);
             }
-            // set a new random target
-            carla::geom::Location location;
-            GetRandomLocation(location, nullptr);
-            _walker_manager.SetWalkerRoute(_mapped_by_index[i], location);
           }
+          // update with current position
+          _walkers_blocked_position[handle] = current;
         }
       }
     }
 
-    // check for resetting time
-    if (_time_to_unblock >= AGENT_UNBLOCK_TIME) {
-      _time_to_unblock = 0.0f;
+    // assign a new random target to the blocked agents, searching all the
+    // paths at once
+    std::vector<std::pair<ActorId, carla::geom::Location>> routes;
+    routes.reserve(blocked.size());
+    for (ActorId id : blocked) {
+      carla::geom::Location location;
+      GetRandomLocation(location, nullptr);
+      routes.emplace_back(id, location);
+    }
+    _walker_manager.SetWalkerRoutes(routes);
+  }
+
+  // move the walkers that left their region to the crowd of the new one
+  void Navigation::MigrateAgents(void) {
+    if (_crowds.size() <= 1u) {
+      return;
+    }
+
+    for (size_t crowd = 0; crowd < _crowds.size(); ++crowd) {
+      dtCrowd *source = _crowds[crowd];
+      const int total_agents = source->getAgentCount();
+      for (int i = 0; i < total_agents; ++i) {
+        const dtCrowdAgent *ag = source->getAgent(i);
+
+        // only pedestrians, vehicles are placed by AddOrUpdateVehicle
+        if (!ag->active || ag->params.useObb ||
+            IsInRegion(crowd, ag->npos, REGION_MIGRATION_MARGIN)) {
+          continue;
+        }
+
+        // add it to the new crowd, where it continues to the same target
+        const size_t region = GetRegion(ag->npos);
+        dtCrowd *target = _crowds[region];
+        const int index = target->addAgent(ag->npos, &ag->params);
+        if (index == -1) {
+          // the crowd is full, try again in the next update
+          continue;
+        }
+        dtCrowdAgent *moved = target->getEditableAgent(index);
+        dtVcopy(moved->vel, ag->vel);
+        dtVcopy(moved->dvel, ag->dvel);
+        dtVcopy(moved->nvel, ag->nvel);
+        moved->paused = ag->paused;
+        moved->dead = ag->dead;
+        if (ag->targetRef != 0 &&
+            ag->targetState != DT_CROWDAGENT_TARGET_NONE &&
+            ag->targetState != DT_CROWDAGENT_TARGET_FAILED &&
+            ag->targetState != DT_CROWDAGENT_TARGET_VELOCITY) {
+          target->requestMoveTarget(index, ag->targetRef, ag->targetPos);
+        }
+        source->removeAgent(i);
+
+        // update the mapping
+        const int old_handle = MakeHandle(crowd, i);
+        const int new_handle = MakeHandle(region, index);
+        auto it = _mapped_by_index.find(old_handle);
+        if (it != _mapped_by_index.end()) {
+          const ActorId id = it->second;
+          _mapped_by_index.erase(it);
+          _mapped_by_index[new_handle] = id;
+          _mapped_walkers_id[id] = new_handle;
+        }
+        auto blocked = _walkers_blocked_position.find(old_handle);
+        if (blocked != _walkers_blocked_position.end()) {
+          const carla::geom::Vector3D position = blocked->second;
+          _walkers_blocked_position.erase(blocked);
+          _walkers_blocked_position[new_handle] = position;
+        }
+      }
     }
   }
 
@@ -927,7 +1288,10 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -942,23 +1306,36 @@ namespace nav {
     }
 
     // get the walker
-    const dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getAgent(index);
-    }
+    const dtCrowdAgent *agent = GetEditableAgent(index);
 
     if (!agent->active) {
       return false;
     }
 
-    // set its position in Unreal coordinates
-    trans.location.x = agent->npos[0];
-    trans.location.y = agent->npos[2];
-    trans.location.z = agent->npos[1];
+    ReadWalkerTransform(id, agent, trans);
 
-    // set its rotation
+    return true;
+  }
+
+  // turn the walkers smoothly towards their velocity, once per update
+  void Navigation::UpdateWalkerYaws(void) {
+    for (size_t crowd = 0; crowd < _crowds.size(); ++crowd) {
+      const int total_agents = _crowds[crowd]->getAgentCount();
+      for (int i = 0; i < total_agents; ++i) {
+        const dtCrowdAgent *agent = _crowds[crowd]->getAgent(i);
+        if (!agent->active || agent->params.useObb) {
+          continue;
+        }
+        auto it = _mapped_by_index.find(MakeHandle(crowd, i));
+        if (it == _mapped_by_index.end()) {
+          continue;
+        }
+        UpdateWalkerYaw(_yaw_walkers[it->second], agent);
+      }
+    }
+  }
+
+  void Navigation::UpdateWalkerYaw(float &current_yaw, const dtCrowdAgent *agent) const {
     float yaw;
     float speed = 0.0f;
     float min = 0.1f;
@@ -972,15 +1349,58 @@ namespace nav {
     }
 
     // interpolate current and target angle
-    float shortest_angle = fmod(yaw - _yaw_walkers[id] + 540.0f, 360.0f) - 180.0f;
+    float shortest_angle = fmod(yaw - current_yaw + 540.0f, 360.0f) - 180.0f;
     float per = (speed / 1.5f);
     if (per > 1.0f) per = 1.0f;
     float rotation_speed = per * 6.0f;
-    trans.rotation.yaw = _yaw_walkers[id] +
-    (shortest_angle * rotation_speed * static_cast<float>(_delta_seconds));
-    _yaw_walkers[id] = trans.rotation.yaw;
+    current_yaw += (shortest_angle * rotation_speed * static_cast<float>(_delta_seconds));
+  }
 
-    return true;
+  // get the transform of a walker agent, with the yaw of the last update
+  void Navigation::ReadWalkerTransform(ActorId id, const dtCrowdAgent *agent, carla::geom::Transform &trans) const {
+    // set its position in Unreal coordinates
+    trans.location.x = agent->npos[0];
+    trans.location.y = agent->npos[2];
+    trans.location.z = agent->npos[1];
+
+    // set its rotation
+    auto yaw = _yaw_walkers.find(id);
+    trans.rotation.yaw = (yaw != _yaw_walkers.end()) ? yaw->second : 0.0f;
+  }
+
+  // write the state of all the walkers to the list not being read
+  void Navigation::ExportWalkerStates(void) {
+    // reuse the list of two updates ago, unless someone still holds it
+    std::shared_ptr<WalkerCrowdStateList> states = std::move(_walker_states_back);
+    if (states == nullptr || states.use_count() > 1) {
+      states = std::make_shared<WalkerCrowdStateList>();
+    }
+    states->clear();
+    states->reserve(_mapped_walkers_id.size());
+
+    for (size_t crowd = 0; crowd < _crowds.size(); ++crowd) {
+      const int total_agents = _crowds[crowd]->getAgentCount();
+      for (int i = 0; i < total_agents; ++i) {
+        const dtCrowdAgent *agent = _crowds[crowd]->getAgent(i);
+        if (!agent->active || agent->params.useObb) {
+          continue;
+        }
+        auto it = _mapped_by_index.find(MakeHandle(crowd, i));
+        if (it == _mapped_by_index.end()) {
+          continue;
+        }
+        WalkerCrowdState state;
+        state.id = it->second;
+        ReadWalkerTransform(state.id, agent, state.transform);
+        state.speed = sqrtf(agent->vel[0] * agent->vel[0] + agent->vel[1] * agent->vel[1] + agent->vel[2] * agent->vel[2]);
+        state.alive = !agent->dead;
+        states->emplace_back(state);
+      }
+    }
+
+    // publish it, the previous one is written next time
+    _walker_states_back = _walker_states.load();
+    _walker_states.store(std::move(states));
   }
 
   // get the walker current location
@@ -991,7 +1411,10 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -1006,12 +1429,7 @@ namespace nav {
     }
 
     // get the walker
-    const dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getAgent(index);
-    }
+    const dtCrowdAgent *agent = GetEditableAgent(index);
 
     if (!agent->active) {
       return false;
@@ -1032,7 +1450,10 @@ namespace nav {
       return 0.0f;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -1047,12 +1468,7 @@ namespace nav {
     }
 
     // get the walker
-    const dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getAgent(index);
-    }
+    const dtCrowdAgent *agent = GetEditableAgent(index);
 
     return sqrt(agent->vel[0] * agent->vel[0] + agent->vel[1] * agent->vel[1] + agent->vel[2] *
     agent->vel[2]);
@@ -1066,7 +1482,10 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_nav_query != nullptr);
+    auto query = _query_pool.Acquire();
+    if (!query) {
+      return false;
+    }
 
     // filter
     dtQueryFilter filter2;
@@ -1082,10 +1501,11 @@ namespace nav {
     int rounds = 10;
     {
       dtStatus status;
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
+      // keep the sequence of random numbers, force single thread running this
+      std::lock_guard<std::mutex> lock(_random_mutex);
+      std::shared_lock<std::shared_timed_mutex> tiles_lock(_tiles_mutex);
       do {
-        status = _nav_query->findRandomPoint(filter, frand, &random_ref, point);
+        status = query->findRandomPoint(filter, frand, &random_ref, point);
         // set the location in Unreal coords
         if (status == DT_SUCCESS) {
           location.x = point[0];
@@ -1102,13 +1522,11 @@ namespace nav {
   // assign a filter index to an agent
   void Navigation::SetAgentFilter(int agent_index, int filter_index)
   {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+
     // get the walker
-    dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getEditableAgent(agent_index);
-    }
+    dtCrowdAgent *agent = GetEditableAgent(agent_index);
     agent->params.queryFilterType = static_cast<unsigned char>(filter_index);
   }
 
@@ -1128,7 +1546,10 @@ namespace nav {
       return;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -1143,55 +1564,54 @@ namespace nav {
     }
 
     // get the walker
-    dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getEditableAgent(index);
-    }
+    dtCrowdAgent *agent = GetEditableAgent(index);
 
     // mark
     agent->paused = pause;
   }
 
-  bool Navigation::HasVehicleNear(ActorId id, float distance, carla::geom::Location direction) {
-    // get the internal index (walker or vehicle)
+  bool Navigation::GetAgentHandle(ActorId id, int &handle) const {
     auto it = _mapped_walkers_id.find(id);
-    if (it == _mapped_walkers_id.end()) {
-      it = _mapped_vehicles_id.find(id);
-      if (it == _mapped_vehicles_id.end()) {
-        return false;
-      }
+    if (it != _mapped_walkers_id.end()) {
+      handle = it->second;
+      return true;
     }
+    // a vehicle can be in several crowds, any of them will do
+    auto vehicle = _mapped_vehicles_id.find(id);
+    if (vehicle != _mapped_vehicles_id.end() && !vehicle->second.empty()) {
+      handle = vehicle->second.front();
+      return true;
+    }
+    return false;
+  }
 
-    float dir[3] = { direction.x, direction.z, direction.y };
-    bool result;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      result = _crowd->hasVehicleNear(it->second, distance * distance, dir, false);
+  bool Navigation::HasVehicleNear(ActorId id, float distance, carla::geom::Location direction) {
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // get the internal handle (walker or vehicle)
+    int handle;
+    if (!GetAgentHandle(id, handle)) {
+      return false;
     }
-    return result;
+
+    float dir[3] = { direction.x, direction.z, direction.y };
+    return GetCrowdOfHandle(handle)->hasVehicleNear(GetIndexOfHandle(handle), distance * distance, dir, false);
   }
 
   /// make agent look at some location
   bool Navigation::SetWalkerLookAt(ActorId id, carla::geom::Location location) {
-    // get the internal index (walker or vehicle)
-    auto it = _mapped_walkers_id.find(id);
-    if (it == _mapped_walkers_id.end()) {
-      it = _mapped_vehicles_id.find(id);
-      if (it == _mapped_vehicles_id.end()) {
-        return false;
-      }
-    }
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
-    dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getEditableAgent(it->second);
+    // get the internal handle (walker or vehicle)
+    int handle;
+    if (!GetAgentHandle(id, handle)) {
+      return false;
     }
 
+    dtCrowdAgent *agent = GetEditableAgent(handle);
+
     // get the position
     float x = (location.x - agent->npos[0]) * 0.0001f;
     float y = (location.y - agent->npos[2]) * 0.0001f;
@@ -1217,7 +1637,10 @@ namespace nav {
       return false;
     }
 
-    DEBUG_ASSERT(_crowd != nullptr);
+    DEBUG_ASSERT(!_crowds.empty());
+
+    // critical section, force single thread running this
+    std::lock_guard<std::mutex> lock(_mutex);
 
     // get the internal index
     auto it = _mapped_walkers_id.find(id);
@@ -1232,12 +1655,7 @@ namespace nav {
     }
 
     // get the walker
-    const dtCrowdAgent *agent;
-    {
-      // critical section, force single thread running this
-      std::lock_guard<std::mutex> lock(_mutex);
-      agent = _crowd->getAgent(index);
-    }
+    const dtCrowdAgent *agent = GetEditableAgent(index);
 
     // mark
     alive = !agent->dead;
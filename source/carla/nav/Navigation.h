@@ -7,10 +7,15 @@
 #pragma once
 
 #include "carla/AtomicList.h"
+#include "carla/AtomicSharedPtr.h"
 #include "carla/client/detail/EpisodeState.h"
 #include "carla/geom/BoundingBox.h"
 #include "carla/geom/Location.h"
 #include "carla/geom/Transform.h"
+#include "carla/nav/CrowdSettings.h"
+#include "carla/nav/NavMeshQueryPool.h"
+#include "carla/nav/PathCache.h"
+#include "carla/nav/TileStreamingSettings.h"
 #include "carla/nav/WalkerManager.h"
 #include "carla/rpc/ActorId.h"
 #include <recast/Recast.h>
@@ -20,6 +25,11 @@
 #include <recast/DetourNavMeshQuery.h>
 #include <recast/DetourCommon.h>
 
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <shared_mutex>
+
 namespace carla {
 namespace nav {
 
@@ -50,6 +60,31 @@ namespace nav {
     carla::geom::BoundingBox bounding;
   };
 
+  /// state of a walker after the last crowd update
+  struct WalkerCrowdState {
+    ActorId id;
+    carla::geom::Transform transform;
+    float speed;
+    bool alive;
+  };
+
+  using WalkerCrowdStateList = std::vector<WalkerCrowdState>;
+
+  /// request of a path between two points, with the walker filter to use
+  /// (0 can not cross roads, 1 can)
+  struct PathRequest {
+    carla::geom::Location from;
+    carla::geom::Location to;
+    unsigned char filter_type { 1 };
+  };
+
+  /// points and area types of a path found
+  struct PathResult {
+    bool found { false };
+    std::vector<carla::geom::Location> path;
+    std::vector<unsigned char> area;
+  };
+
   /// Manage the pedestrians navigation, using the Recast & Detour library for low level calculations.
   ///
   /// This class gets the binary content of the map from the server, which is required for the path finding.
@@ -61,22 +96,42 @@ namespace nav {
     Navigation();
     ~Navigation();
 
-    /// load navigation data
+    /// load navigation data from a file, which stays open to read the tiles
+    /// when they are added, so only the tiles in use are in memory
     bool Load(const std::string &filename);
-    /// load navigation data from memory
+    /// load navigation data from memory, the content is kept to add the tiles
     bool Load(std::vector<uint8_t> content);
     /// return the path points to go from one position to another
     bool GetPath(carla::geom::Location from, carla::geom::Location to, dtQueryFilter * filter,
     std::vector<carla::geom::Location> &path, std::vector<unsigned char> &area);
     bool GetAgentRoute(ActorId id, carla::geom::Location from, carla::geom::Location to,
     std::vector<carla::geom::Location> &path, std::vector<unsigned char> &area);
+    /// find several paths at once split between the threads of the shared
+    /// JobSystem, one result for each request in the same order
+    std::vector<PathResult> GetPaths(const std::vector<PathRequest> &requests);
+    /// get the query filter of a walker (0 can not cross roads, 1 can)
+    bool GetWalkerFilterType(ActorId id, unsigned char &filter_type);
 
     /// reference to the simulator to access API functions
     void SetSimulator(std::weak_ptr<carla::client::detail::Simulator> simulator);
     /// set the seed to use with random numbers
     void SetSeed(unsigned int seed);
-    /// create the crowd object
+    /// set the size of the crowds and how the map is split between them, the
+    /// crowds are created again if there are no agents yet, otherwise it
+    /// returns false and the settings are not changed
+    bool SetCrowdSettings(const CrowdSettings &settings);
+    /// create the crowd objects
     void CreateCrowd(void);
+    /// set which tiles of the navigation mesh are kept loaded, the whole map
+    /// or only the ones around the interest points
+    void SetTileStreaming(const TileStreamingSettings &settings);
+    /// return whether the tiles are loaded on demand
+    bool IsStreamingTiles() const;
+    /// set the moving interest points (the hero vehicles), and load and
+    /// unload the tiles around them and around the walkers
+    void SetInterestPoints(std::vector<carla::geom::Location> points);
+    /// return the number of tiles of the mesh in memory
+    size_t GetLoadedTileCount() const;
     /// create a new walker
     bool AddWalker(ActorId id, carla::geom::Location from);
     /// create a new vehicle in crowd to be avoided by walkers
@@ -100,6 +155,13 @@ namespace nav {
     float GetWalkerSpeed(ActorId id);
     /// update all walkers in crowd
     void UpdateCrowd(const client::detail::EpisodeState &state);
+    /// update all walkers in crowd, @a delta_seconds after the last update
+    void UpdateCrowd(double delta_seconds);
+    /// get the state of all the active walkers after the last update, in a
+    /// single list that can be read without locking while the crowd keeps
+    /// updating (null before the first update). The transforms are the same
+    /// GetWalkerTransform returns until the next update.
+    std::shared_ptr<const WalkerCrowdStateList> GetWalkerStates() const { return _walker_states.load(); };
     /// get a random location for navigation
     bool GetRandomLocation(carla::geom::Location &location, dtQueryFilter * filter = nullptr) const;
     /// set the probability that an agent could cross the roads in its path following
@@ -113,28 +175,75 @@ namespace nav {
     /// return if the agent has been killed by a vehicle
     bool IsWalkerAlive(ActorId id, bool &alive);
 
-    dtCrowd *GetCrowd() { return _crowd; };
+    /// return the number of crowds the map is split into
+    size_t GetCrowdCount() const { return _crowds.size(); };
+
+    dtCrowd *GetCrowd(size_t index = 0u) { return index < _crowds.size() ? _crowds[index] : nullptr; };
 
     /// return the last delta seconds
     double GetDeltaSeconds() { return _delta_seconds; };
 
   private:
 
+    static constexpr size_t PATH_CACHE_SIZE = 256u;
+
     bool _ready { false };
+    /// source of the tile data, the file loaded or the binary content when
+    /// loaded from memory
+    std::ifstream _mesh_file;
     std::vector<uint8_t> _binary_mesh;
     double _delta_seconds { 0.0 };
     /// meshes
     dtNavMesh *_nav_mesh { nullptr };
-    dtNavMeshQuery *_nav_query { nullptr };
-    /// crowd
-    dtCrowd *_crowd { nullptr };
-    /// mapping Id
+    dtNavMeshParams _nav_params;
+    /// a tile of the mesh, its data is read from the source when added
+    struct NavTile {
+      dtTileRef ref { 0 };
+      size_t offset { 0u };
+      int size { 0 };
+      /// position in the grid of tiles
+      int x { 0 };
+      int y { 0 };
+      /// bounds in Recast coordinates (x and z)
+      float bmin[2] { 0.0f, 0.0f };
+      float bmax[2] { 0.0f, 0.0f };
+      bool loaded { false };
+    };
+    /// all the tiles of the map, loaded or not
+    std::vector<NavTile> _tiles;
+    /// tiles at each position of the grid
+    std::unordered_map<uint64_t, std::vector<size_t>> _tiles_by_cell;
+    size_t _loaded_tiles { 0u };
+    TileStreamingSettings _tile_streaming;
+    std::vector<carla::geom::Location> _interest_points;
+    /// path queries search without the crowd mutex, tiles are only added
+    /// or removed with this one locked exclusively
+    mutable std::shared_timed_mutex _tiles_mutex;
+    /// queries to search the meshes, one for each thread searching at once
+    mutable NavMeshQueryPool _query_pool;
+    /// recent paths between polygons
+    PathCache _path_cache { PATH_CACHE_SIZE };
+    /// crowds, one per region of the map
+    std::vector<dtCrowd *> _crowds;
+    CrowdSettings _crowd_settings;
+    /// regions grid, in Recast coordinates (x and z)
+    float _regions_origin[2] { 0.0f, 0.0f };
+    int _regions_x { 1 };
+    int _regions_z { 1 };
+    /// mapping Id to agent handle (crowd * max agents per crowd + index), the
+    /// crowd update migrates walkers between crowds, so these maps are only
+    /// accessed with the mutex locked
     std::unordered_map<ActorId, int> _mapped_walkers_id;
-    std::unordered_map<ActorId, int> _mapped_vehicles_id;
-    // mapping by index also
+    /// vehicles are added to all the crowds around them, one handle each
+    std::unordered_map<ActorId, std::vector<int>> _mapped_vehicles_id;
+    // mapping by handle also
     std::unordered_map<int, ActorId> _mapped_by_index;
     /// store walkers yaw angle from previous tick
     std::unordered_map<ActorId, float> _yaw_walkers;
+    /// state of the walkers after the last update, and the list to write in
+    /// the next one (double buffered)
+    AtomicSharedPtr<WalkerCrowdStateList> _walker_states;
+    std::shared_ptr<WalkerCrowdStateList> _walker_states_back;
     /// saves the position of each actor at intervals and check if any is blocked
     std::unordered_map<int, carla::geom::Vector3D> _walkers_blocked_position;
     double _time_to_unblock { 0.0 };
@@ -145,11 +254,63 @@ namespace nav {
     std::weak_ptr<carla::client::detail::Simulator> _simulator;
     
     mutable std::mutex _mutex;
+    mutable std::mutex _random_mutex;
 
     float _probability_crossing { 0.0f };
 
     /// assign a filter index to an agent
     void SetAgentFilter(int agent_index, int filter_index);
+    /// set the target of an agent to go directly, with the mutex locked
+    bool RequestMoveTarget(dtNavMeshQuery *query, int index, carla::geom::Location to);
+
+    /// return the crowd of the region containing a position (Recast coords)
+    size_t GetRegion(const float *position) const;
+    /// return whether a position (Recast coords) is inside a region, grown
+    /// by margin meters on each side
+    bool IsInRegion(size_t region, const float *position, float margin) const;
+    /// move the walkers that left their region to the crowd of the new one
+    void MigrateAgents(void);
+    /// get the handle of a walker, or of any agent of a vehicle, with the
+    /// mutex locked
+    bool GetAgentHandle(ActorId id, int &handle) const;
+    /// turn the walkers smoothly towards their velocity, once per update
+    void UpdateWalkerYaws(void);
+    void UpdateWalkerYaw(float &current_yaw, const dtCrowdAgent *agent) const;
+    /// get the transform of a walker agent with the yaw of the last update
+    void ReadWalkerTransform(ActorId id, const dtCrowdAgent *agent, carla::geom::Transform &trans) const;
+    /// write the state of all the walkers and publish it
+    void ExportWalkerStates(void);
+    /// find a path using a query of the pool, caching it by filter type
+    /// unless cache_filter_type is negative
+    bool FindPath(carla::geom::Location from, carla::geom::Location to, const dtQueryFilter *filter,
+    int cache_filter_type, std::vector<carla::geom::Location> &path, std::vector<unsigned char> &area);
+    /// add and remove tiles of the mesh around the interest points
+    void UpdateTiles(void);
+
+    /// reads @a count bytes at @a offset of the navigation binary into @a data
+    using MeshReader = std::function<bool(size_t offset, void *data, size_t count)>;
+
+    bool ReadMeshIndex(size_t size, const MeshReader &read);
+
+    void InitLoadedMesh(void);
+
+    bool ReadTileData(const NavTile &tile, unsigned char *data);
+    /// return the key of a position in the grid of tiles
+    static uint64_t GetTileCellKey(int x, int y);
+
+    /// agent handles from crowd and index within it, and back
+    int MakeHandle(size_t crowd, int index) const {
+      return static_cast<int>(crowd) * _crowd_settings.max_agents_per_crowd + index;
+    }
+    dtCrowd *GetCrowdOfHandle(int handle) const {
+      return _crowds[static_cast<size_t>(handle / _crowd_settings.max_agents_per_crowd)];
+    }
+    int GetIndexOfHandle(int handle) const {
+      return handle % _crowd_settings.max_agents_per_crowd;
+    }
+    dtCrowdAgent *GetEditableAgent(int handle) const {
+      return GetCrowdOfHandle(handle)->getEditableAgent(GetIndexOfHandle(handle));
+    }
   };
 
 } // namespace nav
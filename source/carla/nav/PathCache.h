@@ -0,0 +1,114 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/NonCopyable.h"
+
+#include <recast/DetourNavMesh.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace carla {
+namespace nav {
+
+  /// Thread-safe cache of the polygons crossed by the most recently found
+  /// paths, by start and end polygon and query filter. Walkers start and end
+  /// their routes in a few popular spots, so the same searches repeat often.
+  /// When full, the least recently used path is dropped.
+  class PathCache : private NonCopyable {
+  public:
+
+    explicit PathCache(size_t capacity)
+      : _capacity(capacity) {}
+
+    /// Copies to @a polys (up to @a max_polys) the path from @a start to
+    /// @a end, if it is in the cache.
+    bool Get(dtPolyRef start, dtPolyRef end, unsigned char filter,
+        dtPolyRef *polys, int *num_polys, int max_polys) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _index.find(Key{start, end, filter});
+      if (it == _index.end()) {
+        return false;
+      }
+      // mark as the most recently used
+      _entries.splice(_entries.begin(), _entries, it->second);
+      const auto &path = it->second->polys;
+      *num_polys = std::min(static_cast<int>(path.size()), max_polys);
+      std::copy_n(path.begin(), *num_polys, polys);
+      return true;
+    }
+
+    /// Adds the path from @a start to @a end to the cache.
+    void Put(dtPolyRef start, dtPolyRef end, unsigned char filter,
+        const dtPolyRef *polys, int num_polys) {
+      if (_capacity == 0u) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      const Key key{start, end, filter};
+      auto it = _index.find(key);
+      if (it != _index.end()) {
+        _entries.erase(it->second);
+        _index.erase(it);
+      } else if (_entries.size() >= _capacity) {
+        _index.erase(_entries.back().key);
+        _entries.pop_back();
+      }
+      _entries.push_front(Entry{key, std::vector<dtPolyRef>(polys, polys + num_polys)});
+      _index.emplace(key, _entries.begin());
+    }
+
+    void Clear() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _index.clear();
+      _entries.clear();
+    }
+
+  private:
+
+    struct Key {
+      dtPolyRef start;
+      dtPolyRef end;
+      unsigned char filter;
+
+      bool operator==(const Key &rhs) const {
+        return start == rhs.start && end == rhs.end && filter == rhs.filter;
+      }
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key &key) const {
+        const std::hash<dtPolyRef> hash;
+        size_t seed = hash(key.start);
+        seed ^= hash(key.end) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed ^ key.filter;
+      }
+    };
+
+    struct Entry {
+      Key key;
+      std::vector<dtPolyRef> polys;
+    };
+
+    const size_t _capacity;
+
+    std::mutex _mutex;
+
+    /// Most recently used first.
+    std::list<Entry> _entries;
+
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+  };
+
+} // namespace nav
+} // namespace carla
@@ -0,0 +1,32 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/Location.h"
+
+#include <vector>
+
+namespace carla {
+namespace nav {
+
+  /// Settings of the tiles of the navigation mesh kept in memory.
+  struct TileStreamingSettings {
+    /// Radius in meters around each interest point whose tiles are loaded.
+    /// Zero keeps the whole map loaded.
+    float radius = 0.0f;
+
+    /// Extra distance in meters a loaded tile has to be away from every
+    /// interest point before it is unloaded, so tiles at the border are not
+    /// loaded and unloaded each tick.
+    float unload_margin = 20.0f;
+
+    /// Fixed interest points. The hero vehicles are added to them each tick.
+    std::vector<geom::Location> interest_points;
+  };
+
+} // namespace nav
+} // namespace carla
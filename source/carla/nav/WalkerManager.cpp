@@ -60,6 +60,9 @@ namespace nav {
 	// update all routes
     bool WalkerManager::Update(double delta) {
 
+        // walkers that need a new route
+        std::vector<ActorId> blocked;
+
         // check all walkers
         for (auto &it : _walkers) {
 
@@ -95,8 +98,8 @@ namespace nav {
                             SetWalkerNextPoint(it.first);
                             break;
                         case EventResult::TimeOut:
-                            // unblock changing the route
-                            SetWalkerRoute(it.first);
+                            // unblock changing the route, below
+                            blocked.emplace_back(it.first);
                             break;
                     }
                     break;
@@ -107,6 +110,19 @@ namespace nav {
             }
         }
 
+        // set a new random target to the blocked walkers, searching all the
+        // paths at once
+        if (!blocked.empty()) {
+            std::vector<std::pair<ActorId, carla::geom::Location>> routes;
+            routes.reserve(blocked.size());
+            for (ActorId id : blocked) {
+                carla::geom::Location location;
+                _nav->GetRandomLocation(location, nullptr);
+                routes.emplace_back(id, location);
+            }
+            SetWalkerRoutes(routes);
+        }
+
         return true;
     }
 
@@ -131,25 +147,62 @@ namespace nav {
             return false;
 
         // search
-        auto it = _walkers.find(id);
-        if (it == _walkers.end())
+        if (_walkers.find(id) == _walkers.end())
             return false;
 
-        // get it
-        WalkerInfo &info = it->second;
-        std::vector<carla::geom::Location> path;
-        std::vector<unsigned char> area;
+        SetWalkerRoutes({ std::make_pair(id, to) });
+        return true;
+    }
 
-        // save both points for the route
-        _nav->GetWalkerPosition(id, info.from);
-        info.to = to;
-        info.currentIndex = 0;
-        info.state = WALKER_IDLE;
+    // set a new route to several walkers, searching all the paths at once
+    void WalkerManager::SetWalkerRoutes(const std::vector<std::pair<ActorId, carla::geom::Location>> &routes) {
+        // check
+        if (_nav == nullptr)
+            return;
+
+        // save both points for each route
+        std::vector<std::pair<ActorId, WalkerInfo *>> walkers;
+        std::vector<PathRequest> requests;
+        walkers.reserve(routes.size());
+        requests.reserve(routes.size());
+        for (auto &route : routes) {
+            // search
+            auto it = _walkers.find(route.first);
+            if (it == _walkers.end())
+                continue;
+
+            // get the filter of the agent
+            PathRequest request;
+            if (!_nav->GetWalkerFilterType(route.first, request.filter_type))
+                continue;
+
+            // get it
+            WalkerInfo &info = it->second;
+            _nav->GetWalkerPosition(route.first, info.from);
+            info.to = route.second;
+            info.currentIndex = 0;
+            info.state = WALKER_IDLE;
+            request.from = info.from;
+            request.to = info.to;
+            walkers.emplace_back(route.first, &info);
+            requests.emplace_back(request);
+        }
 
-        // get a route from navigation
-        _nav->GetAgentRoute(id, info.from, to, path, area);
+        // get the routes from navigation
+        std::vector<PathResult> results = _nav->GetPaths(requests);
 
-        // create each point of the route
+        // assign them in order
+        for (size_t i = 0; i < walkers.size(); ++i) {
+            AssignRoute(walkers[i].first, *walkers[i].second, results[i].path, results[i].area);
+        }
+    }
+
+    // create each point of the route
+    void WalkerManager::AssignRoute(
+            ActorId id,
+            WalkerInfo &info,
+            std::vector<carla::geom::Location> &path,
+            const std::vector<unsigned char> &area) {
         info.route.clear();
         info.route.reserve(path.size());
         unsigned char previous_area = CARLA_AREA_SIDEWALK;
@@ -177,7 +230,6 @@ namespace nav {
 
         // assign the first point to go (second in the list)
         SetWalkerNextPoint(id);
-        return true;
     }
 
     // set the next point in the route
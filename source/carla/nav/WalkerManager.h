@@ -15,6 +15,10 @@
 #include "carla/rpc/ActorId.h"
 #include "carla/rpc/TrafficLightState.h"
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace carla {
 namespace nav {
 
@@ -68,6 +72,10 @@ namespace nav {
     bool SetWalkerRoute(ActorId id);
     bool SetWalkerRoute(ActorId id, carla::geom::Location to);
 
+    /// set a new route to each walker from its current position, searching
+    /// all the paths at once
+    void SetWalkerRoutes(const std::vector<std::pair<ActorId, carla::geom::Location>> &routes);
+
     /// set the next point in the route
     bool SetWalkerNextPoint(ActorId id);
   
@@ -89,6 +97,10 @@ namespace nav {
 
     EventResult ExecuteEvent(ActorId id, WalkerInfo &info, double delta);
 
+    /// create the route points of a path found and go to the first one
+    void AssignRoute(ActorId id, WalkerInfo &info, std::vector<carla::geom::Location> &path,
+        const std::vector<unsigned char> &area);
+
     std::unordered_map<ActorId, WalkerInfo> _walkers;
     std::vector<std::pair<SharedPtr<carla::client::TrafficLight>, carla::geom::Location>> _traffic_lights;
     Navigation *_nav { nullptr };
@@ -0,0 +1,529 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/pointcloud/LidarKernels.h"
+
+#include "carla/Debug.h"
+#include "carla/JobSystem.h"
+#include "carla/ParallelFor.h"
+#include "carla/SimdMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace carla {
+namespace pointcloud {
+
+  /// Points handed to each job.
+  static constexpr size_t POINTS_PER_JOB = 1u << 15u;
+
+  /// Range image columns handed to each job.
+  static constexpr size_t COLUMNS_PER_JOB = 64u;
+
+  /// Number of hash partitions of the voxel grid when run in parallel.
+  static constexpr unsigned VOXEL_PARTITION_BITS = 6u;
+
+  /// Bits of each coordinate in a voxel key.
+  static constexpr unsigned VOXEL_COORDINATE_BITS = 21u;
+
+  static constexpr uint64_t VOXEL_COORDINATE_MASK = (uint64_t(1u) << VOXEL_COORDINATE_BITS) - 1u;
+
+  static constexpr int32_t VOXEL_COORDINATE_OFFSET = int32_t(1) << (VOXEL_COORDINATE_BITS - 1u);
+
+  using simd::PI;
+
+  static bool UseSingleThread(const size_t count) {
+    return (count <= POINTS_PER_JOB) || (JobSystem::Get().GetWorkerCount() == 0u);
+  }
+
+  // ===========================================================================
+  // -- Scalar kernels ---------------------------------------------------------
+  // ===========================================================================
+
+  static inline int32_t VoxelCoordinate(const float value, const float inverse_size) {
+    return static_cast<int32_t>(std::floor(value * inverse_size));
+  }
+
+  static inline uint64_t MakeVoxelKey(const int32_t x, const int32_t y, const int32_t z) {
+    const auto pack = [](int32_t value) {
+      return static_cast<uint64_t>(value + VOXEL_COORDINATE_OFFSET) & VOXEL_COORDINATE_MASK;
+    };
+    return
+        (pack(x) << (2u * VOXEL_COORDINATE_BITS)) |
+        (pack(y) << VOXEL_COORDINATE_BITS) |
+        pack(z);
+  }
+
+  static inline void VoxelKeysScalar(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      const float inverse_size,
+      uint64_t *keys) {
+    for (size_t i = begin; i < end; ++i) {
+      const float *p = points.GetXYZ(i);
+      keys[i] = MakeVoxelKey(
+          VoxelCoordinate(p[0u], inverse_size),
+          VoxelCoordinate(p[1u], inverse_size),
+          VoxelCoordinate(p[2u], inverse_size));
+    }
+  }
+
+  static inline void RangeAzimuthScalar(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      float *range,
+      float *azimuth) {
+    for (size_t i = begin; i < end; ++i) {
+      const float *p = points.GetXYZ(i);
+      range[i - begin] = std::sqrt(p[0u] * p[0u] + p[1u] * p[1u] + p[2u] * p[2u]);
+      azimuth[i - begin] = simd::Atan2(p[1u], p[0u]);
+    }
+  }
+
+  // ===========================================================================
+  // -- SSE2 kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_SSE2)
+
+  /// Loads points [i, i + 4) as x, y and z vectors. Reads the 16 bytes at
+  /// the start of each point, the stride must be at least that.
+  static inline void Load4(const LidarPointView &points, const size_t i, __m128 &x, __m128 &y, __m128 &z) {
+    __m128 p0 = _mm_loadu_ps(points.GetXYZ(i));
+    __m128 p1 = _mm_loadu_ps(points.GetXYZ(i + 1u));
+    __m128 p2 = _mm_loadu_ps(points.GetXYZ(i + 2u));
+    __m128 p3 = _mm_loadu_ps(points.GetXYZ(i + 3u));
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    x = p0;
+    y = p1;
+    z = p2;
+  }
+
+  static inline __m128i FloorSSE2(const __m128 value) {
+    const __m128i truncated = _mm_cvttps_epi32(value);
+    // Subtract one where the truncation rounded up (negative values).
+    const __m128 greater = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+    return _mm_add_epi32(truncated, _mm_castps_si128(greater));
+  }
+
+  static void VoxelKeysSIMD(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      const float inverse_size,
+      uint64_t *keys) {
+    const __m128 scale = _mm_set1_ps(inverse_size);
+    alignas(16) int32_t coordinates[3u][4u];
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      __m128 x, y, z;
+      Load4(points, i, x, y, z);
+      _mm_store_si128(reinterpret_cast<__m128i *>(coordinates[0u]), FloorSSE2(_mm_mul_ps(x, scale)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(coordinates[1u]), FloorSSE2(_mm_mul_ps(y, scale)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(coordinates[2u]), FloorSSE2(_mm_mul_ps(z, scale)));
+      for (size_t k = 0u; k < 4u; ++k) {
+        keys[i + k] = MakeVoxelKey(coordinates[0u][k], coordinates[1u][k], coordinates[2u][k]);
+      }
+    }
+    VoxelKeysScalar(points, i, end, inverse_size, keys);
+  }
+
+  static void RangeAzimuthSIMD(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      float *range,
+      float *azimuth) {
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      __m128 x, y, z;
+      Load4(points, i, x, y, z);
+      const __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+      _mm_storeu_ps(range + (i - begin), _mm_sqrt_ps(squared));
+      _mm_storeu_ps(azimuth + (i - begin), simd::Atan2SSE2(y, x));
+    }
+    RangeAzimuthScalar(points, i, end, range + (i - begin), azimuth + (i - begin));
+  }
+
+  // ===========================================================================
+  // -- NEON kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#elif defined(LIBCARLA_SIMD_NEON)
+
+  /// Loads points [i, i + 4) as x, y and z vectors. Reads the 16 bytes at
+  /// the start of each point, the stride must be at least that.
+  static inline void Load4(
+      const LidarPointView &points,
+      const size_t i,
+      float32x4_t &x,
+      float32x4_t &y,
+      float32x4_t &z) {
+    const float32x4x2_t p01 = vtrnq_f32(vld1q_f32(points.GetXYZ(i)), vld1q_f32(points.GetXYZ(i + 1u)));
+    const float32x4x2_t p23 = vtrnq_f32(vld1q_f32(points.GetXYZ(i + 2u)), vld1q_f32(points.GetXYZ(i + 3u)));
+    x = vcombine_f32(vget_low_f32(p01.val[0u]), vget_low_f32(p23.val[0u]));
+    y = vcombine_f32(vget_low_f32(p01.val[1u]), vget_low_f32(p23.val[1u]));
+    z = vcombine_f32(vget_high_f32(p01.val[0u]), vget_high_f32(p23.val[0u]));
+  }
+
+  static void VoxelKeysSIMD(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      const float inverse_size,
+      uint64_t *keys) {
+    const float32x4_t scale = vdupq_n_f32(inverse_size);
+    int32_t coordinates[3u][4u];
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      float32x4_t x, y, z;
+      Load4(points, i, x, y, z);
+      vst1q_s32(coordinates[0u], vcvtmq_s32_f32(vmulq_f32(x, scale)));
+      vst1q_s32(coordinates[1u], vcvtmq_s32_f32(vmulq_f32(y, scale)));
+      vst1q_s32(coordinates[2u], vcvtmq_s32_f32(vmulq_f32(z, scale)));
+      for (size_t k = 0u; k < 4u; ++k) {
+        keys[i + k] = MakeVoxelKey(coordinates[0u][k], coordinates[1u][k], coordinates[2u][k]);
+      }
+    }
+    VoxelKeysScalar(points, i, end, inverse_size, keys);
+  }
+
+  static void RangeAzimuthSIMD(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      float *range,
+      float *azimuth) {
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      float32x4_t x, y, z;
+      Load4(points, i, x, y, z);
+      const float32x4_t squared = vaddq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)), vmulq_f32(z, z));
+      vst1q_f32(range + (i - begin), vsqrtq_f32(squared));
+      vst1q_f32(azimuth + (i - begin), simd::Atan2NEON(y, x));
+    }
+    RangeAzimuthScalar(points, i, end, range + (i - begin), azimuth + (i - begin));
+  }
+
+#endif // LIBCARLA_SIMD_NEON
+
+  static void VoxelKeys(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      const float inverse_size,
+      uint64_t *keys) {
+#if defined(LIBCARLA_SIMD_SSE2) || defined(LIBCARLA_SIMD_NEON)
+    if (points.GetStride() >= 4u * sizeof(float)) {
+      VoxelKeysSIMD(points, begin, end, inverse_size, keys);
+      return;
+    }
+#endif
+    VoxelKeysScalar(points, begin, end, inverse_size, keys);
+  }
+
+  static void RangeAzimuth(
+      const LidarPointView &points,
+      const size_t begin,
+      const size_t end,
+      float *range,
+      float *azimuth) {
+#if defined(LIBCARLA_SIMD_SSE2) || defined(LIBCARLA_SIMD_NEON)
+    if (points.GetStride() >= 4u * sizeof(float)) {
+      RangeAzimuthSIMD(points, begin, end, range, azimuth);
+      return;
+    }
+#endif
+    RangeAzimuthScalar(points, begin, end, range, azimuth);
+  }
+
+  // ===========================================================================
+  // -- Voxel grid -------------------------------------------------------------
+  // ===========================================================================
+
+  namespace {
+
+    struct Voxel {
+      double x = 0.0;
+      double y = 0.0;
+      double z = 0.0;
+      uint32_t count = 0u;
+      uint32_t first = 0u;
+    };
+
+  } // namespace
+
+  static inline uint64_t HashVoxelKey(const uint64_t key) {
+    return key * 0x9e3779b97f4a7c15ull;
+  }
+
+  /// Accumulates the points @a indices(i), i in [0, count), all in the same
+  /// hash partition, into @a voxels in order of first appearance.
+  template <typename IndexFunctorT>
+  static void AccumulateVoxels(
+      const LidarPointView &points,
+      const uint64_t *keys,
+      const size_t count,
+      const unsigned partition_bits,
+      IndexFunctorT &&indices,
+      std::vector<Voxel> &voxels) {
+    unsigned table_bits = 4u;
+    while ((size_t(1u) << table_bits) < 2u * count) {
+      ++table_bits;
+    }
+    const size_t table_mask = (size_t(1u) << table_bits) - 1u;
+    constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+    std::vector<uint64_t> table_keys(table_mask + 1u);
+    std::vector<uint32_t> table_voxels(table_mask + 1u, EMPTY);
+    for (size_t i = 0u; i < count; ++i) {
+      const uint32_t index = indices(i);
+      const uint64_t key = keys[index];
+      // Use the hash bits right below the ones of the partition.
+      size_t slot = static_cast<size_t>(HashVoxelKey(key) >> (64u - partition_bits - table_bits)) & table_mask;
+      while ((table_voxels[slot] != EMPTY) && (table_keys[slot] != key)) {
+        slot = (slot + 1u) & table_mask;
+      }
+      if (table_voxels[slot] == EMPTY) {
+        table_keys[slot] = key;
+        table_voxels[slot] = static_cast<uint32_t>(voxels.size());
+        voxels.emplace_back();
+        voxels.back().first = index;
+      }
+      Voxel &voxel = voxels[table_voxels[slot]];
+      const float *p = points.GetXYZ(index);
+      voxel.x += p[0u];
+      voxel.y += p[1u];
+      voxel.z += p[2u];
+      ++voxel.count;
+    }
+  }
+
+  void LidarKernels::VoxelDownsample(
+      const LidarPointView &points,
+      const float voxel_size,
+      std::vector<geom::Location> &centroids,
+      std::vector<uint32_t> *first_indices) {
+    DEBUG_ASSERT(voxel_size > 0.0f);
+    DEBUG_ASSERT(points.size() <= std::numeric_limits<uint32_t>::max());
+    const size_t count = points.size();
+    const float inverse_size = 1.0f / voxel_size;
+    std::vector<uint64_t> keys(count);
+    std::vector<Voxel> voxels;
+
+    if (UseSingleThread(count)) {
+      VoxelKeys(points, 0u, count, inverse_size, keys.data());
+      AccumulateVoxels(points, keys.data(), count, 0u, [](size_t i) {
+        return static_cast<uint32_t>(i);
+      }, voxels);
+    } else {
+      // Compute the keys and count the points of each partition in each
+      // chunk.
+      constexpr size_t partitions = size_t(1u) << VOXEL_PARTITION_BITS;
+      const size_t chunks = (count + POINTS_PER_JOB - 1u) / POINTS_PER_JOB;
+      std::vector<uint32_t> positions(chunks * partitions, 0u);
+      ParallelFor(count, POINTS_PER_JOB, [&](size_t chunk, size_t begin, size_t end) {
+        VoxelKeys(points, begin, end, inverse_size, keys.data());
+        uint32_t *histogram = positions.data() + chunk * partitions;
+        for (size_t i = begin; i < end; ++i) {
+          ++histogram[HashVoxelKey(keys[i]) >> (64u - VOXEL_PARTITION_BITS)];
+        }
+      });
+
+      // Scatter the indices by partition, keeping their order.
+      std::vector<size_t> offsets(partitions + 1u);
+      size_t total = 0u;
+      for (size_t partition = 0u; partition < partitions; ++partition) {
+        offsets[partition] = total;
+        for (size_t chunk = 0u; chunk < chunks; ++chunk) {
+          const uint32_t points_in_partition = positions[chunk * partitions + partition];
+          positions[chunk * partitions + partition] = static_cast<uint32_t>(total);
+          total += points_in_partition;
+        }
+      }
+      offsets[partitions] = total;
+      std::vector<uint32_t> sorted(count);
+      ParallelFor(count, POINTS_PER_JOB, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t *position = positions.data() + chunk * partitions;
+        for (size_t i = begin; i < end; ++i) {
+          sorted[position[HashVoxelKey(keys[i]) >> (64u - VOXEL_PARTITION_BITS)]++] = static_cast<uint32_t>(i);
+        }
+      });
+
+      // Accumulate each partition on its own.
+      std::vector<std::vector<Voxel>> partition_voxels(partitions);
+      ParallelFor(partitions, [&](const size_t partition) {
+        const uint32_t *indices = sorted.data() + offsets[partition];
+        AccumulateVoxels(
+            points,
+            keys.data(),
+            offsets[partition + 1u] - offsets[partition],
+            VOXEL_PARTITION_BITS,
+            [indices](size_t i) { return indices[i]; },
+            partition_voxels[partition]);
+      });
+      size_t voxel_count = 0u;
+      for (const auto &partition : partition_voxels) {
+        voxel_count += partition.size();
+      }
+      voxels.reserve(voxel_count);
+      for (const auto &partition : partition_voxels) {
+        voxels.insert(voxels.end(), partition.begin(), partition.end());
+      }
+      std::sort(voxels.begin(), voxels.end(), [](const Voxel &lhs, const Voxel &rhs) {
+        return lhs.first < rhs.first;
+      });
+    }
+
+    centroids.resize(voxels.size());
+    if (first_indices != nullptr) {
+      first_indices->resize(voxels.size());
+    }
+    for (size_t i = 0u; i < voxels.size(); ++i) {
+      const Voxel &voxel = voxels[i];
+      const double inverse_count = 1.0 / static_cast<double>(voxel.count);
+      centroids[i] = geom::Location(
+          static_cast<float>(voxel.x * inverse_count),
+          static_cast<float>(voxel.y * inverse_count),
+          static_cast<float>(voxel.z * inverse_count));
+      if (first_indices != nullptr) {
+        (*first_indices)[i] = voxel.first;
+      }
+    }
+  }
+
+  // ===========================================================================
+  // -- Range image ------------------------------------------------------------
+  // ===========================================================================
+
+  void LidarKernels::ProjectToRangeImage(
+      const LidarPointView &points,
+      const uint32_t *channel_counts,
+      const size_t channels,
+      const size_t columns,
+      RangeImage &image) {
+    DEBUG_ASSERT(columns > 0u);
+    DEBUG_ASSERT(channels * columns <= size_t(std::numeric_limits<int32_t>::max()));
+    image.rows = channels;
+    image.columns = columns;
+    image.range.assign(channels * columns, 0.0f);
+    image.index.assign(channels * columns, -1);
+    image.point_cell.assign(points.size(), -1);
+
+    std::vector<size_t> offsets(channels + 1u, 0u);
+    for (size_t channel = 0u; channel < channels; ++channel) {
+      offsets[channel + 1u] = std::min(points.size(), offsets[channel] + channel_counts[channel]);
+    }
+
+    const float column_scale = static_cast<float>(columns) / (2.0f * PI);
+    ParallelFor(channels, [&](const size_t channel) {
+      constexpr size_t BLOCK = 256u;
+      float range[BLOCK];
+      float azimuth[BLOCK];
+      float *cell_range = image.range.data() + channel * columns;
+      int32_t *cell_index = image.index.data() + channel * columns;
+      for (size_t begin = offsets[channel]; begin < offsets[channel + 1u]; begin += BLOCK) {
+        const size_t end = std::min(offsets[channel + 1u], begin + BLOCK);
+        RangeAzimuth(points, begin, end, range, azimuth);
+        for (size_t i = begin; i < end; ++i) {
+          const float position = (azimuth[i - begin] + PI) * column_scale;
+          const size_t column = std::min(columns - 1u, static_cast<size_t>(std::max(position, 0.0f)));
+          image.point_cell[i] = static_cast<int32_t>(channel * columns + column);
+          // Keep the closest point, the first one on ties.
+          if ((cell_index[column] < 0) || (range[i - begin] < cell_range[column])) {
+            cell_range[column] = range[i - begin];
+            cell_index[column] = static_cast<int32_t>(i);
+          }
+        }
+      }
+    });
+  }
+
+  // ===========================================================================
+  // -- Ground segmentation ----------------------------------------------------
+  // ===========================================================================
+
+  void LidarKernels::SegmentGround(
+      const LidarPointView &points,
+      const RangeImage &image,
+      const GroundSegmentationOptions &options,
+      std::vector<uint8_t> &is_ground) {
+    DEBUG_ASSERT(image.point_cell.size() == points.size());
+    const size_t rows = image.rows;
+    const size_t columns = image.columns;
+
+    // Order the rings from the lowest up, by the mean elevation of their
+    // points, so it does not matter whether channel 0 is the top or the
+    // bottom one.
+    std::vector<double> elevation(rows, 0.0);
+    std::vector<size_t> row_order(rows);
+    for (size_t row = 0u; row < rows; ++row) {
+      size_t cells = 0u;
+      for (size_t column = 0u; column < columns; ++column) {
+        const int32_t index = image.index[row * columns + column];
+        if (index >= 0) {
+          elevation[row] += points.GetXYZ(static_cast<size_t>(index))[2u] / image.range[row * columns + column];
+          ++cells;
+        }
+      }
+      elevation[row] = (cells > 0u) ? elevation[row] / static_cast<double>(cells) : 0.0;
+      row_order[row] = row;
+    }
+    std::stable_sort(row_order.begin(), row_order.end(), [&](size_t lhs, size_t rhs) {
+      return elevation[lhs] < elevation[rhs];
+    });
+
+    // Walk each column from the lowest ring up.
+    const float max_rise = std::tan(options.max_slope);
+    std::vector<uint8_t> ground_cells(rows * columns, 0u);
+    ParallelFor(columns, COLUMNS_PER_JOB, [&](size_t, const size_t begin, const size_t end) {
+      for (size_t column = begin; column < end; ++column) {
+        bool has_ground = false;
+        float ground_distance = 0.0f;
+        float ground_height = 0.0f;
+        for (const size_t row : row_order) {
+          const int32_t index = image.index[row * columns + column];
+          if (index < 0) {
+            continue;
+          }
+          const float *p = points.GetXYZ(static_cast<size_t>(index));
+          const float distance = std::sqrt(p[0u] * p[0u] + p[1u] * p[1u]);
+          const bool ground = has_ground ?
+              std::abs(p[2u] - ground_height) <= max_rise * std::abs(distance - ground_distance) :
+              p[2u] < options.max_start_height;
+          if (ground) {
+            ground_cells[row * columns + column] = 1u;
+            has_ground = true;
+            ground_distance = distance;
+            ground_height = p[2u];
+          }
+        }
+      }
+    });
+
+    is_ground.resize(points.size());
+    ParallelFor(points.size(), POINTS_PER_JOB, [&](size_t, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const int32_t cell = image.point_cell[i];
+        is_ground[i] = (cell >= 0) ? ground_cells[static_cast<size_t>(cell)] : uint8_t(0u);
+      }
+    });
+  }
+
+  const char *LidarKernels::GetInstructionSet() {
+#if defined(LIBCARLA_SIMD_SSE2)
+    return "sse2";
+#elif defined(LIBCARLA_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+  }
+
+} // namespace pointcloud
+} // namespace carla
@@ -0,0 +1,143 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/Location.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace carla {
+namespace pointcloud {
+
+  /// Read-only view of an array of lidar detections, as LidarDetection or
+  /// SemanticLidarDetection, that start with the geom::Location of the point.
+  class LidarPointView {
+  public:
+
+    LidarPointView() = default;
+
+    template <typename PointT>
+    LidarPointView(const PointT *points, size_t count)
+      : _data(reinterpret_cast<const unsigned char *>(points)),
+        _stride(sizeof(PointT)),
+        _count(count) {
+      static_assert(sizeof(PointT) >= sizeof(geom::Location), "Points must start with a Location");
+    }
+
+    size_t size() const {
+      return _count;
+    }
+
+    size_t GetStride() const {
+      return _stride;
+    }
+
+    /// The x, y and z coordinates of point @a index.
+    const float *GetXYZ(size_t index) const {
+      return reinterpret_cast<const float *>(_data + index * _stride);
+    }
+
+  private:
+
+    const unsigned char *_data = nullptr;
+
+    size_t _stride = 0u;
+
+    size_t _count = 0u;
+  };
+
+  /// Projection of a lidar sweep with one row per channel and a fixed number
+  /// of columns over the 360 degrees of azimuth, starting at -180.
+  struct RangeImage {
+    size_t rows = 0u;
+
+    size_t columns = 0u;
+
+    /// Range of the closest point of each cell, zero if empty.
+    std::vector<float> range;
+
+    /// Index of the closest point of each cell, -1 if empty.
+    std::vector<int32_t> index;
+
+    /// Cell of each point, or -1 for the points beyond the channel counts.
+    std::vector<int32_t> point_cell;
+  };
+
+  struct GroundSegmentationOptions {
+    /// Maximum slope, in radians, between a point and the previous ground
+    /// point of its column to be ground too.
+    float max_slope = 0.15f;
+
+    /// The lowest points of a column are ground only under this height,
+    /// relative to the sensor. Defaults to a sensor mounted at least a meter
+    /// above the ground.
+    float max_start_height = -1.0f;
+  };
+
+  /// Kernels over the points of LidarMeasurement and SemanticLidarMeasurement,
+  /// reading the detections in place.
+  ///
+  /// Coordinates are loaded four points at a time with SSE2 or NEON and the
+  /// work is split between the threads of the shared JobSystem. The output
+  /// does not depend on the number of threads.
+  class LidarKernels {
+  public:
+
+    /// Hashed voxel-grid downsampling. Writes the centroid of the points of
+    /// each occupied voxel of @a voxel_size meters into @a centroids and, if
+    /// given, the index of the first point of the voxel into
+    /// @a first_indices. Voxels are sorted by the index of their first point.
+    static void VoxelDownsample(
+        const LidarPointView &points,
+        float voxel_size,
+        std::vector<geom::Location> &centroids,
+        std::vector<uint32_t> *first_indices = nullptr);
+
+    /// Projects the points into @a image, with a row per channel. The points
+    /// are sorted by channel, @a channel_counts holding the number of points
+    /// of each of the @a channels, as in the header of the measurement.
+    static void ProjectToRangeImage(
+        const LidarPointView &points,
+        const uint32_t *channel_counts,
+        size_t channels,
+        size_t columns,
+        RangeImage &image);
+
+    /// Same as above reading the channel layout from @a measurement.
+    template <typename MeasurementT>
+    static void ProjectToRangeImage(const MeasurementT &measurement, size_t columns, RangeImage &image) {
+      std::vector<uint32_t> counts(measurement.GetChannelCount());
+      for (size_t channel = 0u; channel < counts.size(); ++channel) {
+        counts[channel] = measurement.GetPointCount(channel);
+      }
+      ProjectToRangeImage(
+          LidarPointView(measurement.data(), measurement.size()),
+          counts.data(),
+          counts.size(),
+          columns,
+          image);
+    }
+
+    /// Ring-based ground segmentation. Walks each column of @a image from
+    /// the lowest ring up, marking the cells that continue the ground with a
+    /// slope under the limit. Writes one value per point into @a is_ground,
+    /// 1 for the points whose cell is ground.
+    static void SegmentGround(
+        const LidarPointView &points,
+        const RangeImage &image,
+        const GroundSegmentationOptions &options,
+        std::vector<uint8_t> &is_ground);
+
+    /// Name of the instruction set the kernels run with: "sse2", "neon" or
+    /// "scalar".
+    static const char *GetInstructionSet();
+  };
+
+} // namespace pointcloud
+} // namespace carla
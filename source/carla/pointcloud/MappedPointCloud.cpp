@@ -0,0 +1,146 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/pointcloud/MappedPointCloud.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <sstream>
+
+namespace carla {
+namespace pointcloud {
+
+  namespace ipc = boost::interprocess;
+
+  struct MappedPointCloudFile::Mapping {
+    ipc::file_mapping file;
+    ipc::mapped_region region;
+  };
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  static bool StartsWith(const std::string &line, const char *prefix) {
+    return line.compare(0u, std::strlen(prefix), prefix) == 0;
+  }
+
+  /// Reads the next header line from @a text, advancing @a offset past it.
+  static bool ReadLine(
+      const char *text,
+      size_t length,
+      size_t &offset,
+      std::string &line) {
+    const void *newline = std::memchr(text + offset, '\n', length - offset);
+    if (newline == nullptr) {
+      return false;
+    }
+    const size_t end = static_cast<size_t>(static_cast<const char *>(newline) - text);
+    line.assign(text + offset, end - offset);
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    offset = end + 1u;
+    return true;
+  }
+
+  static size_t ParseCount(const std::string &path, const std::string &value) {
+    std::istringstream in(value);
+    unsigned long long count = 0u;
+    if (!(in >> count)) {
+      throw_exception(std::runtime_error(path + ": invalid point count"));
+    }
+    return static_cast<size_t>(count);
+  }
+
+  // ===========================================================================
+  // -- MappedPointCloudFile ---------------------------------------------------
+  // ===========================================================================
+
+  MappedPointCloudFile::MappedPointCloudFile(const std::string &path) {
+    try {
+      _mapping = std::make_unique<Mapping>();
+      _mapping->file = ipc::file_mapping(path.c_str(), ipc::read_only);
+      _mapping->region = ipc::mapped_region(_mapping->file, ipc::read_only);
+    } catch (const ipc::interprocess_exception &e) {
+      throw_exception(std::runtime_error(path + ": " + e.what()));
+    }
+    const auto *text = static_cast<const char *>(_mapping->region.get_address());
+    const size_t length = _mapping->region.get_size();
+
+    size_t offset = 0u;
+    std::string line;
+    if (!ReadLine(text, length, offset, line)) {
+      throw_exception(std::runtime_error(path + ": not a point cloud file"));
+    }
+
+    bool header_ended = false;
+    if (line == "ply") {
+      _format = PointCloudFormat::BinaryPly;
+      bool has_vertices = false;
+      while (ReadLine(text, length, offset, line)) {
+        if (line == "end_header") {
+          header_ended = true;
+          break;
+        } else if (StartsWith(line, "format ")) {
+          if (line != "format binary_little_endian 1.0") {
+            throw_exception(std::runtime_error(path + ": only binary_little_endian PLY files can be mapped"));
+          }
+        } else if (StartsWith(line, "element ")) {
+          if (has_vertices || !StartsWith(line, "element vertex ")) {
+            throw_exception(std::runtime_error(path + ": only PLY files with a single vertex element can be mapped"));
+          }
+          has_vertices = true;
+          _size = ParseCount(path, line.substr(std::strlen("element vertex ")));
+        } else if (StartsWith(line, "property ")) {
+          _layout += _layout.empty() ? line : '\n' + line;
+        }
+      }
+      _point_size = PointCloudIO::GetPlyPointSize(_layout);
+    } else if (StartsWith(line, "#") || StartsWith(line, "VERSION")) {
+      _format = PointCloudFormat::BinaryPcd;
+      do {
+        if (StartsWith(line, "DATA ")) {
+          if (line != "DATA binary") {
+            throw_exception(std::runtime_error(path + ": only binary PCD files can be mapped"));
+          }
+          header_ended = true;
+          break;
+        } else if (StartsWith(line, "FIELDS ") || StartsWith(line, "SIZE ") ||
+                   StartsWith(line, "TYPE ") || StartsWith(line, "COUNT ")) {
+          _layout += line + '\n';
+        } else if (StartsWith(line, "POINTS ")) {
+          _size = ParseCount(path, line.substr(std::strlen("POINTS ")));
+        }
+      } while (ReadLine(text, length, offset, line));
+      const size_t sizes_line = _layout.find("SIZE ");
+      if (sizes_line != std::string::npos) {
+        std::istringstream sizes(_layout.substr(sizes_line + std::strlen("SIZE ")));
+        size_t size;
+        while (sizes >> size) {
+          _point_size += size;
+        }
+      }
+    }
+
+    if (!header_ended || (_point_size == 0u)) {
+      throw_exception(std::runtime_error(path + ": invalid point cloud header"));
+    }
+    if ((length - offset) / _point_size < _size) {
+      throw_exception(std::runtime_error(path + ": file is truncated"));
+    }
+    _data = reinterpret_cast<const unsigned char *>(text + offset);
+  }
+
+  MappedPointCloudFile::MappedPointCloudFile(MappedPointCloudFile &&rhs) = default;
+
+  MappedPointCloudFile &MappedPointCloudFile::operator=(MappedPointCloudFile &&rhs) = default;
+
+  MappedPointCloudFile::~MappedPointCloudFile() = default;
+
+} // namespace pointcloud
+} // namespace carla
@@ -0,0 +1,149 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Exception.h"
+#include "carla/pointcloud/PointCloudIO.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace carla {
+namespace pointcloud {
+
+  /// A binary PLY or PCD file mapped in memory. Only the header is parsed,
+  /// the points are read from the file as they are accessed.
+  class MappedPointCloudFile {
+  public:
+
+    /// Throws if the file cannot be mapped or is not a binary PLY or PCD with
+    /// a single element of points.
+    explicit MappedPointCloudFile(const std::string &path);
+
+    MappedPointCloudFile(MappedPointCloudFile &&rhs);
+
+    MappedPointCloudFile &operator=(MappedPointCloudFile &&rhs);
+
+    ~MappedPointCloudFile();
+
+    /// Either PointCloudFormat::BinaryPly or PointCloudFormat::BinaryPcd.
+    PointCloudFormat GetFormat() const {
+      return _format;
+    }
+
+    /// The property lines of a PLY, as written by WritePlyHeaderInfo, or the
+    /// FIELDS, SIZE, TYPE and COUNT lines of a PCD.
+    const std::string &GetLayout() const {
+      return _layout;
+    }
+
+    /// Size in bytes of each point.
+    size_t GetPointSize() const {
+      return _point_size;
+    }
+
+    size_t size() const {
+      return _size;
+    }
+
+    const unsigned char *data() const {
+      return _data;
+    }
+
+  private:
+
+    struct Mapping;
+
+    std::unique_ptr<Mapping> _mapping;
+
+    PointCloudFormat _format = PointCloudFormat::BinaryPly;
+
+    std::string _layout;
+
+    size_t _point_size = 0u;
+
+    size_t _size = 0u;
+
+    const unsigned char *_data = nullptr;
+  };
+
+  /// Read-only view of the points of a file written by
+  /// PointCloudIO::SaveToDisk in a binary format, to replay recorded sweeps
+  /// without parsing them. The layout of the file must match the one of
+  /// @a PointT (same WritePlyHeaderInfo and size). Points are read in place
+  /// when the data is aligned, as it is in the files written by
+  /// PointCloudIO, otherwise they are copied once. Binary files are read in
+  /// the byte order they were written in, which is little-endian on every
+  /// platform CARLA runs on.
+  template <typename PointT>
+  class MappedPointCloud {
+    static_assert(std::is_trivially_copyable<PointT>::value, "Points must be trivially copyable");
+  public:
+
+    using value_type = PointT;
+
+    using const_iterator = const PointT *;
+
+    explicit MappedPointCloud(const std::string &path)
+      : _file(path) {
+      const std::string properties = PointCloudIO::GetPlyProperties<PointT>();
+      const std::string expected = _file.GetFormat() == PointCloudFormat::BinaryPcd ?
+          PointCloudIO::GetPcdFields(properties) :
+          properties;
+      if ((_file.GetLayout() != expected) || (_file.GetPointSize() != sizeof(PointT))) {
+        throw_exception(std::runtime_error(path + ": point layout does not match"));
+      }
+      if (reinterpret_cast<uintptr_t>(_file.data()) % alignof(PointT) == 0u) {
+        _begin = reinterpret_cast<const PointT *>(_file.data());
+      } else {
+        _copy.resize(_file.size());
+        std::memcpy(_copy.data(), _file.data(), _file.size() * sizeof(PointT));
+        _begin = _copy.data();
+      }
+    }
+
+    size_t size() const {
+      return _file.size();
+    }
+
+    bool empty() const {
+      return size() == 0u;
+    }
+
+    const_iterator begin() const {
+      return _begin;
+    }
+
+    const_iterator end() const {
+      return _begin + size();
+    }
+
+    const PointT &operator[](size_t index) const {
+      return _begin[index];
+    }
+
+    PointCloudFormat GetFormat() const {
+      return _file.GetFormat();
+    }
+
+  private:
+
+    MappedPointCloudFile _file;
+
+    std::vector<PointT> _copy;
+
+    const PointT *_begin = nullptr;
+  };
+
+} // namespace pointcloud
+} // namespace carla
@@ -0,0 +1,108 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/pointcloud/PointCloudIO.h"
+
+#include "carla/Exception.h"
+
+#include <stdexcept>
+
+namespace carla {
+namespace pointcloud {
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  /// Size in bytes and PCD type letter of a PLY scalar type.
+  static bool GetPlyType(const std::string &type, size_t &size, char &pcd_type) {
+    if (type == "char" || type == "int8") {
+      size = 1u; pcd_type = 'I';
+    } else if (type == "uchar" || type == "uint8") {
+      size = 1u; pcd_type = 'U';
+    } else if (type == "short" || type == "int16") {
+      size = 2u; pcd_type = 'I';
+    } else if (type == "ushort" || type == "uint16") {
+      size = 2u; pcd_type = 'U';
+    } else if (type == "int" || type == "int32") {
+      size = 4u; pcd_type = 'I';
+    } else if (type == "uint" || type == "uint32") {
+      size = 4u; pcd_type = 'U';
+    } else if (type == "float" || type == "float32") {
+      size = 4u; pcd_type = 'F';
+    } else if (type == "double" || type == "float64") {
+      size = 8u; pcd_type = 'F';
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /// Calls @a callback with the type and name of each "property" line.
+  template <typename F>
+  static void ForEachProperty(const std::string &properties, F &&callback) {
+    std::istringstream in(properties);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream words(line);
+      std::string keyword, type, name;
+      words >> keyword >> type >> name;
+      if (keyword != "property" || name.empty()) {
+        throw_exception(std::invalid_argument("invalid point cloud property: " + line));
+      }
+      callback(type, name);
+    }
+  }
+
+  // ===========================================================================
+  // -- PointCloudIO -----------------------------------------------------------
+  // ===========================================================================
+
+  std::string PointCloudIO::GetPcdFields(const std::string &properties) {
+    std::string fields = "FIELDS";
+    std::string sizes = "SIZE";
+    std::string types = "TYPE";
+    std::string counts = "COUNT";
+    ForEachProperty(properties, [&](const std::string &type, const std::string &name) {
+      size_t size;
+      char pcd_type;
+      if (!GetPlyType(type, size, pcd_type)) {
+        throw_exception(std::invalid_argument("point cloud property type not supported: " + type));
+      }
+      fields += ' ' + name;
+      sizes += ' ' + std::to_string(size);
+      types += ' ';
+      types += pcd_type;
+      counts += " 1";
+    });
+    return fields + '\n' + sizes + '\n' + types + '\n' + counts + '\n';
+  }
+
+  size_t PointCloudIO::GetPlyPointSize(const std::string &properties) {
+    size_t total = 0u;
+    bool known = true;
+    ForEachProperty(properties, [&](const std::string &type, const std::string &) {
+      size_t size;
+      char pcd_type;
+      known = known && GetPlyType(type, size, pcd_type);
+      total += known ? size : 0u;
+    });
+    return known ? total : 0u;
+  }
+
+  std::string PointCloudIO::AlignHeader(
+      const std::string &first,
+      const std::string &second,
+      const std::string &comment_prefix,
+      const std::string &comment_suffix) {
+    const size_t length =
+        first.size() + second.size() + comment_prefix.size() + comment_suffix.size();
+    const size_t padding = (DATA_ALIGNMENT - length % DATA_ALIGNMENT) % DATA_ALIGNMENT;
+    return first + comment_prefix + std::string(padding, ' ') + comment_suffix + second;
+  }
+
+} // namespace pointcloud
+} // namespace carla
@@ -6,15 +6,30 @@
 
 #pragma once
 
+#include "carla/Debug.h"
 #include "carla/FileSystem.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
 
 namespace carla {
 namespace pointcloud {
 
+  enum class PointCloudFormat {
+    /// PLY with one line of text per point.
+    AsciiPly,
+    /// PLY with the points as binary_little_endian.
+    BinaryPly,
+    /// PCD (Point Cloud Library) with the points as binary.
+    BinaryPcd
+  };
+
   class PointCloudIO {
 
   public:
@@ -27,15 +42,105 @@ namespace pointcloud {
       }
     }
 
+    /// Writes a binary little-endian PLY. The points are copied as they are
+    /// in memory, so the properties of WritePlyHeaderInfo must follow the
+    /// layout of the point type, as they do for the lidar detections.
+    template <typename PointIt>
+    static void DumpBinaryPly(std::ostream &out, PointIt begin, PointIt end) {
+      const auto count = static_cast<size_t>(std::distance(begin, end));
+      const auto properties = GetBinaryPlyProperties<PointValueT<PointIt>>();
+      out << AlignHeader(
+          "ply\n"
+          "format binary_little_endian 1.0\n",
+          "element vertex " + std::to_string(count) + "\n" +
+          properties +
+          "\nend_header\n",
+          "comment ",
+          "\n");
+      WritePoints(out, begin, end);
+    }
+
+    /// Writes a binary PCD with the fields of WritePlyHeaderInfo.
+    template <typename PointIt>
+    static void DumpBinaryPcd(std::ostream &out, PointIt begin, PointIt end) {
+      const auto count = std::to_string(static_cast<size_t>(std::distance(begin, end)));
+      const auto properties = GetBinaryPlyProperties<PointValueT<PointIt>>();
+      out << AlignHeader(
+          "# .PCD v0.7 - Point Cloud Data file format",
+          "\n"
+          "VERSION 0.7\n" +
+          GetPcdFields(properties) +
+          "WIDTH " + count + "\n"
+          "HEIGHT 1\n"
+          "VIEWPOINT 0 0 0 1 0 0 0\n"
+          "POINTS " + count + "\n"
+          "DATA binary\n",
+          "",
+          "");
+      WritePoints(out, begin, end);
+    }
+
     template <typename PointIt>
-    static std::string SaveToDisk(std::string path, PointIt begin, PointIt end) {
-      FileSystem::ValidateFilePath(path, ".ply");
-      std::ofstream out(path);
-      Dump(out, begin, end);
+    static std::string SaveToDisk(
+        std::string path,
+        PointIt begin,
+        PointIt end,
+        PointCloudFormat format = PointCloudFormat::AsciiPly) {
+      FileSystem::ValidateFilePath(path, format == PointCloudFormat::BinaryPcd ? ".pcd" : ".ply");
+      switch (format) {
+        case PointCloudFormat::AsciiPly: {
+          std::ofstream out(path);
+          Dump(out, begin, end);
+          break;
+        }
+        case PointCloudFormat::BinaryPly: {
+          std::ofstream out(path, std::ios::binary);
+          DumpBinaryPly(out, begin, end);
+          break;
+        }
+        case PointCloudFormat::BinaryPcd: {
+          std::ofstream out(path, std::ios::binary);
+          DumpBinaryPcd(out, begin, end);
+          break;
+        }
+      }
       return path;
     }
 
+    /// Property lines of the PLY header of @a PointT, as written by its
+    /// WritePlyHeaderInfo.
+    template <typename PointT>
+    static std::string GetPlyProperties() {
+      std::ostringstream properties;
+      PointT().WritePlyHeaderInfo(properties);
+      return properties.str();
+    }
+
+    /// FIELDS, SIZE, TYPE and COUNT lines of a PCD header equivalent to the
+    /// PLY @a properties.
+    static std::string GetPcdFields(const std::string &properties);
+
+    /// Size in bytes of a point with the PLY @a properties, or zero if any
+    /// of the types is unknown.
+    static size_t GetPlyPointSize(const std::string &properties);
+
+    /// Binary data of every file starts at a multiple of this, so it can be
+    /// mapped and read in place.
+    static constexpr size_t DATA_ALIGNMENT = 16u;
+
   private:
+    template <typename PointIt>
+    using PointValueT = typename std::iterator_traits<PointIt>::value_type;
+
+    /// Properties of @a PointT for the binary formats, which write the points
+    /// as they are in memory, so the properties must add up to its size.
+    template <typename PointT>
+    static std::string GetBinaryPlyProperties() {
+      auto properties = GetPlyProperties<PointT>();
+      DEBUG_ASSERT_EQ(GetPlyPointSize(properties), sizeof(PointT));
+      return properties;
+    }
+
     template <typename PointIt> static void WriteHeader(std::ostream &out, PointIt begin, PointIt end) {
       DEBUG_ASSERT(std::distance(begin, end) >= 0);
       out << "ply\n"
@@ -45,6 +150,47 @@ namespace pointcloud {
       out << "\nend_header\n";
       out << std::fixed << std::setprecision(4u);
     }
+
+    /// Joins @a first and @a second with a line of @a comment_prefix and
+    /// padding spaces, so the header ends at a multiple of DATA_ALIGNMENT.
+    static std::string AlignHeader(
+        const std::string &first,
+        const std::string &second,
+        const std::string &comment_prefix,
+        const std::string &comment_suffix);
+
+    /// Points in contiguous memory are written in a single call.
+    template <typename PointT>
+    static void WritePoints(std::ostream &out, const PointT *begin, const PointT *end) {
+      static_assert(std::is_trivially_copyable<PointT>::value, "Points must be trivially copyable");
+      out.write(
+          reinterpret_cast<const char *>(begin),
+          static_cast<std::streamsize>(sizeof(PointT) * static_cast<size_t>(end - begin)));
+    }
+
+    template <typename PointT>
+    static void WritePoints(std::ostream &out, PointT *begin, PointT *end) {
+      WritePoints<PointT>(out, static_cast<const PointT *>(begin), static_cast<const PointT *>(end));
+    }
+
+    /// Other iterators go through a block buffer.
+    template <typename PointIt>
+    static void WritePoints(std::ostream &out, PointIt begin, PointIt end) {
+      using PointT = PointValueT<PointIt>;
+      static_assert(std::is_trivially_copyable<PointT>::value, "Points must be trivially copyable");
+      constexpr size_t block_points = std::max<size_t>(1u, (64u * 1024u) / sizeof(PointT));
+      char block[block_points * sizeof(PointT)];
+      size_t count = 0u;
+      for (; begin != end; ++begin) {
+        const PointT point = *begin;
+        std::memcpy(block + count * sizeof(PointT), &point, sizeof(PointT));
+        if (++count == block_points) {
+          out.write(block, static_cast<std::streamsize>(sizeof(block)));
+          count = 0u;
+        }
+      }
+      out.write(block, static_cast<std::streamsize>(count * sizeof(PointT)));
+    }
   };
 
 } // namespace pointcloud
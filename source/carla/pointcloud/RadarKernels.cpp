@@ -0,0 +1,493 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/pointcloud/RadarKernels.h"
+
+#include "carla/Debug.h"
+#include "carla/ParallelFor.h"
+#include "carla/SimdMath.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace carla {
+namespace pointcloud {
+
+  using sensor::data::RadarDetection;
+
+  static_assert(sizeof(geom::Location) == 3u * sizeof(float), "Invalid Location size");
+
+  /// Detections converted by each job.
+  static constexpr size_t DETECTIONS_PER_JOB = 1u << 14u;
+
+  /// Detections whose neighbours are searched by each job.
+  static constexpr size_t CLUSTER_DETECTIONS_PER_JOB = 1u << 11u;
+
+  /// Bits of each coordinate in a cell key.
+  static constexpr unsigned CELL_COORDINATE_BITS = 21u;
+
+  static constexpr uint64_t CELL_COORDINATE_MASK = (uint64_t(1u) << CELL_COORDINATE_BITS) - 1u;
+
+  static constexpr int32_t CELL_COORDINATE_OFFSET = int32_t(1) << (CELL_COORDINATE_BITS - 1u);
+
+  /// Row-major rotation and translation applied to the converted detections.
+  struct AffineTransform {
+    float m[3u][3u];
+    float t[3u];
+  };
+
+  static AffineTransform MakeAffineTransform(const geom::Transform &transform) {
+    AffineTransform affine;
+    const geom::Vector3D axes[3u] = {
+      transform.rotation.RotateVector(geom::Vector3D(1.0f, 0.0f, 0.0f)),
+      transform.rotation.RotateVector(geom::Vector3D(0.0f, 1.0f, 0.0f)),
+      transform.rotation.RotateVector(geom::Vector3D(0.0f, 0.0f, 1.0f))
+    };
+    for (size_t column = 0u; column < 3u; ++column) {
+      affine.m[0u][column] = axes[column].x;
+      affine.m[1u][column] = axes[column].y;
+      affine.m[2u][column] = axes[column].z;
+    }
+    affine.t[0u] = transform.location.x;
+    affine.t[1u] = transform.location.y;
+    affine.t[2u] = transform.location.z;
+    return affine;
+  }
+
+  // ===========================================================================
+  // -- Scalar kernels ---------------------------------------------------------
+  // ===========================================================================
+
+  template <bool Transform>
+  static inline void ToCartesianScalar(
+      const RadarDetection *detections,
+      const size_t begin,
+      const size_t end,
+      const AffineTransform &affine,
+      geom::Location *locations) {
+    for (size_t i = begin; i < end; ++i) {
+      const RadarDetection &detection = detections[i];
+      float sin_azimuth, cos_azimuth, sin_altitude, cos_altitude;
+      simd::SinCos(detection.azimuth, sin_azimuth, cos_azimuth);
+      simd::SinCos(detection.altitude, sin_altitude, cos_altitude);
+      const float horizontal = detection.depth * cos_altitude;
+      const float x = horizontal * cos_azimuth;
+      const float y = horizontal * sin_azimuth;
+      const float z = detection.depth * sin_altitude;
+      geom::Location &location = locations[i];
+      if (Transform) {
+        location.x = ((affine.m[0u][0u] * x + affine.m[0u][1u] * y) + affine.m[0u][2u] * z) + affine.t[0u];
+        location.y = ((affine.m[1u][0u] * x + affine.m[1u][1u] * y) + affine.m[1u][2u] * z) + affine.t[1u];
+        location.z = ((affine.m[2u][0u] * x + affine.m[2u][1u] * y) + affine.m[2u][2u] * z) + affine.t[2u];
+      } else {
+        location.x = x;
+        location.y = y;
+        location.z = z;
+      }
+    }
+  }
+
+  // ===========================================================================
+  // -- SSE2 kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#if defined(LIBCARLA_SIMD_SSE2)
+
+  template <bool Transform>
+  static void ToCartesianSIMD(
+      const RadarDetection *detections,
+      const size_t begin,
+      const size_t end,
+      const AffineTransform &affine,
+      geom::Location *locations) {
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      const float *source = &detections[i].velocity;
+      __m128 velocity = _mm_loadu_ps(source);
+      __m128 azimuth = _mm_loadu_ps(source + 4u);
+      __m128 altitude = _mm_loadu_ps(source + 8u);
+      __m128 depth = _mm_loadu_ps(source + 12u);
+      _MM_TRANSPOSE4_PS(velocity, azimuth, altitude, depth);
+      __m128 sin_azimuth, cos_azimuth, sin_altitude, cos_altitude;
+      simd::SinCosSSE2(azimuth, sin_azimuth, cos_azimuth);
+      simd::SinCosSSE2(altitude, sin_altitude, cos_altitude);
+      const __m128 horizontal = _mm_mul_ps(depth, cos_altitude);
+      __m128 x = _mm_mul_ps(horizontal, cos_azimuth);
+      __m128 y = _mm_mul_ps(horizontal, sin_azimuth);
+      __m128 z = _mm_mul_ps(depth, sin_altitude);
+      if (Transform) {
+        const auto row = [&](const size_t r) {
+          __m128 result = _mm_add_ps(
+              _mm_mul_ps(_mm_set1_ps(affine.m[r][0u]), x),
+              _mm_mul_ps(_mm_set1_ps(affine.m[r][1u]), y));
+          result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(affine.m[r][2u]), z));
+          return _mm_add_ps(result, _mm_set1_ps(affine.t[r]));
+        };
+        const __m128 tx = row(0u);
+        const __m128 ty = row(1u);
+        z = row(2u);
+        x = tx;
+        y = ty;
+      }
+      __m128 w = _mm_setzero_ps();
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      // Each store spills a float into the next location, overwritten by the
+      // next store; the last one writes only three floats.
+      float *target = &locations[i].x;
+      _mm_storeu_ps(target, x);
+      _mm_storeu_ps(target + 3u, y);
+      _mm_storeu_ps(target + 6u, z);
+      _mm_storel_pi(reinterpret_cast<__m64 *>(target + 9u), w);
+      _mm_store_ss(target + 11u, _mm_movehl_ps(w, w));
+    }
+    ToCartesianScalar<Transform>(detections, i, end, affine, locations);
+  }
+
+  // ===========================================================================
+  // -- NEON kernels -----------------------------------------------------------
+  // ===========================================================================
+
+#elif defined(LIBCARLA_SIMD_NEON)
+
+  template <bool Transform>
+  static void ToCartesianSIMD(
+      const RadarDetection *detections,
+      const size_t begin,
+      const size_t end,
+      const AffineTransform &affine,
+      geom::Location *locations) {
+    size_t i = begin;
+    for (; i + 4u <= end; i += 4u) {
+      const float32x4x4_t detection = vld4q_f32(&detections[i].velocity);
+      const float32x4_t depth = detection.val[3u];
+      float32x4_t sin_azimuth, cos_azimuth, sin_altitude, cos_altitude;
+      simd::SinCosNEON(detection.val[1u], sin_azimuth, cos_azimuth);
+      simd::SinCosNEON(detection.val[2u], sin_altitude, cos_altitude);
+      const float32x4_t horizontal = vmulq_f32(depth, cos_altitude);
+      float32x4x3_t location;
+      location.val[0u] = vmulq_f32(horizontal, cos_azimuth);
+      location.val[1u] = vmulq_f32(horizontal, sin_azimuth);
+      location.val[2u] = vmulq_f32(depth, sin_altitude);
+      if (Transform) {
+        const float32x4x3_t p = location;
+        for (size_t r = 0u; r < 3u; ++r) {
+          float32x4_t result = vaddq_f32(
+              vmulq_f32(vdupq_n_f32(affine.m[r][0u]), p.val[0u]),
+              vmulq_f32(vdupq_n_f32(affine.m[r][1u]), p.val[1u]));
+          result = vaddq_f32(result, vmulq_f32(vdupq_n_f32(affine.m[r][2u]), p.val[2u]));
+          location.val[r] = vaddq_f32(result, vdupq_n_f32(affine.t[r]));
+        }
+      }
+      vst3q_f32(&locations[i].x, location);
+    }
+    ToCartesianScalar<Transform>(detections, i, end, affine, locations);
+  }
+
+#endif // LIBCARLA_SIMD_NEON
+
+  template <bool Transform>
+  static void ToCartesian(
+      const RadarDetection *detections,
+      const size_t count,
+      const AffineTransform &affine,
+      geom::Location *locations) {
+    ParallelFor(count, DETECTIONS_PER_JOB, [&](size_t, size_t begin, size_t end) {
+#if defined(LIBCARLA_SIMD_SSE2) || defined(LIBCARLA_SIMD_NEON)
+      ToCartesianSIMD<Transform>(detections, begin, end, affine, locations);
+#else
+      ToCartesianScalar<Transform>(detections, begin, end, affine, locations);
+#endif
+    });
+  }
+
+  // ===========================================================================
+  // -- Clustering -------------------------------------------------------------
+  // ===========================================================================
+
+  static inline int32_t CellCoordinate(const float value, const float inverse_size) {
+    return static_cast<int32_t>(std::floor(value * inverse_size));
+  }
+
+  static inline uint64_t MakeCellKey(const int32_t x, const int32_t y, const int32_t z) {
+    const auto pack = [](int32_t value) {
+      return static_cast<uint64_t>(value + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK;
+    };
+    return
+        (pack(x) << (2u * CELL_COORDINATE_BITS)) |
+        (pack(y) << CELL_COORDINATE_BITS) |
+        pack(z);
+  }
+
+  /// Detections sorted by grid cell, with the neighbouring cells of each
+  /// cell.
+  class ClusterGrid {
+  public:
+
+    ClusterGrid(const geom::Location *locations, const size_t count, const float cell_size) {
+      const float inverse_size = 1.0f / cell_size;
+      std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+      std::vector<std::array<int32_t, 3u>> coordinates(count);
+      ParallelFor(count, DETECTIONS_PER_JOB, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          coordinates[i] = {{
+              CellCoordinate(locations[i].x, inverse_size),
+              CellCoordinate(locations[i].y, inverse_size),
+              CellCoordinate(locations[i].z, inverse_size)}};
+          keys[i] = std::make_pair(
+              MakeCellKey(coordinates[i][0u], coordinates[i][1u], coordinates[i][2u]),
+              static_cast<uint32_t>(i));
+        }
+      });
+      std::sort(keys.begin(), keys.end());
+
+      _sorted.resize(count);
+      std::vector<std::array<int32_t, 3u>> cell_coordinates;
+      for (size_t i = 0u; i < count; ++i) {
+        _sorted[i] = keys[i].second;
+        if ((i == 0u) || (keys[i].first != keys[i - 1u].first)) {
+          _cell_keys.emplace_back(keys[i].first);
+          _cell_begin.emplace_back(static_cast<uint32_t>(i));
+          cell_coordinates.emplace_back(coordinates[keys[i].second]);
+        }
+      }
+      _cell_begin.emplace_back(static_cast<uint32_t>(count));
+
+      _neighbours.resize(_cell_keys.size());
+      ParallelFor(_cell_keys.size(), DETECTIONS_PER_JOB, [&](size_t, size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+          const auto &c = cell_coordinates[cell];
+          auto &neighbours = _neighbours[cell];
+          neighbours.count = 0u;
+          for (int32_t dx = -1; dx <= 1; ++dx) {
+            for (int32_t dy = -1; dy <= 1; ++dy) {
+              for (int32_t dz = -1; dz <= 1; ++dz) {
+                const uint64_t key = MakeCellKey(c[0u] + dx, c[1u] + dy, c[2u] + dz);
+                const auto it = std::lower_bound(_cell_keys.begin(), _cell_keys.end(), key);
+                if ((it != _cell_keys.end()) && (*it == key)) {
+                  neighbours.cells[neighbours.count++] = static_cast<uint32_t>(it - _cell_keys.begin());
+                }
+              }
+            }
+          }
+        }
+      });
+    }
+
+    size_t GetCellCount() const {
+      return _cell_keys.size();
+    }
+
+    /// Calls @a functor(i) for each detection i of @a cell.
+    template <typename FunctorT>
+    void ForEachDetection(const size_t cell, FunctorT &&functor) const {
+      for (uint32_t k = _cell_begin[cell]; k < _cell_begin[cell + 1u]; ++k) {
+        functor(_sorted[k]);
+      }
+    }
+
+    /// Calls @a functor(j) for each detection j of @a cell and its
+    /// neighbouring cells.
+    template <typename FunctorT>
+    void ForEachCandidate(const size_t cell, FunctorT &&functor) const {
+      const auto &neighbours = _neighbours[cell];
+      for (uint32_t n = 0u; n < neighbours.count; ++n) {
+        ForEachDetection(neighbours.cells[n], functor);
+      }
+    }
+
+  private:
+
+    struct Neighbours {
+      uint32_t cells[27u];
+      uint32_t count;
+    };
+
+    std::vector<uint32_t> _sorted;
+
+    std::vector<uint64_t> _cell_keys;
+
+    std::vector<uint32_t> _cell_begin;
+
+    std::vector<Neighbours> _neighbours;
+  };
+
+  static uint32_t FindRoot(std::vector<uint32_t> &parent, uint32_t i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  /// Joins the sets of @a a and @a b, the root being the lowest index.
+  static void Join(std::vector<uint32_t> &parent, const uint32_t a, const uint32_t b) {
+    const uint32_t root_a = FindRoot(parent, a);
+    const uint32_t root_b = FindRoot(parent, b);
+    if (root_a < root_b) {
+      parent[root_b] = root_a;
+    } else if (root_b < root_a) {
+      parent[root_a] = root_b;
+    }
+  }
+
+  // ===========================================================================
+  // -- RadarKernels -----------------------------------------------------------
+  // ===========================================================================
+
+  void RadarKernels::ToCartesian(
+      const RadarDetection *detections,
+      const size_t count,
+      geom::Location *locations) {
+    pointcloud::ToCartesian<false>(detections, count, AffineTransform(), locations);
+  }
+
+  void RadarKernels::ToCartesian(
+      const RadarDetection *detections,
+      const size_t count,
+      const geom::Transform &transform,
+      geom::Location *locations) {
+    pointcloud::ToCartesian<true>(detections, count, MakeAffineTransform(transform), locations);
+  }
+
+  void RadarKernels::Cluster(
+      const geom::Location *locations,
+      const float *velocities,
+      const size_t count,
+      const RadarClusteringOptions &options,
+      std::vector<RadarCluster> &clusters,
+      std::vector<int32_t> *labels) {
+    DEBUG_ASSERT(options.eps > 0.0f);
+    DEBUG_ASSERT(count <= static_cast<size_t>(std::numeric_limits<int32_t>::max()));
+    clusters.clear();
+    if (labels != nullptr) {
+      labels->assign(count, -1);
+    }
+    if (count == 0u) {
+      return;
+    }
+
+    const float eps_squared = options.eps * options.eps;
+    const auto are_neighbours = [&](const uint32_t i, const uint32_t j) {
+      const float dx = locations[i].x - locations[j].x;
+      const float dy = locations[i].y - locations[j].y;
+      const float dz = locations[i].z - locations[j].z;
+      return
+          ((dx * dx + dy * dy + dz * dz) <= eps_squared) &&
+          ((velocities == nullptr) ||
+           (std::abs(velocities[i] - velocities[j]) <= options.max_velocity_difference));
+    };
+
+    const ClusterGrid grid(locations, count, options.eps);
+    const size_t cells = grid.GetCellCount();
+
+    // Find the core detections, each job taking a range of cells.
+    std::vector<uint8_t> is_core(count, 0u);
+    ParallelFor(cells, CLUSTER_DETECTIONS_PER_JOB / 8u, [&](size_t, size_t begin, size_t end) {
+      for (size_t cell = begin; cell < end; ++cell) {
+        grid.ForEachDetection(cell, [&](const uint32_t i) {
+          uint32_t neighbours = 0u;
+          grid.ForEachCandidate(cell, [&](const uint32_t j) {
+            neighbours += are_neighbours(i, j) ? 1u : 0u;
+          });
+          is_core[i] = (neighbours >= options.min_points) ? 1u : 0u;
+        });
+      }
+    });
+
+    // Join the neighbouring core detections, and attach each border
+    // detection to its closest core neighbour.
+    std::vector<uint32_t> parent(count);
+    for (uint32_t i = 0u; i < count; ++i) {
+      parent[i] = i;
+    }
+    std::vector<int32_t> border_core(count, -1);
+    for (size_t cell = 0u; cell < cells; ++cell) {
+      grid.ForEachDetection(cell, [&](const uint32_t i) {
+        if (is_core[i] != 0u) {
+          grid.ForEachCandidate(cell, [&](const uint32_t j) {
+            if ((j < i) && (is_core[j] != 0u) && are_neighbours(i, j)) {
+              Join(parent, i, j);
+            }
+          });
+          return;
+        }
+        float closest = std::numeric_limits<float>::infinity();
+        grid.ForEachCandidate(cell, [&](const uint32_t j) {
+          if ((is_core[j] == 0u) || !are_neighbours(i, j)) {
+            return;
+          }
+          const float distance = (locations[i] - locations[j]).SquaredLength();
+          if ((distance < closest) ||
+              ((distance == closest) && (static_cast<int32_t>(j) < border_core[i]))) {
+            closest = distance;
+            border_core[i] = static_cast<int32_t>(j);
+          }
+        });
+      });
+    }
+
+    // Number the clusters in order of their first detection and add up their
+    // detections.
+    struct Sums {
+      double x = 0.0;
+      double y = 0.0;
+      double z = 0.0;
+      double velocity = 0.0;
+      uint32_t count = 0u;
+    };
+    std::vector<Sums> sums;
+    std::vector<int32_t> root_label(count, -1);
+    for (uint32_t i = 0u; i < count; ++i) {
+      uint32_t root;
+      if (is_core[i] != 0u) {
+        root = FindRoot(parent, i);
+      } else if (border_core[i] >= 0) {
+        root = FindRoot(parent, static_cast<uint32_t>(border_core[i]));
+      } else {
+        continue;
+      }
+      if (root_label[root] < 0) {
+        root_label[root] = static_cast<int32_t>(sums.size());
+        sums.emplace_back();
+      }
+      const int32_t label = root_label[root];
+      auto &cluster = sums[static_cast<size_t>(label)];
+      cluster.x += locations[i].x;
+      cluster.y += locations[i].y;
+      cluster.z += locations[i].z;
+      cluster.velocity += (velocities != nullptr) ? velocities[i] : 0.0f;
+      ++cluster.count;
+      if (labels != nullptr) {
+        (*labels)[i] = label;
+      }
+    }
+
+    clusters.resize(sums.size());
+    for (size_t c = 0u; c < sums.size(); ++c) {
+      const double inverse_count = 1.0 / static_cast<double>(sums[c].count);
+      clusters[c].centroid = geom::Location(
+          static_cast<float>(sums[c].x * inverse_count),
+          static_cast<float>(sums[c].y * inverse_count),
+          static_cast<float>(sums[c].z * inverse_count));
+      clusters[c].mean_velocity = static_cast<float>(sums[c].velocity * inverse_count);
+      clusters[c].detection_count = sums[c].count;
+    }
+  }
+
+  const char *RadarKernels::GetInstructionSet() {
+#if defined(LIBCARLA_SIMD_SSE2)
+    return "sse2";
+#elif defined(LIBCARLA_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+  }
+
+} // namespace pointcloud
+} // namespace carla
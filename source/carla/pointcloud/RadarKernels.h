@@ -0,0 +1,121 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/Location.h"
+#include "carla/geom/Transform.h"
+#include "carla/sensor/data/RadarData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace carla {
+namespace pointcloud {
+
+  struct RadarClusteringOptions {
+    /// Maximum distance, in meters, between two neighbouring detections.
+    float eps = 1.0f;
+
+    /// Minimum number of neighbours, the detection included, of a core
+    /// detection.
+    uint32_t min_points = 3u;
+
+    /// Maximum difference of velocity, in m/s, between two neighbouring
+    /// detections.
+    float max_velocity_difference = std::numeric_limits<float>::infinity();
+  };
+
+  struct RadarCluster {
+    geom::Location centroid;
+
+    /// Mean of the velocity of the detections, in m/s.
+    float mean_velocity = 0.0f;
+
+    uint32_t detection_count = 0u;
+  };
+
+  /// Kernels over the detections of RadarMeasurement, reading them in place.
+  ///
+  /// Detections are converted four at a time with SSE2 or NEON, using
+  /// polynomial sine and cosine, and the work is split between the threads
+  /// of the shared JobSystem. The output does not depend on the number of
+  /// threads.
+  class RadarKernels {
+  public:
+
+    /// Converts the detections to Cartesian coordinates in the frame of the
+    /// sensor, x forward, y right and z up. Writes @a count locations into
+    /// @a locations.
+    static void ToCartesian(
+        const sensor::data::RadarDetection *detections,
+        size_t count,
+        geom::Location *locations);
+
+    /// Same as above applying @a transform to the locations, e.g. the
+    /// transform of the sensor to get them in world frame. Several radars
+    /// can be converted into consecutive ranges of the same array.
+    static void ToCartesian(
+        const sensor::data::RadarDetection *detections,
+        size_t count,
+        const geom::Transform &transform,
+        geom::Location *locations);
+
+    /// Converts the detections of @a measurement to sensor frame.
+    template <typename MeasurementT>
+    static void ToSensorFrame(const MeasurementT &measurement, std::vector<geom::Location> &locations) {
+      locations.resize(measurement.size());
+      ToCartesian(measurement.data(), measurement.size(), locations.data());
+    }
+
+    /// Converts the detections of @a measurement to world frame, using the
+    /// transform of the sensor at the time of the measurement.
+    template <typename MeasurementT>
+    static void ToWorldFrame(const MeasurementT &measurement, std::vector<geom::Location> &locations) {
+      locations.resize(measurement.size());
+      ToCartesian(measurement.data(), measurement.size(), measurement.GetSensorTransform(), locations.data());
+    }
+
+    /// DBSCAN clustering of the detections at @a locations, with velocities
+    /// @a velocities, over a grid of @a options.eps cells. Writes the
+    /// clusters into @a clusters, numbered in order of their first
+    /// detection, and, if given, the cluster of each detection into
+    /// @a labels, -1 for noise. Border detections go to the cluster of their
+    /// closest core neighbour.
+    static void Cluster(
+        const geom::Location *locations,
+        const float *velocities,
+        size_t count,
+        const RadarClusteringOptions &options,
+        std::vector<RadarCluster> &clusters,
+        std::vector<int32_t> *labels = nullptr);
+
+    /// Same as above clustering the detections of @a measurement in sensor
+    /// frame.
+    template <typename MeasurementT>
+    static void Cluster(
+        const MeasurementT &measurement,
+        const RadarClusteringOptions &options,
+        std::vector<RadarCluster> &clusters,
+        std::vector<int32_t> *labels = nullptr) {
+      std::vector<geom::Location> locations;
+      ToSensorFrame(measurement, locations);
+      std::vector<float> velocities(measurement.size());
+      for (size_t i = 0u; i < velocities.size(); ++i) {
+        velocities[i] = measurement[i].velocity;
+      }
+      Cluster(locations.data(), velocities.data(), locations.size(), options, clusters, labels);
+    }
+
+    /// Name of the instruction set the conversion runs with: "sse2", "neon"
+    /// or "scalar".
+    static const char *GetInstructionSet();
+  };
+
+} // namespace pointcloud
+} // namespace carla
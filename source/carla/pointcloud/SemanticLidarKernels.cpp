@@ -0,0 +1,369 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/pointcloud/SemanticLidarKernels.h"
+
+#include "carla/Debug.h"
+#include "carla/ParallelFor.h"
+#include "carla/geom/Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace carla {
+namespace pointcloud {
+
+  using sensor::data::SemanticLidarDetection;
+
+  /// Points handed to each job.
+  static constexpr size_t POINTS_PER_JOB = 1u << 15u;
+
+  // ===========================================================================
+  // -- ObjectTable ------------------------------------------------------------
+  // ===========================================================================
+
+  /// Running sums of the points of an object.
+  struct ObjectSums {
+    uint32_t count = 0u;
+    uint32_t first_index = 0u;
+    uint32_t first_tag = 0u;
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    double xx = 0.0;
+    double xy = 0.0;
+    double yy = 0.0;
+    float min[3u];
+    float max[3u];
+
+    void Add(const SemanticLidarDetection &point, uint32_t index) {
+      const float p[3u] = {point.point.x, point.point.y, point.point.z};
+      if (count == 0u) {
+        first_index = index;
+        first_tag = point.object_tag;
+        std::copy(p, p + 3u, min);
+        std::copy(p, p + 3u, max);
+      }
+      ++count;
+      x += p[0u];
+      y += p[1u];
+      z += p[2u];
+      xx += double(p[0u]) * p[0u];
+      xy += double(p[0u]) * p[1u];
+      yy += double(p[1u]) * p[1u];
+      for (auto i = 0u; i < 3u; ++i) {
+        min[i] = std::min(min[i], p[i]);
+        max[i] = std::max(max[i], p[i]);
+      }
+    }
+
+    void Merge(const ObjectSums &rhs) {
+      if (count == 0u) {
+        *this = rhs;
+        return;
+      }
+      if (rhs.first_index < first_index) {
+        first_index = rhs.first_index;
+        first_tag = rhs.first_tag;
+      }
+      count += rhs.count;
+      x += rhs.x;
+      y += rhs.y;
+      z += rhs.z;
+      xx += rhs.xx;
+      xy += rhs.xy;
+      yy += rhs.yy;
+      for (auto i = 0u; i < 3u; ++i) {
+        min[i] = std::min(min[i], rhs.min[i]);
+        max[i] = std::max(max[i], rhs.max[i]);
+      }
+    }
+  };
+
+  /// Open-addressing hash table with linear probing from object_idx to the
+  /// sums of the object.
+  class ObjectTable {
+  public:
+
+    ObjectTable() {
+      Reset(16u);
+    }
+
+    size_t size() const {
+      return _size;
+    }
+
+    /// Sums of @a key, inserted if missing. Invalidates the references
+    /// returned before.
+    ObjectSums &Find(const uint32_t key) {
+      size_t slot = Hash(key);
+      while (_keys[slot] != EMPTY) {
+        if (_keys[slot] == key) {
+          return _values[slot];
+        }
+        slot = (slot + 1u) & _mask;
+      }
+      if (2u * (_size + 1u) > _keys.size()) {
+        Grow();
+        return Find(key);
+      }
+      ++_size;
+      _keys[slot] = key;
+      return _values[slot];
+    }
+
+    /// Index of @a key among the slots, the key must be present.
+    size_t GetSlot(const uint32_t key) const {
+      size_t slot = Hash(key);
+      while (_keys[slot] != key) {
+        DEBUG_ASSERT(_keys[slot] != EMPTY);
+        slot = (slot + 1u) & _mask;
+      }
+      return slot;
+    }
+
+    size_t GetSlotCount() const {
+      return _keys.size();
+    }
+
+    /// Calls @a functor(key, sums) for each object.
+    template <typename FunctorT>
+    void ForEach(FunctorT &&functor) const {
+      for (size_t slot = 0u; slot < _keys.size(); ++slot) {
+        if (_keys[slot] != EMPTY) {
+          functor(static_cast<uint32_t>(_keys[slot]), _values[slot]);
+        }
+      }
+    }
+
+  private:
+
+    static constexpr uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
+
+    size_t Hash(const uint32_t key) const {
+      return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> _shift);
+    }
+
+    void Reset(const size_t capacity) {
+      DEBUG_ASSERT((capacity & (capacity - 1u)) == 0u);
+      _keys.assign(capacity, EMPTY);
+      _values.assign(capacity, ObjectSums());
+      _mask = capacity - 1u;
+      _shift = 64u;
+      for (size_t c = capacity; c > 1u; c >>= 1u) {
+        --_shift;
+      }
+      _size = 0u;
+    }
+
+    void Grow() {
+      auto keys = std::move(_keys);
+      auto values = std::move(_values);
+      Reset(2u * keys.size());
+      for (size_t slot = 0u; slot < keys.size(); ++slot) {
+        if (keys[slot] != EMPTY) {
+          Find(static_cast<uint32_t>(keys[slot])) = values[slot];
+        }
+      }
+    }
+
+    std::vector<uint64_t> _keys;
+
+    std::vector<ObjectSums> _values;
+
+    size_t _size = 0u;
+
+    size_t _mask = 0u;
+
+    unsigned _shift = 64u;
+  };
+
+  constexpr uint64_t ObjectTable::EMPTY;
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  /// Yaw, in radians, of the principal axis of the xy distribution.
+  static float GetPrincipalYaw(const ObjectSums &sums) {
+    const double n = sums.count;
+    const double mx = sums.x / n;
+    const double my = sums.y / n;
+    const double cxx = sums.xx / n - mx * mx;
+    const double cxy = sums.xy / n - mx * my;
+    const double cyy = sums.yy / n - my * my;
+    return static_cast<float>(0.5 * std::atan2(2.0 * cxy, cxx - cyy));
+  }
+
+  // ===========================================================================
+  // -- SemanticLidarKernels ---------------------------------------------------
+  // ===========================================================================
+
+  void SemanticLidarKernels::AggregateObjects(
+      const SemanticLidarDetection *points,
+      const size_t count,
+      std::vector<SemanticLidarObject> &objects,
+      std::vector<uint32_t> *tag_histogram,
+      const ObjectAggregationOptions &options) {
+    DEBUG_ASSERT(count <= std::numeric_limits<uint32_t>::max());
+    objects.clear();
+    if (tag_histogram != nullptr) {
+      tag_histogram->clear();
+    }
+
+    // Group the points of each job.
+    const size_t jobs = (count + POINTS_PER_JOB - 1u) / POINTS_PER_JOB;
+    std::vector<ObjectTable> tables(jobs);
+    std::vector<std::vector<uint32_t>> histograms(tag_histogram != nullptr ? jobs : 0u);
+    ParallelFor(count, POINTS_PER_JOB, [&](const size_t job, const size_t begin, const size_t end) {
+      ObjectTable &table = tables[job];
+      // Consecutive points usually hit the same object.
+      uint32_t last_key = 0u;
+      ObjectSums *last = nullptr;
+      for (size_t i = begin; i < end; ++i) {
+        const SemanticLidarDetection &point = points[i];
+        if ((last == nullptr) || (point.object_idx != last_key)) {
+          last_key = point.object_idx;
+          last = &table.Find(last_key);
+        }
+        last->Add(point, static_cast<uint32_t>(i));
+      }
+      if (tag_histogram != nullptr) {
+        auto &histogram = histograms[job];
+        for (size_t i = begin; i < end; ++i) {
+          const uint32_t tag = points[i].object_tag;
+          if (tag >= histogram.size()) {
+            histogram.resize(tag + 1u, 0u);
+          }
+          ++histogram[tag];
+        }
+      }
+    });
+
+    // Merge the partial aggregates in job order.
+    ObjectTable merged;
+    for (const auto &table : tables) {
+      table.ForEach([&](uint32_t key, const ObjectSums &sums) {
+        merged.Find(key).Merge(sums);
+      });
+    }
+    if (tag_histogram != nullptr) {
+      for (const auto &histogram : histograms) {
+        if (histogram.size() > tag_histogram->size()) {
+          tag_histogram->resize(histogram.size(), 0u);
+        }
+        for (size_t tag = 0u; tag < histogram.size(); ++tag) {
+          (*tag_histogram)[tag] += histogram[tag];
+        }
+      }
+    }
+
+    // One record per object, sorted by object_idx.
+    std::vector<std::pair<uint32_t, const ObjectSums *>> entries;
+    entries.reserve(merged.size());
+    merged.ForEach([&](uint32_t key, const ObjectSums &sums) {
+      entries.emplace_back(key, &sums);
+    });
+    std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+      return lhs.first < rhs.first;
+    });
+    objects.reserve(entries.size());
+    std::vector<float> yaws;
+    yaws.reserve(entries.size());
+    for (const auto &entry : entries) {
+      const ObjectSums &sums = *entry.second;
+      SemanticLidarObject object;
+      object.object_idx = entry.first;
+      object.object_tag = sums.first_tag;
+      object.point_count = sums.count;
+      object.centroid = geom::Location(
+          static_cast<float>(sums.x / sums.count),
+          static_cast<float>(sums.y / sums.count),
+          static_cast<float>(sums.z / sums.count));
+      const geom::Location min(sums.min[0u], sums.min[1u], sums.min[2u]);
+      const geom::Location max(sums.max[0u], sums.max[1u], sums.max[2u]);
+      object.bounding_box = geom::BoundingBox(0.5f * (min + max), 0.5f * (max - min));
+      object.bounding_box.actor_id = object.object_idx;
+      objects.emplace_back(object);
+      yaws.emplace_back(GetPrincipalYaw(sums));
+    }
+
+    if (!options.oriented_boxes || objects.empty()) {
+      return;
+    }
+
+    // Second pass, extent of the points along the principal axes. The
+    // minimum and maximum do not depend on the order, so the jobs just
+    // merge their ranges.
+    struct Range {
+      float min_u = std::numeric_limits<float>::max();
+      float max_u = std::numeric_limits<float>::lowest();
+      float min_v = std::numeric_limits<float>::max();
+      float max_v = std::numeric_limits<float>::lowest();
+    };
+    std::vector<float> cos_yaw(yaws.size());
+    std::vector<float> sin_yaw(yaws.size());
+    for (size_t i = 0u; i < yaws.size(); ++i) {
+      cos_yaw[i] = std::cos(yaws[i]);
+      sin_yaw[i] = std::sin(yaws[i]);
+    }
+    std::vector<uint32_t> object_of_slot(merged.GetSlotCount(), 0u);
+    for (size_t i = 0u; i < objects.size(); ++i) {
+      object_of_slot[merged.GetSlot(objects[i].object_idx)] = static_cast<uint32_t>(i);
+    }
+    std::vector<std::vector<Range>> job_ranges(jobs);
+    ParallelFor(count, POINTS_PER_JOB, [&](const size_t job, const size_t begin, const size_t end) {
+      auto &ranges = job_ranges[job];
+      ranges.resize(objects.size());
+      uint32_t last_key = 0u;
+      size_t last = objects.size();
+      for (size_t i = begin; i < end; ++i) {
+        const SemanticLidarDetection &point = points[i];
+        if ((last == objects.size()) || (point.object_idx != last_key)) {
+          last_key = point.object_idx;
+          last = object_of_slot[merged.GetSlot(last_key)];
+        }
+        const float dx = point.point.x - objects[last].centroid.x;
+        const float dy = point.point.y - objects[last].centroid.y;
+        const float u = cos_yaw[last] * dx + sin_yaw[last] * dy;
+        const float v = cos_yaw[last] * dy - sin_yaw[last] * dx;
+        Range &range = ranges[last];
+        range.min_u = std::min(range.min_u, u);
+        range.max_u = std::max(range.max_u, u);
+        range.min_v = std::min(range.min_v, v);
+        range.max_v = std::max(range.max_v, v);
+      }
+    });
+    for (size_t i = 0u; i < objects.size(); ++i) {
+      Range range;
+      for (const auto &ranges : job_ranges) {
+        range.min_u = std::min(range.min_u, ranges[i].min_u);
+        range.max_u = std::max(range.max_u, ranges[i].max_u);
+        range.min_v = std::min(range.min_v, ranges[i].min_v);
+        range.max_v = std::max(range.max_v, ranges[i].max_v);
+      }
+      SemanticLidarObject &object = objects[i];
+      const float center_u = 0.5f * (range.min_u + range.max_u);
+      const float center_v = 0.5f * (range.min_v + range.max_v);
+      const geom::Location center(
+          object.centroid.x + cos_yaw[i] * center_u - sin_yaw[i] * center_v,
+          object.centroid.y + sin_yaw[i] * center_u + cos_yaw[i] * center_v,
+          object.bounding_box.location.z);
+      object.oriented_bounding_box = geom::BoundingBox(
+          center,
+          geom::Vector3D(
+              0.5f * (range.max_u - range.min_u),
+              0.5f * (range.max_v - range.min_v),
+              object.bounding_box.extent.z),
+          geom::Rotation(0.0f, geom::Math::ToDegrees(yaws[i]), 0.0f));
+      object.oriented_bounding_box.actor_id = object.object_idx;
+    }
+  }
+
+} // namespace pointcloud
+} // namespace carla
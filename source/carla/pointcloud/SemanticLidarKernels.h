@@ -0,0 +1,75 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/geom/BoundingBox.h"
+#include "carla/geom/Location.h"
+#include "carla/sensor/data/SemanticLidarData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace carla {
+namespace pointcloud {
+
+  /// Aggregate of the points of a semantic lidar sweep that hit the same
+  /// object.
+  struct SemanticLidarObject {
+    uint32_t object_idx = 0u;
+
+    /// Semantic tag of the first point of the object.
+    uint32_t object_tag = 0u;
+
+    uint32_t point_count = 0u;
+
+    geom::Location centroid;
+
+    /// Axis-aligned box of the points, its actor_id is the object index.
+    geom::BoundingBox bounding_box;
+
+    /// Box of the points rotated around the z axis to the principal axis of
+    /// their xy distribution, only if requested.
+    geom::BoundingBox oriented_bounding_box;
+  };
+
+  struct ObjectAggregationOptions {
+    /// Compute the oriented boxes, needs a second pass over the points.
+    bool oriented_boxes = true;
+  };
+
+  /// Kernels over the points of SemanticLidarMeasurement, reading the
+  /// detections in place.
+  class SemanticLidarKernels {
+  public:
+
+    /// Groups the points by object_idx in a single pass, each job adding its
+    /// points to its own open-addressing hash table; the tables are merged at
+    /// the end in job order, so the result does not depend on the number of
+    /// threads. Writes one record per object into @a objects, sorted by
+    /// object_idx, and, if given, the number of points of each semantic tag
+    /// into @a tag_histogram.
+    static void AggregateObjects(
+        const sensor::data::SemanticLidarDetection *points,
+        size_t count,
+        std::vector<SemanticLidarObject> &objects,
+        std::vector<uint32_t> *tag_histogram = nullptr,
+        const ObjectAggregationOptions &options = ObjectAggregationOptions());
+
+    /// Same as above reading the points of @a measurement.
+    template <typename MeasurementT>
+    static void AggregateObjects(
+        const MeasurementT &measurement,
+        std::vector<SemanticLidarObject> &objects,
+        std::vector<uint32_t> *tag_histogram = nullptr,
+        const ObjectAggregationOptions &options = ObjectAggregationOptions()) {
+      AggregateObjects(measurement.data(), measurement.size(), objects, tag_histogram, options);
+    }
+  };
+
+} // namespace pointcloud
+} // namespace carla
@@ -6,10 +6,12 @@
 
 #include "carla/road/Lane.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "carla/Debug.h"
 #include "carla/geom/Math.h"
+#include "carla/geom/PiecewiseCubicPolynomial.h"
 #include "carla/road/element/Geometry.h"
 #include "carla/road/element/RoadInfoElevation.h"
 #include "carla/road/element/RoadInfoGeometry.h"
@@ -128,6 +130,75 @@ namespace road {
     return std::make_pair(dist, tangent);
   }
 
+  /// Batched version of ComputeTotalLaneWidth, fills @a dist and @a tangent
+  /// (sized as @a s) keeping the same accumulation order per distance.
+  template <typename T>
+  static void ComputeTotalLaneWidths(
+      const T container,
+      const std::vector<double> &s,
+      const LaneId lane_id,
+      std::vector<double> &dist,
+      std::vector<double> &tangent) {
+
+    // lane_id can't be 0
+    RELEASE_ASSERT(lane_id != 0);
+
+    const bool negative_lane_id = lane_id < 0;
+    const double min_s = *std::min_element(s.begin(), s.end());
+    std::vector<double> current_dist(s.size());
+    std::vector<double> current_tang(s.size());
+    for (const auto &lane : container) {
+      const auto polynomial = geom::PiecewiseCubicPolynomial::FromInfos(
+          lane.second.template GetInfos<element::RoadInfoLaneWidth>());
+      RELEASE_ASSERT(polynomial.FindRecord(min_s) != polynomial.size());
+      polynomial.EvaluateWithTangent(
+          s.data(), s.size(), current_dist.data(), current_tang.data());
+      if (lane.first != lane_id) {
+        for (size_t i = 0u; i < s.size(); ++i) {
+          dist[i] += negative_lane_id ? current_dist[i] : -current_dist[i];
+          tangent[i] += negative_lane_id ? current_tang[i] : -current_tang[i];
+        }
+      } else {
+        for (size_t i = 0u; i < s.size(); ++i) {
+          const double half_dist = current_dist[i] * 0.5;
+          dist[i] += negative_lane_id ? half_dist : -half_dist;
+          tangent[i] += (negative_lane_id ? current_tang[i] : -current_tang[i]) * 0.5;
+        }
+        break;
+      }
+    }
+  }
+
+  /// Computes the lateral offset and tangent of the center of @a lane with
+  /// respect to the lane 0 for each distance in @a s.
+  static void ComputeLaneOffsets(
+      const Lane &lane,
+      const std::vector<double> &s,
+      std::vector<double> &dist,
+      std::vector<double> &tangent) {
+    const auto *lane_section = lane.GetLaneSection();
+    DEBUG_ASSERT(lane_section != nullptr);
+    const std::map<LaneId, Lane> &lanes = lane_section->GetLanes();
+
+    // check that lane_id exists on the current s
+    RELEASE_ASSERT(!lanes.empty());
+    RELEASE_ASSERT(lane.GetId() >= lanes.begin()->first);
+    RELEASE_ASSERT(lane.GetId() <= lanes.rbegin()->first);
+
+    dist.assign(s.size(), 0.0);
+    tangent.assign(s.size(), 0.0);
+    if (lane.GetId() < 0) {
+      // right lane
+      const auto side_lanes = MakeListView(
+          std::make_reverse_iterator(lanes.lower_bound(0)), lanes.rend());
+      ComputeTotalLaneWidths(side_lanes, s, lane.GetId(), dist, tangent);
+    } else if (lane.GetId() > 0) {
+      // left lane
+      const auto side_lanes = MakeListView(lanes.lower_bound(1), lanes.end());
+      ComputeTotalLaneWidths(side_lanes, s, lane.GetId(), dist, tangent);
+    }
+  }
+
   geom::Transform Lane::ComputeTransform(const double s) const {
     const Road *road = GetRoad();
     DEBUG_ASSERT(road != nullptr);
@@ -203,6 +274,67 @@ namespace road {
     return geom::Transform(dp.location, rot);
   }
 
+  std::vector<geom::Transform> Lane::ComputeTransforms(
+      const std::vector<double> &s) const {
+    std::vector<geom::Transform> result;
+    if (s.empty()) {
+      return result;
+    }
+    const Road *road = GetRoad();
+    DEBUG_ASSERT(road != nullptr);
+
+    // must s be smaller (or eq) than road length and bigger (or eq) than 0?
+    const auto minmax_s = std::minmax_element(s.begin(), s.end());
+    RELEASE_ASSERT(*minmax_s.second <= road->GetLength());
+    RELEASE_ASSERT(*minmax_s.first >= 0.0);
+
+    std::vector<double> lane_t_offsets;
+    std::vector<double> lane_tangents;
+    ComputeLaneOffsets(*this, s, lane_t_offsets, lane_tangents);
+
+    // Compute the tangent of the road's (lane 0) "laneOffset" on each s
+    std::vector<double> lane_offset_tangents(s.size());
+    geom::PiecewiseCubicPolynomial::FromInfos(
+        road->GetInfos<element::RoadInfoLaneOffset>())
+        .Tangent(s.data(), s.size(), lane_offset_tangents.data());
+
+    const auto directed_points = road->GetDirectedPointsIn(s);
+    const bool positive_direction = IsPositiveDirection();
+
+    result.reserve(s.size());
+    for (size_t i = 0u; i < s.size(); ++i) {
+      // Update the road tangent with the "laneOffset" information at current s
+      float lane_tangent = static_cast<float>(lane_tangents[i]);
+      lane_tangent -= static_cast<float>(lane_offset_tangents[i]);
+
+      element::DirectedPoint dp = directed_points[i];
+
+      // Transform from the center of the road to the center of the lane
+      dp.ApplyLateralOffset(static_cast<float>(lane_t_offsets[i]));
+
+      // Update the lane tangent with the road "laneOffset" at current s
+      dp.tangent -= lane_tangent;
+
+      // Unreal's Y axis hack
+      dp.location.y *= -1;
+      dp.tangent    *= -1;
+
+      geom::Rotation rot(
+          geom::Math::ToDegrees(static_cast<float>(dp.pitch)),
+          geom::Math::ToDegrees(static_cast<float>(dp.tangent)),
+          0.0f);
+
+      // Fix the direction of the possitive lanes
+      if (!positive_direction) {
+        rot.yaw += 180.0f;
+        rot.pitch = 360.0f - rot.pitch;
+      }
+
+      result.emplace_back(dp.location, rot);
+    }
+    return result;
+  }
+
   std::pair<geom::Vector3D, geom::Vector3D> Lane::GetCornerPositions(
       const double parameter_s, const float extra_width) const {
     const Road *road = GetRoad();
@@ -264,6 +396,61 @@ namespace road {
     return std::make_pair(dp_r.location, dp_l.location);
   }
 
+  std::vector<std::pair<geom::Vector3D, geom::Vector3D>> Lane::GetCornerPositions(
+      const std::vector<double> &parameter_s, const float extra_width) const {
+    std::vector<std::pair<geom::Vector3D, geom::Vector3D>> result;
+    if (parameter_s.empty()) {
+      return result;
+    }
+    const Road *road = GetRoad();
+    DEBUG_ASSERT(road != nullptr);
+
+    std::vector<double> s(parameter_s.size());
+    std::transform(parameter_s.begin(), parameter_s.end(), s.begin(), [road](double value) {
+      return geom::Math::Clamp(value, 0.0, road->GetLength());
+    });
+
+    std::vector<double> lane_t_offsets;
+    std::vector<double> lane_tangents;
+    ComputeLaneOffsets(*this, s, lane_t_offsets, lane_tangents);
+
+    std::vector<double> lane_widths(s.size());
+    geom::PiecewiseCubicPolynomial::FromInfos(GetInfos<element::RoadInfoLaneWidth>())
+        .Evaluate(s.data(), s.size(), lane_widths.data());
+
+    const auto directed_points = road->GetDirectedPointsIn(s);
+
+    result.reserve(s.size());
+    for (size_t i = 0u; i < s.size(); ++i) {
+      const float lane_t_offset = static_cast<float>(lane_t_offsets[i]);
+      float lane_width = static_cast<float>(lane_widths[i]) / 2.0f;
+      if (extra_width != 0.f && GetType() == Lane::LaneType::Driving) {
+        lane_width += extra_width;
+      }
+
+      // Two points on the center of the road on given s
+      element::DirectedPoint dp_r, dp_l;
+      dp_r = dp_l = directed_points[i];
+
+      // Transform from the center of the road to each of lane corners
+      dp_r.ApplyLateralOffset(lane_t_offset + lane_width);
+      dp_l.ApplyLateralOffset(lane_t_offset - lane_width);
+
+      // Unreal's Y axis hack
+      dp_r.location.y *= -1;
+      dp_l.location.y *= -1;
+
+      // Apply an offset to the Sidewalks
+      if (GetType() == LaneType::Sidewalk) {
+        dp_r.location.z += 0.1524f;
+        dp_l.location.z += 0.1524f;
+      }
+
+      result.emplace_back(dp_r.location, dp_l.location);
+    }
+    return result;
+  }
+
   bool Lane::IsPositiveDirection() const {
     const auto *road = GetRoad();
     DEBUG_ASSERT(road != nullptr);
@@ -115,10 +115,19 @@ namespace road {
 
     geom::Transform ComputeTransform(const double s) const;
 
+    /// Batched version of ComputeTransform for a list of distances, best
+    /// performance is achieved with @a s sorted in ascending order.
+    std::vector<geom::Transform> ComputeTransforms(const std::vector<double> &s) const;
+
     /// Computes the location of the edges given a s
     std::pair<geom::Vector3D, geom::Vector3D> GetCornerPositions(
       const double s, const float extra_width = 0.f) const;
 
+    /// Batched version of GetCornerPositions for a list of distances, best
+    /// performance is achieved with @a s sorted in ascending order.
+    std::vector<std::pair<geom::Vector3D, geom::Vector3D>> GetCornerPositions(
+      const std::vector<double> &s, const float extra_width = 0.f) const;
+
     bool IsPositiveDirection() const;
 
   private:
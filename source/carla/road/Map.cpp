@@ -6,6 +6,8 @@
 
 #include "carla/road/Map.h"
 #include "carla/Exception.h"
+#include "carla/ParallelFor.h"
+#include "carla/geom/DistanceField2D.h"
 #include "carla/geom/Math.h"
 #include "carla/geom/Vector3D.h"
 #include "carla/road/MeshFactory.h"
@@ -23,6 +25,7 @@
 
 #include "marchingcube/MeshReconstruction.h"
 
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -33,6 +36,8 @@
 #include <queue>
 #include <set>
 #include <cmath>
+#include <numeric>
+#include <tuple>
 
 namespace carla {
 namespace road {
@@ -156,6 +161,148 @@ namespace road {
     }
   }
 
+  /// Return a waypoint for each drivable lane every @a distance along @a road.
+  template <typename FuncT>
+  static void ForEachDrivableLaneEvery(const Road &road, double distance, FuncT &&func) {
+    for (double s = EPSILON; s < (road.GetLength() - EPSILON); s += distance) {
+      ForEachDrivableLaneAt(road, s, func);
+    }
+  }
+
+  /// Return the roads of @a data in iteration order, so they can be indexed
+  /// by the parallel generators.
+  static std::vector<const Road *> GetRoadList(const MapData &data) {
+    std::vector<const Road *> result;
+    result.reserve(data.GetRoads().size());
+    for (const auto &pair : data.GetRoads()) {
+      result.emplace_back(&pair.second);
+    }
+    return result;
+  }
+
+  static std::vector<const Junction *> GetJunctionList(const MapData &data) {
+    std::vector<const Junction *> result;
+    result.reserve(data.GetJunctions().size());
+    for (const auto &pair : data.GetJunctions()) {
+      result.emplace_back(&pair.second);
+    }
+    return result;
+  }
+
+  using LaneTypeMeshes = std::map<Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>;
+
+  /// Moves the meshes of @a src to the end of the list of the same lane type
+  /// in @a dst.
+  static void MoveMeshes(LaneTypeMeshes &src, LaneTypeMeshes &dst) {
+    for (auto &pair : src) {
+      auto &list = dst[pair.first];
+      list.insert(
+          list.end(),
+          std::make_move_iterator(pair.second.begin()),
+          std::make_move_iterator(pair.second.end()));
+    }
+  }
+
+  /// Counts the finished work items of a mesh generation and reports them to
+  /// a progress callback, one call at a time.
+  class MeshGenerationProgress {
+  public:
+
+    MeshGenerationProgress(const Map::ProgressCallback &callback, size_t total)
+      : _callback(callback),
+        _total(total) {}
+
+    void Step() {
+      if (_callback) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _callback(++_done, _total);
+      }
+    }
+
+  private:
+
+    const Map::ProgressCallback &_callback;
+
+    const size_t _total;
+
+    size_t _done = 0u;
+
+    std::mutex _mutex;
+  };
+
+  /// Size of the junction raster cells relative to the marching cubes.
+  static constexpr float JUNCTION_RASTER_CELLS_PER_CUBE = 0.25f;
+
+  /// Upper bound of the junction raster cells per side, for huge junctions.
+  static constexpr float JUNCTION_RASTER_MAX_CELLS = 2048.0f;
+
+  /// Distance between samples along the lanes rasterized for a junction.
+  static constexpr double JUNCTION_RASTER_LANE_STEP = 0.25;
+
+  /// Columns of marching cubes handed to each job.
+  static constexpr int JUNCTION_MARCH_BAND_CUBES = 16;
+
+  /// Rasterizes the driving lanes of the roads of @a junction, and of the
+  /// roads right before and after them, into a distance field covering
+  /// [@a min, @a min + @a size].
+  static geom::DistanceField2D RasterizeJunctionLanes(
+      const MapData &data,
+      const Junction &junction,
+      const geom::Vector2D &min,
+      const geom::Vector2D &size,
+      const float cell_size) {
+    // Ordered by id so overlapping lanes are always rasterized in the same
+    // order.
+    std::map<RoadId, const Road *> roads;
+    for (const auto &connection_pair : junction.GetConnections()) {
+      const auto &road = data.GetRoad(connection_pair.second.connecting_road);
+      roads.emplace(road.GetId(), &road);
+      for (const auto *next : road.GetNexts()) {
+        roads.emplace(next->GetId(), next);
+      }
+      for (const auto *prev : road.GetPrevs()) {
+        roads.emplace(prev->GetId(), prev);
+      }
+    }
+
+    geom::DistanceField2D raster(min, size, cell_size);
+    std::vector<double> samples;
+    for (const auto &road_pair : roads) {
+      const auto *road = road_pair.second;
+      for (const auto &lane_section : road->GetLaneSections()) {
+        for (const auto &lane_pair : lane_section.GetLanes()) {
+          const auto &lane = lane_pair.second;
+          if (lane.GetId() == 0 ||
+              (static_cast<uint32_t>(lane.GetType()) & static_cast<uint32_t>(Lane::LaneType::Driving)) == 0) {
+            continue;
+          }
+          const double s_start = lane.GetDistance() + EPSILON;
+          const double s_end = lane.GetDistance() + lane.GetLength() - EPSILON;
+          if (s_end <= s_start) {
+            continue;
+          }
+          const size_t num_steps = static_cast<size_t>(
+              std::ceil((s_end - s_start) / JUNCTION_RASTER_LANE_STEP));
+          samples.resize(num_steps + 1u);
+          for (size_t i = 0u; i < num_steps; ++i) {
+            samples[i] = s_start + static_cast<double>(i) * JUNCTION_RASTER_LANE_STEP;
+          }
+          samples.back() = s_end;
+          const auto corners = lane.GetCornerPositions(samples);
+          for (size_t i = 1u; i < corners.size(); ++i) {
+            raster.FillQuad(
+                corners[i - 1u].first,
+                corners[i - 1u].second,
+                corners[i].second,
+                corners[i].first);
+          }
+        }
+      }
+    }
+    raster.ComputeDistances();
+    return raster;
+  }
+
   /// Assumes road_id and section_id are valid.
   static bool IsLanePresent(const MapData &data, Waypoint waypoint) {
     const auto &section = data.GetRoad(waypoint.road_id).GetLaneSectionById(waypoint.section_id);
@@ -278,6 +425,44 @@ namespace road {
     return GetLane(waypoint).ComputeTransform(waypoint.s);
   }
 
+  std::vector<geom::Transform> Map::ComputeTransforms(
+      const std::vector<Waypoint> &waypoints) const {
+    std::vector<geom::Transform> result(waypoints.size());
+
+    // Sort by lane and distance so each lane is evaluated in a single batch
+    std::vector<size_t> order(waypoints.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      const auto &a = waypoints[lhs];
+      const auto &b = waypoints[rhs];
+      return std::tie(a.road_id, a.section_id, a.lane_id, a.s) <
+             std::tie(b.road_id, b.section_id, b.lane_id, b.s);
+    });
+
+    std::vector<double> s;
+    size_t begin = 0u;
+    while (begin < order.size()) {
+      const auto &first = waypoints[order[begin]];
+      size_t end = begin + 1u;
+      while (end < order.size() &&
+          waypoints[order[end]].road_id == first.road_id &&
+          waypoints[order[end]].section_id == first.section_id &&
+          waypoints[order[end]].lane_id == first.lane_id) {
+        ++end;
+      }
+      s.clear();
+      for (size_t i = begin; i < end; ++i) {
+        s.push_back(waypoints[order[i]].s);
+      }
+      const auto transforms = GetLane(first).ComputeTransforms(s);
+      for (size_t i = begin; i < end; ++i) {
+        result[order[i]] = transforms[i - begin];
+      }
+      begin = end;
+    }
+    return result;
+  }
+
   // ===========================================================================
   // -- Map: Road information --------------------------------------------------
   // ===========================================================================
@@ -783,18 +968,49 @@ namespace road {
 
   std::vector<Waypoint> Map::GenerateWaypoints(const double distance) const {
     RELEASE_ASSERT(distance > 0.0);
+    const auto roads = GetRoadList(_data);
+    // Every road fills a list of its own, the lists are joined afterwards in
+    // the order of the roads.
+    std::vector<std::vector<Waypoint>> waypoints_per_road(roads.size());
+    ParallelFor(roads.size(), [&](const size_t i) {
+      ForEachDrivableLaneEvery(*roads[i], distance, [&](auto &&waypoint) {
+        waypoints_per_road[i].emplace_back(waypoint);
+      });
+    });
+    size_t count = 0u;
+    for (const auto &waypoints : waypoints_per_road) {
+      count += waypoints.size();
+    }
     std::vector<Waypoint> result;
-    for (const auto &pair : _data.GetRoads()) {
-      const auto &road = pair.second;
-      for (double s = EPSILON; s < (road.GetLength() - EPSILON); s += distance) {
-        ForEachDrivableLaneAt(road, s, [&](auto &&waypoint) {
-          result.emplace_back(waypoint);
-        });
-      }
+    result.reserve(count);
+    for (const auto &waypoints : waypoints_per_road) {
+      result.insert(result.end(), waypoints.begin(), waypoints.end());
     }
     return result;
   }
 
+  void Map::GenerateWaypointsInChunks(
+      const double distance,
+      const size_t chunk_size,
+      const std::function<void(const std::vector<Waypoint> &)> &callback) const {
+    RELEASE_ASSERT(distance > 0.0);
+    RELEASE_ASSERT(chunk_size > 0u);
+    std::vector<Waypoint> chunk;
+    chunk.reserve(chunk_size);
+    for (const auto &pair : _data.GetRoads()) {
+      ForEachDrivableLaneEvery(pair.second, distance, [&](auto &&waypoint) {
+        chunk.emplace_back(waypoint);
+        if (chunk.size() == chunk_size) {
+          callback(chunk);
+          chunk.clear();
+        }
+      });
+    }
+    if (!chunk.empty()) {
+      callback(chunk);
+    }
+  }
+
   std::vector<Waypoint> Map::GenerateWaypointsOnRoadEntries(Lane::LaneType lane_type) const {
     std::vector<Waypoint> result;
     for (const auto &pair : _data.GetRoads()) {
@@ -855,24 +1071,34 @@ namespace road {
   }
 
   std::vector<std::pair<Waypoint, Waypoint>> Map::GenerateTopology() const {
-    std::vector<std::pair<Waypoint, Waypoint>> result;
-    for (const auto &pair : _data.GetRoads()) {
-      const auto &road = pair.second;
-      ForEachDrivableLane(road, [&](auto &&waypoint) {
-        auto successors = GetSuccessors(waypoint);
-        if (successors.size() == 0){
+    using Edge = std::pair<Waypoint, Waypoint>;
+    const auto roads = GetRoadList(_data);
+    std::vector<std::vector<Edge>> edges_per_road(roads.size());
+    ParallelFor(roads.size(), [&](const size_t i) {
+      auto &edges = edges_per_road[i];
+      ForEachDrivableLane(*roads[i], [&](auto &&waypoint) {
+        const auto successors = GetSuccessors(waypoint);
+        if (successors.empty()) {
           auto distance = static_cast<float>(GetDistanceAtEndOfLane(GetLane(waypoint)));
           auto last_waypoint = GetWaypoint(waypoint.road_id, waypoint.lane_id, distance);
-          if (last_waypoint.has_value()){
-            result.push_back({waypoint, *last_waypoint});
+          if (last_waypoint.has_value()) {
+            edges.emplace_back(waypoint, *last_waypoint);
           }
-        }
-        else{
-          for (auto &&successor : GetSuccessors(waypoint)) {
-            result.push_back({waypoint, successor});
+        } else {
+          for (const auto &successor : successors) {
+            edges.emplace_back(waypoint, successor);
           }
         }
       });
+    });
+    size_t total = 0u;
+    for (const auto &edges : edges_per_road) {
+      total += edges.size();
+    }
+    std::vector<Edge> result;
+    result.reserve(total);
+    for (const auto &edges : edges_per_road) {
+      result.insert(result.end(), edges.begin(), edges.end());
     }
     return result;
   }
@@ -1146,18 +1372,26 @@ namespace road {
     mesh_factory.road_param.resolution = static_cast<float>(distance);
     mesh_factory.road_param.extra_lane_width = extra_width;
 
-    // Generate roads outside junctions
+    std::vector<const Road *> roads;
     for (auto &&pair : _data.GetRoads()) {
-      const auto &road = pair.second;
-      if (road.IsJunction()) {
-        continue;
+      if (!pair.second.IsJunction()) {
+        roads.emplace_back(&pair.second);
       }
-      out_mesh += *mesh_factory.Generate(road);
     }
-
-    // Generate roads within junctions and smooth them
-    for (const auto &junc_pair : _data.GetJunctions()) {
-      const auto &junction = junc_pair.second;
+    const auto junctions = GetJunctionList(_data);
+
+    // Each road and junction is generated into its own mesh, and the meshes
+    // are concatenated in map order afterwards, so the result does not depend
+    // on the scheduling.
+    std::vector<std::unique_ptr<geom::Mesh>> meshes(roads.size() + junctions.size());
+    ParallelFor(meshes.size(), [&](const size_t i) {
+      // Generate roads outside junctions
+      if (i < roads.size()) {
+        meshes[i] = mesh_factory.Generate(*roads[i]);
+        return;
+      }
+      // Generate roads within junctions and smooth them
+      const auto &junction = *junctions[i - roads.size()];
       std::vector<std::unique_ptr<geom::Mesh>> lane_meshes;
       for(const auto &connection_pair : junction.GetConnections()) {
         const auto &connection = connection_pair.second;
@@ -1169,16 +1403,15 @@ namespace road {
         }
       }
       if(smooth_junctions) {
-        out_mesh += *mesh_factory.MergeAndSmooth(lane_meshes);
+        meshes[i] = mesh_factory.MergeAndSmooth(lane_meshes);
       } else {
-        geom::Mesh junction_mesh;
-        for(auto& lane : lane_meshes) {
-          junction_mesh += *lane;
-        }
-        out_mesh += junction_mesh;
+        auto junction_mesh = std::make_unique<geom::Mesh>();
+        junction_mesh->Append(std::move(lane_meshes));
+        meshes[i] = std::move(junction_mesh);
       }
-    }
+    });
 
+    out_mesh.Append(std::move(meshes));
     return out_mesh;
   }
 
@@ -1186,25 +1419,22 @@ namespace road {
   std::vector<std::unique_ptr<geom::Mesh>> Map::GenerateChunkedMesh(
       const rpc::OpendriveGenerationParameters& params) const {
     geom::MeshFactory mesh_factory(params);
-    std::vector<std::unique_ptr<geom::Mesh>> out_mesh_list;
 
-    std::unordered_map<JuncId, geom::Mesh> junction_map;
-    for (auto &&pair : _data.GetRoads()) {
-      const auto &road = pair.second;
-      if (!road.IsJunction()) {
-        std::vector<std::unique_ptr<geom::Mesh>> road_mesh_list =
-            mesh_factory.GenerateAllWithMaxLen(road);
+    const auto roads = GetRoadList(_data);
+    const auto junctions = GetJunctionList(_data);
 
-        out_mesh_list.insert(
-            out_mesh_list.end(),
-            std::make_move_iterator(road_mesh_list.begin()),
-            std::make_move_iterator(road_mesh_list.end()));
+    // Each job fills its own list, concatenated in map order afterwards.
+    std::vector<std::vector<std::unique_ptr<geom::Mesh>>> meshes_per_job(
+        roads.size() + junctions.size());
+    ParallelFor(meshes_per_job.size(), [&](const size_t i) {
+      if (i < roads.size()) {
+        if (!roads[i]->IsJunction()) {
+          meshes_per_job[i] = mesh_factory.GenerateAllWithMaxLen(*roads[i]);
+        }
+        return;
       }
-    }
-
-    // Generate roads within junctions and smooth them
-    for (const auto &junc_pair : _data.GetJunctions()) {
-      const auto &junction = junc_pair.second;
+      // Generate roads within junctions and smooth them
+      const auto &junction = *junctions[i - roads.size()];
       std::vector<std::unique_ptr<geom::Mesh>> lane_meshes;
       std::vector<std::unique_ptr<geom::Mesh>> sidewalk_lane_meshes;
       for(const auto &connection_pair : junction.GetConnections()) {
@@ -1223,20 +1453,22 @@ namespace road {
       }
       if(params.smooth_junctions) {
         auto merged_mesh = mesh_factory.MergeAndSmooth(lane_meshes);
-        for(auto& lane : sidewalk_lane_meshes) {
-          *merged_mesh += *lane;
-        }
-        out_mesh_list.push_back(std::move(merged_mesh));
+        merged_mesh->Append(std::move(sidewalk_lane_meshes));
+        meshes_per_job[i].push_back(std::move(merged_mesh));
       } else {
         std::unique_ptr<geom::Mesh> junction_mesh = std::make_unique<geom::Mesh>();
-        for(auto& lane : lane_meshes) {
-          *junction_mesh += *lane;
-        }
-        for(auto& lane : sidewalk_lane_meshes) {
-          *junction_mesh += *lane;
-        }
-        out_mesh_list.push_back(std::move(junction_mesh));
+        junction_mesh->Append(std::move(lane_meshes));
+        junction_mesh->Append(std::move(sidewalk_lane_meshes));
+        meshes_per_job[i].push_back(std::move(junction_mesh));
       }
+    });
+
+    std::vector<std::unique_ptr<geom::Mesh>> out_mesh_list;
+    for (auto &job_meshes : meshes_per_job) {
+      out_mesh_list.insert(
+          out_mesh_list.end(),
+          std::make_move_iterator(job_meshes.begin()),
+          std::make_move_iterator(job_meshes.end()));
     }
 
     auto min_pos = geom::Vector2D(
@@ -1252,17 +1484,19 @@ namespace road {
     }
     size_t mesh_amount_x = static_cast<size_t>((max_pos.x - min_pos.x)/params.max_road_length) + 1;
     size_t mesh_amount_y = static_cast<size_t>((max_pos.y - min_pos.y)/params.max_road_length) + 1;
-    std::vector<std::unique_ptr<geom::Mesh>> result;
-    result.reserve(mesh_amount_x*mesh_amount_y);
-    for (size_t i = 0; i < mesh_amount_x*mesh_amount_y; ++i) {
-      result.emplace_back(std::make_unique<geom::Mesh>());
-    }
+    std::vector<std::vector<std::unique_ptr<geom::Mesh>>> meshes_per_chunk(
+        mesh_amount_x*mesh_amount_y);
     for (auto & mesh : out_mesh_list) {
       auto vertex = mesh->GetVertices().front();
       size_t x_pos = static_cast<size_t>((vertex.x - min_pos.x) / params.max_road_length);
       size_t y_pos = static_cast<size_t>((vertex.y - min_pos.y) / params.max_road_length);
-      *(result[x_pos + mesh_amount_x*y_pos]) += *mesh;
+      meshes_per_chunk[x_pos + mesh_amount_x*y_pos].push_back(std::move(mesh));
     }
+    std::vector<std::unique_ptr<geom::Mesh>> result(meshes_per_chunk.size());
+    ParallelFor(result.size(), [&](const size_t i) {
+      result[i] = std::make_unique<geom::Mesh>();
+      result[i]->Append(std::move(meshes_per_chunk[i]));
+    });
 
     return result;
   }
@@ -1270,70 +1504,35 @@ namespace road {
   std::map<road::Lane::LaneType , std::vector<std::unique_ptr<geom::Mesh>>>
     Map::GenerateOrderedChunkedMeshInLocations( const rpc::OpendriveGenerationParameters& params,
                                      const geom::Vector3D& minpos,
-                                     const geom::Vector3D& maxpos) const
+                                     const geom::Vector3D& maxpos,
+                                     const ProgressCallback& progress) const
   {
-
     geom::MeshFactory mesh_factory(params);
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> road_out_mesh_list;
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> junction_out_mesh_list;
-
-    std::thread juntction_thread( &Map::GenerateJunctions, this, mesh_factory, params,
-      minpos, maxpos, &junction_out_mesh_list);
 
     const std::vector<RoadId> RoadsIDToGenerate = FilterRoadsByPosition(minpos, maxpos);
-
-    size_t num_roads = RoadsIDToGenerate.size();
-    size_t num_roads_per_thread = 30;
-    size_t num_threads = (num_roads / num_roads_per_thread) + 1;
-    num_threads = num_threads > 1 ? num_threads : 1;
-    std::vector<std::thread> workers;
-    std::mutex write_mutex;
-    std::cout << "Generating " << std::to_string(num_roads) << " roads" << std::endl;
-
-    for ( size_t i = 0; i < num_threads; ++i ) {
-      std::thread neworker(
-        [this, &write_mutex, &mesh_factory, &RoadsIDToGenerate, &road_out_mesh_list, i, num_roads_per_thread]() {
-        std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> Current =
-          std::move(GenerateRoadsMultithreaded(mesh_factory, RoadsIDToGenerate,i, num_roads_per_thread ));
-        std::lock_guard<std::mutex> guard(write_mutex);
-        for ( auto&& pair : Current ) {
-          if (road_out_mesh_list.find(pair.first) != road_out_mesh_list.end()) {
-            road_out_mesh_list[pair.first].insert(road_out_mesh_list[pair.first].end(),
-              std::make_move_iterator(pair.second.begin()),
-              std::make_move_iterator(pair.second.end()));
-          } else {
-            road_out_mesh_list[pair.first] = std::move(pair.second);
-          }
+    const std::vector<JuncId> JunctionsToGenerate = FilterJunctionsByPosition(minpos, maxpos);
+    const size_t num_roads = RoadsIDToGenerate.size();
+
+    // One job per road and junction, each with its own output, merged in
+    // order afterwards so the chunk order is reproducible.
+    std::vector<LaneTypeMeshes> meshes_per_job(num_roads + JunctionsToGenerate.size());
+    MeshGenerationProgress progress_counter(progress, meshes_per_job.size());
+    ParallelFor(meshes_per_job.size(), [&](const size_t i) {
+      if (i < num_roads) {
+        const auto& road = _data.GetRoads().at(RoadsIDToGenerate[i]);
+        if (!road.IsJunction()) {
+          mesh_factory.GenerateAllOrderedWithMaxLen(road, meshes_per_job[i]);
         }
-      });
-      workers.push_back(std::move(neworker));
-    }
-
-    for (size_t i = 0; i < workers.size(); ++i) {
-      workers[i].join();
-    }
-    workers.clear();
-    for (size_t i = 0; i < workers.size(); ++i) {
-      if (workers[i].joinable()) {
-        workers[i].join();
+      } else {
+        GenerateSingleJunction(mesh_factory, JunctionsToGenerate[i - num_roads], &meshes_per_job[i]);
       }
-    }
+      progress_counter.Step();
+    });
 
-    juntction_thread.join();
-    for (auto&& pair : junction_out_mesh_list) {
-      if (road_out_mesh_list.find(pair.first) != road_out_mesh_list.end())
-      {
-        road_out_mesh_list[pair.first].insert(road_out_mesh_list[pair.first].end(),
-          std::make_move_iterator(pair.second.begin()),
-          std::make_move_iterator(pair.second.end()));
-      }
-      else
-      {
-        road_out_mesh_list[pair.first] = std::move(pair.second);
-      }
+    LaneTypeMeshes road_out_mesh_list;
+    for (auto& job_meshes : meshes_per_job) {
+      MoveMeshes(job_meshes, road_out_mesh_list);
     }
-    std::cout << "Generated " << std::to_string(num_roads) << " roads" << std::endl;
-
     return road_out_mesh_list;
   }
 
@@ -1461,94 +1660,29 @@ namespace road {
       geom::deformation::GetBumpDeformation(posx,posy);
   }
 
-  std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>
-      Map::GenerateRoadsMultithreaded( const carla::geom::MeshFactory& mesh_factory,
-                                        const std::vector<RoadId>& RoadsId,
-                                        const size_t index, const size_t number_of_roads_per_thread) const
-  {
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> out;
-
-    size_t start = index * number_of_roads_per_thread;
-    size_t endoffset = (index+1) * number_of_roads_per_thread;
-    size_t end = RoadsId.size();
-
-    for (int i = start; i < endoffset && i < end; ++i) {
-      const auto& road = _data.GetRoads().at(RoadsId[i]);
-      if (!road.IsJunction()) {
-        mesh_factory.GenerateAllOrderedWithMaxLen(road, out);
-      }
-    }
-    std::cout << "Generated roads from " + std::to_string(index * number_of_roads_per_thread) + " to " + std::to_string((index+1) * number_of_roads_per_thread ) << std::endl;
-    return out;
-  }
-
   void Map::GenerateJunctions(const carla::geom::MeshFactory& mesh_factory,
-    const rpc::OpendriveGenerationParameters& params,
+    const rpc::OpendriveGenerationParameters&,
     const geom::Vector3D& minpos,
     const geom::Vector3D& maxpos,
     std::map<road::Lane::LaneType,
-    std::vector<std::unique_ptr<geom::Mesh>>>* junction_out_mesh_list) const {
-
-    std::vector<JuncId> JunctionsToGenerate = FilterJunctionsByPosition(minpos, maxpos);
-    size_t num_junctions = JunctionsToGenerate.size();
-    std::cout << "Generating " << std::to_string(num_junctions) << " junctions" << std::endl;
-    size_t junctionindex = 0;
-    size_t num_junctions_per_thread = 5;
-    size_t num_threads = (num_junctions / num_junctions_per_thread) + 1;
-    num_threads = num_threads > 1 ? num_threads : 1;
-    std::vector<std::thread> workers;
-    std::mutex write_mutex;
-
-    for ( size_t i = 0; i < num_threads; ++i ) {
-      std::thread neworker(
-        [this, &write_mutex, &mesh_factory, &junction_out_mesh_list, JunctionsToGenerate, i, num_junctions_per_thread, num_junctions]() {
-        std::map<road::Lane::LaneType,
-          std::vector<std::unique_ptr<geom::Mesh>>> junctionsofthisthread;
-
-        size_t minimum = 0;
-        if( (i + 1) * num_junctions_per_thread < num_junctions ){
-          minimum = (i + 1) * num_junctions_per_thread;
-        }else{
-          minimum = num_junctions;
-        }
-        std::cout << "Generating Junctions between  " << std::to_string(i * num_junctions_per_thread) << " and " << std::to_string(minimum) << std::endl;
-
-        for ( size_t junctionindex = i * num_junctions_per_thread;
-                        junctionindex < minimum;
-                        ++junctionindex )
-        {
-          GenerateSingleJunction(mesh_factory, JunctionsToGenerate[junctionindex], &junctionsofthisthread);
-        }
-        std::cout << "Generated Junctions between  " << std::to_string(i * num_junctions_per_thread) << " and " << std::to_string(minimum) << std::endl;
-        std::lock_guard<std::mutex> guard(write_mutex);
-        for ( auto&& pair : junctionsofthisthread ) {
-          if ((*junction_out_mesh_list).find(pair.first) != (*junction_out_mesh_list).end()) {
-            (*junction_out_mesh_list)[pair.first].insert((*junction_out_mesh_list)[pair.first].end(),
-              std::make_move_iterator(pair.second.begin()),
-              std::make_move_iterator(pair.second.end()));
-          } else {
-            (*junction_out_mesh_list)[pair.first] = std::move(pair.second);
-          }
-        }
-      });
-      workers.push_back(std::move(neworker));
-    }
-
-    for (size_t i = 0; i < workers.size(); ++i) {
-      workers[i].join();
-    }
-    workers.clear();
-    for (size_t i = 0; i < workers.size(); ++i) {
-      if (workers[i].joinable()) {
-        workers[i].join();
-      }
+    std::vector<std::unique_ptr<geom::Mesh>>>* junction_out_mesh_list,
+    const ProgressCallback& progress) const {
+
+    const std::vector<JuncId> JunctionsToGenerate = FilterJunctionsByPosition(minpos, maxpos);
+    std::vector<LaneTypeMeshes> meshes_per_junction(JunctionsToGenerate.size());
+    MeshGenerationProgress progress_counter(progress, meshes_per_junction.size());
+    ParallelFor(meshes_per_junction.size(), [&](const size_t i) {
+      GenerateSingleJunction(mesh_factory, JunctionsToGenerate[i], &meshes_per_junction[i]);
+      progress_counter.Step();
+    });
+    for (auto& junction_meshes : meshes_per_junction) {
+      MoveMeshes(junction_meshes, *junction_out_mesh_list);
     }
   }
 
   std::vector<JuncId> Map::FilterJunctionsByPosition( const geom::Vector3D& minpos,
     const geom::Vector3D& maxpos ) const {
 
-    std::cout << "Filtered from " + std::to_string(_data.GetJunctions().size() ) + " junctions " << std::endl;
     std::vector<JuncId> ToReturn;
     for( auto& junction : _data.GetJunctions() ){
       geom::Location junctionLocation = junction.second.GetBoundingBox().location;
@@ -1557,7 +1691,6 @@ namespace road {
         ToReturn.push_back(junction.first);
       }
     }
-    std::cout << "To " + std::to_string(ToReturn.size() ) + " junctions " << std::endl;
 
     return ToReturn;
   }
@@ -1566,7 +1699,6 @@ namespace road {
     const geom::Vector3D& maxpos ) const {
 
     std::vector<RoadId> ToReturn;
-    std::cout << "Filtered from " + std::to_string(_data.GetRoads().size() ) + " roads " << std::endl;
     for( auto& road : _data.GetRoads() ){
       auto &&lane_section = (*road.second.GetLaneSections().begin());
       const road::Lane* lane = road.second.IsRHT() ? lane_section.GetLane(-1) : lane_section.GetLane(1);
@@ -1579,85 +1711,111 @@ namespace road {
         }
       }
     }
-    std::cout << "To " + std::to_string(ToReturn.size() ) + " roads " << std::endl;
     return ToReturn;
   }
 
   std::unique_ptr<geom::Mesh> Map::SDFToMesh(const road::Junction& jinput,
-    const std::vector<geom::Vector3D>& sdfinput,
-    int grid_cells_per_dim) const {
+    const std::vector<geom::Vector3D>& /* sdfinput */,
+    int /* grid_cells_per_dim */) const {
 
-    int junctionid = jinput.GetId();
     float box_extraextension_factor = 1.2f;
     const double CubeSize = 0.5;
     carla::geom::BoundingBox bb = jinput.GetBoundingBox();
     carla::geom::Vector3D MinOffset = bb.location - geom::Location(bb.extent * box_extraextension_factor);
-    carla::geom::Vector3D MaxOffset = bb.location + geom::Location(bb.extent * box_extraextension_factor);
-    carla::geom::Vector3D OffsetPerCell = ( bb.extent * box_extraextension_factor * 2 ) / grid_cells_per_dim;
 
-    auto junctionsdf = [this, OffsetPerCell, CubeSize, MinOffset, junctionid](MeshReconstruction::Vec3 const& pos)
+    MeshReconstruction::Rect3 domain;
+    domain.min = { MinOffset.x, MinOffset.y, MinOffset.z };
+    domain.size = { bb.extent.x * box_extraextension_factor * 2, bb.extent.y * box_extraextension_factor * 2, 0.4 };
+
+    // Sample the driving lanes once into a distance field, so the SDF below
+    // is a couple of lookups instead of several rtree queries per sample.
+    const float raster_size = static_cast<float>(std::max(domain.size.x, domain.size.y));
+    const float cell_size = std::max(
+        static_cast<float>(CubeSize) * JUNCTION_RASTER_CELLS_PER_CUBE,
+        raster_size / JUNCTION_RASTER_MAX_CELLS);
+    const geom::DistanceField2D raster = RasterizeJunctionLanes(
+        _data,
+        jinput,
+        geom::Vector2D(MinOffset.x, MinOffset.y),
+        geom::Vector2D(static_cast<float>(domain.size.x), static_cast<float>(domain.size.y)),
+        cell_size);
+    if (!raster.HasOccupiedCells()) {
+      return std::make_unique<geom::Mesh>();
+    }
+
+    auto junctionsdf = [&raster, CubeSize](MeshReconstruction::Vec3 const& pos)
     {
-      geom::Vector3D worldloc(pos.x, pos.y, pos.z);
-      boost::optional<element::Waypoint> CheckingWaypoint = GetWaypoint(geom::Location(worldloc), 0x1 << 1);
-      if (CheckingWaypoint) {
+      if (raster.IsOccupied(pos.x, pos.y)) {
         if ( pos.z < 0.2) {
           return 0.0;
         } else {
-          return -abs(pos.z);
+          return -std::abs(pos.z);
         }
       }
-      boost::optional<element::Waypoint> InRoadWaypoint = GetClosestWaypointOnRoad(geom::Location(worldloc), 0x1 << 1);
-      geom::Transform InRoadWPTransform = ComputeTransform(*InRoadWaypoint);
-
-      geom::Vector3D director = geom::Location(worldloc) - (InRoadWPTransform.location);
-      geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * GetLaneWidth(*InRoadWaypoint) * 0.5f);
-
-      geom::Vector3D Distance = laneborder - worldloc;
-      if (Distance.Length2D() < CubeSize * 1.1 && pos.z < 0.2) {
+      const double distance_2d = raster.GetDistance(pos.x, pos.y);
+      if (distance_2d < CubeSize * 1.1 && pos.z < 0.2) {
         return 0.0;
       }
-      return Distance.Length() * -1.0;
+      const double distance_z = pos.z - raster.GetNearestOccupied(pos.x, pos.y).z;
+      return -std::sqrt(distance_2d * distance_2d + distance_z * distance_z);
+    };
+    // The normals of the reconstruction are discarded, skip the numerical
+    // gradient and its six extra SDF evaluations per vertex.
+    auto junctiongrad = [](MeshReconstruction::Vec3 const&) {
+      return MeshReconstruction::Vec3{0.0, 0.0, 1.0};
     };
 
-    double gridsizeindouble = grid_cells_per_dim;
-    MeshReconstruction::Rect3 domain;
-    domain.min = { MinOffset.x, MinOffset.y, MinOffset.z };
-    domain.size = { bb.extent.x * box_extraextension_factor * 2, bb.extent.y * box_extraextension_factor * 2, 0.4 };
-
+    // March the domain in independent slabs, one per z-slice and band of
+    // columns, and concatenate them in order.
     MeshReconstruction::Vec3 cubeSize{ CubeSize, CubeSize, 0.2 };
-    auto mesh = MeshReconstruction::MarchCube(junctionsdf, domain, cubeSize );
-    carla::geom::Rotation inverse = bb.rotation;
-    carla::geom::Vector3D trasltation = bb.location;
-    geom::Mesh out_mesh;
-
-    for (auto& cv : mesh.vertices) {
-      geom::Vector3D newvertex;
-      newvertex.x = cv.x;
-      newvertex.y = cv.y;
-      newvertex.z = cv.z;
-      out_mesh.AddVertex(newvertex);
+    const int NumX = static_cast<int>(std::ceil(domain.size.x / cubeSize.x));
+    const int NumZ = static_cast<int>(std::ceil(domain.size.z / cubeSize.z));
+    const int NumBands = (NumX + JUNCTION_MARCH_BAND_CUBES - 1) / JUNCTION_MARCH_BAND_CUBES;
+    std::vector<MeshReconstruction::Mesh> slabs(static_cast<size_t>(NumZ * NumBands));
+    ParallelFor(slabs.size(), [&](const size_t i) {
+      const int iz = static_cast<int>(i) / NumBands;
+      const int ix = (static_cast<int>(i) % NumBands) * JUNCTION_MARCH_BAND_CUBES;
+      const int num_cubes_x = std::min(JUNCTION_MARCH_BAND_CUBES, NumX - ix);
+      MeshReconstruction::Rect3 slab;
+      slab.min = { domain.min.x + ix * cubeSize.x, domain.min.y, domain.min.z + iz * cubeSize.z };
+      // Half a cube short so the rounding of MarchCube never adds a cube.
+      slab.size = { (num_cubes_x - 0.5) * cubeSize.x, domain.size.y, 0.5 * cubeSize.z };
+      slabs[i] = MeshReconstruction::MarchCube(junctionsdf, slab, cubeSize, 0.0, junctiongrad);
+    });
+
+    size_t num_vertices = 0u;
+    size_t num_triangles = 0u;
+    for (const auto& slab : slabs) {
+      num_vertices += slab.vertices.size();
+      num_triangles += slab.triangles.size();
     }
-
-    auto finalvertices = out_mesh.GetVertices();
-    for (auto ct : mesh.triangles) {
-      out_mesh.AddIndex(ct[1] + 1);
-      out_mesh.AddIndex(ct[0] + 1);
-      out_mesh.AddIndex(ct[2] + 1);
+    geom::Mesh out_mesh;
+    out_mesh.Reserve(num_vertices, 3u * num_triangles);
+    for (const auto& slab : slabs) {
+      const size_t first_index = out_mesh.GetVerticesNum() + 1u;
+      for (auto& cv : slab.vertices) {
+        geom::Vector3D newvertex;
+        newvertex.x = cv.x;
+        newvertex.y = cv.y;
+        newvertex.z = cv.z;
+        out_mesh.AddVertex(newvertex);
+      }
+      for (auto ct : slab.triangles) {
+        out_mesh.AddIndex(first_index + ct[1]);
+        out_mesh.AddIndex(first_index + ct[0]);
+        out_mesh.AddIndex(first_index + ct[2]);
+      }
     }
 
-    for (auto& cv : out_mesh.GetVertices() ) {
-      boost::optional<element::Waypoint> CheckingWaypoint = GetWaypoint(geom::Location(cv), 0x1 << 1);
-      if (!CheckingWaypoint)
-      {
-        boost::optional<element::Waypoint> InRoadWaypoint = GetClosestWaypointOnRoad(geom::Location(cv), 0x1 << 1);
-        geom::Transform InRoadWPTransform = ComputeTransform(*InRoadWaypoint);
-
-        geom::Vector3D director = geom::Location(cv) - (InRoadWPTransform.location);
-        geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * GetLaneWidth(*InRoadWaypoint) * 0.5f);
-        cv = laneborder;
+    // Snap the vertices that fall outside the road to the lane border.
+    auto& vertices = out_mesh.GetVertices();
+    ParallelFor(vertices.size(), [&](const size_t i) {
+      auto& cv = vertices[i];
+      if (!raster.IsOccupied(cv.x, cv.y)) {
+        cv = raster.GetNearestOccupied(cv.x, cv.y);
       }
-    }
-    return std::make_unique<geom::Mesh>(out_mesh);
+    });
+    return std::make_unique<geom::Mesh>(std::move(out_mesh));
   }
 
   void Map::GenerateSingleJunction(const carla::geom::MeshFactory& mesh_factory,
@@ -1691,9 +1849,7 @@ namespace road {
           }
         }
         std::unique_ptr<geom::Mesh> sidewalk_mesh = std::make_unique<geom::Mesh>();
-        for (auto& lane : sidewalk_lane_meshes) {
-          *sidewalk_mesh += *lane;
-        }
+        sidewalk_mesh->Append(std::move(sidewalk_lane_meshes));
         (*junction_out_mesh_list)[road::Lane::LaneType::Sidewalk].push_back(std::move(sidewalk_mesh));
       } else {
         std::vector<std::unique_ptr<geom::Mesh>> lane_meshes;
@@ -1714,13 +1870,9 @@ namespace road {
           }
         }
         std::unique_ptr<geom::Mesh> merged_mesh = std::make_unique<geom::Mesh>();
-        for (auto& lane : lane_meshes) {
-          *merged_mesh += *lane;
-        }
+        merged_mesh->Append(std::move(lane_meshes));
         std::unique_ptr<geom::Mesh> sidewalk_mesh = std::make_unique<geom::Mesh>();
-        for (auto& lane : sidewalk_lane_meshes) {
-          *sidewalk_mesh += *lane;
-        }
+        sidewalk_mesh->Append(std::move(sidewalk_lane_meshes));
 
         (*junction_out_mesh_list)[road::Lane::LaneType::Driving].push_back(std::move(merged_mesh));
         (*junction_out_mesh_list)[road::Lane::LaneType::Sidewalk].push_back(std::move(sidewalk_mesh));
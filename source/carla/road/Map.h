@@ -21,6 +21,7 @@
 
 #include <boost/optional.hpp>
 
+#include <functional>
 #include <vector>
 
 namespace carla {
@@ -66,6 +67,11 @@ namespace road {
 
     geom::Transform ComputeTransform(Waypoint waypoint) const;
 
+    /// Batched version of ComputeTransform, the waypoints on the same lane are
+    /// evaluated together.
+    std::vector<geom::Transform> ComputeTransforms(
+        const std::vector<Waypoint> &waypoints) const;
+
     /// ========================================================================
     /// -- Road information ----------------------------------------------------
     /// ========================================================================
@@ -136,6 +142,14 @@ namespace road {
     /// Generate all the waypoints in @a map separated by @a approx_distance.
     std::vector<Waypoint> GenerateWaypoints(double approx_distance) const;
 
+    /// Same as GenerateWaypoints but hands the waypoints to @a callback in
+    /// chunks of at most @a chunk_size, in the same order, so the whole list
+    /// never has to be kept in memory.
+    void GenerateWaypointsInChunks(
+        double approx_distance,
+        size_t chunk_size,
+        const std::function<void(const std::vector<Waypoint> &)> &callback) const;
+
     /// Generate waypoints on each @a lane at the start of each @a road
     std::vector<Waypoint> GenerateWaypointsOnRoadEntries(Lane::LaneType lane_type = Lane::LaneType::Driving) const;
 
@@ -156,6 +170,10 @@ namespace road {
     std::unordered_map<road::RoadId, std::unordered_set<road::RoadId>>
         ComputeJunctionConflicts(JuncId id) const;
 
+    /// Called with the number of finished and total work items while a mesh
+    /// is generated. Calls are serialized but may come from any thread.
+    using ProgressCallback = std::function<void(size_t done, size_t total)>;
+
     /// Buids a mesh based on the OpenDRIVE
     geom::Mesh GenerateMesh(
         const double distance,
@@ -168,7 +186,8 @@ namespace road {
     std::map<road::Lane::LaneType , std::vector<std::unique_ptr<geom::Mesh>>>
       GenerateOrderedChunkedMeshInLocations( const rpc::OpendriveGenerationParameters& params,
                                              const geom::Vector3D& minpos,
-                                             const geom::Vector3D& maxpos) const;
+                                             const geom::Vector3D& maxpos,
+                                             const ProgressCallback& progress = {}) const;
 
     /// Buids a mesh of all crosswalks based on the OpenDRIVE
     geom::Mesh GetAllCrosswalkMesh() const;
@@ -250,18 +269,13 @@ private:
 public:
     inline float GetZPosInDeformation(float posx, float posy) const;
 
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>
-      GenerateRoadsMultithreaded( const carla::geom::MeshFactory& mesh_factory,
-        const std::vector<RoadId>& RoadsID,
-        const size_t index,
-        const size_t number_of_roads_per_thread) const;
-
     void GenerateJunctions(const carla::geom::MeshFactory& mesh_factory,
       const rpc::OpendriveGenerationParameters& params,
       const geom::Vector3D& minpos,
       const geom::Vector3D& maxpos,
       std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>*
-      juntion_out_mesh_list) const;
+      juntion_out_mesh_list,
+      const ProgressCallback& progress = {}) const;
 
     void GenerateSingleJunction(const carla::geom::MeshFactory& mesh_factory,
       const JuncId Id,
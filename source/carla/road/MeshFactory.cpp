@@ -14,6 +14,7 @@
 #include <carla/road/element/RoadInfoMarkRecord.h>
 #include <carla/road/Map.h>
 #include <carla/road/Deformation.h>
+#include <carla/ParallelFor.h>
 
 namespace carla {
 namespace geom {
@@ -31,20 +32,51 @@ namespace geom {
   static constexpr double EPSILON = 10.0 * std::numeric_limits<double>::epsilon();
   static constexpr double MESH_EPSILON = 50.0 * std::numeric_limits<double>::epsilon();
 
+  /// Returns the list of "s" where a lane is sampled between @a s_start and
+  /// @a s_end every @a resolution meters. If @a only_ends is true only the
+  /// first and last samples are returned (used for straight lanes).
+  static std::vector<double> ComputeLaneSamples(
+      const double s_start,
+      const double s_end,
+      const double resolution,
+      const bool only_ends = false) {
+    std::vector<double> samples;
+    double s_current = s_start;
+    if (only_ends) {
+      samples.push_back(s_current);
+    } else {
+      samples.reserve(static_cast<size_t>((s_end - s_start) / resolution) + 2u);
+      do {
+        samples.push_back(s_current);
+        s_current += resolution;
+      } while (s_current < s_end);
+    }
+    // This ensures the mesh is constant and have no gaps between roads,
+    // adding geometry at the very end of the lane
+    if (s_end - (s_current - resolution) > EPSILON) {
+      samples.push_back(s_end - MESH_EPSILON);
+    }
+    return samples;
+  }
+
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::Road &road) const {
-    Mesh out_mesh;
+    std::vector<std::unique_ptr<Mesh>> section_meshes;
     for (auto &&lane_section : road.GetLaneSections()) {
-      out_mesh += *Generate(lane_section);
+      section_meshes.emplace_back(Generate(lane_section));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    auto out_mesh = std::make_unique<Mesh>();
+    out_mesh->Append(std::move(section_meshes));
+    return out_mesh;
   }
 
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::LaneSection &lane_section) const {
-    Mesh out_mesh;
+    std::vector<std::unique_ptr<Mesh>> lane_meshes;
     for (auto &&lane_pair : lane_section.GetLanes()) {
-      out_mesh += *Generate(lane_pair.second);
+      lane_meshes.emplace_back(Generate(lane_pair.second));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    auto out_mesh = std::make_unique<Mesh>();
+    out_mesh->Append(std::move(lane_meshes));
+    return out_mesh;
   }
 
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::Lane &lane) const {
@@ -69,44 +101,27 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
-    }
-    double s_current = s_start;
-
-    std::vector<geom::Vector3D> vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      vertices.push_back(edges.first);
-      vertices.push_back(edges.second);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        vertices.push_back(edges.first);
-        vertices.push_back(edges.second);
-
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-      vertices.push_back(edges.first);
-      vertices.push_back(edges.second);
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto samples = ComputeLaneSamples(
+        s_start, s_end, road_param.resolution, lane.IsStraight());
+
+    // Get the location of the edges of the current lane at every sample
+    const size_t num_vertices = 2u * samples.size();
+    out_mesh.Reserve(num_vertices, Mesh::GetTriangleStripIndexesNum(num_vertices));
+    for (const auto &edges : lane.GetCornerPositions(samples, road_param.extra_lane_width)) {
+      out_mesh.AddVertex(edges.first);
+      out_mesh.AddVertex(edges.second);
     }
 
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
-    out_mesh.AddTriangleStrip(vertices);
+    out_mesh.AddTriangleStripIndexes(1u, num_vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateTesselated(
@@ -119,62 +134,39 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
-
-    std::vector<geom::Vector3D> vertices;
     // Ensure minimum vertices in width are two
     const int vertices_in_width = road_param.vertex_width_resolution >= 2 ? road_param.vertex_width_resolution : 2;
     const int segments_number = vertices_in_width - 1;
 
-    std::vector<geom::Vector2D> uvs;
+    const auto samples = ComputeLaneSamples(s_start, s_end, road_param.resolution);
+
+    const size_t number_of_rows = samples.size();
+    const size_t num_vertices = vertices_in_width * number_of_rows;
+    const size_t num_quads = number_of_rows > 0u ?
+        segments_number * (number_of_rows - 1u) : 0u;
+    out_mesh.Reserve(num_vertices, 6u * num_quads, num_vertices);
     int uvx = 0;
     int uvy = 0;
     // Iterate over the lane's 's' and store the vertices based on it's width
-    do {
-      // Get the location of the edges of the current lane at the current waypoint
-      std::pair<geom::Vector3D, geom::Vector3D> edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
+    for (const auto &edges : lane.GetCornerPositions(samples, road_param.extra_lane_width)) {
       const geom::Vector3D segments_size = ( edges.second - edges.first ) / segments_number;
       geom::Vector3D current_vertex = edges.first;
       uvx = 0;
       for (int i = 0; i < vertices_in_width; ++i) {
-        uvs.push_back(geom::Vector2D(uvx, uvy));
-        vertices.push_back(current_vertex);
+        out_mesh.AddUV(geom::Vector2D(uvx, uvy));
+        out_mesh.AddVertex(current_vertex);
         current_vertex = current_vertex + segments_size;
         uvx++;
       }
       uvy++;
-      // Update the current waypoint's "s"
-      s_current += road_param.resolution;
-    } while (s_current < s_end);
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      std::pair<carla::geom::Vector3D, carla::geom::Vector3D> edges =
-        lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-      const geom::Vector3D segments_size = (edges.second - edges.first) / segments_number;
-      geom::Vector3D current_vertex = edges.first;
-      uvx = 0;
-      for (int i = 0; i < vertices_in_width; ++i)
-      {
-        uvs.push_back(geom::Vector2D(uvx, uvy));
-        vertices.push_back(current_vertex);
-        current_vertex = current_vertex + segments_size;
-        uvx++;
-      }
     }
-    out_mesh.AddVertices(vertices);
-    out_mesh.AddUVs(uvs);
 
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
       lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
 
-    const size_t number_of_rows = (vertices.size() / vertices_in_width);
-
     for (size_t i = 0; i < (number_of_rows - 1); ++i) {
       for (size_t j = 0; j < vertices_in_width - 1; ++j) {
         out_mesh.AddIndex(   j       + (   i       * vertices_in_width ) + 1);
@@ -187,7 +179,7 @@ namespace geom {
       }
     }
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
 
@@ -212,25 +204,25 @@ namespace geom {
         case road::Lane::LaneType::Parking:
         case road::Lane::LaneType::Bidirectional:
         {
-          out_mesh += *GenerateTesselated(lane_pair.second);
+          out_mesh += std::move(*GenerateTesselated(lane_pair.second));
           break;
         }
         case road::Lane::LaneType::Shoulder:
         case road::Lane::LaneType::Sidewalk:
         case road::Lane::LaneType::Biking:
         {
-          out_mesh += *GenerateSidewalk(lane_pair.second);
+          out_mesh += std::move(*GenerateSidewalk(lane_pair.second));
           break;
         }
         default:
         {
-          out_mesh += *GenerateTesselated(lane_pair.second);
+          out_mesh += std::move(*GenerateTesselated(lane_pair.second));
           break;
         }
       }
 
       if( result[lane_pair.second.GetType()].size() <= PosToAdd ){
-        result[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(out_mesh));
+        result[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(out_mesh)));
       } else {
         uint32_t verticesinwidth  = SelectVerticesInWidth(vertices_in_width, lane_pair.second.GetType());
         (result[lane_pair.second.GetType()][PosToAdd])->ConcatMesh(out_mesh, verticesinwidth);
@@ -244,9 +236,9 @@ namespace geom {
     for (auto &&lane_pair : lane_section.GetLanes()) {
       const double s_start = lane_pair.second.GetDistance() + EPSILON;
       const double s_end = lane_pair.second.GetDistance() + lane_pair.second.GetLength() - EPSILON;
-      out_mesh += *GenerateSidewalk(lane_pair.second, s_start, s_end);
+      out_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_start, s_end));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
   std::unique_ptr<Mesh> MeshFactory::GenerateSidewalk(const road::Lane &lane) const{
     const double s_start = lane.GetDistance() + EPSILON;
@@ -265,86 +257,48 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
-
-    std::vector<geom::Vector3D> vertices;
     // Ensure minimum vertices in width are two
     const int vertices_in_width = 6;
-    const int segments_number = vertices_in_width - 1;
-    std::vector<geom::Vector2D> uvs;
+    const auto samples = ComputeLaneSamples(s_start, s_end, road_param.resolution);
+
+    const int number_of_rows = static_cast<int>(samples.size());
+    const size_t num_vertices = vertices_in_width * samples.size();
+    // Three of the five quads of each row are filled.
+    const size_t num_quads = samples.empty() ? 0u : 3u * (samples.size() - 1u);
+    out_mesh.Reserve(num_vertices, 6u * num_quads, num_vertices);
     int uvy = 0;
 
     // Iterate over the lane's 's' and store the vertices based on it's width
-    do {
-      // Get the location of the edges of the current lane at the current waypoint
-      std::pair<geom::Vector3D, geom::Vector3D> edges =
-        lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-
+    for (const auto &edges : lane.GetCornerPositions(samples, road_param.extra_lane_width)) {
       geom::Vector3D low_vertex_first = edges.first - geom::Vector3D(0,0,1);
       geom::Vector3D low_vertex_second = edges.second - geom::Vector3D(0,0,1);
-      vertices.push_back(low_vertex_first);
-      uvs.push_back(geom::Vector2D(0, uvy));
+      out_mesh.AddVertex(low_vertex_first);
+      out_mesh.AddUV(geom::Vector2D(0, uvy));
 
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
+      out_mesh.AddVertex(edges.first);
+      out_mesh.AddUV(geom::Vector2D(1, uvy));
 
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
+      out_mesh.AddVertex(edges.first);
+      out_mesh.AddUV(geom::Vector2D(1, uvy));
 
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
+      out_mesh.AddVertex(edges.second);
+      out_mesh.AddUV(geom::Vector2D(2, uvy));
 
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
+      out_mesh.AddVertex(edges.second);
+      out_mesh.AddUV(geom::Vector2D(2, uvy));
 
-      vertices.push_back(low_vertex_second);
-      uvs.push_back(geom::Vector2D(3, uvy));
+      out_mesh.AddVertex(low_vertex_second);
+      out_mesh.AddUV(geom::Vector2D(3, uvy));
 
-      // Update the current waypoint's "s"
-      s_current += road_param.resolution;
       uvy++;
-    } while (s_current < s_end);
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      std::pair<carla::geom::Vector3D, carla::geom::Vector3D> edges =
-        lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-
-      geom::Vector3D low_vertex_first = edges.first - geom::Vector3D(0,0,1);
-      geom::Vector3D low_vertex_second = edges.second - geom::Vector3D(0,0,1);
-
-      vertices.push_back(low_vertex_first);
-      uvs.push_back(geom::Vector2D(0, uvy));
-
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
-
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
-
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
-
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
-
-      vertices.push_back(low_vertex_second);
-      uvs.push_back(geom::Vector2D(3, uvy));
-
     }
 
-    out_mesh.AddVertices(vertices);
-    out_mesh.AddUVs(uvs);
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
       lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
 
-    const int number_of_rows = (vertices.size() / vertices_in_width);
-
     for (size_t i = 0; i < (number_of_rows - 1); ++i) {
       for (size_t j = 0; j < vertices_in_width - 1; ++j) {
 
@@ -363,7 +317,7 @@ namespace geom {
       }
     }
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
   std::unique_ptr<Mesh> MeshFactory::GenerateWalls(const road::LaneSection &lane_section) const {
     Mesh out_mesh;
@@ -378,13 +332,13 @@ namespace geom {
       const double s_start = lane.GetDistance() + EPSILON;
       const double s_end = lane.GetDistance() + lane.GetLength() - EPSILON;
       if (lane.GetId() == max_lane) {
-        out_mesh += *GenerateLeftWall(lane, s_start, s_end);
+        out_mesh += std::move(*GenerateLeftWall(lane, s_start, s_end));
       }
       if (lane.GetId() == min_lane) {
-        out_mesh += *GenerateRightWall(lane, s_start, s_end);
+        out_mesh += std::move(*GenerateRightWall(lane, s_start, s_end));
       }
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateRightWall(
@@ -397,45 +351,28 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
     const geom::Vector3D height_vector = geom::Vector3D(0.f, 0.f, road_param.wall_height);
 
-    std::vector<geom::Vector3D> r_vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      r_vertices.push_back(edges.first + height_vector);
-      r_vertices.push_back(edges.first);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        r_vertices.push_back(edges.first + height_vector);
-        r_vertices.push_back(edges.first);
-
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
-    }
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto samples = ComputeLaneSamples(
+        s_start, s_end, road_param.resolution, lane.IsStraight());
 
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-      r_vertices.push_back(edges.first + height_vector);
-      r_vertices.push_back(edges.first);
+    const size_t num_vertices = 2u * samples.size();
+    out_mesh.Reserve(num_vertices, Mesh::GetTriangleStripIndexesNum(num_vertices));
+    for (const auto &edges : lane.GetCornerPositions(samples, road_param.extra_lane_width)) {
+      out_mesh.AddVertex(edges.first + height_vector);
+      out_mesh.AddVertex(edges.first);
     }
 
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
-    out_mesh.AddTriangleStrip(r_vertices);
+    out_mesh.AddTriangleStripIndexes(1u, num_vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateLeftWall(
@@ -448,45 +385,28 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
     const geom::Vector3D height_vector = geom::Vector3D(0.f, 0.f, road_param.wall_height);
 
-    std::vector<geom::Vector3D> l_vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      l_vertices.push_back(edges.second);
-      l_vertices.push_back(edges.second + height_vector);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        l_vertices.push_back(edges.second);
-        l_vertices.push_back(edges.second + height_vector);
-
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
-    }
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto samples = ComputeLaneSamples(
+        s_start, s_end, road_param.resolution, lane.IsStraight());
 
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-      l_vertices.push_back(edges.second);
-      l_vertices.push_back(edges.second + height_vector);
+    const size_t num_vertices = 2u * samples.size();
+    out_mesh.Reserve(num_vertices, Mesh::GetTriangleStripIndexesNum(num_vertices));
+    for (const auto &edges : lane.GetCornerPositions(samples, road_param.extra_lane_width)) {
+      out_mesh.AddVertex(edges.second);
+      out_mesh.AddVertex(edges.second + height_vector);
     }
 
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
-    out_mesh.AddTriangleStrip(l_vertices);
+    out_mesh.AddTriangleStripIndexes(1u, num_vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::vector<std::unique_ptr<Mesh>> MeshFactory::GenerateWithMaxLen(
@@ -514,17 +434,17 @@ namespace geom {
         const auto s_until = s_current + road_param.max_road_len;
         Mesh lane_section_mesh;
         for (auto &&lane_pair : lane_section.GetLanes()) {
-          lane_section_mesh += *Generate(lane_pair.second, s_current, s_until);
+          lane_section_mesh += std::move(*Generate(lane_pair.second, s_current, s_until));
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
         s_current = s_until;
       }
       if (s_end - s_current > EPSILON) {
         Mesh lane_section_mesh;
         for (auto &&lane_pair : lane_section.GetLanes()) {
-          lane_section_mesh += *Generate(lane_pair.second, s_current, s_end);
+          lane_section_mesh += std::move(*Generate(lane_pair.second, s_current, s_end));
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
       }
     }
     return mesh_uptr_list;
@@ -564,19 +484,19 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
               case road::Lane::LaneType::Parking:
               case road::Lane::LaneType::Bidirectional:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_until);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_until));
                 break;
               }
               case road::Lane::LaneType::Shoulder:
               case road::Lane::LaneType::Sidewalk:
               case road::Lane::LaneType::Biking:
               {
-                lane_section_mesh += *GenerateSidewalk(lane_pair.second, s_current, s_until);
+                lane_section_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_current, s_until));
                 break;
               }
               default:
               {
-                 lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_until);
+                 lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_until));
                 break;
               }
             }
@@ -588,7 +508,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
 
             size_t PosToAdd = it - redirections.begin();
             if (mesh_uptr_list[lane_pair.second.GetType()].size() <= PosToAdd) {
-              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(lane_section_mesh));
+              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
             } else {
               uint32_t verticesinwidth = SelectVerticesInWidth(vertices_in_width, lane_pair.second.GetType());
               (mesh_uptr_list[lane_pair.second.GetType()][PosToAdd])->ConcatMesh(lane_section_mesh, verticesinwidth);
@@ -605,19 +525,19 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
               case road::Lane::LaneType::Parking:
               case road::Lane::LaneType::Bidirectional:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_end));
                 break;
               }
               case road::Lane::LaneType::Shoulder:
               case road::Lane::LaneType::Sidewalk:
               case road::Lane::LaneType::Biking:
               {
-                lane_section_mesh += *GenerateSidewalk(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_current, s_end));
                 break;
               }
               default:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_end));
                 break;
               }
             }
@@ -631,7 +551,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
             size_t PosToAdd = it - redirections.begin();
 
             if (mesh_uptr_list[lane_pair.second.GetType()].size() <= PosToAdd) {
-              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(lane_section_mesh));
+              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
             } else {
               *(mesh_uptr_list[lane_pair.second.GetType()][PosToAdd]) += lane_section_mesh;
             }
@@ -674,13 +594,13 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         for (auto &&lane_pair : lane_section.GetLanes()) {
           const auto &lane = lane_pair.second;
           if (lane.GetId() == max_lane) {
-            lane_section_mesh += *GenerateLeftWall(lane, s_current, s_until);
+            lane_section_mesh += std::move(*GenerateLeftWall(lane, s_current, s_until));
           }
           if (lane.GetId() == min_lane) {
-            lane_section_mesh += *GenerateRightWall(lane, s_current, s_until);
+            lane_section_mesh += std::move(*GenerateRightWall(lane, s_current, s_until));
           }
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
         s_current = s_until;
       }
       if (s_end - s_current > EPSILON) {
@@ -688,13 +608,13 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         for (auto &&lane_pair : lane_section.GetLanes()) {
           const auto &lane = lane_pair.second;
           if (lane.GetId() == max_lane) {
-            lane_section_mesh += *GenerateLeftWall(lane, s_current, s_end);
+            lane_section_mesh += std::move(*GenerateLeftWall(lane, s_current, s_end));
           }
           if (lane.GetId() == min_lane) {
-            lane_section_mesh += *GenerateRightWall(lane, s_current, s_end);
+            lane_section_mesh += std::move(*GenerateRightWall(lane, s_current, s_end));
           }
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
       }
     }
     return mesh_uptr_list;
@@ -896,7 +816,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         out_mesh.AddVertex(edges.first);
         out_mesh.AddVertex(edges.second);
       }
-      inout.push_back(std::make_unique<Mesh>(out_mesh));
+      inout.push_back(std::make_unique<Mesh>(std::move(out_mesh)));
     }
   }
 
@@ -1038,36 +958,30 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         out_mesh.AddVertex(leftpoint.location);
 
       }
-      inout.push_back(std::make_unique<Mesh>(out_mesh));
+      inout.push_back(std::make_unique<Mesh>(std::move(out_mesh)));
     }
   }
 
-  struct VertexWeight {
-    Mesh::vertex_type* vertex;
-    double weight;
-  };
-  struct VertexNeighbors {
-    Mesh::vertex_type* vertex;
-    std::vector<VertexWeight> neighbors;
-  };
   struct VertexInfo {
-    Mesh::vertex_type * vertex;
+    size_t index;
     size_t lane_mesh_idx;
     bool is_static;
   };
 
   // Helper function to compute the weight of neighboring vertices
-  static VertexWeight ComputeVertexWeight(
+  static double ComputeVertexWeight(
       const MeshFactory::RoadParameters &road_param,
+      const std::vector<Mesh::vertex_type> &vertices,
       const VertexInfo &vertex_info,
       const VertexInfo &neighbor_info) {
-    const float distance3D = geom::Math::Distance(*vertex_info.vertex, *neighbor_info.vertex);
+    const float distance3D = geom::Math::Distance(
+        vertices[vertex_info.index], vertices[neighbor_info.index]);
     // Ignore vertices beyond a certain distance
     if(distance3D > road_param.max_weight_distance) {
-      return {neighbor_info.vertex, 0};
+      return 0;
     }
     if(abs(distance3D) < EPSILON) {
-      return {neighbor_info.vertex, 0};
+      return 0;
     }
     float weight = geom::Math::Clamp<float>(1.0f / distance3D, 0.0f, 100000.0f);
 
@@ -1079,91 +993,169 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         weight *= road_param.lane_ends_multiplier;
       }
     }
-    return {neighbor_info.vertex, weight};
+    return weight;
   }
 
-  // Helper function to compute neighborhoord of vertices and their weights
-  std::vector<VertexNeighbors> GetVertexNeighborhoodAndWeights(
+  /// Neighborhood graph of the smoothed vertices of a merged mesh, in
+  /// compressed sparse row form.
+  struct SmoothingGraph {
+    /// Vertex index of each smoothed vertex.
+    std::vector<size_t> rows;
+    /// The neighbors of row i are in [offsets[i], offsets[i + 1]).
+    std::vector<size_t> offsets;
+    /// Vertex index of each neighbor.
+    std::vector<size_t> columns;
+    /// Weight of each neighbor, normalized to add up to one per row.
+    std::vector<double> weights;
+  };
+
+  /// Number of nearest vertices considered as neighbors, including the
+  /// vertex itself.
+  static constexpr size_t SMOOTHING_NEIGHBORS = 20u;
+
+  /// Number of smoothed vertices handed to each job.
+  static constexpr size_t SMOOTHING_ROWS_PER_JOB = 2048u;
+
+  // Helper function to compute neighborhoord of vertices and their weights.
+  // @a vertices are the vertices of @a lane_meshes concatenated in order.
+  static SmoothingGraph GetVertexNeighborhoodAndWeights(
       const MeshFactory::RoadParameters &road_param,
-      std::vector<std::unique_ptr<Mesh>> &lane_meshes) {
+      const std::vector<std::unique_ptr<Mesh>> &lane_meshes,
+      const std::vector<Mesh::vertex_type> &vertices) {
     // Build rtree for neighborhood queries
     using Rtree = geom::PointCloudRtree<VertexInfo>;
     using Point = Rtree::BPoint;
     Rtree rtree;
+    SmoothingGraph graph;
+    std::vector<VertexInfo> row_infos;
+    size_t first_index = 0u;
     for (size_t lane_mesh_idx = 0; lane_mesh_idx < lane_meshes.size(); ++lane_mesh_idx) {
-      auto& mesh = lane_meshes[lane_mesh_idx];
-      for(size_t i = 0; i < mesh->GetVerticesNum(); ++i) {
-        auto& vertex = mesh->GetVertices()[i];
+      const size_t num_vertices = lane_meshes[lane_mesh_idx]->GetVerticesNum();
+      for(size_t i = 0; i < num_vertices; ++i) {
+        const size_t index = first_index + i;
+        const auto& vertex = vertices[index];
         Point point(vertex.x, vertex.y, vertex.z);
-        if (i < 2 || i >= mesh->GetVerticesNum() - 2) {
-          rtree.InsertElement({point, {&vertex, lane_mesh_idx, true}});
-        } else {
-          rtree.InsertElement({point, {&vertex, lane_mesh_idx, false}});
+        const bool is_static = i < 2 || i >= num_vertices - 2;
+        rtree.InsertElement({point, {index, lane_mesh_idx, is_static}});
+        if (i > 2 && i < num_vertices - 2) {
+          graph.rows.push_back(index);
+          row_infos.push_back({index, lane_mesh_idx, false});
         }
       }
+      first_index += num_vertices;
     }
 
-    // Find neighbors for each vertex and compute their weight
-    std::vector<VertexNeighbors> vertices_neighborhoods;
-    for (size_t lane_mesh_idx = 0; lane_mesh_idx < lane_meshes.size(); ++lane_mesh_idx) {
-      auto& mesh = lane_meshes[lane_mesh_idx];
-      for(size_t i = 0; i < mesh->GetVerticesNum(); ++i) {
-        if (i > 2 && i < mesh->GetVerticesNum() - 2) {
-          auto& vertex = mesh->GetVertices()[i];
-          Point point(vertex.x, vertex.y, vertex.z);
-          auto closest_vertices = rtree.GetNearestNeighbours(point, 20);
-          VertexNeighbors vertex_neighborhood;
-          vertex_neighborhood.vertex = &vertex;
-          for(auto& close_vertex : closest_vertices) {
-            auto &vertex_info = close_vertex.second;
-            if(&vertex == vertex_info.vertex) {
-              continue;
-            }
-            auto vertex_weight = ComputeVertexWeight(
-                road_param, {&vertex, lane_mesh_idx, false}, vertex_info);
-            if(vertex_weight.weight > 0)
-              vertex_neighborhood.neighbors.push_back(vertex_weight);
-          }
-          vertices_neighborhoods.push_back(vertex_neighborhood);
+    // Find neighbors for each vertex and compute their weight, in parallel,
+    // into fixed size slots that are compacted afterwards.
+    const size_t num_rows = graph.rows.size();
+    std::vector<size_t> slot_columns(num_rows * SMOOTHING_NEIGHBORS);
+    std::vector<double> slot_weights(num_rows * SMOOTHING_NEIGHBORS);
+    std::vector<size_t> slot_count(num_rows, 0u);
+    ParallelFor(num_rows, [&](const size_t row) {
+      const auto &vertex_info = row_infos[row];
+      const auto &vertex = vertices[vertex_info.index];
+      Point point(vertex.x, vertex.y, vertex.z);
+      auto closest_vertices = rtree.GetNearestNeighbours(point, SMOOTHING_NEIGHBORS);
+      double sum_weight = 0.0;
+      size_t &count = slot_count[row];
+      for(auto& close_vertex : closest_vertices) {
+        auto &neighbor_info = close_vertex.second;
+        if(neighbor_info.index == vertex_info.index) {
+          continue;
+        }
+        const double weight = ComputeVertexWeight(road_param, vertices, vertex_info, neighbor_info);
+        if(weight > 0 && count < SMOOTHING_NEIGHBORS) {
+          slot_columns[row * SMOOTHING_NEIGHBORS + count] = neighbor_info.index;
+          slot_weights[row * SMOOTHING_NEIGHBORS + count] = weight;
+          sum_weight += weight;
+          ++count;
         }
       }
+      for (size_t i = 0u; i < count; ++i) {
+        slot_weights[row * SMOOTHING_NEIGHBORS + i] /= sum_weight;
+      }
+    });
+
+    graph.offsets.resize(num_rows + 1u);
+    graph.offsets[0u] = 0u;
+    for (size_t row = 0u; row < num_rows; ++row) {
+      graph.offsets[row + 1u] = graph.offsets[row] + slot_count[row];
+    }
+    graph.columns.resize(graph.offsets.back());
+    graph.weights.resize(graph.offsets.back());
+    for (size_t row = 0u; row < num_rows; ++row) {
+      std::copy_n(
+          slot_columns.begin() + static_cast<std::ptrdiff_t>(row * SMOOTHING_NEIGHBORS),
+          slot_count[row],
+          graph.columns.begin() + static_cast<std::ptrdiff_t>(graph.offsets[row]));
+      std::copy_n(
+          slot_weights.begin() + static_cast<std::ptrdiff_t>(row * SMOOTHING_NEIGHBORS),
+          slot_count[row],
+          graph.weights.begin() + static_cast<std::ptrdiff_t>(graph.offsets[row]));
     }
-    return vertices_neighborhoods;
+    return graph;
   }
 
   std::unique_ptr<Mesh> MeshFactory::MergeAndSmooth(std::vector<std::unique_ptr<Mesh>> &lane_meshes) const {
-    geom::Mesh out_mesh;
-
-    auto vertices_neighborhoods = GetVertexNeighborhoodAndWeights(road_param, lane_meshes);
+    auto out_mesh = std::make_unique<Mesh>();
+    out_mesh->Append(lane_meshes);
+
+    auto &vertices = out_mesh->GetVertices();
+    const auto graph = GetVertexNeighborhoodAndWeights(road_param, lane_meshes, vertices);
+    const size_t num_rows = graph.rows.size();
+    if (num_rows == 0u) {
+      return out_mesh;
+    }
 
-    // Laplacian function
-    auto Laplacian = [&](const Mesh::vertex_type* vertex, const std::vector<VertexWeight> &neighbors) -> double {
-      double sum = 0;
-      double sum_weight = 0;
-      for(auto &element : neighbors) {
-        sum += (element.vertex->z - vertex->z)*element.weight;
-        sum_weight += element.weight;
-      }
-      if(sum_weight > 0)
-        return sum / sum_weight;
-      else
-        return 0;
-    };
-    // Run iterative algorithm
-    double lambda = 0.5;
-    int iterations = 100;
-    for(int iter = 0; iter < iterations; ++iter) {
-      for (auto& vertex_neighborhood : vertices_neighborhoods) {
-        auto * vertex = vertex_neighborhood.vertex;
-        vertex->z += static_cast<float>(lambda*Laplacian(vertex, vertex_neighborhood.neighbors));
+    // Run Jacobi sweeps of the Laplacian smoothing on the heights, reading
+    // from one buffer and writing to the other, until the largest update
+    // falls below the tolerance. Vertices without neighbors keep their
+    // height in both buffers.
+    const double lambda = 0.5;
+    std::vector<float> heights(vertices.size());
+    for (size_t i = 0u; i < vertices.size(); ++i) {
+      heights[i] = vertices[i].z;
+    }
+    std::vector<float> next_heights = heights;
+    const size_t num_jobs = (num_rows + SMOOTHING_ROWS_PER_JOB - 1u) / SMOOTHING_ROWS_PER_JOB;
+    std::vector<float> max_update_per_job(num_jobs);
+    for (uint32_t iter = 0u; iter < road_param.smooth_max_iterations; ++iter) {
+      ParallelFor(num_jobs, [&](const size_t job) {
+        const float *z = heights.data();
+        const size_t *columns = graph.columns.data();
+        const double *weights = graph.weights.data();
+        float max_update = 0.0f;
+        const size_t end = std::min(num_rows, (job + 1u) * SMOOTHING_ROWS_PER_JOB);
+        for (size_t row = job * SMOOTHING_ROWS_PER_JOB; row < end; ++row) {
+          const size_t begin_k = graph.offsets[row];
+          const size_t end_k = graph.offsets[row + 1u];
+          if (begin_k == end_k) {
+            continue;
+          }
+          double weighted_sum = 0.0;
+          for (size_t k = begin_k; k < end_k; ++k) {
+            weighted_sum += weights[k] * z[columns[k]];
+          }
+          const size_t vertex = graph.rows[row];
+          const float update = static_cast<float>(lambda * (weighted_sum - z[vertex]));
+          next_heights[vertex] = z[vertex] + update;
+          max_update = std::max(max_update, std::abs(update));
+        }
+        max_update_per_job[job] = max_update;
+      });
+      std::swap(heights, next_heights);
+      const float max_update = *std::max_element(
+          max_update_per_job.begin(),
+          max_update_per_job.end());
+      if (max_update < road_param.smooth_tolerance) {
+        break;
       }
     }
 
-    for(auto &mesh : lane_meshes) {
-      out_mesh += *mesh;
+    for (size_t i = 0u; i < vertices.size(); ++i) {
+      vertices[i].z = heights[i];
     }
-
-    return std::make_unique<Mesh>(out_mesh);
+    return out_mesh;
   }
 
   uint32_t MeshFactory::SelectVerticesInWidth(uint32_t default_num_vertices, road::Lane::LaneType type)
@@ -145,6 +145,8 @@ namespace geom {
       float max_weight_distance         =  5.0f;
       float same_lane_weight_multiplier =  2.0f;
       float lane_ends_multiplier        =  2.0f;
+      float smooth_tolerance            =  0.0001f;
+      uint32_t smooth_max_iterations    =  200u;
     };
 
     RoadParameters road_param;
@@ -8,6 +8,7 @@
 #include "carla/geom/CubicPolynomial.h"
 #include "carla/geom/Location.h"
 #include "carla/geom/Math.h"
+#include "carla/geom/PiecewiseCubicPolynomial.h"
 #include "carla/ListView.h"
 #include "carla/Logging.h"
 #include "carla/road/element/RoadInfoElevation.h"
@@ -18,6 +19,7 @@
 #include "carla/road/MapData.h"
 #include "carla/road/Road.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace carla {
@@ -217,6 +219,60 @@ namespace road {
     return p;
   }
 
+  std::vector<element::DirectedPoint> Road::GetDirectedPointsIn(
+      const std::vector<double> &s) const {
+    std::vector<element::DirectedPoint> result;
+    if (s.empty()) {
+      return result;
+    }
+    result.reserve(s.size());
+
+    std::vector<double> clamped_s(s.size());
+    std::transform(s.begin(), s.end(), clamped_s.begin(), [this](double value) {
+      return geom::Math::Clamp(value, 0.0, _length);
+    });
+
+    // Road's lane offset record, evaluated at the clamped distance
+    std::vector<double> offsets(s.size());
+    geom::PiecewiseCubicPolynomial::FromInfos(
+        _info.GetInfos<element::RoadInfoLaneOffset>())
+        .Evaluate(clamped_s.data(), clamped_s.size(), offsets.data());
+
+    // Road's elevation record, evaluated at the unclamped distance
+    const auto elevation = geom::PiecewiseCubicPolynomial::FromInfos(
+        _info.GetInfos<element::RoadInfoElevation>());
+    const double min_s = *std::min_element(s.begin(), s.end());
+    if (elevation.FindRecord(min_s) == elevation.size()) {
+      throw_exception(std::runtime_error("failed to find road elevation."));
+    }
+    std::vector<double> elevations(s.size());
+    std::vector<double> pitches(s.size());
+    elevation.EvaluateWithTangent(s.data(), s.size(), elevations.data(), pitches.data());
+
+    const auto geometries = _info.GetInfos<element::RoadInfoGeometry>();
+    DEBUG_ASSERT(!geometries.empty());
+    auto geometry = geometries.begin();
+    for (size_t i = 0u; i < s.size(); ++i) {
+      const double current_s = clamped_s[i];
+      // Reuse the previous geometry while the distances are in order
+      if ((*geometry)->GetDistance() > current_s) {
+        geometry = geometries.begin();
+      }
+      while (std::next(geometry) != geometries.end() &&
+          (*std::next(geometry))->GetDistance() <= current_s) {
+        ++geometry;
+      }
+      element::DirectedPoint p =
+          (*geometry)->GetGeometry().PosFromDist(current_s - (*geometry)->GetDistance());
+      // Unreal's Y axis hack (the minus on the offset)
+      p.ApplyLateralOffset(-static_cast<float>(offsets[i]));
+      p.location.z = static_cast<float>(elevations[i]);
+      p.pitch = pitches[i];
+      result.emplace_back(p);
+    }
+    return result;
+  }
+
   const std::pair<double, double> Road::GetNearestPoint(const geom::Location &loc) const {
     std::pair<double, double> last = { 0.0, std::numeric_limits<double>::max() };
 
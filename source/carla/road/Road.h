@@ -92,6 +92,12 @@ namespace road {
     /// - @ param s distance regarding the road to compute the point
     element::DirectedPoint GetDirectedPointInNoLaneOffset(const double s) const;
 
+    /// Batched version of GetDirectedPointIn. Evaluates the laneOffset and
+    /// elevation records of the whole list of distances at once, best
+    /// performance is achieved with @a s sorted in ascending order.
+    std::vector<element::DirectedPoint> GetDirectedPointsIn(
+        const std::vector<double> &s) const;
+
     /// Returns a pair containing:
     /// - @b first:  distance to the nearest point on the center in
     ///              this road segment from the begining of it (s).
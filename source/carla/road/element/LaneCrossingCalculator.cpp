@@ -8,8 +8,11 @@
 #include "carla/road/element/LaneMarking.h"
 
 #include "carla/geom/Location.h"
+#include "carla/geom/Math.h"
 #include "carla/road/Map.h"
 
+#include <cmath>
+
 namespace carla {
 namespace road {
 namespace element {
@@ -25,6 +28,14 @@ namespace element {
       static_cast<uint32_t>(Lane::LaneType::Biking) |
       static_cast<uint32_t>(Lane::LaneType::Parking);
 
+  /// Fraction of the half lane width, around the center of the lane, where a
+  /// location is well inside the lane.
+  static constexpr double INSIDE_LANE_FRACTION = 0.5;
+
+  /// Distance along the lane from the projected waypoint within which the
+  /// lane is considered straight.
+  static constexpr float INSIDE_LANE_DISTANCE = 2.0f;
+
   /// Calculate the lane markings that need to be crossed from @a lane_id_origin
   /// to @a lane_id_destination.
   static std::vector<LaneMarking> CrossingAtSameSection(
@@ -53,16 +64,21 @@ namespace element {
     return {};
   }
 
-  static bool IsOffRoad(const Map &map, const geom::Location &location) {
-    return !map.GetWaypoint(location, FLAGS).has_value();
+  std::vector<LaneMarking> LaneCrossingCalculator::Calculate(
+      const Map &map,
+      const geom::Location &origin,
+      const geom::Location &destination) {
+    return Calculate(map, origin, Project(map, origin), destination, Project(map, destination));
   }
 
   std::vector<LaneMarking> LaneCrossingCalculator::Calculate(
       const Map &map,
       const geom::Location &origin,
-      const geom::Location &destination) {
-    auto w0 = map.GetClosestWaypointOnRoad(origin, FLAGS);
-    auto w1 = map.GetClosestWaypointOnRoad(destination, FLAGS);
+      const LaneProjection &origin_lane,
+      const geom::Location &destination,
+      const LaneProjection &destination_lane) {
+    const auto &w0 = origin_lane.waypoint;
+    const auto &w1 = destination_lane.waypoint;
 
     if (!w0.has_value() || !w1.has_value()) {
       return {};
@@ -73,12 +89,12 @@ namespace element {
       return {};
     }
 
-    if (map.IsJunction(w0->road_id) || map.IsJunction(w1->road_id)) {
+    if (origin_lane.is_junction || destination_lane.is_junction) {
       return {};
     }
 
-    const auto w0_is_offroad = IsOffRoad(map, origin);
-    const auto w1_is_offroad = IsOffRoad(map, destination);
+    const auto w0_is_offroad = origin_lane.is_offroad;
+    const auto w1_is_offroad = destination_lane.is_offroad;
 
     if (w0_is_offroad && w1_is_offroad) {
       // outside the road
@@ -90,8 +106,7 @@ namespace element {
       return {};
     }
 
-    const auto transform = map.ComputeTransform(*w0);
-    geom::Vector3D orig_vec = transform.GetForwardVector();
+    geom::Vector3D orig_vec = origin_lane.transform.GetForwardVector();
     geom::Vector3D dest_vec = (destination - origin).MakeSafeUnitVector(2 * std::numeric_limits<float>::epsilon());
 
     // cross product
@@ -106,6 +121,31 @@ namespace element {
         dest_is_at_right);
   }
 
+  LaneProjection LaneCrossingCalculator::Project(const Map &map, const geom::Location &location) {
+    LaneProjection result;
+    result.waypoint = map.GetClosestWaypointOnRoad(location, FLAGS);
+    if (result.waypoint.has_value()) {
+      // Same test as Map::GetWaypoint, without querying the road again.
+      result.transform = map.ComputeTransform(*result.waypoint);
+      result.half_width = map.GetLaneWidth(*result.waypoint) * 0.5;
+      result.is_offroad = !(geom::Math::Distance2D(result.transform.location, location) < result.half_width);
+      result.is_junction = map.IsJunction(result.waypoint->road_id);
+    }
+    return result;
+  }
+
+  bool LaneCrossingCalculator::IsWellInsideLane(const LaneProjection &lane, const geom::Location &location) {
+    if (!lane.waypoint.has_value() || lane.is_offroad || lane.is_junction) {
+      return false;
+    }
+    const geom::Vector3D offset = location - lane.transform.location;
+    const float along = geom::Math::Dot2D(offset, lane.transform.GetForwardVector());
+    const float across = geom::Math::Dot2D(offset, lane.transform.GetRightVector());
+    return
+        (std::abs(along) < INSIDE_LANE_DISTANCE) &&
+        (std::abs(across) < INSIDE_LANE_FRACTION * lane.half_width);
+  }
+
 } // namespace element
 } // namespace road
 } // namespace carla
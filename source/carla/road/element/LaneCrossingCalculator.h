@@ -6,18 +6,37 @@
 
 #pragma once
 
+#include "carla/geom/Transform.h"
 #include "carla/road/element/LaneMarking.h"
+#include "carla/road/element/Waypoint.h"
+
+#include <boost/optional.hpp>
 
 #include <vector>
 
 namespace carla {
-namespace geom { class Location; }
 namespace road {
 
   class Map;
 
 namespace element {
 
+  /// Lane of a location, as found by the lane crossing calculation.
+  struct LaneProjection {
+    /// Closest waypoint on the road, if any.
+    boost::optional<Waypoint> waypoint;
+
+    /// Whether the location is outside the lane of @a waypoint.
+    bool is_offroad = true;
+
+    bool is_junction = false;
+
+    /// Transform of the center of the lane at @a waypoint.
+    geom::Transform transform;
+
+    double half_width = 0.0;
+  };
+
   class LaneCrossingCalculator {
   public:
 
@@ -25,6 +44,23 @@ namespace element {
         const Map &map,
         const geom::Location &origin,
         const geom::Location &destination);
+
+    /// Same as above with the lanes of @a origin and @a destination already
+    /// projected, so the projection of a location can be reused in the next
+    /// calculation.
+    static std::vector<LaneMarking> Calculate(
+        const Map &map,
+        const geom::Location &origin,
+        const LaneProjection &origin_lane,
+        const geom::Location &destination,
+        const LaneProjection &destination_lane);
+
+    static LaneProjection Project(const Map &map, const geom::Location &location);
+
+    /// Whether @a location is well inside the lane of @a lane and close to
+    /// its waypoint, so it projects to the same lane. Moving between two such
+    /// locations does not cross any lane marking.
+    static bool IsWellInsideLane(const LaneProjection &lane, const geom::Location &location);
   };
 
 } // namespace element
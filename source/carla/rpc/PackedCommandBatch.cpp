@@ -0,0 +1,213 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/rpc/PackedCommandBatch.h"
+
+#include "carla/Exception.h"
+
+#include <cstring>
+
+namespace carla {
+namespace rpc {
+
+  constexpr uint16_t PackedCommandFormat::VERSION;
+  constexpr uint16_t PackedCommandFormat::BYTE_ORDER_MARK;
+  constexpr char PackedCommandFormat::MAGIC[4u];
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  static PackedCommandFormat::TransformRecord MakeTransformRecord(const geom::Transform &transform) {
+    PackedCommandFormat::TransformRecord record;
+    record.location[0u] = transform.location.x;
+    record.location[1u] = transform.location.y;
+    record.location[2u] = transform.location.z;
+    record.rotation[0u] = transform.rotation.pitch;
+    record.rotation[1u] = transform.rotation.yaw;
+    record.rotation[2u] = transform.rotation.roll;
+    return record;
+  }
+
+  static geom::Transform MakeTransform(const PackedCommandFormat::TransformRecord &record) {
+    return geom::Transform(
+        geom::Location(record.location[0u], record.location[1u], record.location[2u]),
+        geom::Rotation(record.rotation[0u], record.rotation[1u], record.rotation[2u]));
+  }
+
+  /// Copies the next @a count records of @a data, advancing @a offset.
+  template <typename T>
+  static void ReadColumn(
+      const unsigned char *data,
+      const size_t size,
+      size_t &offset,
+      const size_t count,
+      std::vector<T> &column) {
+    if ((size - offset) / sizeof(T) < count) {
+      throw_exception(clmdep_msgpack::type_error());
+    }
+    column.resize(count);
+    if (count > 0u) {
+      std::memcpy(column.data(), data + offset, count * sizeof(T));
+    }
+    offset += count * sizeof(T);
+  }
+
+  // ===========================================================================
+  // -- PackedCommandBatch -----------------------------------------------------
+  // ===========================================================================
+
+  void PackedCommandBatch::Add(const Command::ApplyVehicleControl &command) {
+    Format::VehicleControlRecord record;
+    record.throttle = command.control.throttle;
+    record.steer = command.control.steer;
+    record.brake = command.control.brake;
+    record.gear = command.control.gear;
+    record.hand_brake = command.control.hand_brake ? 1u : 0u;
+    record.reverse = command.control.reverse ? 1u : 0u;
+    record.manual_gear_shift = command.control.manual_gear_shift ? 1u : 0u;
+    record.padding = 0u;
+    _vehicle_control_actors.emplace_back(command.actor);
+    _vehicle_controls.emplace_back(record);
+  }
+
+  void PackedCommandBatch::Add(const Command::ApplyWalkerState &command) {
+    Format::WalkerStateRecord record;
+    record.transform = MakeTransformRecord(command.transform);
+    record.speed = command.speed;
+    _walker_state_actors.emplace_back(command.actor);
+    _walker_states.emplace_back(record);
+  }
+
+  void PackedCommandBatch::Add(const Command::ApplyTransform &command) {
+    _transform_actors.emplace_back(command.actor);
+    _transforms.emplace_back(MakeTransformRecord(command.transform));
+  }
+
+  bool PackedCommandBatch::TryAdd(const Command &command) {
+    namespace v2 = boost::variant2;
+    if (const auto *vehicle_control = v2::get_if<Command::ApplyVehicleControl>(&command.command)) {
+      Add(*vehicle_control);
+    } else if (const auto *walker_state = v2::get_if<Command::ApplyWalkerState>(&command.command)) {
+      Add(*walker_state);
+    } else if (const auto *transform = v2::get_if<Command::ApplyTransform>(&command.command)) {
+      Add(*transform);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  void PackedCommandBatch::Append(const Command &command) {
+    if (!TryAdd(command)) {
+      _commands.emplace_back(command);
+    }
+  }
+
+  void PackedCommandBatch::clear() {
+    _vehicle_control_actors.clear();
+    _vehicle_controls.clear();
+    _walker_state_actors.clear();
+    _walker_states.clear();
+    _transform_actors.clear();
+    _transforms.clear();
+    _commands.clear();
+  }
+
+  std::vector<Command> PackedCommandBatch::ToCommands() const {
+    std::vector<Command> commands;
+    commands.reserve(size());
+    ForEach([&](const auto &command) {
+      commands.emplace_back(command);
+    });
+    return commands;
+  }
+
+  size_t PackedCommandBatch::GetEncodedSize() const {
+    return
+        sizeof(Format::Header) +
+        _vehicle_controls.size() * (sizeof(ActorId) + sizeof(Format::VehicleControlRecord)) +
+        _walker_states.size() * (sizeof(ActorId) + sizeof(Format::WalkerStateRecord)) +
+        _transforms.size() * (sizeof(ActorId) + sizeof(Format::TransformRecord));
+  }
+
+  void PackedCommandBatch::msgpack_unpack(const clmdep_msgpack::object &object) {
+    const clmdep_msgpack::object *blob = &object;
+    _commands.clear();
+    if (object.type == clmdep_msgpack::type::ARRAY) {
+      if (object.via.array.size != 2u) {
+        throw_exception(clmdep_msgpack::type_error());
+      }
+      blob = &object.via.array.ptr[0u];
+      object.via.array.ptr[1u].convert(_commands);
+    }
+    if (blob->type != clmdep_msgpack::type::BIN) {
+      throw_exception(clmdep_msgpack::type_error());
+    }
+    Decode(reinterpret_cast<const unsigned char *>(blob->via.bin.ptr), blob->via.bin.size);
+  }
+
+  Command::ApplyVehicleControl PackedCommandBatch::MakeCommand(
+      const ActorId actor,
+      const Format::VehicleControlRecord &record) {
+    return Command::ApplyVehicleControl{actor, VehicleControl(
+        record.throttle,
+        record.steer,
+        record.brake,
+        record.hand_brake != 0u,
+        record.reverse != 0u,
+        record.manual_gear_shift != 0u,
+        record.gear)};
+  }
+
+  Command::ApplyWalkerState PackedCommandBatch::MakeCommand(
+      const ActorId actor,
+      const Format::WalkerStateRecord &record) {
+    return Command::ApplyWalkerState{actor, MakeTransform(record.transform), record.speed};
+  }
+
+  Command::ApplyTransform PackedCommandBatch::MakeCommand(
+      const ActorId actor,
+      const Format::TransformRecord &record) {
+    return Command::ApplyTransform{actor, MakeTransform(record)};
+  }
+
+  PackedCommandFormat::Header PackedCommandBatch::MakeHeader() const {
+    Format::Header header;
+    std::memcpy(header.magic, Format::MAGIC, sizeof(header.magic));
+    header.version = Format::VERSION;
+    header.byte_order = Format::BYTE_ORDER_MARK;
+    header.vehicle_control_count = static_cast<uint32_t>(_vehicle_controls.size());
+    header.walker_state_count = static_cast<uint32_t>(_walker_states.size());
+    header.transform_count = static_cast<uint32_t>(_transforms.size());
+    return header;
+  }
+
+  void PackedCommandBatch::Decode(const unsigned char *data, const size_t size) {
+    Format::Header header;
+    if (size < sizeof(header)) {
+      throw_exception(clmdep_msgpack::type_error());
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if ((std::memcmp(header.magic, Format::MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != Format::VERSION) ||
+        (header.byte_order != Format::BYTE_ORDER_MARK)) {
+      throw_exception(clmdep_msgpack::type_error());
+    }
+    size_t offset = sizeof(header);
+    ReadColumn(data, size, offset, header.vehicle_control_count, _vehicle_control_actors);
+    ReadColumn(data, size, offset, header.vehicle_control_count, _vehicle_controls);
+    ReadColumn(data, size, offset, header.walker_state_count, _walker_state_actors);
+    ReadColumn(data, size, offset, header.walker_state_count, _walker_states);
+    ReadColumn(data, size, offset, header.transform_count, _transform_actors);
+    ReadColumn(data, size, offset, header.transform_count, _transforms);
+    if (offset != size) {
+      throw_exception(clmdep_msgpack::type_error());
+    }
+  }
+
+} // namespace rpc
+} // namespace carla
@@ -0,0 +1,199 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/MsgPack.h"
+#include "carla/rpc/ActorId.h"
+#include "carla/rpc/Command.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace carla {
+namespace rpc {
+
+  /// Binary layout of a PackedCommandBatch. All the values are in the byte
+  /// order of the client, checked by the server with the header.
+  struct PackedCommandFormat {
+
+    static constexpr uint16_t VERSION = 1u;
+
+    static constexpr uint16_t BYTE_ORDER_MARK = 0x0102u;
+
+    static constexpr char MAGIC[4u] = {'C', 'P', 'C', 'B'};
+
+    /// Followed, for each kind of command in the order of the counts, by a
+    /// column of ActorId and a column of records.
+    struct Header {
+      char magic[4u];
+      uint16_t version;
+      uint16_t byte_order;
+      uint32_t vehicle_control_count;
+      uint32_t walker_state_count;
+      uint32_t transform_count;
+    };
+
+    struct VehicleControlRecord {
+      float throttle;
+      float steer;
+      float brake;
+      int32_t gear;
+      uint8_t hand_brake;
+      uint8_t reverse;
+      uint8_t manual_gear_shift;
+      uint8_t padding;
+    };
+
+    struct TransformRecord {
+      float location[3u];
+      float rotation[3u]; ///< Pitch, yaw and roll.
+    };
+
+    struct WalkerStateRecord {
+      TransformRecord transform;
+      float speed;
+    };
+
+    static_assert(sizeof(Header) == 20u, "Invalid packed header size");
+    static_assert(sizeof(VehicleControlRecord) == 20u, "Invalid packed vehicle control size");
+    static_assert(sizeof(TransformRecord) == 24u, "Invalid packed transform size");
+    static_assert(sizeof(WalkerStateRecord) == 28u, "Invalid packed walker state size");
+  };
+
+  /// Batch of the homogeneous commands sent every tick, ApplyVehicleControl,
+  /// ApplyWalkerState and ApplyTransform, stored as columns of plain records.
+  ///
+  /// It is sent as a single msgpack binary blob: a header, then for each kind
+  /// of command a column of actor ids and a column of records. Encoding
+  /// writes the columns straight into the msgpack buffer and decoding copies
+  /// them back, without a msgpack object per command. Commands of any other
+  /// kind added with Append follow the blob as a regular msgpack array, so a
+  /// whole control frame goes in a single call.
+  ///
+  /// The server handles it with the "apply_packed_batch" binding, applying
+  /// first the vehicle controls, then the walker states, then the transforms
+  /// and then the other commands, each in the order they were added.
+  class PackedCommandBatch {
+  public:
+
+    using Format = PackedCommandFormat;
+
+    void Add(const Command::ApplyVehicleControl &command);
+
+    void Add(const Command::ApplyWalkerState &command);
+
+    void Add(const Command::ApplyTransform &command);
+
+    /// Adds @a command if it is one of the packed kinds, otherwise returns
+    /// false.
+    bool TryAdd(const Command &command);
+
+    /// Adds @a command packed if it is one of the packed kinds, otherwise as
+    /// is, to be applied after the packed ones.
+    void Append(const Command &command);
+
+    size_t size() const {
+      return
+          _vehicle_controls.size() + _walker_states.size() + _transforms.size() +
+          _commands.size();
+    }
+
+    bool empty() const {
+      return size() == 0u;
+    }
+
+    /// Removes the commands, keeping the allocated memory.
+    void clear();
+
+    /// Calls @a visitor with each command, as Command::ApplyVehicleControl,
+    /// Command::ApplyWalkerState or Command::ApplyTransform, and then with
+    /// each other command as a Command, in the order they are applied.
+    template <typename VisitorT>
+    void ForEach(VisitorT &&visitor) const;
+
+    /// The commands as variants, to send them through "apply_batch".
+    std::vector<Command> ToCommands() const;
+
+    /// Size of the binary blob, without the other commands.
+    size_t GetEncodedSize() const;
+
+    template <typename Packer>
+    void msgpack_pack(Packer &packer) const {
+      // Without other commands the batch is just the blob.
+      if (!_commands.empty()) {
+        packer.pack_array(2u);
+      }
+      const Format::Header header = MakeHeader();
+      packer.pack_bin(static_cast<uint32_t>(GetEncodedSize()));
+      packer.pack_bin_body(reinterpret_cast<const char *>(&header), sizeof(header));
+      PackColumns(packer, _vehicle_control_actors, _vehicle_controls);
+      PackColumns(packer, _walker_state_actors, _walker_states);
+      PackColumns(packer, _transform_actors, _transforms);
+      if (!_commands.empty()) {
+        packer.pack(_commands);
+      }
+    }
+
+    /// @throw clmdep_msgpack::type_error if @a object is not a valid batch.
+    void msgpack_unpack(const clmdep_msgpack::object &object);
+
+  private:
+
+    template <typename Packer, typename RecordT>
+    static void PackColumns(Packer &packer, const std::vector<ActorId> &actors, const std::vector<RecordT> &records) {
+      if (!actors.empty()) {
+        packer.pack_bin_body(reinterpret_cast<const char *>(actors.data()), actors.size() * sizeof(ActorId));
+        packer.pack_bin_body(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(RecordT));
+      }
+    }
+
+    static Command::ApplyVehicleControl MakeCommand(ActorId actor, const Format::VehicleControlRecord &record);
+
+    static Command::ApplyWalkerState MakeCommand(ActorId actor, const Format::WalkerStateRecord &record);
+
+    static Command::ApplyTransform MakeCommand(ActorId actor, const Format::TransformRecord &record);
+
+    Format::Header MakeHeader() const;
+
+    /// @throw clmdep_msgpack::type_error if @a data is not a valid batch.
+    void Decode(const unsigned char *data, size_t size);
+
+    std::vector<ActorId> _vehicle_control_actors;
+
+    std::vector<Format::VehicleControlRecord> _vehicle_controls;
+
+    std::vector<ActorId> _walker_state_actors;
+
+    std::vector<Format::WalkerStateRecord> _walker_states;
+
+    std::vector<ActorId> _transform_actors;
+
+    std::vector<Format::TransformRecord> _transforms;
+
+    /// Commands that cannot be packed.
+    std::vector<Command> _commands;
+  };
+
+  template <typename VisitorT>
+  void PackedCommandBatch::ForEach(VisitorT &&visitor) const {
+    for (size_t i = 0u; i < _vehicle_controls.size(); ++i) {
+      visitor(MakeCommand(_vehicle_control_actors[i], _vehicle_controls[i]));
+    }
+    for (size_t i = 0u; i < _walker_states.size(); ++i) {
+      visitor(MakeCommand(_walker_state_actors[i], _walker_states[i]));
+    }
+    for (size_t i = 0u; i < _transforms.size(); ++i) {
+      visitor(MakeCommand(_transform_actors[i], _transforms[i]));
+    }
+    for (const auto &command : _commands) {
+      visitor(command);
+    }
+  }
+
+} // namespace rpc
+} // namespace carla
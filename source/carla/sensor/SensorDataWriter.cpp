@@ -0,0 +1,147 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/sensor/SensorDataWriter.h"
+
+#include "carla/Exception.h"
+#include "carla/FileSystem.h"
+#include "carla/Logging.h"
+#include "carla/StopWatch.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+
+namespace carla {
+namespace sensor {
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  static uint64_t GetFileSize(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<uint64_t>(file.tellg()) : 0u;
+  }
+
+  // ===========================================================================
+  // -- SensorDataWriter -------------------------------------------------------
+  // ===========================================================================
+
+  SensorDataWriter::SensorDataWriter(SensorDataWriterOptions options)
+    : _options(std::move(options)) {
+    _workers.CreateThreads(std::max<size_t>(1u, _options.worker_threads), [this]() { Run(); });
+  }
+
+  SensorDataWriter::~SensorDataWriter() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _not_empty.notify_all();
+    _workers.JoinAll();
+  }
+
+  bool SensorDataWriter::WriteBuffer(std::string path, Buffer &&buffer) {
+    auto data = std::make_shared<Buffer>(std::move(buffer));
+    return Push([data=std::move(data)](std::string &path) {
+      WriteBytes(path, data->data(), data->size());
+    }, std::move(path));
+  }
+
+  void SensorDataWriter::Flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _queue.empty() && (_running_writes == 0u); });
+  }
+
+  SensorDataWriterStats SensorDataWriter::GetStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto stats = _stats;
+    stats.queue_depth = _queue.size();
+    return stats;
+  }
+
+  void SensorDataWriter::WriteBytes(std::string &path, const void *data, const size_t size) {
+    FileSystem::ValidateFilePath(path);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+    if (!out) {
+      throw_exception(std::runtime_error("failed to write " + path));
+    }
+  }
+
+  bool SensorDataWriter::Push(Task task, std::string path) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      const size_t max_queue_size = std::max<size_t>(1u, _options.max_queue_size);
+      if (_queue.size() >= max_queue_size) {
+        if (_options.backpressure == WriteBackpressure::Drop) {
+          ++_stats.writes_dropped;
+          return false;
+        }
+        _not_full.wait(lock, [&]() { return _queue.size() < max_queue_size; });
+      }
+      _queue.push_back(Write{std::move(task), std::move(path)});
+      _stats.max_queue_depth = std::max(_stats.max_queue_depth, _queue.size());
+    }
+    _not_empty.notify_one();
+    return true;
+  }
+
+  void SensorDataWriter::Run() {
+    for (;;) {
+      Write write;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        // Pending writes are completed before stopping.
+        _not_empty.wait(lock, [this]() { return _stop || !_queue.empty(); });
+        if (_queue.empty()) {
+          return;
+        }
+        write = std::move(_queue.front());
+        _queue.pop_front();
+        ++_running_writes;
+      }
+      _not_full.notify_one();
+
+      bool succeeded = false;
+      uint64_t size = 0u;
+      StopWatch stop_watch;
+      try {
+        write.task(write.path);
+        size = GetFileSize(write.path);
+        succeeded = true;
+      } catch (const std::exception &e) {
+        log_error("SensorDataWriter: failed to write", write.path, ':', e.what());
+      }
+      stop_watch.Stop();
+      const uint64_t elapsed = stop_watch.GetElapsedTime<std::chrono::microseconds>();
+      // Release the data before reporting the write as completed.
+      write.task = nullptr;
+
+      bool idle = false;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_running_writes;
+        if (succeeded) {
+          ++_stats.files_written;
+          _stats.bytes_written += size;
+        } else {
+          ++_stats.writes_failed;
+        }
+        _stats.total_write_time_us += elapsed;
+        _stats.max_write_time_us = std::max(_stats.max_write_time_us, elapsed);
+        idle = _queue.empty() && (_running_writes == 0u);
+      }
+      if (idle) {
+        _idle.notify_all();
+      }
+    }
+  }
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,199 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Buffer.h"
+#include "carla/Debug.h"
+#include "carla/Memory.h"
+#include "carla/NonCopyable.h"
+#include "carla/ThreadGroup.h"
+#include "carla/image/ImageIO.h"
+#include "carla/image/ImageView.h"
+#include "carla/pointcloud/PointCloudIO.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace carla {
+namespace sensor {
+
+  /// What SensorDataWriter does with a write when its queue is full.
+  enum class WriteBackpressure {
+    /// Block the caller until there is room in the queue.
+    Block,
+    /// Discard the write, counted in the statistics.
+    Drop
+  };
+
+  struct SensorDataWriterOptions {
+    /// Threads encoding and writing the queued data, at least one.
+    size_t worker_threads = 2u;
+
+    /// Maximum number of writes waiting for a worker.
+    size_t max_queue_size = 64u;
+
+    WriteBackpressure backpressure = WriteBackpressure::Block;
+
+    /// Encoder settings of the images.
+    image::ImageWriteOptions image;
+
+    /// Write the bytes of the images and point clouds as they are in memory
+    /// instead of encoding them. Paths are used as given.
+    bool raw = false;
+  };
+
+  struct SensorDataWriterStats {
+    /// Writes waiting for a worker.
+    size_t queue_depth = 0u;
+
+    /// Largest queue depth seen.
+    size_t max_queue_depth = 0u;
+
+    size_t files_written = 0u;
+
+    size_t writes_dropped = 0u;
+
+    /// Writes that threw, the error is logged.
+    size_t writes_failed = 0u;
+
+    /// Size of the files written.
+    uint64_t bytes_written = 0u;
+
+    /// Time spent encoding and writing the files, in microseconds.
+    uint64_t total_write_time_us = 0u;
+
+    /// Longest time spent encoding and writing a single file, in microseconds.
+    uint64_t max_write_time_us = 0u;
+  };
+
+  /// Bounded write-behind queue that encodes and writes sensor data to disk
+  /// from a pool of worker threads, so sensor callbacks return right away.
+  ///
+  /// The data is handed over by shared pointer or by move and is released
+  /// once written, it is never copied. Writes are started in the order they
+  /// are queued, but with several workers they may complete out of order.
+  class SensorDataWriter : private NonCopyable {
+  public:
+
+    explicit SensorDataWriter(SensorDataWriterOptions options = SensorDataWriterOptions());
+
+    /// Waits for the queued writes and joins the workers.
+    ~SensorDataWriter();
+
+    /// Queues writing @a image, the format is deduced from the extension of
+    /// @a path as in ImageIO::WriteView. Returns false if the write was
+    /// dropped.
+    template <typename ImageT>
+    bool WriteImage(std::string path, SharedPtr<ImageT> image) {
+      DEBUG_ASSERT(image != nullptr);
+      if (_options.raw) {
+        return WriteRaw(std::move(path), image);
+      }
+      const auto options = _options.image;
+      return Push([image=std::move(image), options](std::string &path) {
+        path = image::ImageIO::WriteView(
+            std::move(path),
+            image::ImageView::MakeView(*image),
+            options);
+      }, std::move(path));
+    }
+
+    /// Same as above converting the pixels with @a converter, the conversion
+    /// runs in the worker too.
+    template <typename ImageT, typename ColorConverterT>
+    bool WriteImage(std::string path, SharedPtr<ImageT> image, ColorConverterT converter) {
+      DEBUG_ASSERT(image != nullptr);
+      if (_options.raw) {
+        return WriteRaw(std::move(path), image);
+      }
+      const auto options = _options.image;
+      return Push([image=std::move(image), converter, options](std::string &path) {
+        path = image::ImageIO::WriteView(
+            std::move(path),
+            image::ImageView::MakeColorConvertedView(image::ImageView::MakeView(*image), converter),
+            options);
+      }, std::move(path));
+    }
+
+    /// Queues writing the points of @a measurement in @a format.
+    template <typename MeasurementT>
+    bool WritePointCloud(
+        std::string path,
+        SharedPtr<MeasurementT> measurement,
+        pointcloud::PointCloudFormat format = pointcloud::PointCloudFormat::AsciiPly) {
+      DEBUG_ASSERT(measurement != nullptr);
+      if (_options.raw) {
+        return WriteRaw(std::move(path), measurement);
+      }
+      return Push([measurement=std::move(measurement), format](std::string &path) {
+        path = pointcloud::PointCloudIO::SaveToDisk(
+            std::move(path),
+            measurement->begin(),
+            measurement->end(),
+            format);
+      }, std::move(path));
+    }
+
+    /// Queues writing the bytes of @a buffer as they are.
+    bool WriteBuffer(std::string path, Buffer &&buffer);
+
+    /// Blocks until every queued write has completed.
+    void Flush();
+
+    SensorDataWriterStats GetStats() const;
+
+  private:
+
+    using Task = std::function<void(std::string &path)>;
+
+    /// Writes the items of the array @a data as they are in memory.
+    template <typename ArrayT>
+    bool WriteRaw(std::string path, SharedPtr<ArrayT> data) {
+      return Push([data=std::move(data)](std::string &path) {
+        WriteBytes(path, data->data(), data->size() * sizeof(*data->data()));
+      }, std::move(path));
+    }
+
+    static void WriteBytes(std::string &path, const void *data, size_t size);
+
+    bool Push(Task task, std::string path);
+
+    void Run();
+
+    struct Write {
+      Task task;
+      std::string path;
+    };
+
+    const SensorDataWriterOptions _options;
+
+    mutable std::mutex _mutex;
+
+    std::condition_variable _not_empty;
+
+    std::condition_variable _not_full;
+
+    std::condition_variable _idle;
+
+    std::deque<Write> _queue;
+
+    size_t _running_writes = 0u;
+
+    bool _stop = false;
+
+    SensorDataWriterStats _stats;
+
+    ThreadGroup _workers;
+  };
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,230 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/sensor/StreamRecorder.h"
+
+#include "carla/Exception.h"
+#include "carla/FileSystem.h"
+#include "carla/Logging.h"
+#include "carla/ParallelFor.h"
+#include "carla/sensor/s11n/SensorHeaderSerializer.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+
+namespace carla {
+namespace sensor {
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  template <typename T>
+  static void AppendBytes(std::vector<unsigned char> &data, const T &value) {
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+  }
+
+  template <typename T>
+  static void WriteValue(std::ofstream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  // ===========================================================================
+  // -- StreamRecorder ---------------------------------------------------------
+  // ===========================================================================
+
+  StreamRecorder::StreamRecorder(std::string path, StreamRecorderOptions options)
+    : _path([&]() {
+        FileSystem::ValidateFilePath(path, ".rec");
+        return std::move(path);
+      }()),
+      _options(std::move(options)),
+      _chunk(MakeChunk(_options.chunk_size)),
+      _file(_path, std::ios::binary | std::ios::trunc) {
+    Format::FileHeader header;
+    std::memcpy(header.magic, Format::FILE_MAGIC, sizeof(header.magic));
+    header.version = Format::VERSION;
+    header.reserved = 0u;
+    WriteValue(_file, header);
+    if (!_file) {
+      throw_exception(std::runtime_error(_path + ": failed to create the recording"));
+    }
+    _file_size = sizeof(header);
+    _writer = std::thread(&StreamRecorder::RunWriter, this);
+  }
+
+  StreamRecorder::~StreamRecorder() {
+    try {
+      Close();
+    } catch (const std::exception &e) {
+      log_error("StreamRecorder:", e.what());
+    }
+  }
+
+  void StreamRecorder::Append(const uint64_t stream_id, const Buffer &buffer) {
+    using HeaderSerializer = s11n::SensorHeaderSerializer;
+    Format::RecordHeader record;
+    record.stream_id = stream_id;
+    record.frame = 0u;
+    record.timestamp = 0.0;
+    record.size = buffer.size();
+    record.reserved = 0u;
+    if (buffer.size() >= HeaderSerializer::header_offset) {
+      const auto &header = HeaderSerializer::Deserialize(buffer);
+      record.frame = header.frame;
+      record.timestamp = header.timestamp;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_closed) {
+      return;
+    }
+    auto &data = _chunk.data;
+    AppendBytes(data, record);
+    data.insert(data.end(), buffer.begin(), buffer.end());
+    data.resize(Format::AlignRecord(data.size()), 0u);
+
+    auto &index = _chunk.index;
+    if (index.record_count == 0u) {
+      index.min_frame = index.max_frame = record.frame;
+      index.min_timestamp = index.max_timestamp = record.timestamp;
+    } else {
+      index.min_frame = std::min(index.min_frame, record.frame);
+      index.max_frame = std::max(index.max_frame, record.frame);
+      index.min_timestamp = std::min(index.min_timestamp, record.timestamp);
+      index.max_timestamp = std::max(index.max_timestamp, record.timestamp);
+    }
+    ++index.record_count;
+
+    if (data.size() < _options.chunk_size) {
+      return;
+    }
+    _queue.emplace_back(std::move(_chunk));
+    _chunk = MakeChunk(_options.chunk_size);
+    lock.unlock();
+    _queue_ready.notify_one();
+  }
+
+  void StreamRecorder::Close() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_closed) {
+        return;
+      }
+      _closed = true;
+      _queue.emplace_back(std::move(_chunk));
+    }
+    _queue_ready.notify_one();
+    // Returns once every chunk queued is written.
+    _writer.join();
+    if (_write_failed) {
+      _file.close();
+      throw_exception(std::runtime_error(_path + ": failed to write a chunk"));
+    }
+
+    Format::Footer footer;
+    footer.index_offset = _file_size;
+    footer.chunk_count = _index.size();
+    std::memcpy(footer.magic, Format::FOOTER_MAGIC, sizeof(footer.magic));
+    _file.write(
+        reinterpret_cast<const char *>(_index.data()),
+        static_cast<std::streamsize>(_index.size() * sizeof(Format::ChunkIndex)));
+    WriteValue(_file, footer);
+    _file.close();
+    if (!_file) {
+      throw_exception(std::runtime_error(_path + ": failed to write the recording index"));
+    }
+  }
+
+  StreamRecorder::Chunk StreamRecorder::MakeChunk(const size_t capacity) {
+    Chunk chunk;
+    chunk.data.reserve(capacity);
+    std::memset(&chunk.index, 0, sizeof(chunk.index));
+    std::memset(&chunk.header, 0, sizeof(chunk.header));
+    return chunk;
+  }
+
+  void StreamRecorder::EncodeChunk(Chunk &chunk) const {
+    auto &header = chunk.header;
+    std::memcpy(header.magic, Format::CHUNK_MAGIC, sizeof(header.magic));
+    header.compression = Format::None;
+    header.raw_size = chunk.data.size();
+    header.stored_size = chunk.data.size();
+    if (!_options.compress || (chunk.index.record_count == 0u)) {
+      return;
+    }
+    uLongf size = compressBound(static_cast<uLong>(chunk.data.size()));
+    std::vector<unsigned char> compressed(size);
+    const int result = compress2(
+        compressed.data(),
+        &size,
+        chunk.data.data(),
+        static_cast<uLong>(chunk.data.size()),
+        _options.compression_level);
+    // Chunks that fail to compress are stored as they are, so this does not
+    // throw and skip the turn of the chunk.
+    if (result != Z_OK) {
+      log_warning("StreamRecorder: failed to compress a chunk, storing it uncompressed");
+      return;
+    }
+    compressed.resize(size);
+    chunk.data = std::move(compressed);
+    header.compression = Format::Zlib;
+    header.stored_size = size;
+  }
+
+  void StreamRecorder::RunWriter() {
+    std::vector<Chunk> chunks;
+    while (true) {
+      chunks.clear();
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _queue_ready.wait(lock, [this]() { return _closed || !_queue.empty(); });
+        if (_queue.empty()) {
+          return;
+        }
+        std::move(_queue.begin(), _queue.end(), std::back_inserter(chunks));
+        _queue.clear();
+      }
+      try {
+        ParallelFor(chunks.size(), [&](const size_t i) { EncodeChunk(chunks[i]); });
+        for (auto &chunk : chunks) {
+          WriteChunk(chunk);
+        }
+      } catch (const std::exception &e) {
+        log_error("StreamRecorder:", _path, ":", e.what());
+        _write_failed = true;
+      }
+    }
+  }
+
+  void StreamRecorder::WriteChunk(Chunk &chunk) {
+    if ((chunk.index.record_count == 0u) || _write_failed) {
+      return;
+    }
+    const auto &header = chunk.header;
+    chunk.index.offset = _file_size;
+    WriteValue(_file, header);
+    _file.write(
+        reinterpret_cast<const char *>(chunk.data.data()),
+        static_cast<std::streamsize>(header.stored_size));
+    if (!_file) {
+      log_error("StreamRecorder:", _path, ": failed to write a chunk");
+      _write_failed = true;
+      return;
+    }
+    _file_size += sizeof(header) + header.stored_size;
+    _index.push_back(chunk.index);
+  }
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,124 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Buffer.h"
+#include "carla/NonCopyable.h"
+#include "carla/sensor/StreamRecordingFormat.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace carla {
+namespace sensor {
+
+  struct StreamRecorderOptions {
+    /// Size of the uncompressed records gathered before writing a chunk.
+    size_t chunk_size = 4u << 20u;
+
+    /// Compress the chunks with zlib.
+    bool compress = false;
+
+    /// zlib compression level, from 1 (fastest) to 9.
+    int compression_level = 1;
+  };
+
+  /// Appends the raw buffers received from the simulator streams, sensor
+  /// header included, into a chunked file that StreamReplayer reads back.
+  ///
+  /// Records are gathered in memory and written a chunk at a time, with an
+  /// index of the frames of each chunk written at the end of the file on
+  /// Close. Full chunks are queued to a writer thread, so the stream threads
+  /// appending never wait for the disk. The writer compresses the chunks
+  /// queued at once in parallel, and writes them in the order they were
+  /// filled. The queue is not bounded, a disk slower than the streams keeps
+  /// the chunks in memory until Close.
+  class StreamRecorder : private NonCopyable {
+  public:
+
+    /// Stream id of the episode state stream.
+    static constexpr uint64_t EPISODE_STREAM_ID = 0u;
+
+    /// @throw std::runtime_error if the file cannot be created.
+    explicit StreamRecorder(std::string path, StreamRecorderOptions options = StreamRecorderOptions());
+
+    /// Closes the file if still open.
+    ~StreamRecorder();
+
+    /// Appends @a buffer received from stream @a stream_id, as the actor id
+    /// of the sensor or EPISODE_STREAM_ID. Thread-safe.
+    void Append(uint64_t stream_id, const Buffer &buffer);
+
+    /// Writes the pending records and the chunk index, appending afterwards
+    /// is ignored.
+    ///
+    /// @throw std::runtime_error if a chunk or the index failed to be written.
+    void Close();
+
+    const std::string &GetPath() const {
+      return _path;
+    }
+
+  private:
+
+    using Format = StreamRecordingFormat;
+
+    struct Chunk {
+      std::vector<unsigned char> data;
+      Format::ChunkIndex index;
+      Format::ChunkHeader header;
+    };
+
+    static Chunk MakeChunk(size_t capacity);
+
+    /// Compresses the data of @a chunk if enabled and fills its header.
+    void EncodeChunk(Chunk &chunk) const;
+
+    /// Writes the queued chunks until closed and the queue is empty.
+    void RunWriter();
+
+    /// Writes @a chunk at the end of the file. Called by the writer thread
+    /// only.
+    void WriteChunk(Chunk &chunk);
+
+    const std::string _path;
+
+    const StreamRecorderOptions _options;
+
+    /// Guards _chunk, _closed and _queue.
+    std::mutex _mutex;
+
+    /// Notified when a chunk is queued or the recorder is closed.
+    std::condition_variable _queue_ready;
+
+    Chunk _chunk;
+
+    bool _closed = false;
+
+    /// Full chunks waiting for the writer, in the order they were filled.
+    std::deque<Chunk> _queue;
+
+    /// Owned by the writer thread until it is joined.
+    std::ofstream _file;
+
+    uint64_t _file_size = 0u;
+
+    std::vector<Format::ChunkIndex> _index;
+
+    bool _write_failed = false;
+
+    std::thread _writer;
+  };
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,91 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <cstdint>
+
+namespace carla {
+namespace sensor {
+
+  /// Layout of the files written by StreamRecorder, little-endian.
+  ///
+  ///   FileHeader
+  ///   ChunkHeader, chunk payload (compressed or not)
+  ///   ...
+  ///   ChunkIndex for each chunk
+  ///   Footer
+  ///
+  /// An uncompressed chunk payload is a sequence of records, each one a
+  /// RecordHeader followed by the bytes of the buffer, padded to
+  /// RECORD_ALIGNMENT. The footer at the end of the file points to the chunk
+  /// index, so a reader seeks to a frame without reading the chunks before.
+  struct StreamRecordingFormat {
+
+    static constexpr uint32_t VERSION = 1u;
+
+    static constexpr uint32_t RECORD_ALIGNMENT = 8u;
+
+    enum Compression : uint32_t {
+      None = 0u,
+      Zlib = 1u
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader {
+      char magic[8u];
+      uint32_t version;
+      uint32_t reserved;
+    };
+
+    struct ChunkHeader {
+      char magic[4u];
+      uint32_t compression;
+      uint64_t raw_size;
+      uint64_t stored_size;
+    };
+
+    struct RecordHeader {
+      uint64_t stream_id;
+      uint64_t frame;
+      double timestamp;
+      uint32_t size;
+      uint32_t reserved;
+    };
+
+    struct ChunkIndex {
+      /// Offset of the ChunkHeader from the start of the file.
+      uint64_t offset;
+      /// Frame range of the records, streams may deliver frames slightly out
+      /// of order.
+      uint64_t min_frame;
+      uint64_t max_frame;
+      double min_timestamp;
+      double max_timestamp;
+      uint32_t record_count;
+      uint32_t reserved;
+    };
+
+    struct Footer {
+      uint64_t index_offset;
+      uint64_t chunk_count;
+      char magic[8u];
+    };
+#pragma pack(pop)
+
+    static constexpr const char *FILE_MAGIC = "CARLAREC";
+
+    static constexpr const char *CHUNK_MAGIC = "CHNK";
+
+    static constexpr const char *FOOTER_MAGIC = "CARLAIDX";
+
+    static constexpr uint64_t AlignRecord(uint64_t size) {
+      return (size + RECORD_ALIGNMENT - 1u) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+    }
+  };
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,236 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/sensor/StreamReplayer.h"
+
+#include "carla/Exception.h"
+#include "carla/sensor/Deserializer.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace carla {
+namespace sensor {
+
+  namespace ipc = boost::interprocess;
+
+  struct StreamReplayer::Mapping {
+    ipc::file_mapping file;
+    ipc::mapped_region region;
+  };
+
+  /// Records of a chunk, in place in the mapped file if not compressed.
+  struct StreamReplayer::DecodedChunk {
+    const unsigned char *data = nullptr;
+    size_t size = 0u;
+    std::vector<unsigned char> storage;
+  };
+
+  // ===========================================================================
+  // -- Static local methods ---------------------------------------------------
+  // ===========================================================================
+
+  template <typename T>
+  static T ReadValue(const unsigned char *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+  }
+
+  // ===========================================================================
+  // -- StreamReplayer ---------------------------------------------------------
+  // ===========================================================================
+
+  StreamReplayer::StreamReplayer(const std::string &path)
+    : _path(path),
+      _pool(std::make_shared<BufferPool>()) {
+    try {
+      _mapping = std::make_unique<Mapping>();
+      _mapping->file = ipc::file_mapping(path.c_str(), ipc::read_only);
+      _mapping->region = ipc::mapped_region(_mapping->file, ipc::read_only);
+    } catch (const ipc::interprocess_exception &e) {
+      throw_exception(std::runtime_error(path + ": " + e.what()));
+    }
+    _data = static_cast<const unsigned char *>(_mapping->region.get_address());
+    _size = _mapping->region.get_size();
+
+    if (_size < sizeof(Format::FileHeader) + sizeof(Format::Footer)) {
+      throw_exception(std::runtime_error(path + ": not a recording"));
+    }
+    const auto header = ReadValue<Format::FileHeader>(_data);
+    if (std::memcmp(header.magic, Format::FILE_MAGIC, sizeof(header.magic)) != 0) {
+      throw_exception(std::runtime_error(path + ": not a recording"));
+    }
+    if (header.version != Format::VERSION) {
+      throw_exception(std::runtime_error(path + ": unsupported recording version"));
+    }
+    const auto footer = ReadValue<Format::Footer>(_data + _size - sizeof(Format::Footer));
+    if (std::memcmp(footer.magic, Format::FOOTER_MAGIC, sizeof(footer.magic)) != 0) {
+      throw_exception(std::runtime_error(path + ": recording not closed, the index is missing"));
+    }
+    const uint64_t index_end = _size - sizeof(Format::Footer);
+    if ((footer.index_offset > index_end) ||
+        ((index_end - footer.index_offset) != footer.chunk_count * sizeof(Format::ChunkIndex))) {
+      throw_exception(std::runtime_error(path + ": invalid recording index"));
+    }
+    _index.resize(footer.chunk_count);
+    std::memcpy(_index.data(), _data + footer.index_offset, _index.size() * sizeof(Format::ChunkIndex));
+  }
+
+  StreamReplayer::~StreamReplayer() = default;
+
+  uint64_t StreamReplayer::GetFirstFrame() const {
+    uint64_t frame = _index.empty() ? 0u : _index.front().min_frame;
+    for (const auto &chunk : _index) {
+      frame = std::min(frame, chunk.min_frame);
+    }
+    return frame;
+  }
+
+  uint64_t StreamReplayer::GetLastFrame() const {
+    uint64_t frame = 0u;
+    for (const auto &chunk : _index) {
+      frame = std::max(frame, chunk.max_frame);
+    }
+    return frame;
+  }
+
+  size_t StreamReplayer::Replay(
+      const CallbackFunctionType &callback,
+      const StreamReplayerOptions &options) const {
+    std::vector<const Format::ChunkIndex *> chunks;
+    for (const auto &chunk : _index) {
+      if ((chunk.max_frame >= options.first_frame) && (chunk.min_frame <= options.last_frame)) {
+        chunks.emplace_back(&chunk);
+      }
+    }
+    if (chunks.empty()) {
+      return 0u;
+    }
+
+    using clock = std::chrono::steady_clock;
+    bool started = false;
+    clock::time_point start_time;
+    double start_timestamp = 0.0;
+
+    // Decode the next chunk on a thread of its own while this one replays,
+    // the callbacks may wait for the JobSystem.
+    auto decode = [this](const Format::ChunkIndex *chunk) {
+      return std::async(std::launch::async, [this, chunk]() { return Decode(*chunk); });
+    };
+
+    size_t count = 0u;
+    auto next = decode(chunks.front());
+    try {
+      for (size_t i = 0u; i < chunks.size(); ++i) {
+        const DecodedChunk decoded = next.get();
+        if (i + 1u < chunks.size()) {
+          next = decode(chunks[i + 1u]);
+        }
+
+        size_t offset = 0u;
+        while (offset < decoded.size) {
+          if (decoded.size - offset < sizeof(Format::RecordHeader)) {
+            throw_exception(std::runtime_error(_path + ": truncated record"));
+          }
+          const auto record = ReadValue<Format::RecordHeader>(decoded.data + offset);
+          const size_t begin = offset + sizeof(Format::RecordHeader);
+          if (decoded.size - begin < record.size) {
+            throw_exception(std::runtime_error(_path + ": truncated record"));
+          }
+          offset = std::min<size_t>(decoded.size, Format::AlignRecord(begin + record.size));
+          if ((record.frame < options.first_frame) || (record.frame > options.last_frame)) {
+            continue;
+          }
+
+          if (options.speed > 0.0) {
+            if (!started) {
+              started = true;
+              start_time = clock::now();
+              start_timestamp = record.timestamp;
+            } else {
+              const double elapsed = (record.timestamp - start_timestamp) / options.speed;
+              if (elapsed > 0.0) {
+                std::this_thread::sleep_until(
+                    start_time + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(elapsed)));
+              }
+            }
+          }
+
+          Buffer buffer = _pool->Pop();
+          buffer.copy_from(decoded.data + begin, record.size);
+          callback(record.stream_id, std::move(buffer));
+          ++count;
+        }
+      }
+    } catch (...) {
+      // The decoding job references this replayer.
+      if (next.valid()) {
+        next.wait();
+      }
+      throw;
+    }
+    return count;
+  }
+
+  size_t StreamReplayer::ReplaySensorData(
+      const SensorDataCallbackFunctionType &callback,
+      const StreamReplayerOptions &options) const {
+    return Replay([&](const uint64_t stream_id, Buffer buffer) {
+      callback(stream_id, Deserializer::Deserialize(std::move(buffer)));
+    }, options);
+  }
+
+  StreamReplayer::DecodedChunk StreamReplayer::Decode(const Format::ChunkIndex &chunk) const {
+    if ((chunk.offset > _size) || (_size - chunk.offset < sizeof(Format::ChunkHeader))) {
+      throw_exception(std::runtime_error(_path + ": invalid chunk offset"));
+    }
+    const auto header = ReadValue<Format::ChunkHeader>(_data + chunk.offset);
+    const size_t payload_offset = chunk.offset + sizeof(Format::ChunkHeader);
+    if ((std::memcmp(header.magic, Format::CHUNK_MAGIC, sizeof(header.magic)) != 0) ||
+        (_size - payload_offset < header.stored_size)) {
+      throw_exception(std::runtime_error(_path + ": invalid chunk"));
+    }
+    const unsigned char *payload = _data + payload_offset;
+
+    DecodedChunk decoded;
+    switch (header.compression) {
+      case Format::None:
+        decoded.data = payload;
+        decoded.size = header.stored_size;
+        break;
+      case Format::Zlib: {
+        decoded.storage.resize(header.raw_size);
+        uLongf size = static_cast<uLongf>(header.raw_size);
+        const int result = uncompress(
+            decoded.storage.data(),
+            &size,
+            payload,
+            static_cast<uLong>(header.stored_size));
+        if ((result != Z_OK) || (size != header.raw_size)) {
+          throw_exception(std::runtime_error(_path + ": failed to decompress a chunk"));
+        }
+        decoded.data = decoded.storage.data();
+        decoded.size = decoded.storage.size();
+        break;
+      }
+      default:
+        throw_exception(std::runtime_error(_path + ": unknown chunk compression"));
+    }
+    return decoded;
+  }
+
+} // namespace sensor
+} // namespace carla
@@ -0,0 +1,103 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/Buffer.h"
+#include "carla/BufferPool.h"
+#include "carla/Memory.h"
+#include "carla/NonCopyable.h"
+#include "carla/sensor/StreamRecordingFormat.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace carla {
+namespace sensor {
+
+  class SensorData;
+
+  struct StreamReplayerOptions {
+    /// Records with a frame outside [first_frame, last_frame] are skipped.
+    uint64_t first_frame = 0u;
+
+    uint64_t last_frame = std::numeric_limits<uint64_t>::max();
+
+    /// Replay speed relative to the recorded timestamps, 1 replays at
+    /// wall-clock speed. Zero replays as fast as possible.
+    double speed = 0.0;
+  };
+
+  /// Reads back a file written by StreamRecorder, memory-mapped, and calls
+  /// the callbacks with the recorded buffers in the order they were
+  /// recorded, to run the code consuming sensor data without the simulator.
+  ///
+  /// Seeking uses the chunk index at the end of the file, only the chunks
+  /// overlapping the requested frames are read. The next chunk is
+  /// decompressed in a thread of its own while the current one is replayed.
+  class StreamReplayer : private NonCopyable {
+  public:
+
+    using CallbackFunctionType = std::function<void(uint64_t stream_id, Buffer buffer)>;
+
+    using SensorDataCallbackFunctionType = std::function<void(uint64_t stream_id, SharedPtr<SensorData> data)>;
+
+    /// @throw std::runtime_error if @a path is not a complete recording.
+    explicit StreamReplayer(const std::string &path);
+
+    ~StreamReplayer();
+
+    size_t GetChunkCount() const {
+      return _index.size();
+    }
+
+    /// Lowest frame recorded, zero if the recording is empty.
+    uint64_t GetFirstFrame() const;
+
+    /// Highest frame recorded, zero if the recording is empty.
+    uint64_t GetLastFrame() const;
+
+    /// Calls @a callback with each recorded buffer, sensor header included,
+    /// as received from the stream. Returns the number of buffers replayed.
+    size_t Replay(
+        const CallbackFunctionType &callback,
+        const StreamReplayerOptions &options = StreamReplayerOptions()) const;
+
+    /// Same as above passing each buffer through Deserializer::Deserialize,
+    /// as a sensor callback receives it.
+    size_t ReplaySensorData(
+        const SensorDataCallbackFunctionType &callback,
+        const StreamReplayerOptions &options = StreamReplayerOptions()) const;
+
+  private:
+
+    using Format = StreamRecordingFormat;
+
+    struct Mapping;
+
+    struct DecodedChunk;
+
+    DecodedChunk Decode(const Format::ChunkIndex &chunk) const;
+
+    const std::string _path;
+
+    std::unique_ptr<Mapping> _mapping;
+
+    const unsigned char *_data = nullptr;
+
+    size_t _size = 0u;
+
+    std::vector<Format::ChunkIndex> _index;
+
+    std::shared_ptr<BufferPool> _pool;
+  };
+
+} // namespace sensor
+} // namespace carla
@@ -9,6 +9,7 @@
 #include "carla/Debug.h"
 #include "carla/sensor/data/Array.h"
 #include "carla/sensor/data/DVSEvent.h"
+#include "carla/sensor/data/DVSEventKernels.h"
 #include "carla/sensor/data/Color.h"
 #include "carla/sensor/s11n/DVSEventArraySerializer.h"
 
@@ -56,22 +57,50 @@ namespace data {
     ///  Get an event "frame" image for visualization
     std::vector<Color> ToImage() const {
       std::vector<Color> img(GetHeight() * GetWidth());
-      for (const auto &event : *this) {
-        size_t index = (GetWidth() * event.y) + event.x;
-        if (event.pol == true) {
-          // Blue is positive
-          img[index].b = 255u;
-        } else {
-          // Red is negative
-          img[index].r = 255u;
-        }
-      }
+      ToImage(img.data());
       return img;
     }
 
+    /// Same as above, writing into @a image of GetHeight() x GetWidth()
+    /// pixels.
+    void ToImage(Color *image) const {
+      DVSEventKernels::ToImage(data(), size(), GetWidth(), GetHeight(), image);
+    }
+
+    /// Sum of the polarities of the events of each pixel, into @a frame of
+    /// GetHeight() x GetWidth() elements.
+    void ToEventFrame(std::int32_t *frame) const {
+      DVSEventKernels::ToEventFrame(data(), size(), GetWidth(), GetHeight(), frame);
+    }
+
+    /// Exponentially decayed time surface of the latest event of each pixel,
+    /// into @a surface of GetHeight() x GetWidth() elements, see
+    /// DVSEventKernels::ToTimeSurface.
+    void ToTimeSurface(std::int64_t reference_time, float decay_time, float *surface) const {
+      DVSEventKernels::ToTimeSurface(
+          data(), size(), GetWidth(), GetHeight(), reference_time, decay_time, surface);
+    }
+
+    /// Voxel grid of the polarities, into @a grid of @a bins x GetHeight() x
+    /// GetWidth() elements, see DVSEventKernels::ToVoxelGrid.
+    void ToVoxelGrid(size_t bins, float *grid) const {
+      DVSEventKernels::ToVoxelGrid(data(), size(), GetWidth(), GetHeight(), bins, grid);
+    }
+
+    /// Get all the events' columns in a single pass, into buffers of size()
+    /// elements. Any of them may be null to skip that column.
+    void ToColumns(
+        std::uint16_t *x,
+        std::uint16_t *y,
+        std::int64_t *t,
+        std::int16_t *pol) const {
+      DVSEventKernels::ToColumns(data(), size(), x, y, t, pol);
+    }
+
     /// Get the array of events in pure vector format
     std::vector<std::vector<std::int64_t>> ToArray() const {
       std::vector<std::vector<std::int64_t>> array;
+      array.reserve(size());
       for (const auto &event : *this) {
         array.push_back({static_cast<std::int64_t>(event.x), static_cast<std::int64_t>(event.y), static_cast<std::int64_t>(event.t), (2*static_cast<std::int64_t>(event.pol)) - 1});
       }
@@ -80,37 +109,29 @@ namespace data {
 
     /// Get all events' x coordinate for convenience
     std::vector<std::uint16_t> ToArrayX() const {
-      std::vector<std::uint16_t> array;
-      for (const auto &event : *this) {
-        array.push_back(event.x);
-      }
+      std::vector<std::uint16_t> array(size());
+      ToColumns(array.data(), nullptr, nullptr, nullptr);
       return array;
     }
 
     /// Get all events' y coordinate for convenience
     std::vector<std::uint16_t> ToArrayY() const {
-      std::vector<std::uint16_t> array;
-      for (const auto &event : *this) {
-        array.push_back(event.y);
-      }
+      std::vector<std::uint16_t> array(size());
+      ToColumns(nullptr, array.data(), nullptr, nullptr);
       return array;
     }
 
     /// Get all events' timestamp for convenience
     std::vector<std::int64_t> ToArrayT() const {
-      std::vector<std::int64_t> array;
-      for (const auto &event : *this) {
-        array.push_back(event.t);
-      }
+      std::vector<std::int64_t> array(size());
+      ToColumns(nullptr, nullptr, array.data(), nullptr);
       return array;
     }
 
     /// Get all events' polarity for convenience
     std::vector<short> ToArrayPol() const {
-      std::vector<short> array;
-      for (const auto &event : *this) {
-        array.push_back(2*static_cast<short>(event.pol) - 1);
-      }
+      std::vector<short> array(size());
+      ToColumns(nullptr, nullptr, nullptr, array.data());
       return array;
     }
 
@@ -0,0 +1,333 @@
+// Copyright (c) 2020 Robotics and Perception Group (GPR)
+// University of Zurich and ETH Zurich
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/sensor/data/DVSEventKernels.h"
+
+#include "carla/Debug.h"
+#include "carla/JobSystem.h"
+#include "carla/ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace carla {
+namespace sensor {
+namespace data {
+
+  /// Events handed to each job.
+  static constexpr size_t EVENTS_PER_JOB = 1u << 16u;
+
+  /// Minimum number of pixels of each band of rows.
+  static constexpr size_t PIXELS_PER_BAND = 1u << 16u;
+
+  // ===========================================================================
+  // -- EventBands -------------------------------------------------------------
+  // ===========================================================================
+
+  static bool IsInside(const DVSEvent &event, size_t width, size_t height) {
+    return (event.x < width) && (event.y < height);
+  }
+
+  static uint32_t MakeKey(const DVSEvent &event, size_t width) {
+    return static_cast<uint32_t>(2u * (width * event.y + event.x) + (event.pol ? 1u : 0u));
+  }
+
+  /// The events inside the image, grouped by bands of rows and in their
+  /// original order within each band. Each event is stored as its pixel index
+  /// and polarity, key = 2 * (width * y + x) + pol, and, only if requested,
+  /// its timestamp, so the bands are read sequentially.
+  ///
+  /// Without worker threads, or with a single chunk of events, the whole
+  /// image is a single band read directly from the events.
+  class EventBands {
+  public:
+
+    EventBands(
+        const DVSEvent *events,
+        size_t count,
+        size_t width,
+        size_t height,
+        bool with_times)
+      : _events(events),
+        _count(count),
+        _width(width),
+        _height(height),
+        _direct((count <= EVENTS_PER_JOB) || (JobSystem::Get().GetWorkerCount() == 0u)),
+        _rows_per_band(_direct ?
+            std::max<size_t>(1u, height) :
+            std::max<size_t>(1u, PIXELS_PER_BAND / std::max<size_t>(1u, width))),
+        _bands((height + _rows_per_band - 1u) / _rows_per_band) {
+      DEBUG_ASSERT(count <= std::numeric_limits<uint32_t>::max());
+      DEBUG_ASSERT(width * height <= std::numeric_limits<uint32_t>::max() / 2u);
+      if (_direct) {
+        if (with_times) {
+          for (size_t i = 0u; i < count; ++i) {
+            if (IsInside(events[i], width, height)) {
+              UpdateTimeRange(events[i].t, _min_time, _max_time);
+            }
+          }
+        }
+        return;
+      }
+      const size_t chunks = (count + EVENTS_PER_JOB - 1u) / EVENTS_PER_JOB;
+
+      // Count the events of each band in each chunk.
+      std::vector<uint32_t> positions(chunks * _bands, 0u);
+      std::vector<std::int64_t> min_times(chunks, std::numeric_limits<std::int64_t>::max());
+      std::vector<std::int64_t> max_times(chunks, std::numeric_limits<std::int64_t>::min());
+      ParallelFor(chunks, [&](const size_t chunk) {
+        uint32_t *histogram = positions.data() + chunk * _bands;
+        const size_t end = std::min(count, (chunk + 1u) * EVENTS_PER_JOB);
+        for (size_t i = chunk * EVENTS_PER_JOB; i < end; ++i) {
+          const DVSEvent &event = events[i];
+          if (IsInside(event, width, height)) {
+            ++histogram[event.y / _rows_per_band];
+            UpdateTimeRange(event.t, min_times[chunk], max_times[chunk]);
+          }
+        }
+      });
+
+      // Turn the counts into the position of the first event of each band
+      // and chunk, bands first so the chunks of a band are contiguous.
+      _offsets.resize(_bands + 1u);
+      size_t total = 0u;
+      for (size_t band = 0u; band < _bands; ++band) {
+        _offsets[band] = total;
+        for (size_t chunk = 0u; chunk < chunks; ++chunk) {
+          const uint32_t events_in_band = positions[chunk * _bands + band];
+          positions[chunk * _bands + band] = static_cast<uint32_t>(total);
+          total += events_in_band;
+        }
+      }
+      _offsets[_bands] = total;
+      for (size_t chunk = 0u; chunk < chunks; ++chunk) {
+        _min_time = std::min(_min_time, min_times[chunk]);
+        _max_time = std::max(_max_time, max_times[chunk]);
+      }
+
+      // Scatter the events, each chunk to its own slots.
+      _keys.resize(total);
+      if (with_times) {
+        _times.resize(total);
+      }
+      ParallelFor(chunks, [&](const size_t chunk) {
+        uint32_t *position = positions.data() + chunk * _bands;
+        const size_t end = std::min(count, (chunk + 1u) * EVENTS_PER_JOB);
+        for (size_t i = chunk * EVENTS_PER_JOB; i < end; ++i) {
+          const DVSEvent &event = events[i];
+          if (IsInside(event, width, height)) {
+            const uint32_t slot = position[event.y / _rows_per_band]++;
+            _keys[slot] = MakeKey(event, width);
+            if (with_times) {
+              _times[slot] = event.t;
+            }
+          }
+        }
+      });
+    }
+
+    /// Earliest timestamp of the events inside the image, only if requested.
+    std::int64_t GetMinTime() const {
+      return _min_time;
+    }
+
+    /// Latest timestamp of the events inside the image, only if requested.
+    std::int64_t GetMaxTime() const {
+      return _max_time;
+    }
+
+    /// Calls @a functor(first_row, end_row, for_each_event) for each band, in
+    /// parallel. for_each_event(callback) calls callback(key, time) for each
+    /// event of the band in order, time is zero if not requested.
+    template <typename FunctorT>
+    void ForEachBand(FunctorT &&functor) const {
+      if (_direct) {
+        functor(0u, _height, [this](auto &&callback) {
+          for (size_t i = 0u; i < _count; ++i) {
+            const DVSEvent &event = _events[i];
+            if (IsInside(event, _width, _height)) {
+              callback(MakeKey(event, _width), static_cast<std::int64_t>(event.t));
+            }
+          }
+        });
+        return;
+      }
+      ParallelFor(_bands, [&](const size_t band) {
+        const size_t first_row = band * _rows_per_band;
+        const size_t begin = _offsets[band];
+        const size_t end = _offsets[band + 1u];
+        functor(first_row, std::min(_height, first_row + _rows_per_band), [&](auto &&callback) {
+          for (size_t i = begin; i < end; ++i) {
+            callback(_keys[i], _times.empty() ? std::int64_t(0) : _times[i]);
+          }
+        });
+      });
+    }
+
+  private:
+
+    static void UpdateTimeRange(std::int64_t time, std::int64_t &min_time, std::int64_t &max_time) {
+      min_time = std::min(min_time, time);
+      max_time = std::max(max_time, time);
+    }
+
+    const DVSEvent *_events;
+
+    const size_t _count;
+
+    const size_t _width;
+
+    const size_t _height;
+
+    const bool _direct;
+
+    const size_t _rows_per_band;
+
+    const size_t _bands;
+
+    std::vector<size_t> _offsets;
+
+    std::vector<uint32_t> _keys;
+
+    std::vector<std::int64_t> _times;
+
+    std::int64_t _min_time = std::numeric_limits<std::int64_t>::max();
+
+    std::int64_t _max_time = std::numeric_limits<std::int64_t>::min();
+  };
+
+  // ===========================================================================
+  // -- DVSEventKernels --------------------------------------------------------
+  // ===========================================================================
+
+  void DVSEventKernels::ToColumns(
+      const DVSEvent *events,
+      const size_t count,
+      std::uint16_t *x,
+      std::uint16_t *y,
+      std::int64_t *t,
+      std::int16_t *pol) {
+    const size_t chunks = (count + EVENTS_PER_JOB - 1u) / EVENTS_PER_JOB;
+    ParallelFor(chunks, [=](const size_t chunk) {
+      const size_t end = std::min(count, (chunk + 1u) * EVENTS_PER_JOB);
+      for (size_t i = chunk * EVENTS_PER_JOB; i < end; ++i) {
+        const DVSEvent &event = events[i];
+        if (x != nullptr) {
+          x[i] = event.x;
+        }
+        if (y != nullptr) {
+          y[i] = event.y;
+        }
+        if (t != nullptr) {
+          t[i] = event.t;
+        }
+        if (pol != nullptr) {
+          pol[i] = static_cast<std::int16_t>(2 * static_cast<std::int16_t>(event.pol) - 1);
+        }
+      }
+    });
+  }
+
+  void DVSEventKernels::ToImage(
+      const DVSEvent *events,
+      const size_t count,
+      const size_t width,
+      const size_t height,
+      Color *image) {
+    EventBands bands(events, count, width, height, false);
+    bands.ForEachBand([&](size_t first_row, size_t end_row, auto &&for_each_event) {
+      std::fill(image + first_row * width, image + end_row * width, Color());
+      for_each_event([&](uint32_t key, std::int64_t) {
+        Color &pixel = image[key / 2u];
+        if (key & 1u) {
+          // Blue is positive
+          pixel.b = 255u;
+        } else {
+          // Red is negative
+          pixel.r = 255u;
+        }
+      });
+    });
+  }
+
+  void DVSEventKernels::ToEventFrame(
+      const DVSEvent *events,
+      const size_t count,
+      const size_t width,
+      const size_t height,
+      std::int32_t *frame) {
+    EventBands bands(events, count, width, height, false);
+    bands.ForEachBand([&](size_t first_row, size_t end_row, auto &&for_each_event) {
+      std::fill(frame + first_row * width, frame + end_row * width, 0);
+      for_each_event([&](uint32_t key, std::int64_t) {
+        frame[key / 2u] += 2 * static_cast<std::int32_t>(key & 1u) - 1;
+      });
+    });
+  }
+
+  void DVSEventKernels::ToTimeSurface(
+      const DVSEvent *events,
+      const size_t count,
+      const size_t width,
+      const size_t height,
+      const std::int64_t reference_time,
+      const float decay_time,
+      float *surface) {
+    constexpr auto NO_EVENT = std::numeric_limits<std::int64_t>::min();
+    EventBands bands(events, count, width, height, true);
+    bands.ForEachBand([&](size_t first_row, size_t end_row, auto &&for_each_event) {
+      const size_t offset = first_row * width;
+      std::vector<std::int64_t> latest((end_row - first_row) * width, NO_EVENT);
+      for_each_event([&](uint32_t key, std::int64_t time) {
+        latest[key / 2u - offset] = time;
+      });
+      for (size_t i = 0u; i < latest.size(); ++i) {
+        surface[offset + i] = (latest[i] == NO_EVENT) ?
+            0.0f :
+            std::exp(static_cast<float>(latest[i] - reference_time) / decay_time);
+      }
+    });
+  }
+
+  void DVSEventKernels::ToVoxelGrid(
+      const DVSEvent *events,
+      const size_t count,
+      const size_t width,
+      const size_t height,
+      const size_t bins,
+      float *grid) {
+    if (bins == 0u) {
+      return;
+    }
+    EventBands bands(events, count, width, height, true);
+    const size_t plane = width * height;
+    const std::int64_t min_time = bands.GetMinTime();
+    const std::int64_t span = bands.GetMaxTime() > min_time ? bands.GetMaxTime() - min_time : 0;
+    const double scale = span > 0 ? static_cast<double>(bins - 1u) / static_cast<double>(span) : 0.0;
+    bands.ForEachBand([&](size_t first_row, size_t end_row, auto &&for_each_event) {
+      for (size_t bin = 0u; bin < bins; ++bin) {
+        float *rows = grid + bin * plane;
+        std::fill(rows + first_row * width, rows + end_row * width, 0.0f);
+      }
+      for_each_event([&](uint32_t key, std::int64_t time) {
+        const double position = scale * static_cast<double>(time - min_time);
+        const size_t bin = std::min(static_cast<size_t>(position), bins - 1u);
+        const float weight = static_cast<float>(position - static_cast<double>(bin));
+        const float polarity = (key & 1u) ? 1.0f : -1.0f;
+        float *voxel = grid + bin * plane + key / 2u;
+        voxel[0u] += polarity * (1.0f - weight);
+        if (bin + 1u < bins) {
+          voxel[plane] += polarity * weight;
+        }
+      });
+    });
+  }
+
+} // namespace data
+} // namespace sensor
+} // namespace carla
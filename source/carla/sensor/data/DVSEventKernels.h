@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Robotics and Perception Group (GPR)
+// University of Zurich and ETH Zurich
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/sensor/data/Color.h"
+#include "carla/sensor/data/DVSEvent.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace carla {
+namespace sensor {
+namespace data {
+
+  /// Bulk conversions of DVS events into columns and accumulated images.
+  ///
+  /// Events are split in chunks between the threads of the shared JobSystem.
+  /// The image kernels first bucket the events of each chunk by bands of
+  /// rows, then accumulate every band on its own thread, keeping the order of
+  /// the events, so the result is the same as a serial pass. Events outside
+  /// the image are ignored. Output buffers are provided by the caller, have
+  /// row-major layout and are fully overwritten.
+  class DVSEventKernels {
+  public:
+
+    /// Writes the x, y, timestamp and polarity (-1 or 1) of @a count events
+    /// into buffers of @a count elements, in a single pass. Any of the
+    /// buffers may be null to skip that column.
+    static void ToColumns(
+        const DVSEvent *events,
+        size_t count,
+        std::uint16_t *x,
+        std::uint16_t *y,
+        std::int64_t *t,
+        std::int16_t *pol);
+
+    /// Event image of @a width x @a height pixels, blue where there is a
+    /// positive event and red where there is a negative one.
+    static void ToImage(
+        const DVSEvent *events,
+        size_t count,
+        size_t width,
+        size_t height,
+        Color *image);
+
+    /// Sum of the polarities of the events of each pixel.
+    static void ToEventFrame(
+        const DVSEvent *events,
+        size_t count,
+        size_t width,
+        size_t height,
+        std::int32_t *frame);
+
+    /// Exponentially decayed time surface, exp((t - @a reference_time) /
+    /// @a decay_time) with t the timestamp of the latest event of each pixel,
+    /// and zero for pixels without events. Times are in the units of
+    /// DVSEvent::t.
+    static void ToTimeSurface(
+        const DVSEvent *events,
+        size_t count,
+        size_t width,
+        size_t height,
+        std::int64_t reference_time,
+        float decay_time,
+        float *surface);
+
+    /// Voxel grid of @a bins x @a height x @a width. The time span of the
+    /// events is split in @a bins, and the polarity of each event is shared
+    /// between its two nearest bins.
+    static void ToVoxelGrid(
+        const DVSEvent *events,
+        size_t count,
+        size_t width,
+        size_t height,
+        size_t bins,
+        float *grid);
+  };
+
+} // namespace data
+} // namespace sensor
+} // namespace carla
@@ -235,15 +235,24 @@ void TrafficManagerLocal::Run() {
 
     registration_lock.unlock();
 
-    // Sending the current cycle's batch command to the simulator.
+    // Sending the current cycle's batch command to the simulator in a single
+    // call, the vehicle controls packed and the rest, e.g. the light states,
+    // after them as usual. If the server does not handle packed batches, the
+    // whole frame goes in a single batch, in order.
+    if (synchronous_mode || control_frame.size() > 0) {
+      packed_control_frame.clear();
+      for (const auto &command : control_frame) {
+        packed_control_frame.Append(command);
+      }
+      auto simulator = episode_proxy.Lock();
+      if (packed_control_frame.empty() ||
+          !simulator->TryApplyPackedBatchSync(packed_control_frame, false)) {
+        simulator->ApplyBatchSync(control_frame, false);
+      }
+    }
     if (synchronous_mode) {
-      episode_proxy.Lock()->ApplyBatchSync(control_frame, false);
       step_end.store(true);
       step_end_trigger.notify_one();
-    } else {
-      if (control_frame.size() > 0){
-        episode_proxy.Lock()->ApplyBatchSync(control_frame, false);
-      }
     }
   }
 }
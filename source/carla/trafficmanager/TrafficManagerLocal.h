@@ -17,6 +17,7 @@
 #include "carla/client/World.h"
 #include "carla/Memory.h"
 #include "carla/rpc/Command.h"
+#include "carla/rpc/PackedCommandBatch.h"
 
 #include "carla/trafficmanager/AtomicActorSet.h"
 #include "carla/trafficmanager/InMemoryMap.h"
@@ -86,6 +87,8 @@ private:
   TLFrame tl_frame;
   /// Array to hold output data of motion planning.
   ControlFrame control_frame;
+  /// The control frame as sent, the vehicle controls packed.
+  carla::rpc::PackedCommandBatch packed_control_frame;
   /// Variable to keep track of currently reserved array space for frames.
   uint64_t current_reserved_capacity {0u};
   /// Various stages representing core operations of traffic manager.